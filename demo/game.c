@@ -6,39 +6,69 @@
 #include <time.h>
 
 #include "asset.h"
+#include "ai_field.h"
+#include "ai_items.h"
 #include "asset_cache.h"
-#include "background.h"
 #include "car.h"
 #include "checkpoints.h"
 #include "collision.h"
 #include "forces.h"
+#include "ghost.h"
+#include "item_pool.h"
+#include "kart_store.h"
+#include "lap_timer.h"
 #include "power_up.h"
+#include "replay.h"
+#include "rubber_band.h"
 #include "sdl_wrapper.h"
+#include "standings.h"
+#include "track.h"
+#include "track_registry.h"
 #include <SDL2/SDL_mixer.h>
 
 typedef enum { MENU, SETTINGS, RACE, PAUSE } game_state_t;
-const double SCALE_CONST = 29875.0;
-const size_t NUM_MENU_BUTTONS = 4;
-const double G = 9.81;
+const size_t NUM_MENU_BUTTONS = 6;
 const char *BACKGROUND_PATH = "assets/frogger-background.png";
-const char *MINIMAP_PATH = "assets/minimap.png";
-const double TRACK_MU = 2;
 const double CAR_ELASTICITY = 2.5;
 const size_t NUM_CARS = 3;
+// The size of the field the player races against. Against a ghost the
+// player races alone.
+const size_t NUM_AI_KARTS = 8;
 const double WALL_ELASTICITY = 1;
-double AI_PATH_TOLERANCE = 0.2;
-double STAR_MULTIPLIER = 1.2;
+// The controls each arrow key drives with, in the order of their actions
+const car_controls_t ARROW_CONTROLS[] = {{.throttle = 0, .steer = 1},
+                                         {.throttle = 1, .steer = 0},
+                                         {.throttle = 0, .steer = -1},
+                                         {.throttle = -1, .steer = 0}};
 
 double EASY_AI_SPEED = 250;
 double MED_AI_SPEED = 300;
 double HARD_AI_SPEED = 350;
+// The fraction of its racing line's speed profile the front of the AI grid
+// holds. Each kart further back is a little slower, so the field spreads out.
+double EASY_AI_SKILL = 0.8;
+double MED_AI_SKILL = 0.9;
+double HARD_AI_SKILL = 1.0;
+const double AI_SKILL_SPREAD = 0.1;
+// How long each frame the AI karts may spend looking for obstacles, in
+// microseconds
+const double AI_PERCEPTION_BUDGET = 250;
+// How far the AI karts' skills are stretched to keep them near the player:
+// up to 10% faster when well behind, and 15% slower when well ahead
+const rubber_band_config_t AI_RUBBER_BAND = {.max_scale = 1.1,
+                                             .min_scale = 0.85,
+                                             .gap_range = 1500,
+                                             .response = 0.5,
+                                             .rate = 2};
 size_t NUM_VILLAINS = 4;
 
 const vector_t MIN = {0, 0};
 const vector_t MAX = {1000, 500};
-const vector_t SPAWN_POS = {600, 200};
+// Where on screen the player's kart is held while the track scrolls under it
+const vector_t CAMERA_POS = {600, 200};
 const SDL_Rect CAR_BOX = {.x = 350, .y = 175, .w = 50, .h = 100};
 const SDL_Rect CAR_STATS_BOX = {.x = 450, .y = 160, .w = 234, .h = 175};
+const SDL_Rect TRACK_NAME_BOX = {.x = 750, .y = 200, .w = 200, .h = 40};
 const SDL_Rect VILLAIN_CHOOSER_BOX = {.x = 50, .y = 100, .w = 300, .h = 111};
 const char *VILLAIN_CHOOSER_PATHS[] = {
     "assets/easy_ai.png", "assets/mid_ai.png", "assets/hard_ai.png",
@@ -46,7 +76,6 @@ const char *VILLAIN_CHOOSER_PATHS[] = {
 
 const SDL_Rect GAME_LOGO = {.x = 335, .y = 10, .w = 330, .h = 150};
 const char *MENU_BACKGROUND_PATH = "assets/background.png";
-const char *GAME_BACKGROUND_PATH = "assets/new_track.png";
 const char *GAME_LOGO_PATH = "assets/caltech_karts_logo.png";
 const char *CAR_STAT_PATHS[] = {"assets/f1_car_menu.png",
                                 "assets/golf_cart_menu.png",
@@ -58,23 +87,23 @@ const char *LAP_NO_PATHS[] = {
 };
 const size_t NO_LAPS = 3;
 const SDL_Rect LAP_BOX = {.x = 20, .y = 280, .w = 180, .h = 60};
-const double WALL_WIDTH = 50.0;
 const double MINIMAP_SCALE = 0.02;
 const double MINI_CAR_RADIUS = 50;
 
-const size_t NUM_BOXES = 3;
 const double SHROOM_DURATION = 5;
 const double STAR_DURATION = 10;
 const double REVERSE_DURATION = 10;
+// The race clock's slots cover a few seconds of frames, about as long as the
+// power ups last
+const double RACE_TIMER_TICK = 1.0 / 60;
+const size_t RACE_TIMER_SLOTS = 512;
+// The race is simulated in steps of a fixed length, however long frames
+// take, and at most this many steps a frame; a slower frame slows the race
+// down rather than stalling it
+const double PHYSICS_DT = 1.0 / 60;
+const size_t MAX_PHYSICS_STEPS = 8;
 const double ITEM_DISTANCE = 50; // how an item should be placed
 const double SHELL_ROT_SPEED = 6.0;
-const double STUN_ROT_SPEED = 2 * M_PI;
-
-const vector_t START_IN = {408, 200};
-const vector_t START_OUT = {640, 200};
-const size_t START_OFFSET = 3;
-const vector_t AI_START_OFFSET = {-120, 0};
-const double MAX_W = M_PI / 32;
 
 const char *WRONG_WAY_IMAGE_PATH = "assets/wrong_way.png";
 const char *WRONG_WAY_ARROW_IMAGE_PATH = "assets/wrong_way_arrow.png";
@@ -84,10 +113,24 @@ const double WRONG_WAY_OFFSET = 60;
 
 const char *GAME_FONT_PATH = "assets/RetroMario-Regular.ttf";
 const vector_t TIME_POSITION = {50, 250};
+const SDL_Rect STANDINGS_BOX = {.x = 50, .y = 200, .w = 100, .h = 100};
+const SDL_Rect DELTA_BOX = {.x = 50, .y = 340, .w = 100, .h = 40};
+const char *ORDINAL_SUFFIXES[] = {"th", "st", "nd", "rd"};
+const char *BOX_PATH = "assets/box.png";
+const char *SHELL_PATH = "assets/shell.png";
+const char *SHROOM_PATH = "assets/mushroom.png";
+const char *STAR_PATH = "assets/star.png";
+const char *BOOST_PATH = "assets/boost_pad.png";
+const char *SCRAMBLE_PATH = "assets/reverse_controls.png";
+const SDL_Rect ITEM_BOUNDING_BOX = {900, 400, 100, 100};
 
 const char *GAME_MUSIC = "assets/game_music.wav";
 const char *MENU_MUSIC = "assets/menu_music.wav";
 const char *STAR_MUSIC = "assets/star_music.wav";
+// Environment variables naming the file every race is recorded to, and a
+// recorded race to play back instead of showing the menu
+const char *RECORD_ENV = "CK_RECORD";
+const char *REPLAY_ENV = "CK_REPLAY";
 
 SDL_Rect WINDOW = {
     .x = MIN.x, .y = MIN.y, .w = MAX.x - MIN.x, .h = MAX.y - MIN.y};
@@ -97,6 +140,8 @@ void start_race(state_t *state);
 void open_settings(state_t *state);
 void prev_car(state_t *state);
 void next_car(state_t *state);
+void prev_track(state_t *state);
+void next_track(state_t *state);
 void next_villain(state_t *state);
 void prev_villain(state_t *state);
 void restart_game(state_t *state);
@@ -149,7 +194,25 @@ button_info_t MENU_BUTTON_TEMPLATES[] = {
      .text_box = (SDL_Rect){CAR_BOX.x - 20, CAR_BOX.y + CAR_BOX.h + 20, 40, 40},
      .text_color = (rgb_color_t){255, 255, 255},
      .text = NULL,
-     .handler = (void *)prev_car}};
+     .handler = (void *)prev_car},
+    {.image_path = "assets/right_arrow.png",
+     .font_path = NULL,
+     .image_box = (SDL_Rect){TRACK_NAME_BOX.x + 130, TRACK_NAME_BOX.y + 50,
+                             40, 40},
+     .text_box = (SDL_Rect){TRACK_NAME_BOX.x + 130, TRACK_NAME_BOX.y + 50, 0,
+                            0},
+     .text_color = (rgb_color_t){255, 255, 255},
+     .text = NULL,
+     .handler = (void *)next_track},
+    {.image_path = "assets/left_arrow.png",
+     .font_path = NULL,
+     .image_box = (SDL_Rect){TRACK_NAME_BOX.x + 30, TRACK_NAME_BOX.y + 50, 40,
+                             40},
+     .text_box = (SDL_Rect){TRACK_NAME_BOX.x + 30, TRACK_NAME_BOX.y + 50, 0,
+                            0},
+     .text_color = (rgb_color_t){255, 255, 255},
+     .text = NULL,
+     .handler = (void *)prev_track}};
 
 button_info_t HOME_BUTTON = {.image_path = "assets/home.png",
                              .font_path = NULL,
@@ -184,6 +247,9 @@ button_info_t SETTINGS_BUTTONS_TEMPLATES[] = {
 
 struct state {
   double time;
+  // The time that has passed in the race that it has not been stepped
+  // through yet, less than PHYSICS_DT
+  double step_time;
   list_t *body_assets;
   list_t *lap_numbers;
   list_t *car_stats;
@@ -194,33 +260,57 @@ struct state {
   asset_t *logo;
   car_type_t car_type;
   villain_type_t villain_type;
+  size_t track_idx;
   list_t *settings_buttons;
   body_t *car;
-  body_t *villain;
+  // The player's kart, then the AI karts in the order of the AI field
+  list_t *karts;
+  // The karts' state, with each kart's ID its place in karts
+  kart_store_t *kart_store;
+  ai_field_t *ai_field;
+  ai_items_t *ai_items;
+  rubber_band_t *rubber_band;
   asset_t *wrong_way_arrow;
   scene_t *scene;
+  track_t *track;
+  standings_t *standings;
   asset_t *bg;
-  double villain_speed;
   checkpoint_state_t *checkpoint_state;
   game_state_t game_state;
   list_t *menu_buttons;
   asset_t *mini_map;
   asset_t *wrong_way;
+  // Whether the player was going the wrong way at the last physics step
+  bool going_wrong_way;
   asset_t *mini_car;
-  asset_t *mini_villain;
-  list_t *inside_walls;
-  list_t *outside_walls;
+  list_t *mini_villains;
   asset_t *home_button;
   asset_t *instructions;
   bool *switches;
-  list_t *boxes;
-  list_t *shells;
+  // The item boxes, and the items the karts have put on the road
+  item_pool_t *items;
+  // The race's clock, which the power ups' effects and the boxes' refills
+  // are timed by, and the timer that ends the player's star music
+  timer_wheel_t *timers;
+  timer_id_t star_timer;
   size_t *key_mapping;
   Mix_Chunk *menu_music;
   Mix_Chunk *game_music;
   Mix_Chunk *star_music;
   double best_time;
-  double lap_time;
+  lap_timer_t *lap_timer;
+  // The fastest lap saved for the track, which is raced against in ghost
+  // mode, and the player's current lap
+  ghost_t *ghost;
+  ghost_player_t *ghost_player;
+  ghost_t *ghost_recording;
+  asset_t *ghost_car;
+  asset_t *mini_ghost;
+  // The race being recorded and where to save it, and the race being played
+  // back, or NULL
+  replay_t *recording;
+  const char *record_path;
+  replay_t *replay;
 };
 
 asset_t *create_button_from_info(state_t *state, button_info_t info) {
@@ -245,77 +335,103 @@ asset_t *create_button_from_info(state_t *state, button_info_t info) {
   return button;
 }
 
-list_t *inside_walls() {
-  list_t *points = inside_walls_points(WALL_WIDTH);
-  size_t size = list_size(points);
-  list_t *inside_walls = list_init(size, NULL);
-  for (size_t i = 0; i < size; i++) {
-    body_t *body = body_init(list_get(points, i), INFINITY, get_blue());
-    list_add(inside_walls, body);
+/**
+ * Saves and stops the recording of the current race, if there is one.
+ */
+void save_recording(state_t *state) {
+  if (state->recording == NULL) {
+    return;
   }
-  return inside_walls;
-}
-
-list_t *outside_walls() {
-  list_t *points = outside_walls_points(WALL_WIDTH);
-  size_t size = list_size(points);
-  list_t *outside_walls = list_init(size, NULL);
-  for (size_t i = 0; i < size; i++) {
-    body_t *body = body_init(list_get(points, i), INFINITY, get_blue());
-    list_add(outside_walls, body);
+  if (replay_write(state->recording, state->record_path)) {
+    printf("Recorded %zu ticks to %s\n", replay_size(state->recording),
+           state->record_path);
+  } else {
+    fprintf(stderr, "Could not write replay '%s'\n", state->record_path);
   }
-  return outside_walls;
+  replay_free(state->recording);
+  state->recording = NULL;
 }
 
 void race_free(state_t *state) {
+  save_recording(state);
   // remember to set things to null after freeing
   for (size_t i = 0; i < list_size(state->body_assets); i++) {
     body_remove(asset_get_body(list_get(state->body_assets, i)));
   }
   list_free(state->body_assets);
-  for (size_t i = 0; i < list_size(state->shells); i++) {
-    body_remove(asset_get_body(list_get(state->shells, i)));
-  }
-  list_free(state->shells);
-  for (size_t i = 0; i < list_size(state->boxes); i++) {
-    body_remove(asset_get_body(list_get(state->boxes, i)));
-  }
-  list_free(state->boxes);
+  item_pool_free(state->items);
+  state->items = NULL;
+  timer_wheel_free(state->timers);
+  state->timers = NULL;
+  standings_free(state->standings);
+  state->standings = NULL;
+  lap_timer_free(state->lap_timer);
+  state->lap_timer = NULL;
   state->bg = NULL;
   state->car = NULL;
-  state->villain = NULL;
+  list_free(state->karts);
+  state->karts = NULL;
+  // Freed once the scene has freed the karts' bodies
+  kart_store_free(state->kart_store);
+  state->kart_store = NULL;
+  ai_items_free(state->ai_items);
+  state->ai_items = NULL;
+  rubber_band_free(state->rubber_band);
+  state->rubber_band = NULL;
+  ai_field_free(state->ai_field);
+  state->ai_field = NULL;
   body_remove(asset_get_body(state->mini_map));
   asset_destroy(state->mini_map);
   state->mini_map = NULL;
   body_remove(asset_get_body(state->mini_car));
   asset_destroy(state->mini_car);
   state->mini_car = NULL;
-  body_remove(asset_get_body(state->mini_villain));
-  asset_destroy(state->mini_villain);
-  state->mini_villain = NULL;
+  for (size_t i = 0; i < list_size(state->mini_villains); i++) {
+    body_remove(asset_get_body(list_get(state->mini_villains, i)));
+  }
+  list_free(state->mini_villains);
+  state->mini_villains = NULL;
+  if (state->ghost_car != NULL) {
+    body_remove(asset_get_body(state->ghost_car));
+    asset_destroy(state->ghost_car);
+    state->ghost_car = NULL;
+    body_remove(asset_get_body(state->mini_ghost));
+    asset_destroy(state->mini_ghost);
+    state->mini_ghost = NULL;
+  }
+  if (state->ghost != NULL) {
+    ghost_player_free(state->ghost_player);
+    ghost_free(state->ghost);
+    state->ghost_player = NULL;
+    state->ghost = NULL;
+  }
+  ghost_free(state->ghost_recording);
+  state->ghost_recording = NULL;
 
   return;
 }
 
-body_t *background() {
-  return body_init(background_list(), INFINITY, get_blue());
+body_t *background(track_t *track) {
+  return body_init(track_make_background(track), INFINITY, get_blue());
 }
 
-void use_item(state_t *state) {
-  body_t *car = state->car;
+/**
+ * The timer callback that puts the race music back on when the player's
+ * star wears off.
+ */
+void end_star_music(void *aux) {
+  state_t *state = aux;
+  state->star_timer = NO_TIMER;
+  Mix_HaltChannel(0);
+  Mix_PlayChannel(0, state->game_music, -1);
+}
+
+/**
+ * Uses a kart's item, which may be the player's or an AI kart's.
+ */
+void use_item(state_t *state, body_t *car) {
   if (car_has_shell(car)) {
-    power_up_info_t info = car_get_powerup_state(car);
-    body_t *shell = info.shell;
-    info.shell = NULL;
-    car_set_powerup_state(car, info);
-    create_stun_collision(state->scene, car, shell, 1.0);
-    size_t size = list_size(state->inside_walls);
-    for (size_t i = 0; i < size; i++) {
-      create_physics_collision(state->scene, list_get(state->inside_walls, i),
-                               shell, WALL_ELASTICITY);
-      create_physics_collision(state->scene, list_get(state->outside_walls, i),
-                               shell, WALL_ELASTICITY);
-    }
+    item_pool_throw_shell(state->items, car);
     return;
   }
   power_up_info_t info = car_get_powerup_state(car);
@@ -327,7 +443,7 @@ void use_item(state_t *state) {
     break;
   }
   case SHROOM: {
-    info.fast = fmax(info.fast, SHROOM_DURATION);
+    car_start_effect(car, state->timers, EFFECT_FAST, SHROOM_DURATION);
     vector_t vel = body_get_velocity(car);
     if (vec_get_length(vel) == 0) {
       vel = direction;
@@ -341,67 +457,48 @@ void use_item(state_t *state) {
     break;
   }
   case STAR: {
-    Mix_HaltChannel(0);
-    Mix_PlayChannel(0, state->star_music, -1);
-    info.immune = STAR_DURATION;
+    if (car == state->car) {
+      Mix_HaltChannel(0);
+      Mix_PlayChannel(0, state->star_music, -1);
+      timer_wheel_cancel(state->timers, state->star_timer);
+      state->star_timer = timer_wheel_schedule(state->timers, STAR_DURATION,
+                                               end_star_music, state);
+    }
+    car_start_effect(car, state->timers, EFFECT_IMMUNE, STAR_DURATION);
     vector_t vel = body_get_velocity(car);
     if (vec_get_length(vel) == 0) {
       vel = direction;
     }
     vel = vec_multiply(
-        STAR_MULTIPLIER * car_get_top_speed(car) / vec_get_length(vel), vel);
+        get_star_multiplier() * car_get_top_speed(car) / vec_get_length(vel),
+        vel);
     body_add_impulse(car,
                      vec_multiply(body_get_mass(car),
                                   vec_subtract(vel, body_get_velocity(car))));
     break;
   }
   case REVERSE: {
-    info.reverse = REVERSE_DURATION;
+    // Only the player has controls to scramble
+    car_start_effect(state->car, state->timers, EFFECT_REVERSE,
+                     REVERSE_DURATION);
     printf("CONTROLS SCRAMBLED!\n");
     permute(state->key_mapping, 4);
     break;
   }
   case FAKE: {
-    vector_t center = vec_subtract(body_get_centroid(state->car),
+    vector_t center = vec_subtract(body_get_centroid(car),
                                    vec_multiply(ITEM_DISTANCE, direction));
-    asset_t *box = make_box(center);
-    list_add(state->body_assets, box);
-    scene_add_body(state->scene, asset_get_body(box));
-    create_stun_collision(state->scene, state->car, asset_get_body(box),
-                          3.0); // constant over 2
-    create_stun_collision(state->scene, state->villain, asset_get_body(box),
-                          3.0); // constant over 2
+    item_pool_add_fake(state->items, center);
     break;
   }
   case SHELL: {
-    vector_t center = vec_subtract(body_get_centroid(state->car),
-                                   vec_multiply(ITEM_DISTANCE, direction));
-    asset_t *shell = make_shell(center, theta, SHELL_ROT_SPEED);
-    body_t *body = asset_get_body(shell);
-    info.shell = body;
-    scene_add_body(state->scene, body);
-    size_t size = list_size(state->shells);
-    for (ssize_t i = 0; i < size; i++) {
-      body_t *curr = asset_get_body(list_get(state->shells, i));
-      if (curr == NULL) {
-        list_remove(state->shells, i);
-        i--;
-        size--;
-      } else {
-        create_shell_collision(state->scene, curr, body);
-      }
-    }
-    list_add(state->shells, shell);
-    create_stun_collision(state->scene, state->villain, body,
-                          1.0); // constant under 2
+    item_pool_add_shell(state->items, car, theta, SHELL_ROT_SPEED);
+    // Keep the pool's mark when the item is cleared below
+    info.shell = true;
     break;
   }
   case BOOST: {
-    asset_t *boost = make_boost(state->car);
-    body_t *body = asset_get_body(boost);
-    scene_add_body(state->scene, body);
-    list_add(state->body_assets, boost);
-    create_boost_collision(state->scene, state->car, body);
+    item_pool_add_boost(state->items, car);
     break;
   }
   default:
@@ -411,134 +508,164 @@ void use_item(state_t *state) {
   car_set_powerup_state(car, info);
 }
 
-/* KEY HANDLER */
-void on_key(char key, key_event_type_t type, double held_time, state_t *state) {
-  if (state->game_state != RACE) {
-    return;
-  }
+/**
+ * Sets the player's controls from the arrow keys held this tick, and uses or
+ * flips its item when the key has just been pressed.
+ */
+void apply_input(state_t *state, const input_snapshot_t *input) {
   body_t *car = state->car;
-  vector_t vel = body_get_velocity(car);
-  power_up_info_t car_powerups = car_get_powerup_state(state->car);
-  if (car_powerups.stun > 0) {
+  car_controls_t controls = {.throttle = 0, .steer = 0};
+  if (car_has_effect(car, EFFECT_STUN)) {
+    car_set_controls(car, controls);
     return;
   }
-  double multiplier = 1;
-  if (car_powerups.fast > 0) {
-    multiplier = get_speed_multiplier();
-  } else if (car_powerups.immune > 0) {
-    multiplier = STAR_MULTIPLIER;
-  }
-  double speed = vec_get_length(vel);
-  double theta = body_get_rotation(car);
-  vector_t direction = {.x = sin(theta), .y = -cos(theta)};
-  double top_speed = multiplier * car_get_top_speed(car);
-  double turining_radius =
-      vec_get_length(vel) * vec_get_length(vel) / (car_get_friction(car) * G);
-  if (key < 5 && car_get_powerup_state(state->car).reverse > 0) {
-    key = state->key_mapping[key - 1] + 1;
-  }
-  if (type == KEY_PRESSED) {
-    switch (key) {
-    case UP_ARROW: {
-      if (speed <= top_speed) {
-        vector_t acceleration =
-            vec_multiply(car_get_acceleration(car) * held_time, direction);
-        vel = vec_add(vel, acceleration);
-      } else {
-        vel = vec_multiply(top_speed / speed, vel);
-      }
-      break;
-    }
-    case DOWN_ARROW: {
-      if (speed <= top_speed) {
-        vector_t acceleration =
-            vec_multiply(car_get_acceleration(car) * held_time, direction);
-        vel = vec_subtract(vel, acceleration);
-      } else {
-        vel = vec_multiply(top_speed / speed, vel);
-      }
-      break;
-    }
-    case LEFT_ARROW: {
-      if (vel.x == 0 && vel.y == 0) {
-        break;
-      }
-      double dtheta =
-          sqrt(car_get_friction(car) * G / turining_radius) * held_time;
-      if (dtheta > MAX_W) {
-        dtheta = MAX_W;
-      }
-      body_set_rotation(car, body_get_rotation(car) + dtheta);
-      break;
+  for (action_t action = ACTION_LEFT; action <= ACTION_BACK; action++) {
+    if (!input_is_held(input, action)) {
+      continue;
     }
-    case RIGHT_ARROW: {
-      if (vel.x == 0 && vel.y == 0) {
-        break;
-      }
-      double dtheta =
-          sqrt(car_get_friction(car) * G / turining_radius) * held_time;
-      if (dtheta > MAX_W) {
-        dtheta = MAX_W;
-      }
-      body_set_rotation(car, body_get_rotation(car) - dtheta);
-      break;
-    }
-    case SPACE_BAR: {
-      use_item(state);
-      break;
-    }
-    case R: {
-      if (car_has_shell(car)) {
-        flip_shell(car_get_powerup_state(car).shell);
-      }
-      break;
+    size_t control = car_has_effect(car, EFFECT_REVERSE)
+                         ? state->key_mapping[action]
+                         : action;
+    controls.throttle += ARROW_CONTROLS[control].throttle;
+    controls.steer += ARROW_CONTROLS[control].steer;
+  }
+  car_set_controls(car, controls);
+  if (input_was_pressed(input, ACTION_ITEM)) {
+    use_item(state, car);
+  }
+  if (input_was_pressed(input, ACTION_FLIP) && car_has_shell(car)) {
+    item_pool_flip_shell(state->items, car);
+  }
+}
+
+/**
+ * Keeps the track origin in sync with the background after the scene has been
+ * re-centered, then updates each car's progress along the track.
+ */
+void update_track_progress(state_t *state) {
+  vector_t center = vec_multiply(
+      0.5, vec_add(track_get_min(state->track), track_get_max(state->track)));
+  track_set_origin(state->track,
+                   vec_subtract(body_get_centroid(asset_get_body(state->bg)),
+                                center));
+  kart_progress_t *progress = kart_store_get_progress(state->kart_store);
+  for (size_t i = 0; i < list_size(state->karts); i++) {
+    checkpoint_state_update(progress[i].checkpoint_state,
+                            list_get(state->karts, i));
+  }
+}
+
+/**
+ * Returns the pose of the player's kart in track coordinates.
+ */
+ghost_pose_t get_player_pose(state_t *state) {
+  vector_t position = vec_subtract(body_get_centroid(state->car),
+                                   track_get_origin(state->track));
+  return (ghost_pose_t){.position = position,
+                        .rotation = body_get_rotation(state->car)};
+}
+
+/**
+ * Keeps the lap just finished as the track's ghost if it is the fastest yet,
+ * saving it for later races, and starts recording the next lap.
+ */
+void finish_ghost_lap(state_t *state, double lap_time) {
+  ghost_t *lap = state->ghost_recording;
+  ghost_finish(lap, lap_time);
+  if (state->ghost == NULL || lap_time < ghost_get_lap_time(state->ghost)) {
+    if (state->ghost != NULL) {
+      ghost_player_free(state->ghost_player);
+      ghost_free(state->ghost);
     }
-    default:
-      break;
+    state->ghost = lap;
+    state->ghost_player = ghost_player_init(lap);
+    const track_entry_t *entry = track_registry_get(state->track_idx);
+    if (!ghost_write(lap, entry->ghost_path)) {
+      fprintf(stderr, "Could not save ghost '%s'\n", entry->ghost_path);
     }
+  } else {
+    ghost_free(lap);
   }
-  body_set_velocity(car, vel);
+  state->ghost_recording = ghost_init();
+  ghost_record(state->ghost_recording, lap_timer_get_lap_time(state->lap_timer),
+               get_player_pose(state));
 }
 
 void handle_checkpoint_state(state_t *state, double dt) {
   checkpoint_state_t *checkpoint_state = car_get_checkpoint_state(state->car);
-  if (get_wrong_way(state->car, checkpoint_state)) {
-    asset_render(state->wrong_way);
-    asset_render(state->wrong_way_arrow);
+  state->going_wrong_way = get_wrong_way(state->car, checkpoint_state);
+  if (state->going_wrong_way) {
     set_wrong_way_time(checkpoint_state,
                        get_wrong_way_time(checkpoint_state) + dt);
   } else {
     set_wrong_way_time(checkpoint_state, 0);
   }
+  double progress = get_lap_progress(checkpoint_state);
+  // The time of this frame into the lap, which is past the line on the frame
+  // that finishes it
+  double time = lap_timer_get_lap_time(state->lap_timer) + dt;
+  ghost_record(state->ghost_recording, time, get_player_pose(state));
   if (get_lap_over(checkpoint_state)) {
+    double lap_time = lap_timer_finish_lap(state->lap_timer, progress, dt);
     reset_checkpoint_state(checkpoint_state);
     car_set_laps_done(state->car, car_get_laps_done(state->car) + 1);
-    if (state->best_time == 0.0 || state->lap_time <= state->best_time) {
-      state->best_time = state->lap_time;
-    }
-    state->lap_time = 0.0;
+    state->best_time = fmin(state->best_time, lap_time);
+    finish_ghost_lap(state, lap_time);
   } else {
-    state->lap_time += dt;
+    lap_timer_update(state->lap_timer, progress, dt);
+  }
+  // The AI karts follow the player's
+  kart_progress_t *kart_progress = kart_store_get_progress(state->kart_store);
+  for (size_t i = 1; i < list_size(state->karts); i++) {
+    if (get_lap_over(kart_progress[i].checkpoint_state)) {
+      reset_checkpoint_state(kart_progress[i].checkpoint_state);
+      kart_progress[i].laps_done++;
+    }
   }
-  if (get_lap_over(car_get_checkpoint_state(state->villain))) {
-    reset_checkpoint_state(car_get_checkpoint_state(state->villain));
-    car_set_laps_done(state->villain, car_get_laps_done(state->villain) + 1);
+}
+
+/**
+ * Ranks the player (kart 0) and the AI karts by how far they have raced.
+ */
+void update_standings(state_t *state) {
+  kart_progress_t *progress = kart_store_get_progress(state->kart_store);
+  for (size_t i = 0; i < list_size(state->karts); i++) {
+    standings_set_progress(state->standings, i, progress[i].laps_done,
+                           get_lap_progress(progress[i].checkpoint_state));
   }
+  standings_update(state->standings);
 }
 
 void create_mini_map(state_t *state) {
-  list_t *map = background_list();
-  vector_t vec = vec_subtract(*(vector_t *)list_get(map, 3),
-                              *(vector_t *)list_get(map, 1));
-  list_free(map);
+  vector_t vec =
+      vec_subtract(track_get_max(state->track), track_get_min(state->track));
   vec = vec_multiply(MINIMAP_SCALE, vec);
   vector_t center = vec_multiply(0.5, vec);
   center = (vector_t){.x = center.x, .y = MAX.y - center.y};
   list_t *points = make_rectangle(center, vec.x, vec.y);
   body_t *body = body_init(points, INFINITY, get_blue());
-  state->mini_map = asset_make_image_with_body(MINIMAP_PATH, body);
+  const track_entry_t *entry = track_registry_get(state->track_idx);
+  state->mini_map = asset_make_image_with_body(entry->minimap_path, body);
   state->mini_car = make_mini_car(state->car_type);
-  state->mini_villain = make_mini_villain(state->villain_type);
+  size_t num_ai = ai_field_size(state->ai_field);
+  state->mini_villains = list_init(num_ai, (free_func_t)asset_destroy);
+  for (size_t i = 0; i < num_ai; i++) {
+    list_add(state->mini_villains, make_mini_villain(state->villain_type));
+  }
+  if (state->ghost_car != NULL) {
+    state->mini_ghost = make_mini_villain(GHOST);
+  }
+}
+
+/**
+ * Moves the mini-map marker for a kart to where the kart is on the track.
+ */
+void place_on_mini_map(state_t *state, asset_t *marker, body_t *kart) {
+  vector_t bg_center = body_get_centroid(asset_get_body(state->bg));
+  vector_t pos = vec_subtract(body_get_centroid(kart), bg_center);
+  pos = vec_add(body_get_centroid(asset_get_body(state->mini_map)),
+                vec_multiply(MINIMAP_SCALE, pos));
+  body_set_centroid(asset_get_body(marker), pos);
 }
 
 void update_mini_map(state_t *state) {
@@ -550,13 +677,17 @@ void update_mini_map(state_t *state) {
   body_set_centroid(asset_get_body(state->mini_car), car_pos);
   body_set_rotation(asset_get_body(state->mini_car),
                     body_get_rotation(state->car));
-  vector_t villain_center = body_get_centroid(state->villain);
-  vector_t villain_pos = vec_subtract(villain_center, bg_center);
-  villain_pos = vec_add(body_get_centroid(asset_get_body(state->mini_map)),
-                        vec_multiply(MINIMAP_SCALE, villain_pos));
-  body_set_centroid(asset_get_body(state->mini_villain), villain_pos);
-  body_set_rotation(asset_get_body(state->mini_villain),
-                    body_get_rotation(state->villain) + M_PI);
+  for (size_t i = 0; i < ai_field_size(state->ai_field); i++) {
+    body_t *villain = ai_field_get_car(state->ai_field, i);
+    asset_t *mini_villain = list_get(state->mini_villains, i);
+    place_on_mini_map(state, mini_villain, villain);
+    body_set_rotation(asset_get_body(mini_villain),
+                      body_get_rotation(villain) + M_PI);
+  }
+  if (state->ghost_player != NULL && state->ghost_car != NULL) {
+    place_on_mini_map(state, state->mini_ghost,
+                      asset_get_body(state->ghost_car));
+  }
 }
 
 void update_arrow(state_t *state) {
@@ -571,30 +702,6 @@ void update_arrow(state_t *state) {
   body_set_rotation(arrow_body, -atan2(right_way.y, right_way.x));
 }
 
-void create_boxes(state_t *state) {
-  state->boxes = list_init(2, (free_func_t)asset_destroy);
-  list_t *inside = get_inside_out();
-  list_t *outside = get_outside_in();
-  size_t size = list_size(inside);
-  for (size_t i = 0; i < size; i += 2) {
-    vector_t in = *(vector_t *)list_get(inside, i);
-    vector_t out = *(vector_t *)list_get(outside, i);
-    for (size_t j = 1; j <= NUM_BOXES; j++) {
-      vector_t center =
-          vec_add(vec_multiply(j, in), vec_multiply(NUM_BOXES + 1 - j, out));
-      center = vec_multiply(1.0 / ((double)NUM_BOXES + 1.0), center);
-      asset_t *box = make_box(center);
-      body_t *body = asset_get_body(box);
-      scene_add_body(state->scene, body);
-      create_box_collision(state->scene, state->car, body, state->switches);
-      create_box_collision(state->scene, state->villain, body, state->switches);
-      list_add(state->boxes, box);
-    }
-  }
-  list_free(inside);
-  list_free(outside);
-}
-
 void menu_free(state_t *state) {
   list_free(state->car_options);
   list_free(state->car_stats);
@@ -615,34 +722,143 @@ void prev_villain(state_t *state) {
   state->villain_type = (state->villain_type + 3) % NUM_VILLAINS;
 }
 
-double get_villain_speed(state_t *state, villain_type_t villain_type) {
+double get_villain_speed(villain_type_t villain_type) {
   switch (villain_type) {
   case EASY_AI:
     return EASY_AI_SPEED;
   case MEDIUM_AI:
     return MED_AI_SPEED;
   case HARD_AI:
+  case GHOST:
     return HARD_AI_SPEED;
+  }
+}
+
+double get_villain_skill(villain_type_t villain_type) {
+  switch (villain_type) {
+  case EASY_AI:
+    return EASY_AI_SKILL;
+  case MEDIUM_AI:
+    return MED_AI_SKILL;
+  case HARD_AI:
   case GHOST:
-    return SCALE_CONST / (state->best_time);
+    return HARD_AI_SKILL;
+  }
+}
+
+/**
+ * Lines the AI karts up on the grid behind the player, in the kart types the
+ * player did not pick, and hands them to the AI field.
+ */
+void create_ai_karts(state_t *state) {
+  size_t num_ai = state->villain_type == GHOST ? 0 : NUM_AI_KARTS;
+  double top_speed = get_villain_speed(state->villain_type);
+  double skill = get_villain_skill(state->villain_type);
+  state->ai_field = ai_field_init(state->track, NUM_AI_KARTS);
+  // A time budget makes the drivers depend on the speed of the machine, so
+  // races that are recorded or played back plan every kart every tick
+  bool exact = state->record_path != NULL || state->replay != NULL;
+  ai_field_set_perception_budget(state->ai_field,
+                                 exact ? 0 : AI_PERCEPTION_BUDGET);
+  ai_field_set_focus(state->ai_field, state->car);
+  for (size_t i = 0; i < num_ai; i++) {
+    spawn_t spawn = track_get_grid_slot(state->track, i + 1);
+    car_type_t type = (state->car_type + 1 + i % (NUM_CARS - 1)) % NUM_CARS;
+    body_t *villain = make_car_in_store(state->kart_store, type);
+    body_set_centroid(villain, spawn.position);
+    body_set_rotation(villain, spawn.rotation);
+    list_add(state->body_assets, make_car_image(villain));
+    scene_add_body(state->scene, villain);
+    create_surface_forces(state->scene, state->track, villain);
+    create_vehicle_controller(state->scene, villain);
+    create_wall_collision(state->scene, state->track, villain,
+                          WALL_ELASTICITY);
+    change_top_speed(villain, top_speed);
+    car_set_checkpoint_state(villain, checkpoint_state_init(state->track));
+    list_add(state->karts, villain);
+    ai_field_add(state->ai_field, villain,
+                 skill * (1 - AI_SKILL_SPREAD * i / num_ai));
   }
+  state->ai_items = ai_items_init(state->ai_field, state->karts, state->car);
+  state->rubber_band = rubber_band_init(state->ai_field, state->karts,
+                                        state->car, &AI_RUBBER_BAND);
+}
+
+/**
+ * Loads the track's saved ghost, if it has one, and in ghost mode makes the
+ * kart that replays it. The kart has no forces or collisions; it is moved to
+ * the ghost's pose every frame.
+ */
+void create_ghost(state_t *state) {
+  const track_entry_t *entry = track_registry_get(state->track_idx);
+  state->ghost = ghost_read(entry->ghost_path);
+  state->ghost_player = NULL;
+  if (state->ghost != NULL) {
+    state->ghost_player = ghost_player_init(state->ghost);
+  }
+  state->ghost_recording = ghost_init();
+  state->ghost_car = NULL;
+  state->mini_ghost = NULL;
+  if (state->villain_type == GHOST) {
+    body_t *ghost_car = make_car(state->car_type);
+    scene_add_body(state->scene, ghost_car);
+    state->ghost_car = make_car_image(ghost_car);
+  }
+}
+
+/**
+ * Puts the ghost kart where the ghost was at the same time into its lap.
+ * Should be called after the track origin has been updated and before the
+ * lap timer has been.
+ */
+void update_ghost(state_t *state, double dt) {
+  if (state->ghost_player == NULL || state->ghost_car == NULL) {
+    return;
+  }
+  double time = lap_timer_get_lap_time(state->lap_timer) + dt;
+  ghost_pose_t pose = ghost_player_pose_at(state->ghost_player, time);
+  body_t *ghost_car = asset_get_body(state->ghost_car);
+  body_set_centroid(ghost_car, vec_add(pose.position,
+                                       track_get_origin(state->track)));
+  body_set_rotation(ghost_car, pose.rotation);
 }
 
 void start_race(state_t *state) {
   Mix_HaltChannel(0);
   Mix_PlayChannel(0, state->game_music, -1);
   state->time = 0;
+  state->step_time = 0;
+  state->going_wrong_way = false;
   state->game_state = RACE;
+  // The item draws are the race's only randomness, so a recording keeps
+  // their seed
+  uint32_t seed = state->replay != NULL ? replay_get_setup(state->replay).seed
+                                        : (uint32_t)rand();
+  srand(seed);
+  if (state->record_path != NULL) {
+    replay_setup_t setup = {.seed = seed,
+                            .track_idx = state->track_idx,
+                            .car_type = state->car_type,
+                            .villain_type = state->villain_type};
+    state->recording = replay_init(&setup);
+  }
   state->key_mapping = malloc(4 * sizeof(size_t));
   for (size_t i = 0; i < 4; i++) {
     state->key_mapping[i] = i;
   }
   menu_free(state);
 
+  // Already resident if the menu had time to prefetch it
+  const track_entry_t *entry = track_registry_get(state->track_idx);
+  state->track = track_load(entry->track_path);
+  assert(state->track != NULL);
+  track_set_origin(state->track, VEC_ZERO);
+  state->timers = timer_wheel_init(RACE_TIMER_TICK, RACE_TIMER_SLOTS);
+  state->star_timer = NO_TIMER;
   state->body_assets = list_init(2, (free_func_t)asset_destroy);
-  body_t *bg_body = background();
+  body_t *bg_body = background(state->track);
   scene_add_body(state->scene, bg_body);
-  state->bg = asset_make_image_with_body(GAME_BACKGROUND_PATH, bg_body);
+  state->bg = asset_make_image_with_body(entry->background_path, bg_body);
   list_add(state->body_assets, state->bg);
   state->lap_numbers = list_init(NO_LAPS, (free_func_t)asset_destroy);
   for (size_t i = 0; i < NO_LAPS; i++) {
@@ -650,23 +866,22 @@ void start_race(state_t *state) {
   }
   state->pause_button = create_button_from_info(state, PAUSE_BUTTON);
 
-  body_t *car = make_car(state->car_type);
-  body_set_centroid(car, SPAWN_POS);
+  spawn_t spawn = track_get_spawn(state->track, 0);
+  state->kart_store = kart_store_init(1 + NUM_AI_KARTS);
+  body_t *car = make_car_in_store(state->kart_store, state->car_type);
+  body_set_centroid(car, spawn.position);
   state->car = car;
   list_add(state->body_assets, make_car_image(car));
-  body_set_rotation(car, M_PI);
+  body_set_rotation(car, spawn.rotation);
   scene_add_body(state->scene, car);
-  create_drag(state->scene, TRACK_MU, car);
-
-  body_t *villain = make_car((state->car_type + 1) % NUM_CARS);
-  body_set_centroid(villain, vec_add(AI_START_OFFSET, SPAWN_POS));
-  state->villain = villain;
-  list_add(state->body_assets, make_car_image(villain));
-  body_set_rotation(villain, M_PI);
-  scene_add_body(state->scene, villain);
-  create_drag(state->scene, TRACK_MU, villain);
-  state->villain_speed = get_villain_speed(state, state->villain_type);
-  change_top_speed(villain, state->villain_speed);
+  create_surface_forces(state->scene, state->track, car);
+  create_vehicle_controller(state->scene, car);
+
+  car_set_checkpoint_state(car, checkpoint_state_init(state->track));
+  create_wall_collision(state->scene, state->track, car, WALL_ELASTICITY);
+  state->karts = list_init(1 + NUM_AI_KARTS, NULL);
+  list_add(state->karts, car);
+  create_ai_karts(state);
 
   body_t *arrow_body =
       body_init(make_rectangle(VEC_ZERO, WRONG_WAY_WIDTH, WRONG_WAY_HEIGHT),
@@ -675,55 +890,22 @@ void start_race(state_t *state) {
       WRONG_WAY_ARROW_IMAGE_PATH, arrow_body);
 
   if (state->villain_type != GHOST) {
-    create_car_collision(state->scene, state->car, villain);
+    create_kart_collisions(state->scene, state->karts, state->timers);
   }
 
-  list_t *checkpoints = make_checkpoints(get_inside_out(), get_outside_in(),
-                                         START_IN, START_OUT, START_OFFSET);
-  checkpoint_state_t *checkpoint_state_car = checkpoint_state_init(checkpoints);
-  checkpoint_state_t *checkpoint_state_villain =
-      checkpoint_state_init(checkpoints);
-
-  car_set_checkpoint_state(state->car, checkpoint_state_car);
-  car_set_checkpoint_state(state->villain, checkpoint_state_villain);
+  state->standings = standings_init(list_size(state->karts),
+                                    track_get_length(state->track));
+  state->lap_timer = lap_timer_init(state->track, NO_LAPS);
+  create_ghost(state);
 
   state->wrong_way = asset_make_image(WRONG_WAY_IMAGE_PATH, GAME_LOGO);
 
-  for (size_t i = 0; i < list_size(checkpoints); i++) {
-    scene_add_body(state->scene, list_get(checkpoints, i));
-    create_collision(state->scene, state->car, list_get(checkpoints, i),
-                     checkpoint_collision, checkpoint_state_car, 0);
-    create_collision(state->scene, state->villain, list_get(checkpoints, i),
-                     checkpoint_collision, checkpoint_state_villain, 0);
-  }
-
-  state->outside_walls = outside_walls();
-  state->inside_walls = inside_walls();
-  size_t len_outside_walls = list_size(state->outside_walls);
-  size_t len_inside_walls = list_size(state->inside_walls);
-  for (size_t i = 0; i < len_outside_walls; i++) {
-    scene_add_body(state->scene, list_get(state->outside_walls, i));
-    create_physics_collision(state->scene, state->car,
-                             list_get(state->outside_walls, i),
-                             WALL_ELASTICITY);
-    create_physics_collision(state->scene, state->villain,
-                             list_get(state->outside_walls, i),
-                             WALL_ELASTICITY);
-  }
-  for (size_t i = 0; i < len_inside_walls; i++) {
-    scene_add_body(state->scene, list_get(state->inside_walls, i));
-    create_physics_collision(state->scene, state->car,
-                             list_get(state->inside_walls, i), WALL_ELASTICITY);
-    create_physics_collision(state->scene, state->villain,
-                             list_get(state->inside_walls, i), WALL_ELASTICITY);
-  }
   state->switches = malloc(6 * sizeof(bool));
   for (size_t i = 0; i < 6; i++)
     state->switches[i] = true;
-  create_boxes(state);
-  state->shells = list_init(2, (free_func_t)asset_destroy);
+  state->items = item_pool_init(state->track, state->karts, state->switches,
+                                state->timers, seed);
   create_mini_map(state);
-  sdl_on_key((key_handler_t)on_key);
 }
 
 void next_car(state_t *state) {
@@ -733,6 +915,14 @@ void prev_car(state_t *state) {
   state->car_type = ((state->car_type + 2) % NUM_CARS);
 }
 
+void next_track(state_t *state) {
+  state->track_idx = (state->track_idx + 1) % track_registry_size();
+}
+void prev_track(state_t *state) {
+  size_t num_tracks = track_registry_size();
+  state->track_idx = (state->track_idx + num_tracks - 1) % num_tracks;
+}
+
 void create_menu_buttons(state_t *state) {
   for (size_t i = 0; i < NUM_MENU_BUTTONS; i++) {
     button_info_t info = MENU_BUTTON_TEMPLATES[i];
@@ -741,23 +931,6 @@ void create_menu_buttons(state_t *state) {
   }
 
   state->best_time = 170;
-  state->lap_time = 0.0;
-}
-
-void fix_villain_path(body_t *car) {
-  double theta = body_get_rotation(car);
-  vector_t direction = {.x = sin(theta), .y = -cos(theta)};
-  vector_t right_way =
-      get_right_way_from_position(car_get_checkpoint_state(car), car);
-  double dot_prod = vec_dot(direction, right_way);
-  if (abs(dot_prod > AI_PATH_TOLERANCE)) {
-    theta = theta + atan2(right_way.y, right_way.x) -
-            atan2(direction.y, direction.x);
-    body_set_rotation(car, theta);
-  }
-  vector_t new_dir = {sin(theta), -cos(theta)};
-  vector_t velocity = vec_multiply(car_get_top_speed(car), new_dir);
-  body_set_velocity(car, velocity);
 }
 
 void show_menu(state_t *state) {
@@ -768,6 +941,17 @@ void show_menu(state_t *state) {
   }
   asset_render(list_get(state->car_options, state->car_type));
   asset_render(list_get(state->car_stats, state->car_type));
+  const track_entry_t *entry = track_registry_get(state->track_idx);
+  asset_t *track_name =
+      asset_make_text(GAME_FONT_PATH, TRACK_NAME_BOX, entry->name, get_blue());
+  asset_render(track_name);
+  asset_destroy(track_name);
+
+  // Load the selected track a piece at a time while the player is choosing,
+  // then the one after it in case they keep cycling
+  if (track_registry_prefetch(state->track_idx)) {
+    track_registry_prefetch((state->track_idx + 1) % track_registry_size());
+  }
 }
 
 asset_t *make_time_asset(double time) {
@@ -790,6 +974,89 @@ asset_t *make_time_asset(double time) {
   return asset;
 }
 
+// Makes an asset to display the player's item
+asset_t *item_asset(power_up_type_t power) {
+  const char *filepath = SHELL_PATH;
+  switch (power) {
+  case SHELL: {
+    filepath = SHELL_PATH;
+    break;
+  }
+  case REVERSE: {
+    filepath = SCRAMBLE_PATH;
+    break;
+  }
+  case BOOST: {
+    filepath = BOOST_PATH;
+    break;
+  }
+  case SHROOM: {
+    filepath = SHROOM_PATH;
+    break;
+  }
+  case STAR: {
+    filepath = STAR_PATH;
+    break;
+  }
+  case FAKE: {
+    filepath = BOX_PATH;
+    break;
+  }
+  default: {
+    break;
+  }
+  }
+  return asset_make_image(filepath, ITEM_BOUNDING_BOX);
+}
+
+void render_standings(standings_t *standings) {
+  size_t position = standings_get_position(standings, 0);
+  size_t suffix = position % 10;
+  if (suffix > 3 || (position / 10) % 10 == 1) {
+    suffix = 0;
+  }
+  char text[16];
+  snprintf(text, sizeof(text), "%zu%s/%zu", position, ORDINAL_SUFFIXES[suffix],
+           standings_get_num_karts(standings));
+  asset_t *asset =
+      asset_make_text(GAME_FONT_PATH, STANDINGS_BOX, text, get_blue());
+  asset_render(asset);
+  asset_destroy(asset);
+}
+
+/**
+ * Shows how far the player is ahead of (blue) or behind (red) their best lap
+ * at the same point on the track, once they have a best lap.
+ */
+void render_delta(lap_timer_t *lap_timer) {
+  if (lap_timer_get_best_lap(lap_timer) == INFINITY) {
+    return;
+  }
+  double delta = lap_timer_get_delta(lap_timer);
+  char text[16];
+  snprintf(text, sizeof(text), "%+.2f", delta);
+  rgb_color_t color = delta > 0 ? get_red() : get_blue();
+  asset_t *asset = asset_make_text(GAME_FONT_PATH, DELTA_BOX, text, color);
+  asset_render(asset);
+  asset_destroy(asset);
+}
+
+/**
+ * Prints the player's lap and sector times at the end of the race.
+ */
+void print_lap_times(state_t *state) {
+  lap_timer_t *lap_timer = state->lap_timer;
+  size_t num_sectors = track_get_num_sectors(state->track);
+  for (size_t lap = 0; lap < lap_timer_get_num_laps(lap_timer); lap++) {
+    printf("Lap %zu: %.3f (", lap + 1, lap_timer_get_record(lap_timer, lap));
+    for (size_t i = 0; i < num_sectors; i++) {
+      printf("%s%.3f", i > 0 ? " " : "",
+             lap_timer_get_record_sector(lap_timer, lap, i));
+    }
+    printf(")\n");
+  }
+}
+
 /* EMSCRIPTEN FUNCTIONS */
 state_t *emscripten_init() {
   asset_cache_init();
@@ -799,10 +1066,28 @@ state_t *emscripten_init() {
   Mix_AllocateChannels(1);
   state_t *state = malloc(sizeof(state_t));
   state->villain_type = MEDIUM_AI;
+  state->track_idx = 0;
   state->scene = scene_init();
   state->game_state = MENU;
   srand(time(NULL));
+  state->recording = NULL;
+  state->record_path = getenv(RECORD_ENV);
+  state->replay = NULL;
+  const char *replay_path = getenv(REPLAY_ENV);
+  if (replay_path != NULL) {
+    state->replay = replay_read(replay_path);
+    if (state->replay == NULL) {
+      fprintf(stderr, "Could not read replay '%s'\n", replay_path);
+    }
+  }
   restart_game(state);
+  if (state->replay != NULL) {
+    replay_setup_t setup = replay_get_setup(state->replay);
+    state->track_idx = setup.track_idx;
+    state->car_type = setup.car_type;
+    state->villain_type = setup.villain_type;
+    start_race(state);
+  }
   return state;
 }
 
@@ -896,37 +1181,51 @@ void restart_game(state_t *state) {
   create_menu_buttons(state);
 }
 
-void show_race(state_t *state, double dt) {
+/**
+ * Shows the AI karts the player's kart and the loose shells and fake boxes
+ * on the road.
+ */
+void add_ai_obstacles(state_t *state) {
+  ai_field_add_obstacle(state->ai_field, state->car, OBSTACLE_KART);
+  for (size_t i = 0; i < item_pool_size(state->items); i++) {
+    if (item_pool_is_hazard(state->items, i)) {
+      ai_field_add_circle_obstacle(
+          state->ai_field, item_pool_get_position(state->items, i),
+          item_pool_get_velocity(state->items, i),
+          item_pool_get_radius(state->items, i), OBSTACLE_HAZARD);
+    }
+  }
+}
+
+void ai_use_item(body_t *car, void *aux) {
+  use_item(aux, car);
+}
+
+/**
+ * Steps the race forward by a fixed time.
+ */
+void step_race(state_t *state, double dt) {
   state->time += dt;
-  power_up_info_t info = car_get_powerup_state(state->car);
-  if (info.stun > 0) {
-    body_set_rotation(state->car,
-                      body_get_rotation(state->car) + dt * STUN_ROT_SPEED);
-  }
-  info.fast -= dt;
-  info.immune -= dt;
-  info.reverse -= dt;
-  info.stun -= dt;
-  if (info.immune <= 0 && info.immune > -dt) {
-    Mix_HaltChannel(0);
-    Mix_PlayChannel(0, state->game_music, -1);
-  }
-  power_up_info_t villain_info = car_get_powerup_state(state->villain);
-  if (villain_info.stun > 0) {
-    body_set_rotation(state->villain,
-                      body_get_rotation(state->villain) + dt * STUN_ROT_SPEED);
-  }
-  villain_info.fast -= dt;
-  villain_info.immune -= dt;
-  villain_info.reverse -= dt;
-  villain_info.stun -= dt;
-  car_set_powerup_state(state->car, info);
+  timer_wheel_advance(state->timers, dt);
   scene_tick(state->scene, dt);
-  scene_center_body(state->scene, state->car, SPAWN_POS);
-  update_shell(state->car, dt);
+  scene_center_body(state->scene, state->car, CAMERA_POS);
+  update_track_progress(state);
+  rubber_band_update(state->rubber_band, state->standings, dt);
+  update_ghost(state, dt);
+  item_pool_update(state->items, dt);
+  add_ai_obstacles(state);
+  ai_field_update(state->ai_field, dt);
+  ai_items_update(state->ai_items, state->standings, dt, ai_use_item, state);
+  for (size_t i = 0; i < list_size(state->karts); i++) {
+    car_respawn(list_get(state->karts, i));
+  }
+  handle_checkpoint_state(state, dt);
+  update_standings(state);
+}
+
+void render_race(state_t *state) {
   update_mini_map(state);
   update_arrow(state);
-  fix_villain_path(state->villain);
   size_t size = list_size(state->body_assets);
   for (ssize_t i = 0; i < size; i++) {
     asset_t *curr = list_get(state->body_assets, i);
@@ -939,33 +1238,27 @@ void show_race(state_t *state, double dt) {
       asset_render(curr);
     }
   }
-  size = list_size(state->boxes);
-  for (size_t i = 0; i < size; i++) {
-    asset_t *box = list_get(state->boxes, i);
-    if (update_box(box, dt)) {
-      asset_render(box);
-    }
+  if (state->ghost_player != NULL && state->ghost_car != NULL) {
+    asset_render(state->ghost_car);
   }
-  size = list_size(state->shells);
-  for (ssize_t i = 0; i < size; i++) {
-    asset_t *curr = list_get(state->shells, i);
-    body_t *body = asset_get_body(curr);
-    if (body == NULL) {
-      list_remove(state->shells, i);
-      i--;
-      size--;
-    } else {
-      asset_render(curr);
-    }
+  item_pool_render(state->items);
+  if (state->going_wrong_way) {
+    asset_render(state->wrong_way);
+    asset_render(state->wrong_way_arrow);
   }
-  car_respawn(state->car);
-  handle_checkpoint_state(state, dt);
   asset_render(state->mini_map);
   asset_render(state->mini_car);
-  asset_render(state->mini_villain);
+  for (size_t i = 0; i < list_size(state->mini_villains); i++) {
+    asset_render(list_get(state->mini_villains, i));
+  }
+  if (state->ghost_player != NULL && state->ghost_car != NULL) {
+    asset_render(state->mini_ghost);
+  }
   asset_t *time_asset = make_time_asset(state->time);
   asset_render(time_asset);
   asset_destroy(time_asset);
+  render_standings(state->standings);
+  render_delta(state->lap_timer);
   power_up_type_t power = car_get_powerup_state(state->car).power_up;
   if (power > 0) {
     asset_t *item = item_asset(power);
@@ -973,8 +1266,29 @@ void show_race(state_t *state, double dt) {
     asset_destroy(item);
   }
   asset_render(state->pause_button);
+}
+
+/**
+ * Steps the race through the time a frame took, in steps of PHYSICS_DT,
+ * and draws it.
+ */
+void show_race(state_t *state, double dt) {
+  state->step_time += dt;
+  size_t steps = 0;
+  while (state->step_time >= PHYSICS_DT &&
+         car_get_laps_done(state->car) != NO_LAPS) {
+    if (steps == MAX_PHYSICS_STEPS) {
+      state->step_time = 0;
+      break;
+    }
+    step_race(state, PHYSICS_DT);
+    state->step_time -= PHYSICS_DT;
+    steps++;
+  }
+  render_race(state);
   if (car_get_laps_done(state->car) == NO_LAPS) {
     printf("Race Over!\n");
+    print_lap_times(state);
     printf("Your best time was %f \n", state->best_time);
     restart_game(state);
     return;
@@ -990,12 +1304,26 @@ void pause_game(state_t *state) {
 
 bool emscripten_main(state_t *state) {
   double dt = time_since_last_tick();
+  input_snapshot_t input = sdl_take_input();
+  if (state->replay != NULL && state->game_state == RACE &&
+      !replay_next(state->replay, &dt, &input)) {
+    printf("Replay finished at %f\n", state->time);
+    restart_game(state);
+  }
+  // A replay quits once its race is over
+  if (state->replay != NULL && state->game_state == MENU) {
+    sdl_request_quit();
+  }
   sdl_clear();
   switch (state->game_state) {
   case MENU:
     show_menu(state);
     break;
   case RACE:
+    if (state->recording != NULL) {
+      replay_record(state->recording, dt, &input);
+    }
+    apply_input(state, &input);
     show_race(state, dt);
     break;
   case SETTINGS:
@@ -1013,12 +1341,17 @@ bool emscripten_main(state_t *state) {
 }
 
 void emscripten_free(state_t *state) {
+  save_recording(state);
+  if (state->replay != NULL) {
+    replay_free(state->replay);
+  }
   Mix_FreeChunk(state->menu_music);
   Mix_FreeChunk(state->game_music);
   Mix_FreeChunk(state->star_music);
   Mix_Quit();
   list_free(state->body_assets);
   scene_free(state->scene);
+  track_cache_destroy();
   asset_cache_destroy();
   free(state);
 }
@@ -0,0 +1,484 @@
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <float.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "race_sim.h"
+#include "track.h"
+#include "track_generator.h"
+
+// Runs a batch of AI races without a display, spread over worker threads,
+// and prints every kart's result as CSV or JSON. The races are on a track
+// file or on a circuit from the track generator. Build with
+// 'make NO_ASAN=true race_batch'.
+
+const char *DEFAULT_TRACK = "assets/tracks/caltech.trk";
+const size_t DEFAULT_RACES = 100;
+const uint64_t DEFAULT_SEED = 1;
+// A grid the size of the game's, with its lap count and AI settings
+const race_config_t DEFAULT_CONFIG = {.num_karts = 9,
+                                      .num_laps = 3,
+                                      .skill = 1.0,
+                                      .skill_spread = 0.1,
+                                      .skill_jitter = 0,
+                                      .kart_type = -1,
+                                      .top_speed = 0,
+                                      .wall_elasticity = 1,
+                                      .time_limit = 900,
+                                      .dt = 1.0 / 60,
+                                      .shell_interval = 0};
+const char *KART_TYPE_NAMES[] = {"f1", "golf_cart", "pickup"};
+// The generated circuit raced with -g, before -L and -C change it. Its
+// vertices, checkpoints, box rows and corners scale with its length.
+const track_params_t DEFAULT_CIRCUIT = {.length = 12000,
+                                        .corners = 12,
+                                        .width = 220,
+                                        .wobble = 0.6,
+                                        .size = 500,
+                                        .num_checkpoints = 60,
+                                        .num_box_rows = 10,
+                                        .seed = 0};
+// The most races, karts, laps, threads or checkpoints an option can ask for
+const uint64_t MAX_COUNT = 1000000;
+#define TRACK_LABEL_SIZE 64
+
+typedef enum { FORMAT_CSV, FORMAT_JSON } format_t;
+
+/**
+ * The work shared by the worker threads. Each worker claims the next race
+ * that has not been started until there are none left.
+ */
+typedef struct batch {
+  const char *track_path;
+  // The circuit to generate instead of reading a track, or NULL
+  const track_params_t *circuit;
+  race_config_t config;
+  uint64_t seed;
+  size_t num_races;
+  size_t next_race;
+  size_t num_done;
+  pthread_mutex_t lock;
+  race_result_t **results;
+} batch_t;
+
+static bool claim_race(batch_t *batch, size_t *race) {
+  pthread_mutex_lock(&batch->lock);
+  bool claimed = batch->next_race < batch->num_races;
+  if (claimed) {
+    *race = batch->next_race++;
+  }
+  pthread_mutex_unlock(&batch->lock);
+  return claimed;
+}
+
+/**
+ * Reads or generates the batch's track. The caller owns the returned track.
+ */
+static track_t *load_track(batch_t *batch) {
+  return batch->circuit != NULL ? track_generate(batch->circuit)
+                                : track_read(batch->track_path);
+}
+
+static void *run_worker(void *aux) {
+  batch_t *batch = aux;
+  // The track's origin is set by every race, so each worker has its own
+  track_t *track = load_track(batch);
+  assert(track != NULL);
+  size_t race;
+  while (claim_race(batch, &race)) {
+    batch->results[race] =
+        race_sim_run(track, &batch->config, batch->seed + race);
+    pthread_mutex_lock(&batch->lock);
+    batch->num_done++;
+    fprintf(stderr, "\r%zu/%zu races", batch->num_done, batch->num_races);
+    pthread_mutex_unlock(&batch->lock);
+  }
+  track_free(track);
+  return NULL;
+}
+
+/**
+ * Prints a time, or nothing for a kart that did not set one.
+ */
+static void print_csv_time(FILE *out, double time) {
+  if (isfinite(time)) {
+    fprintf(out, "%.4f", time);
+  }
+}
+
+static void print_csv(FILE *out, batch_t *batch) {
+  size_t num_laps = batch->config.num_laps;
+  fprintf(out, "race,seed,kart,type,skill,position,finish_time,distance,"
+               "wall_hits,kart_hits");
+  for (size_t lap = 0; lap < num_laps; lap++) {
+    fprintf(out, ",lap_%zu", lap + 1);
+  }
+  fprintf(out, "\n");
+  for (size_t race = 0; race < batch->num_races; race++) {
+    race_result_t *result = batch->results[race];
+    for (size_t kart = 0; kart < race_result_get_num_karts(result); kart++) {
+      fprintf(out, "%zu,%llu,%zu,%s,%.4f,%zu,", race,
+              (unsigned long long)(batch->seed + race), kart,
+              KART_TYPE_NAMES[race_result_get_kart_type(result, kart)],
+              race_result_get_skill(result, kart),
+              race_result_get_position(result, kart));
+      print_csv_time(out, race_result_get_finish_time(result, kart));
+      fprintf(out, ",%.1f,%zu,%zu", race_result_get_distance(result, kart),
+              race_result_get_wall_hits(result, kart),
+              race_result_get_kart_hits(result, kart));
+      for (size_t lap = 0; lap < num_laps; lap++) {
+        fprintf(out, ",");
+        print_csv_time(out, race_result_get_lap_time(result, kart, lap));
+      }
+      fprintf(out, "\n");
+    }
+  }
+}
+
+/**
+ * Prints a time, or null for a kart that did not set one.
+ */
+static void print_json_time(FILE *out, double time) {
+  if (isfinite(time)) {
+    fprintf(out, "%.4f", time);
+  } else {
+    fprintf(out, "null");
+  }
+}
+
+static void print_json(FILE *out, batch_t *batch) {
+  race_config_t *config = &batch->config;
+  fprintf(out,
+          "{\"config\": {\"track\": \"%s\", \"karts\": %zu, \"laps\": %zu, "
+          "\"skill\": %g, \"skill_spread\": %g, \"skill_jitter\": %g, "
+          "\"top_speed\": %g, \"wall_elasticity\": %g, \"time_limit\": %g, "
+          "\"dt\": %g, \"shell_interval\": %g},\n \"races\": [",
+          batch->track_path, config->num_karts, config->num_laps,
+          config->skill, config->skill_spread, config->skill_jitter,
+          config->top_speed, config->wall_elasticity, config->time_limit,
+          config->dt, config->shell_interval);
+  for (size_t race = 0; race < batch->num_races; race++) {
+    race_result_t *result = batch->results[race];
+    size_t num_karts = race_result_get_num_karts(result);
+    fprintf(out, "%s\n  {\"race\": %zu, \"seed\": %llu, \"duration\": %.4f, "
+                 "\"peak_shells\": %zu, \"order\": [",
+            race > 0 ? "," : "", race,
+            (unsigned long long)(batch->seed + race),
+            race_result_get_duration(result),
+            race_result_get_peak_shells(result));
+    for (size_t position = 1; position <= num_karts; position++) {
+      fprintf(out, "%s%zu", position > 1 ? ", " : "",
+              race_result_get_kart(result, position));
+    }
+    fprintf(out, "], \"karts\": [");
+    for (size_t kart = 0; kart < num_karts; kart++) {
+      fprintf(out, "%s\n   {\"kart\": %zu, \"type\": \"%s\", "
+                   "\"skill\": %.4f, \"position\": %zu, \"finish_time\": ",
+              kart > 0 ? "," : "", kart,
+              KART_TYPE_NAMES[race_result_get_kart_type(result, kart)],
+              race_result_get_skill(result, kart),
+              race_result_get_position(result, kart));
+      print_json_time(out, race_result_get_finish_time(result, kart));
+      fprintf(out, ", \"distance\": %.1f, \"wall_hits\": %zu, "
+                   "\"kart_hits\": %zu, \"laps\": [",
+              race_result_get_distance(result, kart),
+              race_result_get_wall_hits(result, kart),
+              race_result_get_kart_hits(result, kart));
+      for (size_t lap = 0; lap < race_result_get_num_laps(result); lap++) {
+        fprintf(out, "%s", lap > 0 ? ", " : "");
+        print_json_time(out, race_result_get_lap_time(result, kart, lap));
+      }
+      fprintf(out, "]}");
+    }
+    fprintf(out, "]}");
+  }
+  fprintf(out, "\n ]}\n");
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "usage: %s [options]\n"
+          "  -t PATH   track file (default %s)\n"
+          "  -g SEED   race on a generated circuit instead of a track file\n"
+          "  -L LENGTH lap length of the generated circuit (default %g)\n"
+          "  -C N      checkpoints on the generated circuit (default: one "
+          "every %g)\n"
+          "  -x PATH   also save the generated circuit as a binary track, "
+          "for -t\n"
+          "  -n N      number of races (default %zu)\n"
+          "  -j N      worker threads (default: one per core)\n"
+          "  -r SEED   seed of the first race; race i uses SEED + i\n"
+          "  -k N      karts per race (default %zu)\n"
+          "  -l N      laps per race (default %zu)\n"
+          "  -s SKILL  skill of the kart on pole (default %g)\n"
+          "  -S FRAC   skill spread from the front to the back of the grid "
+          "(default %g)\n"
+          "  -J FRAC   random skill jitter per kart (default %g)\n"
+          "  -c TYPE   every kart's type: f1, golf_cart or pickup "
+          "(default: a random mix)\n"
+          "  -v SPEED  every kart's top speed (default: the kart's own)\n"
+          "  -w E      wall elasticity (default %g)\n"
+          "  -T SECS   time limit per race (default %g)\n"
+          "  -d SECS   physics tick (default %g)\n"
+          "  -H SECS   every kart fires a homing shell this often, to stress "
+          "test the items\n"
+          "  -f FORMAT csv or json (default csv)\n"
+          "  -o PATH   write the results to a file instead of stdout\n",
+          program, DEFAULT_TRACK, DEFAULT_CIRCUIT.length,
+          DEFAULT_CIRCUIT.length / DEFAULT_CIRCUIT.num_checkpoints,
+          DEFAULT_RACES, DEFAULT_CONFIG.num_karts,
+          DEFAULT_CONFIG.num_laps, DEFAULT_CONFIG.skill,
+          DEFAULT_CONFIG.skill_spread, DEFAULT_CONFIG.skill_jitter,
+          DEFAULT_CONFIG.wall_elasticity, DEFAULT_CONFIG.time_limit,
+          DEFAULT_CONFIG.dt);
+}
+
+static bool parse_kart_type(const char *name, int *type) {
+  for (size_t i = 0; i < sizeof(KART_TYPE_NAMES) / sizeof(char *); i++) {
+    if (strcmp(name, KART_TYPE_NAMES[i]) == 0) {
+      *type = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Reads a whole number in [min, max] from an option's value. Fails on
+ * anything else, including a sign, trailing characters or an empty value.
+ */
+static bool parse_unsigned(const char *text, uint64_t min, uint64_t max,
+                           uint64_t *value) {
+  if (!isdigit((unsigned char)text[0])) {
+    return false;
+  }
+  char *end;
+  errno = 0;
+  unsigned long long number = strtoull(text, &end, 10);
+  if (*end != '\0' || errno == ERANGE || number < min || number > max) {
+    return false;
+  }
+  *value = number;
+  return true;
+}
+
+static bool parse_size(const char *text, size_t min, size_t *value) {
+  uint64_t number;
+  if (!parse_unsigned(text, min, MAX_COUNT, &number)) {
+    return false;
+  }
+  *value = number;
+  return true;
+}
+
+/**
+ * Reads a finite number in [min, max] from an option's value.
+ */
+static bool parse_double(const char *text, double min, double max,
+                         double *value) {
+  char *end;
+  errno = 0;
+  double number = strtod(text, &end);
+  if (end == text || *end != '\0' || errno == ERANGE || !isfinite(number) ||
+      number < min || number > max) {
+    return false;
+  }
+  *value = number;
+  return true;
+}
+
+/**
+ * Scales the default circuit to the given lap length, keeping the spacing of
+ * its vertices, checkpoints, box rows and corners.
+ */
+static track_params_t scale_circuit(double length, uint32_t seed) {
+  track_params_t circuit = DEFAULT_CIRCUIT;
+  double scale = length / DEFAULT_CIRCUIT.length;
+  circuit.length = length;
+  circuit.seed = seed;
+  circuit.size = fmax(round(scale * DEFAULT_CIRCUIT.size), 3);
+  circuit.corners = fmax(round(scale * DEFAULT_CIRCUIT.corners), 3);
+  circuit.num_checkpoints =
+      fmax(round(scale * DEFAULT_CIRCUIT.num_checkpoints), 2);
+  circuit.num_box_rows = round(scale * DEFAULT_CIRCUIT.num_box_rows);
+  return circuit;
+}
+
+int main(int argc, char *argv[]) {
+  batch_t batch = {.track_path = DEFAULT_TRACK,
+                   .config = DEFAULT_CONFIG,
+                   .seed = DEFAULT_SEED,
+                   .num_races = DEFAULT_RACES};
+  long num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+  format_t format = FORMAT_CSV;
+  const char *out_path = NULL;
+  race_config_t *config = &batch.config;
+  bool generate = false;
+  uint32_t circuit_seed = 0;
+  double circuit_length = DEFAULT_CIRCUIT.length;
+  size_t num_checkpoints = 0;
+  const char *circuit_path = NULL;
+  uint64_t number;
+  bool valid = true;
+  int opt;
+  while (valid &&
+         (opt = getopt(argc, argv,
+                       "t:g:L:C:x:n:j:r:k:l:s:S:J:c:v:w:T:d:H:f:o:h")) != -1) {
+    switch (opt) {
+    case 't':
+      batch.track_path = optarg;
+      break;
+    case 'g':
+      generate = true;
+      valid = parse_unsigned(optarg, 0, UINT32_MAX, &number);
+      circuit_seed = number;
+      break;
+    case 'L':
+      valid = parse_double(optarg, 1, HUGE_VAL, &circuit_length);
+      break;
+    case 'C':
+      valid = parse_size(optarg, 2, &num_checkpoints);
+      break;
+    case 'x':
+      circuit_path = optarg;
+      break;
+    case 'n':
+      valid = parse_size(optarg, 1, &batch.num_races);
+      break;
+    case 'j':
+      valid = parse_unsigned(optarg, 1, MAX_COUNT, &number);
+      num_threads = number;
+      break;
+    case 'r':
+      valid = parse_unsigned(optarg, 0, UINT64_MAX, &batch.seed);
+      break;
+    case 'k':
+      valid = parse_size(optarg, 1, &config->num_karts);
+      break;
+    case 'l':
+      valid = parse_size(optarg, 1, &config->num_laps);
+      break;
+    case 's':
+      valid = parse_double(optarg, -HUGE_VAL, HUGE_VAL, &config->skill);
+      break;
+    case 'S':
+      valid =
+          parse_double(optarg, -HUGE_VAL, HUGE_VAL, &config->skill_spread);
+      break;
+    case 'J':
+      valid = parse_double(optarg, 0, HUGE_VAL, &config->skill_jitter);
+      break;
+    case 'c':
+      valid = parse_kart_type(optarg, &config->kart_type);
+      break;
+    case 'v':
+      valid = parse_double(optarg, 0, HUGE_VAL, &config->top_speed);
+      break;
+    case 'w':
+      valid = parse_double(optarg, 0, HUGE_VAL, &config->wall_elasticity);
+      break;
+    case 'T':
+      valid = parse_double(optarg, DBL_MIN, HUGE_VAL, &config->time_limit);
+      break;
+    case 'd':
+      valid = parse_double(optarg, DBL_MIN, HUGE_VAL, &config->dt);
+      break;
+    case 'H':
+      valid = parse_double(optarg, 0, HUGE_VAL, &config->shell_interval);
+      break;
+    case 'f':
+      if (strcmp(optarg, "csv") == 0) {
+        format = FORMAT_CSV;
+      } else if (strcmp(optarg, "json") == 0) {
+        format = FORMAT_JSON;
+      } else {
+        valid = false;
+      }
+      break;
+    case 'o':
+      out_path = optarg;
+      break;
+    default:
+      usage(argv[0]);
+      return opt == 'h' ? 0 : 1;
+    }
+  }
+  // Stray arguments are not options, so they are probably a mistake
+  if (!valid || optind < argc || num_threads < 1) {
+    usage(argv[0]);
+    return 1;
+  }
+  track_params_t circuit = scale_circuit(circuit_length, circuit_seed);
+  if (num_checkpoints > 0) {
+    circuit.num_checkpoints = num_checkpoints;
+    circuit.size = fmax(circuit.size, num_checkpoints);
+  }
+  char track_label[TRACK_LABEL_SIZE];
+  if (generate) {
+    // The generator asserts on circuits it cannot draw
+    if (circuit.length < 2 * M_PI * circuit.width ||
+        circuit.num_checkpoints < 2) {
+      usage(argv[0]);
+      return 1;
+    }
+    batch.circuit = &circuit;
+    snprintf(track_label, sizeof(track_label), "generated:%u:%g",
+             circuit.seed, circuit.length);
+    batch.track_path = track_label;
+  }
+  // Check the track once up front rather than in every worker
+  track_t *track = load_track(&batch);
+  if (track == NULL) {
+    return 1;
+  }
+  if (generate && circuit_path != NULL &&
+      !track_write_binary(track, circuit_path)) {
+    fprintf(stderr, "Could not write '%s'\n", circuit_path);
+    track_free(track);
+    return 1;
+  }
+  track_free(track);
+  FILE *out = out_path != NULL ? fopen(out_path, "w") : stdout;
+  if (out == NULL) {
+    fprintf(stderr, "Could not open '%s'\n", out_path);
+    return 1;
+  }
+
+  batch.results = malloc(batch.num_races * sizeof(race_result_t *));
+  assert(batch.results != NULL);
+  pthread_mutex_init(&batch.lock, NULL);
+  if ((size_t)num_threads > batch.num_races) {
+    num_threads = batch.num_races > 0 ? batch.num_races : 1;
+  }
+  pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+  assert(threads != NULL);
+  for (long i = 0; i < num_threads; i++) {
+    pthread_create(&threads[i], NULL, run_worker, &batch);
+  }
+  for (long i = 0; i < num_threads; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  fprintf(stderr, "\n");
+
+  if (format == FORMAT_CSV) {
+    print_csv(out, &batch);
+  } else {
+    print_json(out, &batch);
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+  for (size_t race = 0; race < batch.num_races; race++) {
+    race_result_free(batch.results[race]);
+  }
+  free(batch.results);
+  free(threads);
+  pthread_mutex_destroy(&batch.lock);
+  return 0;
+}
@@ -0,0 +1,161 @@
+#ifndef __AI_FIELD_H__
+#define __AI_FIELD_H__
+
+#include "ai_perception.h"
+#include "body.h"
+#include "racing_line.h"
+#include "track.h"
+#include <stddef.h>
+
+/**
+ * The computer drivers for a field of karts.
+ *
+ * Each driver follows a racing line optimized for its kart. Every tick it
+ * steers with pure pursuit, turning onto the arc that meets the line a short
+ * distance ahead, and works the throttle and brake to hold a fraction of the
+ * line's speed profile set by its skill. It drives through
+ * car_set_controls(), so it has exactly the controls and limits the player
+ * has.
+ *
+ * Rather than aim at the line itself, a driver picks one of a few points
+ * spread across the road around it, sweeping its kart towards each to find
+ * the walls, karts and items in the way (see ai_perception.h). Planning is
+ * the expensive part of an update, so it can be given a time budget: karts
+ * take turns to replan until the budget is spent, and the rest keep their
+ * last aim.
+ *
+ * Karts far from a focus, usually the player, and from every other kart do
+ * not need the physics at all. Once given a focus, the field takes them out
+ * of it (see body_set_kinematic()) and glides them along their racing lines
+ * at the speeds the profiles set, handing them back to the physics as they
+ * come near the focus or another kart.
+ *
+ * The drivers' state is kept in packed arrays indexed by kart and the whole
+ * field is updated in one pass. Karts with the same top speed and grip share
+ * a racing line, so a grid of one or two kart types optimizes only one or two
+ * lines however many karts there are.
+ */
+typedef struct ai_field ai_field_t;
+
+/**
+ * Creates an empty field of drivers.
+ *
+ * @param track the track the karts are racing on, which must outlive the
+ *   field
+ * @param capacity the most karts that will be added
+ * @return the new field
+ */
+ai_field_t *ai_field_init(track_t *track, size_t capacity);
+
+/**
+ * Releases the drivers and their racing lines. The karts are not freed.
+ */
+void ai_field_free(ai_field_t *field);
+
+/**
+ * Adds a driver for a kart, optimizing a racing line for it unless one
+ * already exists for a kart with the same top speed and grip.
+ *
+ * @param field the field
+ * @param car the kart, which must have a checkpoint state on the track and
+ *   a vehicle controller (see create_vehicle_controller())
+ * @param skill the fraction of the line's speed profile the driver holds,
+ *   from 0 to 1
+ * @return the kart's index in the field
+ */
+size_t ai_field_add(ai_field_t *field, body_t *car, double skill);
+
+/**
+ * Returns the number of karts in the field.
+ */
+size_t ai_field_size(ai_field_t *field);
+
+/**
+ * Returns the kart at the given index.
+ */
+body_t *ai_field_get_car(ai_field_t *field, size_t idx);
+
+/**
+ * Returns the racing line the kart at the given index follows.
+ */
+racing_line_t *ai_field_get_line(ai_field_t *field, size_t idx);
+
+/**
+ * Returns the fraction of its racing line's speed profile the kart at the
+ * given index holds.
+ */
+double ai_field_get_skill(ai_field_t *field, size_t idx);
+
+/**
+ * Changes the fraction of its racing line's speed profile the kart at the
+ * given index holds, from the next update.
+ */
+void ai_field_set_skill(ai_field_t *field, size_t idx, double skill);
+
+/**
+ * Returns how far the kart at the given index is aiming to the side of its
+ * racing line, positive to its left.
+ */
+double ai_field_get_aim_offset(ai_field_t *field, size_t idx);
+
+/**
+ * Limits how long each update spends planning where the karts aim. At least
+ * one kart is planned every update however small the budget.
+ *
+ * @param field the field
+ * @param budget the limit in microseconds, or 0 to plan every kart every
+ *   update, which keeps the drivers independent of the speed of the machine
+ */
+void ai_field_set_perception_budget(ai_field_t *field, double budget);
+
+/**
+ * Sets the body the karts are simulated around, such as the player's kart.
+ * Karts far from it and from each other glide along their racing lines.
+ *
+ * @param field the field
+ * @param focus the body, or NULL (the default) to simulate every kart
+ */
+void ai_field_set_focus(ai_field_t *field, body_t *focus);
+
+/**
+ * Returns whether the kart at the given index is gliding along its racing
+ * line rather than being simulated.
+ */
+bool ai_field_is_gliding(ai_field_t *field, size_t idx);
+
+/**
+ * Adds a body for the drivers to avoid during the next update. The field's
+ * own karts are always avoided. Obstacles are forgotten after each update,
+ * so they should be added again every tick.
+ *
+ * @param field the field
+ * @param body the body, which may be freed once it has been added
+ * @param type what kind of obstacle the body is
+ */
+void ai_field_add_obstacle(ai_field_t *field, body_t *body,
+                           obstacle_type_t type);
+
+/**
+ * Adds a circle for the drivers to avoid during the next update, like
+ * ai_field_add_obstacle() but for something that is not a body.
+ *
+ * @param field the field
+ * @param position the circle's center
+ * @param velocity the circle's velocity
+ * @param radius the circle's radius
+ * @param type what kind of obstacle the circle is
+ */
+void ai_field_add_circle_obstacle(ai_field_t *field, vector_t position,
+                                  vector_t velocity, double radius,
+                                  obstacle_type_t type);
+
+/**
+ * Drives every kart for one tick, except those that are stunned. Should be
+ * called after the karts' checkpoint states have been updated.
+ *
+ * @param field the field
+ * @param dt the length of the tick
+ */
+void ai_field_update(ai_field_t *field, double dt);
+
+#endif // #ifndef __AI_FIELD_H__
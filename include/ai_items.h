@@ -0,0 +1,74 @@
+#ifndef __AI_ITEMS_H__
+#define __AI_ITEMS_H__
+
+#include "ai_field.h"
+#include "body.h"
+#include "list.h"
+#include "standings.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * When the computer drivers use the items they pick up.
+ *
+ * Each driver looks at its item a few times a second rather than every
+ * frame, and the drivers take turns, so only a few decide in any frame
+ * however large the field is. A driver holds a new item for a moment, then
+ * uses it when the situation suits it:
+ * - a shell is readied at once, and thrown at a kart close ahead;
+ * - a fake item box is dropped on a kart close behind, or by the leader;
+ * - a boost or mushroom is fired on a straight;
+ * - a star is used to fend off a nearby kart, or to catch up on a straight
+ *   from the back half of the field;
+ * - scrambled controls are used on the player while the player is ahead.
+ *
+ * Karts gliding far from the player (see ai_field_set_focus()) and stunned
+ * karts hold on to their items.
+ */
+typedef struct ai_items ai_items_t;
+
+/**
+ * A function that uses a kart's item, such as throwing its shell.
+ *
+ * @param car the kart using its item
+ * @param aux the auxiliary value passed to ai_items_update()
+ */
+typedef void (*item_user_t)(body_t *car, void *aux);
+
+/**
+ * Creates the item policy for a field of drivers.
+ *
+ * @param field the drivers, which must outlive the policy
+ * @param karts every kart in the race, indexed as in the standings, which
+ *   must include the field's karts and the player
+ * @param player the player's kart
+ * @return the new policy
+ */
+ai_items_t *ai_items_init(ai_field_t *field, list_t *karts, body_t *player);
+
+/**
+ * Releases the memory allocated for the policy.
+ */
+void ai_items_free(ai_items_t *items);
+
+/**
+ * Returns whether the driver at the given index in the field would use its
+ * item now, ignoring how long it has held it.
+ */
+bool ai_items_wants_use(ai_items_t *items, size_t idx,
+                        standings_t *standings);
+
+/**
+ * Advances the policy's clock, letting the drivers whose turn it is decide,
+ * and uses the items of those that choose to.
+ *
+ * @param items the policy
+ * @param standings the current running order
+ * @param dt the time since the last update
+ * @param use uses a kart's item
+ * @param aux passed to use
+ */
+void ai_items_update(ai_items_t *items, standings_t *standings, double dt,
+                     item_user_t use, void *aux);
+
+#endif // #ifndef __AI_ITEMS_H__
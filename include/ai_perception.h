@@ -0,0 +1,125 @@
+#ifndef __AI_PERCEPTION_H__
+#define __AI_PERCEPTION_H__
+
+#include "body.h"
+#include "track.h"
+#include <stddef.h>
+
+/**
+ * What the computer drivers can see of the road ahead.
+ *
+ * A driver judges a candidate aim point by sweeping its kart's bounding
+ * circle along the straight path to it. Against the walls the sweep marches
+ * through the track's distance field, so it costs a handful of lookups
+ * however complex the track is. Against karts and items it finds each
+ * obstacle's closest approach while both keep their current velocities. The
+ * cheapest candidate balances how far it strays from the racing line against
+ * how soon and how badly it would hit something.
+ *
+ * Obstacles are snapshots of bodies' positions and velocities, so bodies may
+ * be freed once they have been added.
+ */
+typedef struct ai_perception ai_perception_t;
+
+/**
+ * The kinds of obstacle, which cost different amounts to run into.
+ */
+typedef enum { OBSTACLE_KART, OBSTACLE_HAZARD } obstacle_type_t;
+
+/**
+ * Creates a view of a track with no obstacles.
+ *
+ * @param track the track, which must outlive the perception
+ * @return the new perception
+ */
+ai_perception_t *ai_perception_init(track_t *track);
+
+/**
+ * Releases the memory allocated for the perception.
+ */
+void ai_perception_free(ai_perception_t *perception);
+
+/**
+ * Forgets every obstacle.
+ */
+void ai_perception_clear(ai_perception_t *perception);
+
+/**
+ * Adds a body to avoid, where it is now and moving as it is now.
+ *
+ * @param perception the perception
+ * @param body the body, which is only compared against the kart a candidate
+ *   is scored for from then on
+ * @param type what kind of obstacle the body is
+ */
+void ai_perception_add(ai_perception_t *perception, body_t *body,
+                       obstacle_type_t type);
+
+/**
+ * Adds a circle to avoid that is not a body, such as an item on the road.
+ *
+ * @param perception the perception
+ * @param position the circle's center
+ * @param velocity the circle's velocity
+ * @param radius the circle's radius
+ * @param type what kind of obstacle the circle is
+ */
+void ai_perception_add_circle(ai_perception_t *perception, vector_t position,
+                              vector_t velocity, double radius,
+                              obstacle_type_t type);
+
+/**
+ * Returns the number of obstacles.
+ */
+size_t ai_perception_size(ai_perception_t *perception);
+
+/**
+ * Returns the radius of a circle around a body's centroid that contains the
+ * whole body.
+ */
+double ai_perception_radius(body_t *body);
+
+/**
+ * Returns how far a circle can move along a path before it touches a wall,
+ * as a fraction of the path. A circle that starts against a wall is only
+ * stopped by coming closer to it.
+ *
+ * @param perception the perception
+ * @param from the center of the circle
+ * @param to the end of the path
+ * @param radius the radius of the circle
+ * @return 1 if the path is clear, and less the sooner it is blocked
+ */
+double ai_perception_cast_wall(ai_perception_t *perception, vector_t from,
+                               vector_t to, double radius);
+
+/**
+ * Returns the cost of the obstacles a kart would hit driving straight to a
+ * point at the given speed. Obstacles hit sooner cost more.
+ *
+ * @param perception the perception
+ * @param car the kart, which is not an obstacle to itself
+ * @param to the end of the path
+ * @param speed how fast the kart travels along the path
+ * @return 0 if nothing is in the way
+ */
+double ai_perception_cast_obstacles(ai_perception_t *perception, body_t *car,
+                                    vector_t to, double speed);
+
+/**
+ * Picks the cheapest of several aim points for a kart, counting the walls
+ * and obstacles in the way of each.
+ *
+ * @param perception the perception
+ * @param car the kart
+ * @param targets the candidate aim points
+ * @param bias each candidate's cost before anything is in the way, such as
+ *   how far it strays from the racing line
+ * @param size the number of candidates
+ * @return the index of the cheapest candidate, the first of any ties
+ */
+size_t ai_perception_choose(ai_perception_t *perception, body_t *car,
+                            const vector_t *targets, const double *bias,
+                            size_t size);
+
+#endif // #ifndef __AI_PERCEPTION_H__
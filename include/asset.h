@@ -1,21 +1,11 @@
 #ifndef __ASSET_H__
 #define __ASSET_H__
 
+#include "asset_body.h"
 #include "sdl_wrapper.h"
 #include <color.h>
 #include <stddef.h>
 
-typedef enum { ASSET_IMAGE, ASSET_FONT, ASSET_BUTTON } asset_type_t;
-
-typedef struct asset asset_t;
-
-/**
- * Gets the `asset_type_t` of the asset.
- *
- * @return the type of the asset.
- */
-asset_type_t asset_get_type(asset_t *asset);
-
 /**
  * Allocates memory for an image asset with the given parameters.
  * The image cannot be rotated
@@ -27,29 +17,6 @@ asset_type_t asset_get_type(asset_t *asset);
  */
 asset_t *asset_make_image(const char *filepath, SDL_Rect bounding_box);
 
-/**
- * Allocates memory for an image asset with an attached body. When the asset
- * is rendered, the image will be rendered on top of the body.
- * The image cannot be rotated
- *
- * @param filepath the filepath to the image file
- * @param body the body to render the image on top of
- * @return a pointer to the newly allocated image asset
- */
-asset_t *asset_make_image_with_body(const char *filepath, body_t *body);
-
-/**
- * Allocates memory for an image asset with an attached body. When the asset
- * is rendered, the image will be rendered on top of the body.
- * The image can be rotated
- *
- * @param filepath the filepath to the image file
- * @param body the body to render the image on top of
- * @return a pointer to the newly allocated image asset
- */
-asset_t *asset_make_rotatable_image_with_body(const char *filepath,
-                                              body_t *body);
-
 /**
  * Allocates memory for a text asset with the given parameters.
  *
@@ -63,11 +30,6 @@ asset_t *asset_make_rotatable_image_with_body(const char *filepath,
 asset_t *asset_make_text(const char *filepath, SDL_Rect bounding_box,
                          const char *text, rgb_color_t color);
 
-/**
- * A button handler.
- *
- * @param state the state of the game
- */
 typedef void (*button_handler_t)(void *state);
 
 /**
@@ -100,32 +62,4 @@ asset_t *asset_make_button(SDL_Rect bounding_box, asset_t *image_asset,
  */
 void asset_on_button_click(asset_t *button, state_t *state, double x, double y);
 
-/**
- * Returns the body of the asset, or NULL if there is none. The user does not
- * have ownership of the body.
- * @param asset the asset
- * @returns the body
- */
-body_t *asset_get_body(asset_t *asset);
-
-/**
- * Sets the body of the asset, if possible. The user no longer has
- * ownership of the body.
- * @param asset the asset
- * @param body the body
- */
-void asset_set_body(asset_t *asset, body_t *body);
-
-/**
- * Renders the asset to the screen.
- * @param asset the asset to render
- */
-void asset_render(asset_t *asset);
-
-/**
- * Frees the memory allocated for the asset.
- * @param asset the asset to free
- */
-void asset_destroy(asset_t *asset);
-
 #endif // #ifndef __ASSET_H__
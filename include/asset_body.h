@@ -0,0 +1,81 @@
+#ifndef __ASSET_BODY_H__
+#define __ASSET_BODY_H__
+
+#include "body.h"
+#include <stddef.h>
+
+/*
+ * The part of the asset API the game rules use, which does not need SDL:
+ * images drawn on top of bodies. The race simulator links asset_headless.c
+ * for it instead of asset.c. asset.h adds the assets placed on the screen.
+ */
+
+typedef enum { ASSET_IMAGE, ASSET_FONT, ASSET_BUTTON } asset_type_t;
+
+typedef struct asset asset_t;
+
+/**
+ * Gets the `asset_type_t` of the asset.
+ *
+ * @return the type of the asset.
+ */
+asset_type_t asset_get_type(asset_t *asset);
+
+/**
+ * Allocates memory for an image asset with an attached body. When the asset
+ * is rendered, the image will be rendered on top of the body.
+ * The image cannot be rotated
+ *
+ * @param filepath the filepath to the image file
+ * @param body the body to render the image on top of
+ * @return a pointer to the newly allocated image asset
+ */
+asset_t *asset_make_image_with_body(const char *filepath, body_t *body);
+
+/**
+ * Allocates memory for an image asset with an attached body. When the asset
+ * is rendered, the image will be rendered on top of the body.
+ * The image can be rotated
+ *
+ * @param filepath the filepath to the image file
+ * @param body the body to render the image on top of
+ * @return a pointer to the newly allocated image asset
+ */
+asset_t *asset_make_rotatable_image_with_body(const char *filepath,
+                                              body_t *body);
+
+/**
+ * A button handler.
+ *
+ * @param state the state of the game
+ */
+
+/**
+ * Returns the body of the asset, or NULL if there is none. The user does not
+ * have ownership of the body.
+ * @param asset the asset
+ * @returns the body
+ */
+body_t *asset_get_body(asset_t *asset);
+
+/**
+ * Sets the body of the asset, if possible. The user no longer has
+ * ownership of the body.
+ * @param asset the asset
+ * @param body the body
+ */
+void asset_set_body(asset_t *asset, body_t *body);
+
+/**
+ * Renders the asset to the screen.
+ * @param asset the asset to render
+ */
+void asset_render(asset_t *asset);
+
+/**
+ * Frees the memory allocated for the asset.
+ * @param asset the asset to free
+ */
+void asset_destroy(asset_t *asset);
+
+#endif // #ifndef __ASSET_BODY_H__
@@ -145,12 +145,30 @@ void body_set_velocity(body_t *body, vector_t v);
  */
 void body_set_rotation(body_t *body, double angle);
 
+/**
+ * Gets how fast a body is turning.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return the body's angular velocity in radians per second
+ */
+double body_get_angular_velocity(body_t *body);
+
+/**
+ * Changes how fast a body turns about its center of mass; body_tick() turns
+ * it by this much per second. Kinematic bodies are not turned.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param omega the body's new angular velocity in radians per second.
+ *   Positive is counterclockwise.
+ */
+void body_set_angular_velocity(body_t *body, double omega);
+
 /**
  * Updates the body after a given time interval has elapsed.
  * Sets acceleration and velocity according to the forces and impulses
  * applied to the body during the tick.
  * The body should be translated at the *average* of the velocities before
- * and after the tick.
+ * and after the tick, and turned at its angular velocity.
  * Resets the forces and impulses accumulated on the body.
  *
  * @param body the body to tick
@@ -206,4 +224,23 @@ void body_remove(body_t *body);
  */
 bool body_is_removed(body_t *body);
 
+/**
+ * Sets whether a body is kinematic. A kinematic body is moved only by
+ * whoever sets its position and velocity: body_tick() moves it at its
+ * velocity and discards the forces and impulses applied to it, and force
+ * creators may skip it altogether.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @param kinematic whether the body is kinematic
+ */
+void body_set_kinematic(body_t *body, bool kinematic);
+
+/**
+ * Returns whether a body is kinematic; bodies start out not kinematic.
+ *
+ * @param body a pointer to a body returned from body_init()
+ * @return whether the body is kinematic
+ */
+bool body_is_kinematic(body_t *body);
+
 #endif // #ifndef __BODY_H__
@@ -1,43 +1,39 @@
 #ifndef __CAR_H__
 #define __CAR_H__
 
-#include "asset.h"
+#include "asset_body.h"
 #include "body.h"
 #include "checkpoints.h"
+#include "kart_store.h"
 #include "list.h"
 #include "power_up.h"
+#include "scene.h"
+#include "timer_wheel.h"
+#include "track.h"
 #include <stdint.h>
 #include <stdlib.h>
 
-typedef enum {
-  F1,
-  GOLF_CART,
-  PICKUP,
-} car_type_t;
-
-typedef struct car_info car_info_t;
-
 typedef struct AI_info AI_info_t;
 
 typedef struct ghost_info ghost_info_t;
 
 typedef enum { EASY_AI, MEDIUM_AI, HARD_AI, GHOST } villain_type_t;
 
-typedef struct power_up_info {
-  size_t power_up;
-  double immune;
-  double stun;
-  double reverse;
-  double fast;
-  body_t *shell;
-} power_up_info_t;
+/*
+ * A car is a body tied to a kart in a kart store (see kart_store.h), which
+ * holds the kart's state. The functions taking a car look its state up in
+ * the store, for code that works on one car at a time.
+ */
+
+/**
+ * Returns the store holding the car's state.
+ */
+kart_store_t *car_get_store(body_t *car);
 
 /**
- * A function that initializes a car_info_t struct with the given type and
- * physical values. Returns a pointer to the initialized car info struct.
+ * Returns the car's ID in its store.
  */
-car_info_t *make_car_info(car_type_t type, double friction, double top_speed,
-                          double acceleration);
+size_t car_get_id(body_t *car);
 
 /**
  * A function that returns the checkpoint_state of the car.
@@ -81,6 +77,41 @@ power_up_info_t car_get_powerup_state(body_t *car);
  */
 void car_set_powerup_state(body_t *car, power_up_info_t power_up_info);
 
+/**
+ * Returns how much the car's active power ups raise its top speed, 1 when it
+ * has none.
+ */
+double car_get_speed_multiplier(body_t *car);
+
+/**
+ * Puts the car under an effect for at least the given time, or makes one it
+ * is already under last that long. The effect wears off when a timer on the
+ * given clock runs out, so the car must outlive the clock or the clock must
+ * stop being advanced once the car is freed.
+ *
+ * @param car the car
+ * @param timers the clock the race is timed by
+ * @param effect the effect
+ * @param duration how long the effect lasts from now, in seconds
+ */
+void car_start_effect(body_t *car, timer_wheel_t *timers, car_effect_t effect,
+                      double duration);
+
+/**
+ * Returns whether the car is under an effect.
+ */
+bool car_has_effect(body_t *car, car_effect_t effect);
+
+/**
+ * Returns how many times the car has run into another kart.
+ */
+size_t car_get_kart_hits(body_t *car);
+
+/**
+ * Counts a new collision between the car and another kart.
+ */
+void car_add_kart_hit(body_t *car);
+
 /**
  * A function that returns the type of the car.
  * Pointer to car body passed in as a parameter.
@@ -106,13 +137,102 @@ double car_get_acceleration(body_t *car);
 double car_get_top_speed(body_t *car);
 
 /**
- * Function to call in main that returns a body to the last
- * checkpoint if it accidentally leaves the track
+ * Returns the largest sideways acceleration the car's tires can hold in a
+ * corner, which sets how tightly it can turn at a given speed.
+ */
+double car_get_grip(body_t *car);
+
+/**
+ * Sets the controls the car is driven with until they are next set, the way
+ * the arrow keys drive the player's car. The AI drives through this too, so
+ * it has the same limits as the player. Each control is clamped to its
+ * range.
+ */
+void car_set_controls(body_t *car, car_controls_t controls);
+
+/**
+ * Returns the controls the car is driven with.
+ */
+car_controls_t car_get_controls(body_t *car);
+
+/**
+ * Returns how fast the car turns at full lock at its current speed, in
+ * radians per second: as fast as the friction of its tires allows, and no
+ * tighter than its smallest turning circle. A car that is not moving does
+ * not turn.
+ */
+double car_get_turn_rate(body_t *car);
+
+/**
+ * Function to call in main that puts a car back on the track, facing the
+ * right way, if it has left the road or has been going the wrong way for too
+ * long. The pose comes from the track's respawn table.
+ *
+ * @param car the car
+ * @return whether the car was moved
+ */
+bool car_respawn(body_t *car);
+
+/**
+ * Adds a force creator to a scene that slows or pushes the car according to
+ * the surface under it (see surface.h). Replaces a constant create_drag().
+ *
+ * @param scene the scene containing the car
+ * @param track the track the car is racing on
+ * @param car the car
+ */
+void create_surface_forces(scene_t *scene, track_t *track, body_t *car);
+
+/**
+ * Adds a force creator to a scene that drives the car with its controls
+ * during each physics step, so it handles the same at any frame rate. The
+ * throttle and brake push the car along its heading up to its top speed, the
+ * tires push back on any sideways slide with up to their grip, and the
+ * steering turns the car at up to car_get_turn_rate(). A stunned car is not
+ * driven.
+ *
+ * @param scene the scene containing the car
+ * @param car the car
+ */
+void create_vehicle_controller(scene_t *scene, body_t *car);
+
+/**
+ * Adds a force creator to a scene that keeps a body inside the track walls.
+ * A single force creator tests the body against every wall segment, and
+ * skips the tests entirely when the body is far from the walls.
+ *
+ * @param scene the scene containing the body
+ * @param track the track whose walls to collide with
+ * @param body a rectangular body, such as a car
+ * @param elasticity the elasticity of the bounce off a wall
+ */
+void create_wall_collision(scene_t *scene, track_t *track, body_t *body,
+                           double elasticity);
+
+/**
+ * Like create_wall_collision(), and also counts each new contact between the
+ * body and a wall.
+ *
+ * @param hits incremented on every new wall contact; must stay valid while
+ *   the scene holds the force creator
+ */
+void create_counted_wall_collision(scene_t *scene, track_t *track,
+                                   body_t *body, double elasticity,
+                                   size_t *hits);
+
+/**
+ * Makes a car of the given type as a new kart in a store. Freeing the car's
+ * body removes the kart from the store.
+ *
+ * @param store the store, which must not be full
+ * @param type the type of car
+ * @return the car's body
  */
-void car_respawn(body_t *car);
+body_t *make_car_in_store(kart_store_t *store, car_type_t type);
 
 /**
- * A function that initializes a car body with the given type.
+ * A function that initializes a car body with the given type, in a store of
+ * its own that is freed with it.
  * Returns a pointer to the initialized car body.
  */
 body_t *make_car(car_type_t type);
@@ -1,34 +1,31 @@
 #ifndef __CHECKPOINTS_H__
 #define __CHECKPOINTS_H__
 
-#include "asset.h"
 #include "body.h"
-#include "list.h"
+#include "track.h"
 #include "vector.h"
 
-typedef struct checkpoint_state checkpoint_state_t;
-
-typedef struct checkpoint_info checkpoint_info_t;
-
 /**
- * Function to create a list of checkpoints between the given in_wall and
- * out_wall Requires that in_wall and out_wall are the same length
- * Accepts a start state which indicates the start and finish line.
- * Accepts an offset for the start index relative to the list
+ * A kart's progress around the track. Progress is the arc length along the
+ * track's centerline from the start line, and the checkpoints are positions
+ * on that same scale, so the state is updated from the kart's position alone
+ * instead of from checkpoint collisions.
  */
-list_t *make_checkpoints(list_t *in_wall, list_t *out_wall, vector_t start_i,
-                         vector_t start_o, size_t start_offset);
+typedef struct checkpoint_state checkpoint_state_t;
 
 /**
- * Function to get the index of a checkpoint body
+ * Function to initialize the checkpoint state for a kart racing on a track.
+ * Returns a pointer to initialized checkpoint state struct
  */
-size_t get_checkpoint_idx(body_t *checkpoint);
+checkpoint_state_t *checkpoint_state_init(track_t *track);
 
 /**
- * Function to initialize the checkpoint state from a list of checkpoints
- * Returns a pointer to initialized checkpoint state struct
+ * Function to update the checkpoint state from the car's current position.
+ * Should be called once per tick after the scene has been re-centered and
+ * the track origin updated.
  */
-checkpoint_state_t *checkpoint_state_init(list_t *checkpoints);
+void checkpoint_state_update(checkpoint_state_t *checkpoint_state,
+                             body_t *car);
 
 /**
  * Function to reset the checkpoint state to the settings as they would
@@ -38,6 +35,7 @@ void reset_checkpoint_state(checkpoint_state_t *checkpoint_state);
 
 /**
  * Function to free the memory allocated for checkpoint state.
+ * The track is not freed.
  */
 void checkpoint_state_free(checkpoint_state_t *checkpoint_state);
 
@@ -51,6 +49,23 @@ double get_wrong_way_time(checkpoint_state_t *checkpoint_state);
  */
 void set_wrong_way_time(checkpoint_state_t *checkpoint_state, double time);
 
+/**
+ * Function to get the track the checkpoint state follows.
+ */
+track_t *get_track(checkpoint_state_t *checkpoint_state);
+
+/**
+ * Function to get the distance along the centerline from the start line.
+ */
+double get_progress(checkpoint_state_t *checkpoint_state);
+
+/**
+ * Function to get the distance into the current lap. Unlike get_progress()
+ * this is negative for a car that has backed over the start line without
+ * finishing the lap, so it can be added to the completed lap distance.
+ */
+double get_lap_progress(checkpoint_state_t *checkpoint_state);
+
 /**
  * Function to get the index of the current checkpoint.
  */
@@ -61,6 +76,18 @@ size_t get_current_checkpoint(checkpoint_state_t *checkpoint_state);
  */
 size_t get_furthest_checkpoint(checkpoint_state_t *checkpoint_state);
 
+/**
+ * Function to get the number of checkpoints, including the start line.
+ */
+size_t get_num_checkpoints(checkpoint_state_t *checkpoint_state);
+
+/**
+ * Function to get the scene positions of the inner and outer ends of the
+ * checkpoint line at the given index.
+ */
+void get_checkpoint_line(checkpoint_state_t *checkpoint_state, size_t idx,
+                         vector_t *in, vector_t *out);
+
 /**
  * Function to check if a lap is over.
  */
@@ -72,13 +99,7 @@ bool get_lap_over(checkpoint_state_t *checkpoint_state);
 bool get_wrong_way(body_t *car, checkpoint_state_t *checkpoint_state);
 
 /**
- * Function to get the list of checkpoints.
- */
-list_t *get_checkpoints(checkpoint_state_t *checkpoint_state);
-
-/**
- * Function to get the right way direction vector from the current to
- * the next vector
+ * Function to get the direction of the track at the car's progress
  */
 vector_t get_right_way(checkpoint_state_t *checkpoint_state);
 
@@ -89,12 +110,4 @@ vector_t get_right_way(checkpoint_state_t *checkpoint_state);
 vector_t get_right_way_from_position(checkpoint_state_t *checkpoint_state,
                                      body_t *car);
 
-/**
- * Function to handle collision of a car with a checkpoint.
- * Aux should be the checkpoint state of game which is updated after
- * colision
- */
-void checkpoint_collision(body_t *car, body_t *checkpoint, vector_t axis,
-                          void *aux, double force_const);
-
-#endif // #ifndef __CHECKPOINT_H__
\ No newline at end of file
+#endif // #ifndef __CHECKPOINT_H__
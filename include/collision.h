@@ -32,4 +32,30 @@ typedef struct {
  */
 collision_info_t find_collision(body_t *body1, body_t *body2);
 
+/**
+ * A thin static wall: a line segment with the side bodies belong on.
+ */
+typedef struct segment {
+  vector_t start;
+  vector_t end;
+  /** Unit normal pointing to the side bodies are pushed back to */
+  vector_t normal;
+} segment_t;
+
+/**
+ * Computes the status of the collision between a rectangular body and a
+ * capsule: a segment thickened by a radius. The test is closed form for an
+ * oriented box, so it needs no edge lists, and the rounded ends of the
+ * capsule cannot be slipped past.
+ *
+ * @param body a body whose shape is a rectangle (see make_rectangle())
+ * @param segment the core of the capsule
+ * @param radius the radius of the capsule
+ * @return whether the shapes are colliding, and if so, the contact normal as
+ * a unit vector pointing from the body towards the segment. A body that has
+ * crossed the segment gets the opposite of the segment's normal.
+ */
+collision_info_t find_segment_collision(body_t *body, segment_t segment,
+                                        double radius);
+
 #endif // #ifndef __COLLISION_H__
@@ -0,0 +1,62 @@
+#ifndef __DISTANCE_FIELD_H__
+#define __DISTANCE_FIELD_H__
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A signed distance field sampled on a regular grid. The field describes the
+ * road between two closed boundaries: it is the distance to the nearest
+ * boundary, positive on the road and negative inside the inner boundary or
+ * outside the outer one. Lookups interpolate bilinearly between grid nodes,
+ * so every query is O(1) regardless of the shape of the boundaries.
+ *
+ * Distances are exact near the boundaries and clamped far from them, which
+ * keeps the bake proportional to the length of the boundaries rather than
+ * to their length times the area of the grid.
+ */
+typedef struct distance_field distance_field_t;
+
+/**
+ * Bakes a distance field covering the rectangle from min to max.
+ *
+ * @param min the corner of the grid with the smallest coordinates
+ * @param max the corner of the grid with the largest coordinates
+ * @param cell_size the spacing between grid nodes
+ * @param inner the inner boundary of the road
+ * @param outer the outer boundary of the road
+ * @param size the number of vertices on each boundary
+ * @return the new distance field
+ */
+distance_field_t *distance_field_init(vector_t min, vector_t max,
+                                      double cell_size, const vector_t *inner,
+                                      const vector_t *outer, size_t size);
+
+/**
+ * Releases the memory allocated for a distance field.
+ */
+void distance_field_free(distance_field_t *field);
+
+/**
+ * Returns the interpolated signed distance at a point. Points outside the
+ * grid use the value at the nearest edge of the grid.
+ */
+double distance_field_sample(distance_field_t *field, vector_t point);
+
+/**
+ * Returns the gradient of the field at a point, which has a length of about
+ * 1. On the road it points away from the nearest boundary, and off the road
+ * it points back towards the road.
+ */
+vector_t distance_field_gradient(distance_field_t *field, vector_t point);
+
+/**
+ * Returns the closest point to `point` that is at least `margin` away from
+ * both boundaries, found by stepping along the gradient. Points that already
+ * satisfy the margin are returned unchanged.
+ */
+vector_t distance_field_nearest(distance_field_t *field, vector_t point,
+                                double margin);
+
+#endif // #ifndef __DISTANCE_FIELD_H__
@@ -122,6 +122,30 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                       collision_handler_t handler, void *aux,
                       double force_const);
 
+/**
+ * Adds a single force creator to a scene that calls a collision handler each
+ * time two bodies in a group collide, or, if `others` is not NULL, each time
+ * a body in the group collides with one of the others. The handler is called
+ * like create_collision()'s, with the group's body first.
+ *
+ * Pairs whose bounding circles do not overlap are skipped without running the
+ * full collision test, so a large group of bodies that are mostly apart costs
+ * little more each tick than a handful of pairs. The force creator is removed
+ * when any of its bodies is.
+ *
+ * @param scene the scene containing the bodies
+ * @param group the bodies to test against each other or against `others`;
+ *   the list is copied
+ * @param others may be NULL; otherwise the bodies to test the group against,
+ *   which are not tested against each other; the list is copied
+ * @param handler a function to call whenever two of the bodies collide
+ * @param aux an auxiliary value to pass to the handler
+ * @param force_const a constant to pass to the handler
+ */
+void create_group_collision(scene_t *scene, list_t *group, list_t *others,
+                            collision_handler_t handler, void *aux,
+                            double force_const);
+
 /**
  * Adds a force creator to a scene that destroys two bodies when they collide.
  * The bodies should be destroyed by calling body_remove().
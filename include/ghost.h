@@ -0,0 +1,117 @@
+#ifndef __GHOST_H__
+#define __GHOST_H__
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A recorded lap that can be raced against as a ghost.
+ *
+ * The kart's pose is sampled at a fixed rate, in track coordinates so the
+ * recording does not depend on where the scene has scrolled. Each sample is
+ * quantized and stored as the difference from a straight-line prediction
+ * off the two samples before it, zigzag-encoded in as few bytes as it needs.
+ * A kart that holds its line and speed predicts well, so most samples take
+ * three bytes and a whole lap takes a few KB.
+ */
+typedef struct ghost ghost_t;
+
+/**
+ * Plays a ghost back. The player decodes samples as playback reaches them
+ * and keeps the few it needs to interpolate in a ring buffer, so each frame
+ * costs at most a sample's decoding and one spline evaluation.
+ */
+typedef struct ghost_player ghost_player_t;
+
+/**
+ * Where a ghost is at a moment of its lap.
+ */
+typedef struct ghost_pose {
+  vector_t position;
+  double rotation;
+} ghost_pose_t;
+
+/**
+ * Starts an empty recording.
+ */
+ghost_t *ghost_init(void);
+
+/**
+ * Releases the memory allocated for a ghost.
+ */
+void ghost_free(ghost_t *ghost);
+
+/**
+ * Records the kart's pose at the given time since the lap started. Calls must
+ * come in order of time, e.g. once a frame; the samples that fall between
+ * this call and the last are interpolated from the two.
+ *
+ * @param ghost the recording
+ * @param time the time since the start of the lap
+ * @param pose the kart's position in track coordinates and its rotation
+ */
+void ghost_record(ghost_t *ghost, double time, ghost_pose_t pose);
+
+/**
+ * Ends the recording at the lap time. The kart is usually found over the line
+ * a little after crossing it, so the lap time may be before the last pose
+ * recorded; the recording is extended to a sample past the line.
+ *
+ * @param ghost the recording, with at least one pose recorded
+ * @param lap_time the time the kart crossed the line
+ */
+void ghost_finish(ghost_t *ghost, double lap_time);
+
+/**
+ * Returns the time of the recorded lap, or INFINITY if it was not finished.
+ */
+double ghost_get_lap_time(ghost_t *ghost);
+
+/**
+ * Returns the number of samples recorded.
+ */
+size_t ghost_get_num_samples(ghost_t *ghost);
+
+/**
+ * Returns the number of bytes the encoded samples take.
+ */
+size_t ghost_get_size(ghost_t *ghost);
+
+/**
+ * Reads a ghost written by ghost_write().
+ *
+ * @param path the path to the file
+ * @return the ghost, or NULL if the file is missing or malformed
+ */
+ghost_t *ghost_read(const char *path);
+
+/**
+ * Writes a ghost to a file.
+ *
+ * @return whether the file was written
+ */
+bool ghost_write(ghost_t *ghost, const char *path);
+
+/**
+ * Starts playing a ghost from the start of its lap.
+ *
+ * @param ghost the ghost, which must outlive the player and not be recorded
+ *   to while it plays
+ */
+ghost_player_t *ghost_player_init(ghost_t *ghost);
+
+/**
+ * Releases the player. The ghost is not freed.
+ */
+void ghost_player_free(ghost_player_t *player);
+
+/**
+ * Returns the ghost's pose, in track coordinates, at the given time since the
+ * start of its lap. Times before the start or after the end of the lap give
+ * the first or last pose. Playback is fastest when the time moves forward
+ * from call to call; going back restarts decoding from the start of the lap.
+ */
+ghost_pose_t ghost_player_pose_at(ghost_player_t *player, double time);
+
+#endif // #ifndef __GHOST_H__
@@ -0,0 +1,87 @@
+#ifndef __INPUT_H__
+#define __INPUT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * The player's controls, each driven by one key.
+ */
+typedef enum {
+  ACTION_LEFT,
+  ACTION_AHEAD,
+  ACTION_RIGHT,
+  ACTION_BACK,
+  ACTION_ITEM,
+  ACTION_FLIP,
+  NUM_ACTIONS
+} action_t;
+
+/**
+ * The controls as they stood at one tick. Each action is a bit, set in held
+ * while its key is down and in pressed if its key went down since the last
+ * snapshot, even if it has already been released.
+ */
+typedef struct input_snapshot {
+  uint8_t held;
+  uint8_t pressed;
+  // How long each held action has been held, in seconds
+  float held_times[NUM_ACTIONS];
+} input_snapshot_t;
+
+/**
+ * The state of the controls between ticks.
+ *
+ * Key presses and releases update a bitset of held actions as they arrive,
+ * and each tick takes one snapshot of it. Nothing is scanned per tick, so
+ * the cost of input is proportional to the number of key events, and every
+ * held action is seen exactly once per tick however many events arrived.
+ */
+typedef struct input input_t;
+
+/**
+ * Allocates the controls with nothing held.
+ */
+input_t *input_init(void);
+
+/**
+ * Releases the memory allocated for the controls.
+ */
+void input_free(input_t *input);
+
+/**
+ * Records a key going down. Repeated presses while the key is held are
+ * ignored.
+ *
+ * @param input the controls
+ * @param action the key's action
+ * @param time the time of the press in seconds
+ */
+void input_press(input_t *input, action_t action, double time);
+
+/**
+ * Records a key coming up.
+ */
+void input_release(input_t *input, action_t action);
+
+/**
+ * Takes the snapshot for a tick and starts collecting presses for the next.
+ *
+ * @param input the controls
+ * @param time the time of the tick in seconds, on the same clock as the
+ *   presses
+ * @return the snapshot
+ */
+input_snapshot_t input_take_snapshot(input_t *input, double time);
+
+/**
+ * Returns whether an action is held in a snapshot.
+ */
+bool input_is_held(const input_snapshot_t *snapshot, action_t action);
+
+/**
+ * Returns whether an action was pressed since the previous snapshot.
+ */
+bool input_was_pressed(const input_snapshot_t *snapshot, action_t action);
+
+#endif // #ifndef __INPUT_H__
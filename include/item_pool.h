@@ -0,0 +1,164 @@
+#ifndef __ITEM_POOL_H__
+#define __ITEM_POOL_H__
+
+#include "body.h"
+#include "list.h"
+#include "timer_wheel.h"
+#include "track.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The items on the road: the track's item boxes, and the fake boxes, shells
+ * and boost pads the karts put down.
+ *
+ * Items are not bodies in the scene. Each is a circle whose state is kept in
+ * parallel arrays, in track coordinates so re-centering the scene does not
+ * move them. Once per tick the pool steers the homing shells, moves the
+ * shells, sweeping loose ones through the track's walls so they bounce off
+ * them at any speed, sorts every item into a grid over the track and looks
+ * up the cells around each kart and shell. Using an item never registers
+ * new force creators, and hundreds of shells cost little more than a few.
+ * Emptied boxes refill, and the karts' stuns and boosts wear off, on timers
+ * on the race's clock. Each kind of item is drawn by moving one sprite to
+ * every item of that kind.
+ */
+typedef struct item_pool item_pool_t;
+
+/**
+ * The kinds of item on the road.
+ */
+typedef enum {
+  // Gives a kart that touches it an item, then hides until it refills
+  ITEM_BOX,
+  // Looks like a box, but stuns a kart that touches it and is used up
+  ITEM_FAKE,
+  // Circles the kart that holds it until thrown, or seeks a kart once fired,
+  // and stuns any other kart it touches, or the thrower once loose. Two
+  // shells that touch destroy each other.
+  ITEM_SHELL,
+  // Boosts the kart that put it down each time it drives onto it
+  ITEM_BOOST,
+  NUM_ITEM_KINDS
+} item_kind_t;
+
+/**
+ * Creates a pool holding the track's item boxes.
+ *
+ * @param track the track, which must outlive the pool and have its origin
+ *   kept in sync with the scene
+ * @param karts the karts that pick up and run into items, which must not
+ *   change while the pool is in use
+ * @param switches which power ups boxes may give, indexed by
+ *   power_up_type_t; must outlive the pool
+ * @param timers the clock the race is timed by, which must outlive the pool
+ * @param seed the seed of the random numbers the boxes draw items with, so a
+ *   race with the same seed gives out the same items
+ * @return the new pool
+ */
+item_pool_t *item_pool_init(track_t *track, list_t *karts, bool *switches,
+                            timer_wheel_t *timers, uint64_t seed);
+
+/**
+ * Releases the memory allocated for the pool, and stops its boxes' refill
+ * timers.
+ */
+void item_pool_free(item_pool_t *pool);
+
+/**
+ * Returns the number of items in the pool.
+ */
+size_t item_pool_size(item_pool_t *pool);
+
+/**
+ * Returns the kind of the item at the given index.
+ */
+item_kind_t item_pool_get_kind(item_pool_t *pool, size_t idx);
+
+/**
+ * Returns the center of the item at the given index in scene coordinates.
+ */
+vector_t item_pool_get_position(item_pool_t *pool, size_t idx);
+
+/**
+ * Returns the velocity of the item at the given index.
+ */
+vector_t item_pool_get_velocity(item_pool_t *pool, size_t idx);
+
+/**
+ * Returns the radius of the item at the given index.
+ */
+double item_pool_get_radius(item_pool_t *pool, size_t idx);
+
+/**
+ * Returns whether the item at the given index is something to steer around:
+ * a fake box or a loose shell.
+ */
+bool item_pool_is_hazard(item_pool_t *pool, size_t idx);
+
+/**
+ * Puts a fake box on the road.
+ *
+ * @param pool the pool
+ * @param center the box's center in scene coordinates
+ */
+void item_pool_add_fake(item_pool_t *pool, vector_t center);
+
+/**
+ * Gives a kart a shell to circle it until it is thrown (see car_has_shell()).
+ *
+ * @param pool the pool
+ * @param car the kart, which must be one of the pool's karts
+ * @param angle where on its circle the shell starts, in radians
+ * @param spin how fast the shell circles, in radians per second
+ */
+void item_pool_add_shell(item_pool_t *pool, body_t *car, double angle,
+                         double spin);
+
+/**
+ * Lets go of the shell circling a kart, which flies on at the velocity it
+ * had. Does nothing if the kart has no shell.
+ */
+void item_pool_throw_shell(item_pool_t *pool, body_t *car);
+
+/**
+ * Reverses the direction the shell circling a kart goes round in. Does
+ * nothing if the kart has no shell.
+ */
+void item_pool_flip_shell(item_pool_t *pool, body_t *car);
+
+/**
+ * Fires a homing shell from a kart's nose at the kart the least far ahead of
+ * it round the lap. The shell follows the road until it is close to its
+ * target, then turns straight for it, and breaks if it has not hit anything
+ * after a few seconds. A kart may fire any number of homing shells.
+ *
+ * @param pool the pool
+ * @param car the kart, which must be one of the pool's karts
+ */
+void item_pool_add_homing_shell(item_pool_t *pool, body_t *car);
+
+/**
+ * Puts a boost pad under a kart, facing the way it faces.
+ *
+ * @param pool the pool
+ * @param car the kart, which must be one of the pool's karts
+ */
+void item_pool_add_boost(item_pool_t *pool, body_t *car);
+
+/**
+ * Moves the shells and resolves every contact between the items and the
+ * karts and between shells, removing the items that are used up. Should be
+ * called once per tick, after the scene has been ticked and re-centered.
+ *
+ * @param pool the pool
+ * @param dt the length of the tick
+ */
+void item_pool_update(item_pool_t *pool, double dt);
+
+/**
+ * Draws the items, except boxes that are refilling.
+ */
+void item_pool_render(item_pool_t *pool);
+
+#endif // #ifndef __ITEM_POOL_H__
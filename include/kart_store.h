@@ -0,0 +1,179 @@
+#ifndef __KART_STORE_H__
+#define __KART_STORE_H__
+
+#include "checkpoints.h"
+#include "timer_wheel.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The state of the karts in a race, kept as components: one dense array for
+ * each kind of state, indexed by kart ID. A system that needs one kind of
+ * state for every kart, such as the lap counter or the standings, walks that
+ * one array. The power ups' effects are switched off in place by timers on
+ * the race's clock.
+ *
+ * A kart's ID is the order it was added in. The arrays are allocated once,
+ * for the capacity the store is made with, so IDs and pointers into the
+ * arrays stay valid as long as the store does. Karts are usually added by
+ * make_car_in_store() (see car.h), which ties a car's body to its ID.
+ */
+typedef struct kart_store kart_store_t;
+
+typedef enum {
+  F1,
+  GOLF_CART,
+  PICKUP,
+} car_type_t;
+
+/**
+ * How a kart drives, which is set by its type.
+ */
+typedef struct kart_stats {
+  car_type_t type;
+  double friction;
+  double top_speed;
+  double acceleration;
+} kart_stats_t;
+
+/**
+ * The controls a car is driven with, which its vehicle controller (see
+ * create_vehicle_controller()) works at every physics step.
+ */
+typedef struct car_controls {
+  // From -1, braking and then reversing as hard as possible, to 1, full
+  // throttle
+  double throttle;
+  // From -1, full lock to the right, to 1, full lock to the left
+  double steer;
+} car_controls_t;
+
+/**
+ * The item a kart holds.
+ */
+typedef struct power_up_info {
+  size_t power_up;
+  bool shell; // whether a shell circles the car (see item_pool.h)
+} power_up_info_t;
+
+/**
+ * The power ups' effects on a car, which wear off after a while (see
+ * car_start_effect()).
+ */
+typedef enum {
+  // Can't be stunned, and faster (a star)
+  EFFECT_IMMUNE,
+  // Spins out of control, not driven
+  EFFECT_STUN,
+  // Controls scrambled
+  EFFECT_REVERSE,
+  // Faster (a mushroom or boost pad)
+  EFFECT_FAST,
+  // Stunned too recently to be stunned again
+  EFFECT_STUN_COOLDOWN,
+  NUM_EFFECTS
+} car_effect_t;
+
+/**
+ * Whether an effect is on, and the timer that switches it off.
+ */
+typedef struct effect_timer {
+  bool on;
+  timer_id_t id;
+} effect_timer_t;
+
+/**
+ * The effects a kart is under, indexed by car_effect_t.
+ */
+typedef struct kart_effects {
+  effect_timer_t effects[NUM_EFFECTS];
+} kart_effects_t;
+
+/**
+ * How far a kart has got in the race.
+ */
+typedef struct kart_progress {
+  // Owned by the store once set, and freed when the kart is removed
+  checkpoint_state_t *checkpoint_state;
+  uint8_t laps_done;
+  size_t kart_hits;
+} kart_progress_t;
+
+/**
+ * Allocates a store with no karts.
+ *
+ * @param capacity the most karts the store can hold
+ * @return the new store
+ */
+kart_store_t *kart_store_init(size_t capacity);
+
+/**
+ * Releases the store. Its memory is freed once every kart added to it has
+ * been removed too, so the bodies of its karts may be freed after this.
+ */
+void kart_store_free(kart_store_t *store);
+
+/**
+ * Adds a kart that holds no item, is under no effect and has not started
+ * racing, with its controls at rest.
+ *
+ * @param store the store, which must not be full
+ * @param stats how the kart drives
+ * @return the kart's ID
+ */
+size_t kart_store_add(kart_store_t *store, kart_stats_t stats);
+
+/**
+ * Takes a kart out of the race, freeing its checkpoint state. Its ID is not
+ * reused, and its components are left as they were.
+ */
+void kart_store_remove(kart_store_t *store, size_t id);
+
+/**
+ * Returns the number of karts that have been added to the store.
+ */
+size_t kart_store_size(kart_store_t *store);
+
+/**
+ * Returns each kart's stats, indexed by kart ID.
+ */
+kart_stats_t *kart_store_get_stats(kart_store_t *store);
+
+/**
+ * Returns each kart's controls, indexed by kart ID.
+ */
+car_controls_t *kart_store_get_controls(kart_store_t *store);
+
+/**
+ * Returns the item each kart holds, indexed by kart ID.
+ */
+power_up_info_t *kart_store_get_items(kart_store_t *store);
+
+/**
+ * Returns the effects each kart is under, indexed by kart ID.
+ */
+kart_effects_t *kart_store_get_effects(kart_store_t *store);
+
+/**
+ * Returns how far each kart has got, indexed by kart ID.
+ */
+kart_progress_t *kart_store_get_progress(kart_store_t *store);
+
+/**
+ * Puts a kart under an effect for at least the given time, or makes one it
+ * is already under last that long. The effect wears off when a timer on the
+ * given clock runs out, so the store must outlive the clock or the clock
+ * must stop being advanced once the store is freed.
+ *
+ * @param store the store
+ * @param id the kart's ID
+ * @param timers the clock the race is timed by
+ * @param effect the effect
+ * @param duration how long the effect lasts from now, in seconds
+ */
+void kart_store_start_effect(kart_store_t *store, size_t id,
+                             timer_wheel_t *timers, car_effect_t effect,
+                             double duration);
+
+#endif // #ifndef __KART_STORE_H__
@@ -0,0 +1,111 @@
+#ifndef __LAP_TIMER_H__
+#define __LAP_TIMER_H__
+
+#include "track.h"
+#include <stddef.h>
+
+/**
+ * Lap, sector and split timing for one kart.
+ *
+ * The timer is driven by the kart's lap progress (see get_lap_progress()).
+ * Every update records the time at which the kart passed each sample point,
+ * spaced evenly along the lap, and the end of each of the track's sectors,
+ * interpolating between updates. The fastest lap's samples form a
+ * distance-time table, so the live delta to the best lap is a lookup at the
+ * kart's current progress. All memory is allocated by lap_timer_init(), so
+ * updates never allocate.
+ */
+typedef struct lap_timer lap_timer_t;
+
+/**
+ * Allocates a timer for a kart racing on a track.
+ *
+ * @param track the track, which must outlive the timer
+ * @param max_laps how many of the most recent laps keep a time record
+ * @return the new timer
+ */
+lap_timer_t *lap_timer_init(track_t *track, size_t max_laps);
+
+/**
+ * Releases the memory allocated for the timer. The track is not freed.
+ */
+void lap_timer_free(lap_timer_t *timer);
+
+/**
+ * Advances the current lap. Should be called once per tick after the kart's
+ * checkpoint state has been updated, on every tick that does not finish a
+ * lap.
+ *
+ * @param timer the timer
+ * @param progress the kart's distance into the current lap
+ * @param dt the time since the last update
+ */
+void lap_timer_update(lap_timer_t *timer, double progress, double dt);
+
+/**
+ * Closes the current lap on the tick the kart crossed the finish line, and
+ * starts the next one from the moment it crossed.
+ *
+ * @param timer the timer
+ * @param progress the kart's distance past the start line
+ * @param dt the time since the last update
+ * @return the time of the lap that was finished
+ */
+double lap_timer_finish_lap(lap_timer_t *timer, double progress, double dt);
+
+/**
+ * Returns the time since the start of the current lap.
+ */
+double lap_timer_get_lap_time(lap_timer_t *timer);
+
+/**
+ * Returns the fastest finished lap, or INFINITY before the first one.
+ */
+double lap_timer_get_best_lap(lap_timer_t *timer);
+
+/**
+ * Returns how far the current lap is behind the fastest one at the same
+ * progress, in seconds. Negative values mean the kart is ahead. Returns 0
+ * before the first lap is finished.
+ */
+double lap_timer_get_delta(lap_timer_t *timer);
+
+/**
+ * Returns the index of the sector the kart is in.
+ */
+size_t lap_timer_get_sector(lap_timer_t *timer);
+
+/**
+ * Returns the time spent in a sector on the current lap: the final time of a
+ * sector already passed, the running time of the current one, and 0 for the
+ * sectors still ahead.
+ */
+double lap_timer_get_sector_time(lap_timer_t *timer, size_t sector);
+
+/**
+ * Returns the fastest time through a sector on any lap, or INFINITY before
+ * the sector was first finished.
+ */
+double lap_timer_get_best_sector(lap_timer_t *timer, size_t sector);
+
+/**
+ * Returns the number of finished laps.
+ */
+size_t lap_timer_get_num_laps(lap_timer_t *timer);
+
+/**
+ * Returns the recorded time of a finished lap. Only the most recent
+ * `max_laps` laps are kept.
+ *
+ * @param timer the timer
+ * @param lap the index of the lap, counting from 0 for the first one
+ */
+double lap_timer_get_record(lap_timer_t *timer, size_t lap);
+
+/**
+ * Returns the recorded time through a sector on a finished lap.
+ */
+double lap_timer_get_record_sector(lap_timer_t *timer, size_t lap,
+                                   size_t sector);
+
+#endif // #ifndef __LAP_TIMER_H__
@@ -0,0 +1,136 @@
+#ifndef __RACE_SIM_H__
+#define __RACE_SIM_H__
+
+#include "car.h"
+#include "track.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Complete races between AI drivers, run without a display as fast as the
+ * physics allows.
+ *
+ * A race builds its own scene, so races on different threads share nothing
+ * but their configuration, as long as each thread has its own copy of the
+ * track (see track_read()). Every kart has the forces and rules it has in
+ * the game: surfaces, walls, kart-to-kart collisions that stun, respawns and
+ * lap timing. The same configuration and seed always give the same race.
+ *
+ * Races can also be run as a stress test of the items, with every kart
+ * firing homing shells at the kart ahead of it so that hundreds are on the
+ * road at once.
+ */
+typedef struct race_result race_result_t;
+
+/**
+ * The settings shared by a batch of races.
+ */
+typedef struct race_config {
+  size_t num_karts;
+  size_t num_laps;
+  // The skill of the kart on pole. The kart in grid slot i drives at
+  // skill * (1 - skill_spread * i / num_karts), plus or minus up to
+  // skill_jitter.
+  double skill;
+  double skill_spread;
+  double skill_jitter;
+  // Every kart's type, or -1 for a random mix
+  int kart_type;
+  // Replaces every kart's top speed if positive
+  double top_speed;
+  double wall_elasticity;
+  // Races still running after this long are stopped, and the karts that had
+  // not finished are ranked by how far they got
+  double time_limit;
+  // The length of every physics step. The simulator has no frames to keep
+  // up with, so it steps by exactly this; the game steps by 1 / 60 second.
+  double dt;
+  // Every kart fires a homing shell this often, in seconds, or never if 0
+  double shell_interval;
+} race_config_t;
+
+/**
+ * Runs one race to the finish or the time limit.
+ *
+ * @param track the track, which is not shared with other threads
+ * @param config the race settings
+ * @param seed picks the kart types and skill jitter
+ * @return the results, which the caller must free
+ */
+race_result_t *race_sim_run(track_t *track, const race_config_t *config,
+                            uint64_t seed);
+
+/**
+ * Releases the memory allocated for the results.
+ */
+void race_result_free(race_result_t *result);
+
+/**
+ * Returns the number of karts that raced.
+ */
+size_t race_result_get_num_karts(race_result_t *result);
+
+/**
+ * Returns the number of laps the race was over.
+ */
+size_t race_result_get_num_laps(race_result_t *result);
+
+/**
+ * Returns how long the race ran, which is the time limit if some kart did
+ * not finish.
+ */
+double race_result_get_duration(race_result_t *result);
+
+/**
+ * Returns the most shells that were on the road at once.
+ */
+size_t race_result_get_peak_shells(race_result_t *result);
+
+/**
+ * Returns the type of the kart that started in the given grid slot.
+ */
+car_type_t race_result_get_kart_type(race_result_t *result, size_t kart);
+
+/**
+ * Returns the skill of the kart's driver.
+ */
+double race_result_get_skill(race_result_t *result, size_t kart);
+
+/**
+ * Returns the kart's finishing position, starting at 1 for the winner.
+ */
+size_t race_result_get_position(race_result_t *result, size_t kart);
+
+/**
+ * Returns the kart that finished in the given position (starting at 1).
+ */
+size_t race_result_get_kart(race_result_t *result, size_t position);
+
+/**
+ * Returns the time of one of the kart's laps, or INFINITY if the kart did
+ * not finish it. The first lap is timed from the start of the race.
+ */
+double race_result_get_lap_time(race_result_t *result, size_t kart,
+                                size_t lap);
+
+/**
+ * Returns the time the kart finished the race, or INFINITY if it did not.
+ */
+double race_result_get_finish_time(race_result_t *result, size_t kart);
+
+/**
+ * Returns how far the kart raced, up to the finish line.
+ */
+double race_result_get_distance(race_result_t *result, size_t kart);
+
+/**
+ * Returns how many times the kart hit a wall before it finished.
+ */
+size_t race_result_get_wall_hits(race_result_t *result, size_t kart);
+
+/**
+ * Returns how many times the kart ran into another kart before it finished.
+ */
+size_t race_result_get_kart_hits(race_result_t *result, size_t kart);
+
+#endif // #ifndef __RACE_SIM_H__
@@ -0,0 +1,69 @@
+#ifndef __RACING_LINE_H__
+#define __RACING_LINE_H__
+
+#include "track.h"
+#include "vector.h"
+#include <stddef.h>
+
+/**
+ * A racing line around a track and the fastest speed a kart can hold along
+ * it.
+ *
+ * The line is built once when a race starts. Stations are spaced evenly
+ * along the centerline, and each one is moved sideways within the road to
+ * minimize the total squared curvature of the line, coarse stations first so
+ * long corners are smoothed as a whole. The speed at each station is the
+ * cornering limit for its curvature, lowered wherever the kart could not
+ * brake down to the speed of the stations ahead or accelerate up to it from
+ * the ones behind. Lookups are indexed by the kart's progress, so following
+ * the line costs no searching.
+ */
+typedef struct racing_line racing_line_t;
+
+/**
+ * What a kart can do, which shapes its speed profile.
+ */
+typedef struct racing_limits {
+  double top_speed;
+  /** The largest sideways acceleration the tires can hold in a corner */
+  double lateral_accel;
+  double acceleration;
+  double braking;
+} racing_limits_t;
+
+/**
+ * Optimizes a racing line for a track.
+ *
+ * @param track the track, which must outlive the line
+ * @param limits what the kart following the line can do
+ * @return the new racing line
+ */
+racing_line_t *racing_line_init(track_t *track, racing_limits_t limits);
+
+/**
+ * Releases the memory allocated for the racing line. The track is not freed.
+ */
+void racing_line_free(racing_line_t *line);
+
+/**
+ * Returns the number of stations on the line.
+ */
+size_t racing_line_get_size(racing_line_t *line);
+
+/**
+ * Returns how far the station at the given index has been moved from the
+ * centerline, positive to the left of the direction of travel.
+ */
+double racing_line_get_offset(racing_line_t *line, size_t idx);
+
+/**
+ * Returns the scene position of the racing line at the given progress.
+ */
+vector_t racing_line_point_at(racing_line_t *line, double progress);
+
+/**
+ * Returns the target speed on the racing line at the given progress.
+ */
+double racing_line_speed_at(racing_line_t *line, double progress);
+
+#endif // #ifndef __RACING_LINE_H__
@@ -0,0 +1,92 @@
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include "input.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A recording of a race's input, which plays the race back exactly.
+ *
+ * Besides the settings the race was started with and the seed of the
+ * global random number generator, a race depends only on the length of each
+ * tick and the controls at each tick, so those are what is stored. Each tick
+ * takes a byte of flags saying what changed since the tick before, followed
+ * by only what did: the tick length, the held actions and the new presses,
+ * then the hold time of each held action. An idle tick at a steady frame
+ * rate takes one byte.
+ */
+typedef struct replay replay_t;
+
+/**
+ * The settings a race was started with.
+ */
+typedef struct replay_setup {
+  uint32_t seed;
+  uint32_t track_idx;
+  uint32_t car_type;
+  uint32_t villain_type;
+} replay_setup_t;
+
+/**
+ * Starts an empty recording of a race.
+ *
+ * @param setup the race's settings
+ * @return the recording
+ */
+replay_t *replay_init(const replay_setup_t *setup);
+
+/**
+ * Releases the memory allocated for the recording.
+ */
+void replay_free(replay_t *replay);
+
+/**
+ * Returns the settings the recorded race was started with.
+ */
+replay_setup_t replay_get_setup(replay_t *replay);
+
+/**
+ * Returns the number of ticks recorded.
+ */
+size_t replay_size(replay_t *replay);
+
+/**
+ * Appends a tick to the recording.
+ *
+ * @param replay the recording
+ * @param dt the length of the tick
+ * @param input the controls the tick was run with
+ */
+void replay_record(replay_t *replay, double dt, const input_snapshot_t *input);
+
+/**
+ * Plays back the next tick of the recording.
+ *
+ * @param replay the recording
+ * @param dt set to the length of the tick
+ * @param input set to the controls the tick was run with
+ * @return false, leaving dt and input unchanged, once every tick has been
+ *   played
+ */
+bool replay_next(replay_t *replay, double *dt, input_snapshot_t *input);
+
+/**
+ * Reads a recording from a file. Playback starts at its first tick.
+ *
+ * @param path the file's path
+ * @return the recording, or NULL if the file is missing or malformed
+ */
+replay_t *replay_read(const char *path);
+
+/**
+ * Writes a recording to a file.
+ *
+ * @param replay the recording
+ * @param path the file's path
+ * @return whether the whole recording was written
+ */
+bool replay_write(replay_t *replay, const char *path);
+
+#endif // #ifndef __REPLAY_H__
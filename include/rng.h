@@ -0,0 +1,38 @@
+#ifndef __RNG_H__
+#define __RNG_H__
+
+#include <stdint.h>
+
+/**
+ * A xorshift random number generator. Its state is a single number kept by
+ * the caller, so races do not depend on the global rand() state and can run
+ * on several threads.
+ */
+
+/**
+ * Makes the starting state for a seed. The seed is scrambled with a
+ * splitmix64 step, so consecutive seeds start far apart, and the state is
+ * never zero, which xorshift never leaves.
+ *
+ * @param seed any number
+ * @return the starting state
+ */
+uint64_t rng_seed(uint64_t seed);
+
+/**
+ * Advances the state and returns the next random number.
+ *
+ * @param state the state, made by rng_seed()
+ * @return a random number, never zero
+ */
+uint64_t rng_next(uint64_t *state);
+
+/**
+ * Advances the state and returns a random number in [-1, 1).
+ *
+ * @param state the state, made by rng_seed()
+ * @return the random number
+ */
+double rng_signed(uint64_t *state);
+
+#endif // #ifndef __RNG_H__
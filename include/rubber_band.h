@@ -0,0 +1,75 @@
+#ifndef __RUBBER_BAND_H__
+#define __RUBBER_BAND_H__
+
+#include "ai_field.h"
+#include "body.h"
+#include "list.h"
+#include "standings.h"
+
+/**
+ * Catch-up for a field of drivers, which keeps them racing close to the
+ * player.
+ *
+ * Each driver's skill (see ai_field_set_skill()) is its skill when added to
+ * the field times a scale. The scale rises above 1 while the driver is
+ * behind the player and falls below 1 while it is ahead, in proportion to
+ * the gap in race distance up to the configured bounds. The scales ease
+ * towards their targets rather than jump to them, and are only worked out a
+ * few times a second from the standings, so the cost per tick is a timer.
+ */
+typedef struct rubber_band rubber_band_t;
+
+/**
+ * How strongly the drivers are pulled towards the player.
+ */
+typedef struct rubber_band_config {
+  // The scale of a driver at least gap_range behind the player, and of one
+  // at least gap_range ahead
+  double max_scale;
+  double min_scale;
+  double gap_range;
+  // How quickly the scales approach their targets, per second
+  double response;
+  // How many times a second the scales are updated
+  double rate;
+} rubber_band_config_t;
+
+/**
+ * Starts pulling a field of drivers towards the player. Every driver starts
+ * at its own skill.
+ *
+ * @param field the drivers, which must outlive the controller
+ * @param karts every kart in the race, indexed as in the standings, which
+ *   must include the field's karts and the player
+ * @param player the player's kart
+ * @param config the bounds and rates, which are copied
+ * @return the new controller
+ */
+rubber_band_t *rubber_band_init(ai_field_t *field, list_t *karts,
+                                body_t *player,
+                                const rubber_band_config_t *config);
+
+/**
+ * Releases the memory allocated for the controller. The drivers keep the
+ * skills they have.
+ */
+void rubber_band_free(rubber_band_t *band);
+
+/**
+ * Returns the scale on the skill of the driver at the given index in the
+ * field.
+ */
+double rubber_band_get_scale(rubber_band_t *band, size_t idx);
+
+/**
+ * Advances the controller's clock, and updates the drivers' skills from the
+ * gaps in the standings when an update is due.
+ *
+ * @param band the controller
+ * @param standings the current running order
+ * @param dt the time since the last call
+ */
+void rubber_band_update(rubber_band_t *band, standings_t *standings,
+                        double dt);
+
+#endif // #ifndef __RUBBER_BAND_H__
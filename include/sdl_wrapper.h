@@ -2,6 +2,7 @@
 #define __SDL_WRAPPER_H__
 
 #include "color.h"
+#include "input.h"
 #include "list.h"
 #include "polygon.h"
 #include "scene.h"
@@ -75,6 +76,20 @@ void sdl_init(vector_t min, vector_t max);
  */
 bool sdl_is_done(void *state);
 
+/**
+ * Makes the next call to sdl_is_done() report that the window was closed.
+ */
+void sdl_request_quit(void);
+
+/**
+ * Returns the state of the player's controls for this tick, from the key
+ * events processed by sdl_is_done(). Should be called exactly once per tick,
+ * since each call starts collecting presses for the next one.
+ *
+ * @return the controls' snapshot
+ */
+input_snapshot_t sdl_take_input(void);
+
 /**
  * Clears the screen. Should be called before drawing polygons in each frame.
  */
@@ -154,8 +169,9 @@ void sdl_display_message(TTF_Font *font, const char *message, vector_t loc,
 void sdl_render_scene(scene_t *scene, void *aux);
 
 /**
- * Registers a function to be called every time a key is pressed.
- * Overwrites any existing handler.
+ * Registers a function to be called every time a key is pressed or released.
+ * Held keys are not reported every frame; see sdl_take_input() for the keys
+ * held at each tick. Overwrites any existing handler.
  *
  * Example:
  * ```
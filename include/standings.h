@@ -0,0 +1,86 @@
+#ifndef __STANDINGS_H__
+#define __STANDINGS_H__
+
+#include <stddef.h>
+
+/**
+ * The running order of a race. Each kart is identified by an index from 0 to
+ * the number of karts, and is ranked by its race distance: completed laps
+ * times the lap length plus its progress into the current lap.
+ *
+ * The order is kept between updates and repaired with an insertion sort,
+ * which costs O(n) when no karts have swapped places and O(n + swaps)
+ * otherwise.
+ */
+typedef struct standings standings_t;
+
+/**
+ * The largest number of karts a race can have.
+ */
+extern const size_t STANDINGS_MAX_KARTS;
+
+/**
+ * Allocates standings for a race. Karts start in index order.
+ *
+ * @param num_karts the number of karts, at most STANDINGS_MAX_KARTS
+ * @param lap_length the length of one lap
+ * @return the new standings
+ */
+standings_t *standings_init(size_t num_karts, double lap_length);
+
+/**
+ * Releases the memory allocated for the standings.
+ */
+void standings_free(standings_t *standings);
+
+/**
+ * Returns the number of karts in the race.
+ */
+size_t standings_get_num_karts(standings_t *standings);
+
+/**
+ * Records a kart's latest lap count and progress. The order is not changed
+ * until standings_update() is called.
+ *
+ * @param standings the standings
+ * @param kart the kart's index
+ * @param laps the number of completed laps
+ * @param progress the distance into the current lap, which is negative for a
+ *   kart that has not crossed the start line yet
+ */
+void standings_set_progress(standings_t *standings, size_t kart, size_t laps,
+                            double progress);
+
+/**
+ * Reorders the karts after their progress has been updated.
+ */
+void standings_update(standings_t *standings);
+
+/**
+ * Returns a kart's race position, starting at 1 for the leader.
+ */
+size_t standings_get_position(standings_t *standings, size_t kart);
+
+/**
+ * Returns the index of the kart in the given race position (starting at 1).
+ */
+size_t standings_get_kart(standings_t *standings, size_t position);
+
+/**
+ * Returns a kart's race distance: completed laps times the lap length plus
+ * its progress into the current lap.
+ */
+double standings_get_distance(standings_t *standings, size_t kart);
+
+/**
+ * Returns how far a kart is behind the leader, or 0 for the leader.
+ */
+double standings_gap_to_leader(standings_t *standings, size_t kart);
+
+/**
+ * Returns how far a kart is behind the kart one position ahead of it, or 0
+ * for the leader.
+ */
+double standings_gap_to_next(standings_t *standings, size_t kart);
+
+#endif // #ifndef __STANDINGS_H__
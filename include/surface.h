@@ -0,0 +1,113 @@
+#ifndef __SURFACE_H__
+#define __SURFACE_H__
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The kinds of ground a kart can drive on.
+ */
+typedef enum {
+  SURFACE_ASPHALT,
+  SURFACE_GRASS,
+  SURFACE_SAND,
+  SURFACE_BOOST,
+  NUM_SURFACES
+} surface_type_t;
+
+/**
+ * How a surface acts on a kart driving over it. Every value is an
+ * acceleration, so karts of any mass are slowed the same way.
+ */
+typedef struct surface_properties {
+  // Drag proportional to the kart's velocity
+  double drag;
+  // Constant friction against the direction of travel
+  double friction;
+  // Constant push in the direction of travel
+  double thrust;
+} surface_properties_t;
+
+/**
+ * A rectangle of the track covered by one surface.
+ */
+typedef struct surface_region {
+  vector_t min;
+  vector_t max;
+  uint32_t type;
+} surface_region_t;
+
+/**
+ * A low-resolution grid of surface types covering a track, with one byte per
+ * cell. Lookups are O(1).
+ */
+typedef struct surface_map surface_map_t;
+
+/**
+ * Returns how the given surface acts on karts.
+ */
+surface_properties_t surface_get_properties(surface_type_t type);
+
+/**
+ * Looks up a surface type by its name in a track file ("asphalt", "grass",
+ * "sand" or "boost").
+ *
+ * @param name the name of the surface
+ * @param type set to the surface type if the name is known
+ * @return whether the name is known
+ */
+bool surface_parse_type(const char *name, surface_type_t *type);
+
+/**
+ * Allocates a surface map covering the rectangle from min to max, with every
+ * cell set to the same surface.
+ *
+ * @param min the corner with the smallest coordinates
+ * @param max the corner with the largest coordinates
+ * @param cell_size the side length of each cell
+ * @param fill the surface to start every cell with
+ * @return the new surface map
+ */
+surface_map_t *surface_map_init(vector_t min, vector_t max, double cell_size,
+                                surface_type_t fill);
+
+/**
+ * Releases the memory allocated for a surface map.
+ */
+void surface_map_free(surface_map_t *map);
+
+/**
+ * Returns the number of columns in the map.
+ */
+size_t surface_map_get_width(surface_map_t *map);
+
+/**
+ * Returns the number of rows in the map.
+ */
+size_t surface_map_get_height(surface_map_t *map);
+
+/**
+ * Returns the center of the cell in the given column and row.
+ */
+vector_t surface_map_get_cell_center(surface_map_t *map, size_t col,
+                                     size_t row);
+
+/**
+ * Sets the surface of the cell in the given column and row.
+ */
+void surface_map_set_cell(surface_map_t *map, size_t col, size_t row,
+                          surface_type_t type);
+
+/**
+ * Sets the surface of every cell whose center is inside the region.
+ */
+void surface_map_fill(surface_map_t *map, surface_region_t region);
+
+/**
+ * Returns the surface at a point. Points off the map are grass.
+ */
+surface_type_t surface_map_get(surface_map_t *map, vector_t point);
+
+#endif // #ifndef __SURFACE_H__
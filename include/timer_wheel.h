@@ -0,0 +1,102 @@
+#ifndef __TIMER_WHEEL_H__
+#define __TIMER_WHEEL_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A clock that calls functions when timers run out, such as a power up
+ * wearing off or an item box refilling.
+ *
+ * Timers are hashed into a ring of slots by the tick they run out on, one
+ * tick being a fixed fraction of a second, so advancing the clock only looks
+ * at the slots of the ticks that passed, and in each only at the timers
+ * that ran out or that wrap round the ring. Timers run out at exactly their
+ * time, not rounded to a tick. Timers are kept in a pool that grows as
+ * needed and reuses the entries of timers that have run out.
+ */
+typedef struct timer_wheel timer_wheel_t;
+
+/**
+ * Identifies a timer. A timer's ID is never reused, so one that has run out
+ * or been cancelled can be passed to any function taking an ID.
+ */
+typedef uint64_t timer_id_t;
+
+/**
+ * An ID that is never given to a timer.
+ */
+extern const timer_id_t NO_TIMER;
+
+/**
+ * A function called when a timer runs out.
+ *
+ * @param aux the value passed when the timer was scheduled
+ */
+typedef void (*timer_callback_t)(void *aux);
+
+/**
+ * Allocates a clock at time 0 with no timers.
+ *
+ * @param tick the length of a slot, in seconds
+ * @param num_slots the number of slots; timers further ahead than one turn
+ *   of the ring still run out on time, but are looked at once a turn
+ * @return the new clock
+ */
+timer_wheel_t *timer_wheel_init(double tick, size_t num_slots);
+
+/**
+ * Releases the memory allocated for the clock. Pending timers are dropped
+ * without being called.
+ */
+void timer_wheel_free(timer_wheel_t *wheel);
+
+/**
+ * Returns the time the clock has been advanced by since it was created.
+ */
+double timer_wheel_get_time(timer_wheel_t *wheel);
+
+/**
+ * Returns the number of timers that have not run out or been cancelled.
+ */
+size_t timer_wheel_size(timer_wheel_t *wheel);
+
+/**
+ * Starts a timer.
+ *
+ * @param wheel the clock
+ * @param delay how long from now the timer runs out; a timer that runs out
+ *   at once is called on the next advance
+ * @param callback the function to call when the timer runs out
+ * @param aux the value to pass to the callback
+ * @return the timer's ID
+ */
+timer_id_t timer_wheel_schedule(timer_wheel_t *wheel, double delay,
+                                timer_callback_t callback, void *aux);
+
+/**
+ * Stops a timer before it runs out.
+ *
+ * @param wheel the clock
+ * @param id the timer's ID
+ * @return whether the timer was pending
+ */
+bool timer_wheel_cancel(timer_wheel_t *wheel, timer_id_t id);
+
+/**
+ * Returns how long until a timer runs out, or 0 if it is not pending.
+ */
+double timer_wheel_get_remaining(timer_wheel_t *wheel, timer_id_t id);
+
+/**
+ * Advances the clock, calling the timers that run out in order of the ticks
+ * they run out on. Callbacks may schedule and cancel timers; timers they
+ * schedule that run out by the new time are called during the same advance.
+ *
+ * @param wheel the clock
+ * @param dt how far to advance the clock
+ */
+void timer_wheel_advance(timer_wheel_t *wheel, double dt);
+
+#endif // #ifndef __TIMER_WHEEL_H__
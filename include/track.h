@@ -0,0 +1,402 @@
+#ifndef __TRACK_H__
+#define __TRACK_H__
+
+#include "collision.h"
+#include "list.h"
+#include "surface.h"
+#include "vector.h"
+#include "wall_bvh.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * The baked geometry of a race track: the boundaries and centerline, the wall
+ * segments, the checkpoint lines, the item box positions and the spawn grid.
+ *
+ * Tracks are described in a human-editable text file (see
+ * assets/tracks/caltech.trk) or in a compact binary file written by
+ * track_write_binary(), which reads the same on any machine. Everything
+ * that can be derived from the boundaries is computed once when the track
+ * is loaded, so starting a race only copies the baked arrays.
+ */
+typedef struct track track_t;
+
+/**
+ * A starting slot on the grid.
+ */
+typedef struct spawn {
+  vector_t position;
+  double rotation;
+} spawn_t;
+
+/**
+ * Geometry to bake into a track without going through a file, e.g. from the
+ * track generator. Arrays are copied, so the caller keeps ownership of them.
+ */
+typedef struct track_desc {
+  const char *name;
+  double verge_width;
+  /** The corners of the area covered by the track */
+  vector_t min;
+  vector_t max;
+  /** The number of vertices on each boundary and on the centerline */
+  size_t size;
+  const vector_t *inner;
+  const vector_t *outer;
+  /** May be NULL to use the midpoints of the boundaries */
+  const vector_t *centerline;
+  /** (inner, outer) pairs in lap order, starting with the start line */
+  size_t num_checkpoints;
+  const vector_t *checkpoints;
+  /** May be NULL for rows of boxes across every other vertex */
+  size_t num_boxes;
+  const vector_t *boxes;
+  /**
+   * The checkpoint each timing sector starts at, in lap order beginning with
+   * 0. May be NULL for up to three sectors of roughly equal checkpoint counts.
+   */
+  size_t num_sectors;
+  const size_t *sectors;
+} track_desc_t;
+
+/**
+ * Bakes a track from its description. The spawn grid is placed on the start
+ * line. The caller owns the returned track.
+ *
+ * @param desc the geometry of the track
+ * @return the new track
+ */
+track_t *track_init(const track_desc_t *desc);
+
+/**
+ * Returns the track stored at the given path, loading and baking it the first
+ * time it is requested. The track is owned by the track cache and must not be
+ * freed by the caller; see track_cache_destroy().
+ *
+ * Files starting with the binary magic are read as binary tracks, anything
+ * else is parsed as a text track.
+ *
+ * @param path the path to the track file
+ * @return the cached track, or NULL if the file could not be read
+ */
+track_t *track_load(const char *path);
+
+/**
+ * Frees every track in the track cache.
+ */
+void track_cache_destroy(void);
+
+/**
+ * Parses and bakes a text track file. The caller owns the returned track.
+ *
+ * @param path the path to the text file
+ * @return the new track, or NULL if the file is missing or malformed
+ */
+track_t *track_read_text(const char *path);
+
+/**
+ * Reads a binary track file. The caller owns the returned track.
+ *
+ * @param path the path to the binary file
+ * @return the new track, or NULL if the file is missing or malformed
+ */
+track_t *track_read_binary(const char *path);
+
+/**
+ * Reads a track file in either format, as track_load() does, but without
+ * going through the cache. The caller owns the returned track, so this is
+ * how each thread that races on a track gets a copy of its own.
+ *
+ * @param path the path to the track file
+ * @return the new track, or NULL if the file is missing or malformed
+ */
+track_t *track_read(const char *path);
+
+/**
+ * Writes the baked track to a binary file.
+ *
+ * @param track the track to write
+ * @param path the path of the file to create
+ * @return whether the file was written
+ */
+bool track_write_binary(track_t *track, const char *path);
+
+/**
+ * Frees a track that is not owned by the track cache.
+ *
+ * @param track the track to free
+ */
+void track_free(track_t *track);
+
+/**
+ * Returns the display name of the track.
+ */
+const char *track_get_name(track_t *track);
+
+/**
+ * Returns the number of vertices on each boundary (and on the centerline).
+ */
+size_t track_get_size(track_t *track);
+
+/**
+ * Returns the inner boundary, i.e. the edge of the inside walls facing the
+ * road. The array has track_get_size() entries.
+ */
+const vector_t *track_get_inner(track_t *track);
+
+/**
+ * Returns the outer boundary, i.e. the edge of the outside walls facing the
+ * road. The array has track_get_size() entries.
+ */
+const vector_t *track_get_outer(track_t *track);
+
+/**
+ * Returns the centerline of the road. The array has track_get_size() entries.
+ */
+const vector_t *track_get_centerline(track_t *track);
+
+/**
+ * Returns the number of wall segments, one per boundary edge. The first half
+ * are the inside walls and the second half are the outside walls.
+ */
+size_t track_get_num_walls(track_t *track);
+
+/**
+ * Returns the wall segment at the given index in scene coordinates (see
+ * track_set_origin()). Its normal faces the road.
+ */
+segment_t track_get_wall(track_t *track, size_t idx);
+
+/**
+ * Returns the number of checkpoint lines, including the start line.
+ */
+size_t track_get_num_checkpoints(track_t *track);
+
+/**
+ * Returns the checkpoint line at the given index as an (inner, outer) pair.
+ * Checkpoint 0 is the start/finish line.
+ */
+const vector_t *track_get_checkpoint(track_t *track, size_t idx);
+
+/**
+ * Returns the number of item boxes.
+ */
+size_t track_get_num_boxes(track_t *track);
+
+/**
+ * Returns the item box centers. The array has track_get_num_boxes() entries.
+ */
+const vector_t *track_get_boxes(track_t *track);
+
+/**
+ * Returns the number of slots in the spawn grid.
+ */
+size_t track_get_num_spawns(track_t *track);
+
+/**
+ * Returns the spawn slot at the given index. The player uses slot 0.
+ */
+spawn_t track_get_spawn(track_t *track, size_t idx);
+
+/**
+ * Returns a starting slot for any number of karts. The first slots are the
+ * spawn grid's own; after those the grid is repeated in rows further and
+ * further behind it along the centerline, each kart as far from the
+ * centerline as the spawn it lines up behind.
+ */
+spawn_t track_get_grid_slot(track_t *track, size_t idx);
+
+/**
+ * Returns the corner of the background with the smallest coordinates.
+ */
+vector_t track_get_min(track_t *track);
+
+/**
+ * Returns the corner of the background with the largest coordinates.
+ */
+vector_t track_get_max(track_t *track);
+
+/**
+ * Copies an array of points into a newly allocated list of vectors,
+ * suitable for passing to body_init().
+ *
+ * @param points the points to copy
+ * @param size the number of points
+ * @return the new list, which owns its vectors
+ */
+list_t *track_make_shape(const vector_t *points, size_t size);
+
+/**
+ * Returns the rectangle covered by the background image as a new list of
+ * vectors.
+ */
+list_t *track_make_background(track_t *track);
+
+/**
+ * Sets where the track's origin currently is in the scene. The scene is
+ * re-centered on the player every tick, which shifts every body; the game
+ * keeps the origin in sync so the queries below can take and return scene
+ * positions. Baked arrays returned by the getters above are not shifted.
+ *
+ * @param track the track
+ * @param origin the scene position of the track's (0, 0)
+ */
+void track_set_origin(track_t *track, vector_t origin);
+
+/**
+ * Returns the scene position of the track's (0, 0).
+ */
+vector_t track_get_origin(track_t *track);
+
+/**
+ * Returns the length of one lap, measured along the centerline.
+ */
+double track_get_length(track_t *track);
+
+/**
+ * Returns the progress (arc length past the start line) of the checkpoint at
+ * the given index. Progress values increase with the index.
+ */
+double track_get_checkpoint_progress(track_t *track, size_t idx);
+
+/**
+ * Returns the number of timing sectors the lap is split into.
+ */
+size_t track_get_num_sectors(track_t *track);
+
+/**
+ * Returns the index of the checkpoint the sector at the given index starts
+ * at. Sector 0 starts at the start line and each sector ends where the next
+ * one starts, the last one at the finish line.
+ */
+size_t track_get_sector_checkpoint(track_t *track, size_t idx);
+
+/**
+ * Returns the progress at which the sector at the given index starts.
+ */
+double track_get_sector_progress(track_t *track, size_t idx);
+
+/**
+ * Returns the index of the last checkpoint at or before the given progress,
+ * found by binary search.
+ *
+ * @param track the track
+ * @param progress a progress value in [0, track_get_length())
+ * @return the checkpoint index
+ */
+size_t track_find_checkpoint(track_t *track, double progress);
+
+/**
+ * Projects a scene position onto the centerline and returns its progress:
+ * the arc length from the start line, in [0, track_get_length()).
+ *
+ * `segment` holds the centerline segment the previous projection ended on.
+ * The search walks from there to the closest segment, so repeated lookups for
+ * the same kart are O(1). Pass a value >= track_get_size() to search every
+ * segment.
+ *
+ * @param track the track
+ * @param point the position to project
+ * @param segment the segment hint, updated to the segment that was found
+ * @return the progress of the closest point on the centerline
+ */
+double track_project(track_t *track, vector_t point, size_t *segment);
+
+/**
+ * Returns the centerline segment containing the given progress, found by
+ * binary search on the arc lengths.
+ */
+size_t track_segment_at(track_t *track, double progress);
+
+/**
+ * Returns the scene position of the centerline point at the given progress.
+ */
+vector_t track_point_at(track_t *track, double progress);
+
+/**
+ * Returns where to put a car back on the track at or just behind the given
+ * progress: a scene position on the centerline and the rotation that faces
+ * along it. The poses are baked at even steps of progress when the track is
+ * loaded, so this is a table lookup.
+ */
+spawn_t track_respawn_at(track_t *track, double progress);
+
+/**
+ * Returns the unit direction of travel along the given centerline segment.
+ */
+vector_t track_segment_direction(track_t *track, size_t segment);
+
+/**
+ * Returns the unit direction of travel at the given progress.
+ */
+vector_t track_direction_at(track_t *track, double progress);
+
+/**
+ * Returns the signed distance from a scene position to the nearest road
+ * boundary: positive on the road and negative past either boundary. Looked
+ * up in a distance field baked when the track is loaded.
+ */
+double track_get_distance(track_t *track, vector_t point);
+
+/**
+ * Returns the gradient of track_get_distance(), which has a length of about
+ * 1 and points away from the nearest boundary, or back towards the road.
+ */
+vector_t track_get_distance_gradient(track_t *track, vector_t point);
+
+/**
+ * Returns whether a scene position is on the road.
+ */
+bool track_on_road(track_t *track, vector_t point);
+
+/**
+ * Returns the closest scene position to `point` that is on the road and at
+ * least `margin` from both boundaries.
+ *
+ * @param track the track
+ * @param point the position to move onto the road
+ * @param margin the clearance to leave from the boundaries
+ * @return the position on the road
+ */
+vector_t track_nearest_on_road(track_t *track, vector_t point, double margin);
+
+/**
+ * Returns the surface at a scene position. The road is asphalt except where
+ * the track file marks other surfaces; the verge along each boundary and
+ * everything off the road is grass.
+ */
+surface_type_t track_get_surface(track_t *track, vector_t point);
+
+/**
+ * Moves a circle in a straight line between two scene positions and finds
+ * the first wall it runs into, looked up in a tree of the walls' bounding
+ * boxes baked when the track is loaded (see wall_bvh_sweep()). The hit's
+ * center is a scene position.
+ *
+ * @param track the track
+ * @param start the circle's center at the start of the move
+ * @param end the circle's center at the end of the move
+ * @param radius the circle's radius
+ * @param hit set to the first contact if there is one
+ * @return whether the circle ran into a wall
+ */
+bool track_sweep(track_t *track, vector_t start, vector_t end, double radius,
+                 wall_hit_t *hit);
+
+/**
+ * Finds the walls that may be within a distance of a scene position: those
+ * whose bounding boxes overlap the square around it, looked up in the same
+ * tree as track_sweep().
+ *
+ * @param track the track
+ * @param center the scene position
+ * @param radius the distance
+ * @param walls set to the indices of the first max_walls walls found (see
+ * track_get_wall())
+ * @param max_walls the room in walls
+ * @return the number of walls found, which may be more than max_walls
+ */
+size_t track_find_walls(track_t *track, vector_t center, double radius,
+                        size_t *walls, size_t max_walls);
+
+#endif // #ifndef __TRACK_H__
@@ -0,0 +1,44 @@
+#ifndef __TRACK_GENERATOR_H__
+#define __TRACK_GENERATOR_H__
+
+#include "track.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * The shape of a generated circuit.
+ *
+ * Circuits are closed Catmull-Rom splines through control points scattered
+ * around a circle, resampled to vertices spaced evenly along the centerline.
+ * The same parameters and seed always produce the same track. A circuit whose
+ * corners come out tighter than the road width is redrawn with less wobble,
+ * so the boundaries never fold over themselves.
+ */
+typedef struct track_params {
+  /** The length of one lap along the centerline, over 2 pi road widths */
+  double length;
+  /** The number of spline control points, at least 3 */
+  size_t corners;
+  /** The distance between the boundaries */
+  double width;
+  /** How far control points stray from the circle, from 0 to 1 */
+  double wobble;
+  /** The number of vertices on each boundary, so half the wall count */
+  size_t size;
+  /** The number of checkpoint lines, including the start line */
+  size_t num_checkpoints;
+  /** The number of rows of item boxes across the road */
+  size_t num_box_rows;
+  uint32_t seed;
+} track_params_t;
+
+/**
+ * Generates and bakes a circuit. The caller owns the returned track and
+ * frees it with track_free().
+ *
+ * @param params the shape of the circuit
+ * @return the new track
+ */
+track_t *track_generate(const track_params_t *params);
+
+#endif // #ifndef __TRACK_GENERATOR_H__
@@ -0,0 +1,42 @@
+#ifndef __TRACK_REGISTRY_H__
+#define __TRACK_REGISTRY_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Everything a race needs to know about one of the game's tracks: the track
+ * file with its geometry, spawn grid and item layout, the textures drawn
+ * under it, and the file the ghost of its best lap is saved to.
+ */
+typedef struct track_entry {
+  const char *name;
+  const char *track_path;
+  const char *background_path;
+  const char *minimap_path;
+  const char *ghost_path;
+} track_entry_t;
+
+/**
+ * Returns the number of registered tracks.
+ */
+size_t track_registry_size(void);
+
+/**
+ * Returns the registered track at the given index.
+ */
+const track_entry_t *track_registry_get(size_t idx);
+
+/**
+ * Loads the next resource of the given track that is not resident yet: its
+ * baked geometry through the track cache, then its textures through the
+ * asset cache. Each call does at most one load, so calling it once a frame
+ * from a menu spreads the work over several frames instead of stalling the
+ * start of the race.
+ *
+ * @param idx the index of the track to prefetch
+ * @return whether every resource of the track is resident
+ */
+bool track_registry_prefetch(size_t idx);
+
+#endif // #ifndef __TRACK_REGISTRY_H__
@@ -0,0 +1,80 @@
+#ifndef __WALL_BVH_H__
+#define __WALL_BVH_H__
+
+#include "collision.h"
+#include "vector.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * A bounding volume hierarchy over a fixed set of wall segments: a binary
+ * tree of axis-aligned boxes, each holding the walls of its two children,
+ * with a few walls in each leaf. Sweeping a circle through the tree only
+ * tests the walls in the boxes its path crosses, so a query costs about the
+ * logarithm of the number of walls rather than all of them.
+ *
+ * The tree is built once and never changes, so its nodes are kept in one
+ * array in depth-first order.
+ */
+typedef struct wall_bvh wall_bvh_t;
+
+/**
+ * Where a moving circle first touched a wall.
+ */
+typedef struct wall_hit {
+  /** How far along the sweep the circle touched, from 0 to 1 */
+  double time;
+  /** The circle's center at that moment */
+  vector_t center;
+  /** The unit vector from the wall towards the circle's center */
+  vector_t normal;
+  /** The index of the wall that was touched */
+  size_t wall;
+} wall_hit_t;
+
+/**
+ * Builds a tree over the given walls, splitting each box across its longer
+ * side at the median of its walls' midpoints.
+ *
+ * @param walls the walls, which are copied
+ * @param num_walls the number of walls
+ * @return the new tree
+ */
+wall_bvh_t *wall_bvh_init(const segment_t *walls, size_t num_walls);
+
+/**
+ * Releases the memory allocated for a tree.
+ */
+void wall_bvh_free(wall_bvh_t *bvh);
+
+/**
+ * Moves a circle in a straight line and finds the first wall it touches
+ * while moving towards it. A circle that starts overlapping a wall touches
+ * it at time 0 unless it is moving away. Walls are touched from either
+ * side.
+ *
+ * @param bvh the tree
+ * @param start the circle's center at the start of the sweep
+ * @param end the circle's center at the end of the sweep
+ * @param radius the circle's radius
+ * @param hit set to the first contact if there is one
+ * @return whether the circle touched a wall
+ */
+bool wall_bvh_sweep(wall_bvh_t *bvh, vector_t start, vector_t end,
+                    double radius, wall_hit_t *hit);
+
+/**
+ * Finds the walls whose bounding boxes overlap an axis-aligned box, only
+ * visiting the parts of the tree the box overlaps.
+ *
+ * @param bvh the tree
+ * @param min the corner of the box with the smallest coordinates
+ * @param max the corner of the box with the largest coordinates
+ * @param walls set to the indices of the first max_walls walls found
+ * @param max_walls the room in walls
+ * @return the number of walls found, which may be more than max_walls
+ */
+size_t wall_bvh_query(wall_bvh_t *bvh, vector_t min, vector_t max,
+                      size_t *walls, size_t max_walls);
+
+#endif // #ifndef __WALL_BVH_H__
@@ -0,0 +1,459 @@
+#include "ai_field.h"
+#include "car.h"
+#include "checkpoints.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <time.h>
+
+// How far ahead on the line a driver aims: a fixed distance plus the
+// distance covered in a fixed time at the current speed
+const double AI_LOOKAHEAD_DISTANCE = 80.0;
+const double AI_LOOKAHEAD_TIME = 0.4;
+// How far ahead a driver reads the speed profile, in seconds at its current
+// speed, to make up for the time the throttle takes to bite
+const double AI_SPEED_PREVIEW = 0.25;
+// How much faster than the profile a driver goes before braking
+const double AI_SPEED_TOLERANCE = 10.0;
+// The acceleration and braking the speed profiles assume
+const double AI_ACCELERATION = 300.0;
+const double AI_BRAKING = 300.0;
+// A driver picks one of this many aim points spread across the road around
+// the racing line, preferring those nearest the line and the one it chose
+// last
+const size_t AI_NUM_AIMS = 5;
+const double AI_AIM_SPACING = 35.0;
+const double AI_AIM_STRAY_COST = 1.0;
+const double AI_AIM_SWITCH_COST = 0.5;
+// Karts this far from the focus and from every other kart stop being
+// simulated and glide along their racing lines instead. They are simulated
+// again once they come within the nearer distances, which keeps them from
+// flickering between the two. The focus distances are off the screen.
+const double AI_LOD_FOCUS_FAR = 1000.0;
+const double AI_LOD_FOCUS_NEAR = 800.0;
+const double AI_LOD_KART_FAR = 300.0;
+const double AI_LOD_KART_NEAR = 200.0;
+// How quickly a gliding kart closes the gap to its racing line, per second
+const double AI_LOD_SETTLE_RATE = 1.0;
+
+struct ai_field {
+  track_t *track;
+  size_t size;
+  size_t capacity;
+  // The racing lines and the limits each was optimized for
+  size_t num_lines;
+  racing_line_t **lines;
+  racing_limits_t *limits;
+  // Each kart's state, indexed by kart
+  body_t **cars;
+  size_t *line_idx;
+  float *skills;
+  // How far each driver aims to the side of its racing line
+  float *aim_offsets;
+  // Aims are replanned round-robin, starting from this kart each update,
+  // until the budget in microseconds runs out
+  ai_perception_t *perception;
+  size_t next_plan;
+  double budget;
+  // Karts far from the focus glide along their lines, at a distance along
+  // the track, a speed and an offset to the side of the line
+  body_t *focus;
+  double *glide_progress;
+  float *glide_speeds;
+  float *glide_offsets;
+};
+
+ai_field_t *ai_field_init(track_t *track, size_t capacity) {
+  ai_field_t *field = malloc(sizeof(ai_field_t));
+  assert(field != NULL);
+  field->track = track;
+  field->size = 0;
+  field->capacity = capacity;
+  field->num_lines = 0;
+  field->lines = malloc(capacity * sizeof(racing_line_t *));
+  field->limits = malloc(capacity * sizeof(racing_limits_t));
+  field->cars = malloc(capacity * sizeof(body_t *));
+  field->line_idx = malloc(capacity * sizeof(size_t));
+  field->skills = malloc(capacity * sizeof(float));
+  field->aim_offsets = malloc(capacity * sizeof(float));
+  field->glide_progress = malloc(capacity * sizeof(double));
+  field->glide_speeds = malloc(capacity * sizeof(float));
+  field->glide_offsets = malloc(capacity * sizeof(float));
+  assert(field->lines != NULL && field->limits != NULL &&
+         field->cars != NULL && field->line_idx != NULL &&
+         field->skills != NULL && field->aim_offsets != NULL &&
+         field->glide_progress != NULL && field->glide_speeds != NULL &&
+         field->glide_offsets != NULL);
+  field->perception = ai_perception_init(track);
+  field->next_plan = 0;
+  field->budget = 0;
+  field->focus = NULL;
+  return field;
+}
+
+void ai_field_free(ai_field_t *field) {
+  for (size_t i = 0; i < field->num_lines; i++) {
+    racing_line_free(field->lines[i]);
+  }
+  free(field->lines);
+  free(field->limits);
+  free(field->cars);
+  free(field->line_idx);
+  free(field->skills);
+  free(field->aim_offsets);
+  free(field->glide_progress);
+  free(field->glide_speeds);
+  free(field->glide_offsets);
+  ai_perception_free(field->perception);
+  free(field);
+}
+
+/**
+ * Returns the index of the racing line for a kart with the given limits,
+ * optimizing a new one if no kart so far has had them.
+ */
+static size_t find_line(ai_field_t *field, racing_limits_t limits) {
+  for (size_t i = 0; i < field->num_lines; i++) {
+    racing_limits_t other = field->limits[i];
+    if (other.top_speed == limits.top_speed &&
+        other.lateral_accel == limits.lateral_accel) {
+      return i;
+    }
+  }
+  size_t idx = field->num_lines++;
+  field->lines[idx] = racing_line_init(field->track, limits);
+  field->limits[idx] = limits;
+  return idx;
+}
+
+size_t ai_field_add(ai_field_t *field, body_t *car, double skill) {
+  assert(field->size < field->capacity);
+  size_t idx = field->size++;
+  racing_limits_t limits = {.top_speed = car_get_top_speed(car),
+                            .lateral_accel = car_get_grip(car),
+                            .acceleration = AI_ACCELERATION,
+                            .braking = AI_BRAKING};
+  field->cars[idx] = car;
+  field->line_idx[idx] = find_line(field, limits);
+  field->skills[idx] = skill;
+  field->aim_offsets[idx] = 0;
+  return idx;
+}
+
+size_t ai_field_size(ai_field_t *field) { return field->size; }
+
+body_t *ai_field_get_car(ai_field_t *field, size_t idx) {
+  assert(idx < field->size);
+  return field->cars[idx];
+}
+
+racing_line_t *ai_field_get_line(ai_field_t *field, size_t idx) {
+  assert(idx < field->size);
+  return field->lines[field->line_idx[idx]];
+}
+
+double ai_field_get_skill(ai_field_t *field, size_t idx) {
+  assert(idx < field->size);
+  return field->skills[idx];
+}
+
+void ai_field_set_skill(ai_field_t *field, size_t idx, double skill) {
+  assert(idx < field->size);
+  field->skills[idx] = skill;
+}
+
+double ai_field_get_aim_offset(ai_field_t *field, size_t idx) {
+  assert(idx < field->size);
+  return field->aim_offsets[idx];
+}
+
+void ai_field_set_perception_budget(ai_field_t *field, double budget) {
+  field->budget = budget;
+}
+
+void ai_field_set_focus(ai_field_t *field, body_t *focus) {
+  field->focus = focus;
+  if (focus == NULL) {
+    for (size_t i = 0; i < field->size; i++) {
+      body_set_kinematic(field->cars[i], false);
+    }
+  }
+}
+
+bool ai_field_is_gliding(ai_field_t *field, size_t idx) {
+  assert(idx < field->size);
+  return body_is_kinematic(field->cars[idx]);
+}
+
+void ai_field_add_obstacle(ai_field_t *field, body_t *body,
+                           obstacle_type_t type) {
+  ai_perception_add(field->perception, body, type);
+}
+
+void ai_field_add_circle_obstacle(ai_field_t *field, vector_t position,
+                                  vector_t velocity, double radius,
+                                  obstacle_type_t type) {
+  ai_perception_add_circle(field->perception, position, velocity, radius,
+                           type);
+}
+
+/**
+ * Returns the point a driver aims for: one lookahead along the racing line,
+ * moved sideways by the given offset.
+ */
+static vector_t aim_point(racing_line_t *line, double progress, double speed,
+                          double offset) {
+  double ahead = progress + AI_LOOKAHEAD_DISTANCE + AI_LOOKAHEAD_TIME * speed;
+  vector_t point = racing_line_point_at(line, ahead);
+  if (offset == 0) {
+    return point;
+  }
+  vector_t along = vec_subtract(racing_line_point_at(line, ahead + 1), point);
+  double length = vec_get_length(along);
+  if (length == 0) {
+    return point;
+  }
+  vector_t normal = {.x = -along.y / length, .y = along.x / length};
+  return vec_add(point, vec_multiply(offset, normal));
+}
+
+/**
+ * Returns the unit vector along the racing line at the given progress.
+ */
+static vector_t line_direction(racing_line_t *line, double progress) {
+  vector_t along = vec_subtract(racing_line_point_at(line, progress + 1),
+                                racing_line_point_at(line, progress));
+  double length = vec_get_length(along);
+  return length == 0 ? along : vec_multiply(1 / length, along);
+}
+
+/**
+ * Chooses where the kart at the given index aims until it is next planned.
+ */
+static void plan_aim(ai_field_t *field, size_t idx) {
+  body_t *car = field->cars[idx];
+  if (car_has_effect(car, EFFECT_STUN) || body_is_kinematic(car)) {
+    return;
+  }
+  racing_line_t *line = field->lines[field->line_idx[idx]];
+  double progress = get_progress(car_get_checkpoint_state(car));
+  double speed = vec_get_length(body_get_velocity(car));
+  vector_t targets[AI_NUM_AIMS];
+  double bias[AI_NUM_AIMS];
+  double offsets[AI_NUM_AIMS];
+  for (size_t i = 0; i < AI_NUM_AIMS; i++) {
+    double steps = (double)i - (AI_NUM_AIMS - 1) / 2;
+    offsets[i] = steps * AI_AIM_SPACING;
+    targets[i] = aim_point(line, progress, speed, offsets[i]);
+    bias[i] = AI_AIM_STRAY_COST * fabs(steps);
+    if (offsets[i] != field->aim_offsets[idx]) {
+      bias[i] += AI_AIM_SWITCH_COST;
+    }
+  }
+  size_t choice =
+      ai_perception_choose(field->perception, car, targets, bias, AI_NUM_AIMS);
+  field->aim_offsets[idx] = offsets[choice];
+}
+
+static double microseconds_since(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e6 +
+         (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+/**
+ * Replans the karts' aims in turn until every kart has been planned or the
+ * budget runs out. At least one kart is planned each update, so every kart
+ * is replanned within as many updates as there are karts.
+ */
+static void plan_aims(ai_field_t *field) {
+  if (field->size == 0) {
+    return;
+  }
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  size_t planned = 0;
+  while (planned < field->size) {
+    if (planned > 0 && field->budget > 0 &&
+        microseconds_since(&start) >= field->budget) {
+      break;
+    }
+    plan_aim(field, (field->next_plan + planned) % field->size);
+    planned++;
+  }
+  field->next_plan = (field->next_plan + planned) % field->size;
+}
+
+/**
+ * Returns the curvature of the arc pure pursuit follows to the aim point:
+ * 2 sin(alpha) / d for a target at distance d and angle alpha off the
+ * heading. Positive curves to the left.
+ */
+static double pursuit_curvature(body_t *car, vector_t target) {
+  vector_t offset = vec_subtract(target, body_get_centroid(car));
+  double distance = vec_get_length(offset);
+  if (distance == 0) {
+    return 0;
+  }
+  double theta = body_get_rotation(car);
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  double sin_alpha = vec_cross(heading, offset) / distance;
+  // Turn as hard as possible towards a target behind the kart
+  if (vec_dot(heading, offset) < 0) {
+    sin_alpha = sin_alpha < 0 ? -1 : 1;
+  }
+  return 2 * sin_alpha / distance;
+}
+
+static bool in_range(vector_t a, vector_t b, double range) {
+  vector_t offset = vec_subtract(a, b);
+  return vec_dot(offset, offset) < range * range;
+}
+
+/**
+ * Whether the kart at the given index should be simulated: it is stunned,
+ * or near the focus or another kart. Gliding karts must come nearer than
+ * simulated ones to switch.
+ */
+static bool needs_physics(ai_field_t *field, size_t idx) {
+  body_t *car = field->cars[idx];
+  if (field->focus == NULL || car_has_effect(car, EFFECT_STUN)) {
+    return true;
+  }
+  bool gliding = body_is_kinematic(car);
+  double focus_range = gliding ? AI_LOD_FOCUS_NEAR : AI_LOD_FOCUS_FAR;
+  double kart_range = gliding ? AI_LOD_KART_NEAR : AI_LOD_KART_FAR;
+  vector_t center = body_get_centroid(car);
+  if (in_range(center, body_get_centroid(field->focus), focus_range)) {
+    return true;
+  }
+  for (size_t i = 0; i < field->size; i++) {
+    if (i != idx &&
+        in_range(center, body_get_centroid(field->cars[i]), kart_range)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Takes the kart at the given index out of the physics, keeping its speed
+ * and its distance from its racing line.
+ */
+static void start_gliding(ai_field_t *field, size_t idx) {
+  body_t *car = field->cars[idx];
+  racing_line_t *line = field->lines[field->line_idx[idx]];
+  double progress = get_progress(car_get_checkpoint_state(car));
+  vector_t along = line_direction(line, progress);
+  vector_t point = racing_line_point_at(line, progress);
+  vector_t offset = vec_subtract(body_get_centroid(car), point);
+  field->glide_progress[idx] = progress;
+  field->glide_speeds[idx] = vec_get_length(body_get_velocity(car));
+  field->glide_offsets[idx] = vec_cross(along, offset);
+  body_set_kinematic(car, true);
+}
+
+/**
+ * Moves a gliding kart along its racing line, speeding up and slowing down
+ * as the speed profile asks and drifting onto the line. The kart is left
+ * with the velocity it is moving at, so it carries on smoothly if it is
+ * simulated again.
+ */
+static void glide(ai_field_t *field, size_t idx, double dt) {
+  body_t *car = field->cars[idx];
+  racing_line_t *line = field->lines[field->line_idx[idx]];
+  double progress = field->glide_progress[idx];
+  double speed = field->glide_speeds[idx];
+  double target_speed =
+      field->skills[idx] * car_get_speed_multiplier(car) *
+      racing_line_speed_at(line, progress + AI_SPEED_PREVIEW * speed);
+  speed += fmax(fmin(target_speed - speed, AI_ACCELERATION * dt),
+                -AI_BRAKING * dt);
+  // Progress is measured along the centerline, which is shorter or longer
+  // than the racing line around corners
+  double stretch = vec_get_length(vec_subtract(
+      racing_line_point_at(line, progress + 1),
+      racing_line_point_at(line, progress)));
+  if (stretch > 0) {
+    progress = fmod(progress + speed * dt / stretch,
+                    track_get_length(field->track));
+  }
+  double offset = field->glide_offsets[idx] * exp(-AI_LOD_SETTLE_RATE * dt);
+
+  vector_t along = line_direction(line, progress);
+  vector_t normal = {.x = -along.y, .y = along.x};
+  body_set_centroid(car, vec_add(racing_line_point_at(line, progress),
+                                 vec_multiply(offset, normal)));
+  body_set_rotation(car, atan2(along.x, -along.y));
+  body_set_velocity(car, vec_multiply(speed, along));
+  field->glide_progress[idx] = progress;
+  field->glide_speeds[idx] = speed;
+  field->glide_offsets[idx] = offset;
+}
+
+/**
+ * Works the steering, throttle and brake of the simulated kart at the given
+ * index.
+ */
+static void drive(ai_field_t *field, size_t idx, double dt) {
+  body_t *car = field->cars[idx];
+  racing_line_t *line = field->lines[field->line_idx[idx]];
+  double progress = get_progress(car_get_checkpoint_state(car));
+  double speed = vec_get_length(body_get_velocity(car));
+  vector_t target =
+      aim_point(line, progress, speed, field->aim_offsets[idx]);
+  // Steer onto the arc through the aim point, which turns at its curvature
+  // times the speed
+  double curvature = pursuit_curvature(car, target);
+  double turn_rate = car_get_turn_rate(car);
+  car_controls_t controls = {.throttle = 0, .steer = 0};
+  if (turn_rate > 0) {
+    controls.steer = curvature * speed / turn_rate;
+  }
+
+  double target_speed =
+      field->skills[idx] * car_get_speed_multiplier(car) *
+      racing_line_speed_at(line, progress + AI_SPEED_PREVIEW * speed);
+  // A kart off its line may need a tighter arc than the line does, so slow
+  // to a speed the tires can hold it at
+  if (curvature != 0) {
+    target_speed =
+        fmin(target_speed, sqrt(car_get_grip(car) / fabs(curvature)));
+  }
+  // Brake only once well over the target, and ease off either pedal once it
+  // would overshoot the target in a single tick
+  if (speed < target_speed || speed > target_speed + AI_SPEED_TOLERANCE) {
+    controls.throttle =
+        (target_speed - speed) / (car_get_acceleration(car) * dt);
+  }
+  car_set_controls(car, controls);
+}
+
+void ai_field_update(ai_field_t *field, double dt) {
+  for (size_t i = 0; i < field->size; i++) {
+    body_t *car = field->cars[i];
+    bool physics = needs_physics(field, i);
+    if (physics && body_is_kinematic(car)) {
+      body_set_kinematic(car, false);
+      field->aim_offsets[i] = 0;
+    } else if (!physics && !body_is_kinematic(car)) {
+      start_gliding(field, i);
+    }
+  }
+
+  for (size_t i = 0; i < field->size; i++) {
+    ai_perception_add(field->perception, field->cars[i], OBSTACLE_KART);
+  }
+  plan_aims(field);
+  ai_perception_clear(field->perception);
+
+  for (size_t i = 0; i < field->size; i++) {
+    body_t *car = field->cars[i];
+    if (body_is_kinematic(car)) {
+      glide(field, i, dt);
+    } else if (!car_has_effect(car, EFFECT_STUN)) {
+      drive(field, i, dt);
+    }
+  }
+}
@@ -0,0 +1,195 @@
+#include "ai_items.h"
+#include "car.h"
+#include "checkpoints.h"
+#include "power_up.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// How many times a second each driver looks at its item
+const double AI_ITEM_RATE = 4.0;
+// How long a driver holds a new item before it will use it
+const double AI_ITEM_HOLD = 1.0;
+// How close another kart must be for each item to be worth using on it
+const double AI_SHELL_RANGE = 250.0;
+const double AI_FAKE_RANGE = 300.0;
+const double AI_STAR_RANGE = 200.0;
+// How far to the side a kart ahead or behind may be, per unit along the
+// heading
+const double AI_ITEM_CONE = 0.5;
+// A straight is where the racing line's speed profile stays within a
+// fraction of the kart's top speed for some distance ahead
+const double AI_STRAIGHT_LENGTH = 300.0;
+const size_t AI_STRAIGHT_SAMPLES = 4;
+const double AI_STRAIGHT_SPEED = 0.95;
+
+struct ai_items {
+  ai_field_t *field;
+  list_t *karts;
+  size_t player;
+  double period;
+  double time;
+  // Indexed by kart in the field
+  size_t *standings_idx;
+  double *next_turns;
+  float *held_times;
+};
+
+/**
+ * Returns the index of a kart in the list of all karts.
+ */
+static size_t find_kart(list_t *karts, body_t *car) {
+  for (size_t i = 0; i < list_size(karts); i++) {
+    if (list_get(karts, i) == car) {
+      return i;
+    }
+  }
+  assert(false);
+  return 0;
+}
+
+ai_items_t *ai_items_init(ai_field_t *field, list_t *karts, body_t *player) {
+  ai_items_t *items = malloc(sizeof(ai_items_t));
+  assert(items != NULL);
+  size_t size = ai_field_size(field);
+  items->field = field;
+  items->karts = karts;
+  items->player = find_kart(karts, player);
+  items->period = 1 / AI_ITEM_RATE;
+  items->time = 0;
+  items->standings_idx = malloc(size * sizeof(size_t));
+  items->next_turns = malloc(size * sizeof(double));
+  items->held_times = malloc(size * sizeof(float));
+  assert(items->standings_idx != NULL && items->next_turns != NULL &&
+         items->held_times != NULL);
+  for (size_t i = 0; i < size; i++) {
+    items->standings_idx[i] = find_kart(karts, ai_field_get_car(field, i));
+    // Spread the drivers' turns evenly over a period
+    items->next_turns[i] = items->period * i / size;
+    items->held_times[i] = 0;
+  }
+  return items;
+}
+
+void ai_items_free(ai_items_t *items) {
+  free(items->standings_idx);
+  free(items->next_turns);
+  free(items->held_times);
+  free(items);
+}
+
+/**
+ * Whether another kart is within range of the kart at the given index.
+ *
+ * @param items the policy
+ * @param idx the kart's index in the field
+ * @param range how far away the other kart may be
+ * @param direction 1 to look only ahead of the kart, -1 only behind it, and
+ *   0 all around it
+ */
+static bool kart_near(ai_items_t *items, size_t idx, double range,
+                      int direction) {
+  body_t *car = ai_field_get_car(items->field, idx);
+  vector_t center = body_get_centroid(car);
+  double theta = body_get_rotation(car);
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  for (size_t i = 0; i < list_size(items->karts); i++) {
+    body_t *other = list_get(items->karts, i);
+    if (other == car) {
+      continue;
+    }
+    vector_t offset = vec_subtract(body_get_centroid(other), center);
+    if (vec_dot(offset, offset) > range * range) {
+      continue;
+    }
+    if (direction == 0) {
+      return true;
+    }
+    double along = direction * vec_dot(offset, heading);
+    double aside = fabs(vec_cross(heading, offset));
+    if (along > 0 && aside <= AI_ITEM_CONE * along) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * Whether the kart at the given index can hold close to its top speed for
+ * a while.
+ */
+static bool on_straight(ai_items_t *items, size_t idx) {
+  body_t *car = ai_field_get_car(items->field, idx);
+  racing_line_t *line = ai_field_get_line(items->field, idx);
+  double progress = get_progress(car_get_checkpoint_state(car));
+  double limit = AI_STRAIGHT_SPEED * car_get_top_speed(car);
+  for (size_t i = 0; i <= AI_STRAIGHT_SAMPLES; i++) {
+    double ahead = AI_STRAIGHT_LENGTH * i / AI_STRAIGHT_SAMPLES;
+    if (racing_line_speed_at(line, progress + ahead) < limit) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ai_items_wants_use(ai_items_t *items, size_t idx,
+                        standings_t *standings) {
+  body_t *car = ai_field_get_car(items->field, idx);
+  power_up_info_t info = car_get_powerup_state(car);
+  if (ai_field_is_gliding(items->field, idx) ||
+      car_has_effect(car, EFFECT_STUN)) {
+    return false;
+  }
+  if (car_has_shell(car)) {
+    return kart_near(items, idx, AI_SHELL_RANGE, 1);
+  }
+  size_t position =
+      standings_get_position(standings, items->standings_idx[idx]);
+  switch (info.power_up) {
+  case SHELL: {
+    return true;
+  }
+  case FAKE: {
+    return position == 1 || kart_near(items, idx, AI_FAKE_RANGE, -1);
+  }
+  case BOOST:
+  case SHROOM: {
+    return !car_has_effect(car, EFFECT_FAST) && on_straight(items, idx);
+  }
+  case STAR: {
+    bool behind = 2 * position > standings_get_num_karts(standings);
+    return kart_near(items, idx, AI_STAR_RANGE, 0) ||
+           (behind && on_straight(items, idx));
+  }
+  case REVERSE: {
+    return standings_get_position(standings, items->player) < position;
+  }
+  default: {
+    return false;
+  }
+  }
+}
+
+void ai_items_update(ai_items_t *items, standings_t *standings, double dt,
+                     item_user_t use, void *aux) {
+  items->time += dt;
+  for (size_t i = 0; i < ai_field_size(items->field); i++) {
+    if (items->time < items->next_turns[i]) {
+      continue;
+    }
+    while (items->next_turns[i] <= items->time) {
+      items->next_turns[i] += items->period;
+    }
+    body_t *car = ai_field_get_car(items->field, i);
+    if (car_get_powerup_state(car).power_up == NONE && !car_has_shell(car)) {
+      items->held_times[i] = 0;
+      continue;
+    }
+    items->held_times[i] += items->period;
+    if (items->held_times[i] >= AI_ITEM_HOLD &&
+        ai_items_wants_use(items, i, standings)) {
+      use(car, aux);
+      items->held_times[i] = 0;
+    }
+  }
+}
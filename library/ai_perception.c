@@ -0,0 +1,232 @@
+#include "ai_perception.h"
+#include "list.h"
+#include "polygon.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t PERCEPTION_INITIAL_OBSTACLES = 16;
+// Running into something costs its base cost if it happens at the end of a
+// path, rising to twice that if it happens straight away
+const double PERCEPTION_WALL_COST = 6.0;
+const double PERCEPTION_KART_COST = 4.0;
+const double PERCEPTION_HAZARD_COST = 8.0;
+// A sweep is blocked once it comes this close to a wall
+const double PERCEPTION_HIT_DISTANCE = 1.0;
+// How much closer to a wall than it starts a sweep may come
+const double PERCEPTION_WALL_SLACK = 8.0;
+// The shortest step a sweep takes, so grazing a wall does not stall it
+const double PERCEPTION_MIN_STEP = 4.0;
+const size_t PERCEPTION_MAX_STEPS = 64;
+// Karts slower than this are treated as moving this fast, so the time to
+// reach a target stays finite
+const double PERCEPTION_MIN_SPEED = 20.0;
+
+struct ai_perception {
+  track_t *track;
+  size_t size;
+  size_t capacity;
+  // Each obstacle's snapshot, indexed by obstacle
+  body_t **bodies;
+  vector_t *positions;
+  vector_t *velocities;
+  float *radii;
+  float *costs;
+};
+
+ai_perception_t *ai_perception_init(track_t *track) {
+  ai_perception_t *perception = malloc(sizeof(ai_perception_t));
+  assert(perception != NULL);
+  perception->track = track;
+  perception->size = 0;
+  perception->capacity = 0;
+  perception->bodies = NULL;
+  perception->positions = NULL;
+  perception->velocities = NULL;
+  perception->radii = NULL;
+  perception->costs = NULL;
+  return perception;
+}
+
+void ai_perception_free(ai_perception_t *perception) {
+  free(perception->bodies);
+  free(perception->positions);
+  free(perception->velocities);
+  free(perception->radii);
+  free(perception->costs);
+  free(perception);
+}
+
+void ai_perception_clear(ai_perception_t *perception) {
+  perception->size = 0;
+}
+
+static void ensure_capacity(ai_perception_t *perception) {
+  if (perception->size < perception->capacity) {
+    return;
+  }
+  size_t capacity = perception->capacity == 0 ? PERCEPTION_INITIAL_OBSTACLES
+                                              : 2 * perception->capacity;
+  perception->bodies =
+      realloc(perception->bodies, capacity * sizeof(body_t *));
+  perception->positions =
+      realloc(perception->positions, capacity * sizeof(vector_t));
+  perception->velocities =
+      realloc(perception->velocities, capacity * sizeof(vector_t));
+  perception->radii = realloc(perception->radii, capacity * sizeof(float));
+  perception->costs = realloc(perception->costs, capacity * sizeof(float));
+  assert(perception->bodies != NULL && perception->positions != NULL &&
+         perception->velocities != NULL && perception->radii != NULL &&
+         perception->costs != NULL);
+  perception->capacity = capacity;
+}
+
+/**
+ * Adds an obstacle, which is skipped when scoring the given body's
+ * candidates.
+ */
+static void add_obstacle(ai_perception_t *perception, body_t *body,
+                         vector_t position, vector_t velocity, double radius,
+                         obstacle_type_t type) {
+  ensure_capacity(perception);
+  size_t idx = perception->size++;
+  perception->bodies[idx] = body;
+  perception->positions[idx] = position;
+  perception->velocities[idx] = velocity;
+  perception->radii[idx] = radius;
+  perception->costs[idx] =
+      type == OBSTACLE_KART ? PERCEPTION_KART_COST : PERCEPTION_HAZARD_COST;
+}
+
+void ai_perception_add(ai_perception_t *perception, body_t *body,
+                       obstacle_type_t type) {
+  add_obstacle(perception, body, body_get_centroid(body),
+               body_get_velocity(body), ai_perception_radius(body), type);
+}
+
+void ai_perception_add_circle(ai_perception_t *perception, vector_t position,
+                              vector_t velocity, double radius,
+                              obstacle_type_t type) {
+  add_obstacle(perception, NULL, position, velocity, radius, type);
+}
+
+size_t ai_perception_size(ai_perception_t *perception) {
+  return perception->size;
+}
+
+double ai_perception_radius(body_t *body) {
+  vector_t centroid = body_get_centroid(body);
+  list_t *points = polygon_get_points(body_get_polygon(body));
+  double radius = 0;
+  for (size_t i = 0; i < list_size(points); i++) {
+    vector_t *point = list_get(points, i);
+    radius = fmax(radius, vec_get_length(vec_subtract(*point, centroid)));
+  }
+  return radius;
+}
+
+double ai_perception_cast_wall(ai_perception_t *perception, vector_t from,
+                               vector_t to, double radius) {
+  track_t *track = perception->track;
+  vector_t path = vec_subtract(to, from);
+  double length = vec_get_length(path);
+  double start = track_get_distance(track, from);
+  // Off the road there is nothing to judge the walls by
+  if (length == 0 || start <= 0) {
+    return 1;
+  }
+  // A kart already close to a wall may still steer along or away from it,
+  // but not further into it
+  double margin = fmax(fmin(radius, start - PERCEPTION_WALL_SLACK), 0);
+  vector_t direction = vec_multiply(1 / length, path);
+  double t = 0;
+  for (size_t i = 0; i < PERCEPTION_MAX_STEPS && t < length; i++) {
+    vector_t point = vec_add(from, vec_multiply(t, direction));
+    double clear = track_get_distance(track, point) - margin;
+    if (clear < PERCEPTION_HIT_DISTANCE) {
+      return t / length;
+    }
+    t += fmax(clear, PERCEPTION_MIN_STEP);
+  }
+  return fmin(t / length, 1);
+}
+
+/**
+ * Returns the first time two circles moving apart or together at a constant
+ * relative velocity touch, or INFINITY if they never do.
+ *
+ * @param offset the position of the second circle relative to the first
+ * @param velocity the velocity of the second circle relative to the first
+ * @param radius the sum of the circles' radii
+ */
+static double contact_time(vector_t offset, vector_t velocity,
+                           double radius) {
+  double c = vec_dot(offset, offset) - radius * radius;
+  if (c <= 0) {
+    return 0;
+  }
+  double a = vec_dot(velocity, velocity);
+  double b = vec_dot(offset, velocity);
+  double discriminant = b * b - a * c;
+  if (b >= 0 || discriminant < 0) {
+    return INFINITY;
+  }
+  return (-b - sqrt(discriminant)) / a;
+}
+
+double ai_perception_cast_obstacles(ai_perception_t *perception, body_t *car,
+                                    vector_t to, double speed) {
+  vector_t from = body_get_centroid(car);
+  vector_t path = vec_subtract(to, from);
+  double length = vec_get_length(path);
+  if (length == 0) {
+    return 0;
+  }
+  double horizon = length / fmax(speed, PERCEPTION_MIN_SPEED);
+  vector_t velocity = vec_multiply(1 / horizon, path);
+  double radius = ai_perception_radius(car);
+  double cost = 0;
+  for (size_t i = 0; i < perception->size; i++) {
+    if (perception->bodies[i] == car) {
+      continue;
+    }
+    double time = contact_time(
+        vec_subtract(perception->positions[i], from),
+        vec_subtract(perception->velocities[i], velocity),
+        radius + perception->radii[i]);
+    if (time <= horizon) {
+      cost += perception->costs[i] * (2 - time / horizon);
+    }
+  }
+  return cost;
+}
+
+size_t ai_perception_choose(ai_perception_t *perception, body_t *car,
+                            const vector_t *targets, const double *bias,
+                            size_t size) {
+  assert(size > 0);
+  vector_t from = body_get_centroid(car);
+  double speed = vec_get_length(body_get_velocity(car));
+  double radius = ai_perception_radius(car);
+  size_t best = 0;
+  double best_cost = INFINITY;
+  for (size_t i = 0; i < size; i++) {
+    double cost = bias[i];
+    if (cost >= best_cost) {
+      continue;
+    }
+    double clear = ai_perception_cast_wall(perception, from, targets[i],
+                                           radius);
+    if (clear < 1) {
+      cost += PERCEPTION_WALL_COST * (2 - clear);
+    }
+    if (cost < best_cost) {
+      cost += ai_perception_cast_obstacles(perception, car, targets[i], speed);
+    }
+    if (cost < best_cost) {
+      best = i;
+      best_cost = cost;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,48 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "asset_body.h"
+
+// An implementation of asset_body.h for programs that run without a display,
+// such as the race simulator. Assets keep their type and body, so the game
+// rules that hide an item by clearing its asset's body still work, but
+// nothing is loaded or drawn. Link it instead of asset.c, asset_cache.c and
+// sdl_wrapper.c.
+
+typedef struct asset {
+  asset_type_t type;
+  body_t *body;
+} asset_t;
+
+static asset_t *asset_init(asset_type_t type, body_t *body) {
+  asset_t *asset = malloc(sizeof(asset_t));
+  assert(asset != NULL);
+  asset->type = type;
+  asset->body = body;
+  return asset;
+}
+
+asset_type_t asset_get_type(asset_t *asset) { return asset->type; }
+
+asset_t *asset_make_image_with_body(const char *filepath, body_t *body) {
+  return asset_init(ASSET_IMAGE, body);
+}
+
+asset_t *asset_make_rotatable_image_with_body(const char *filepath,
+                                              body_t *body) {
+  return asset_init(ASSET_IMAGE, body);
+}
+
+body_t *asset_get_body(asset_t *asset) {
+  return asset->type == ASSET_IMAGE ? asset->body : NULL;
+}
+
+void asset_set_body(asset_t *asset, body_t *body) {
+  if (asset->type == ASSET_IMAGE) {
+    asset->body = body;
+  }
+}
+
+void asset_render(asset_t *asset) {}
+
+void asset_destroy(asset_t *asset) { free(asset); }
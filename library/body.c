@@ -13,7 +13,9 @@ struct body {
   vector_t force;
   vector_t impulse;
   bool removed;
+  bool kinematic;
   double rotation;
+  double angular_velocity;
 
   void *info;
   free_func_t info_freer;
@@ -29,7 +31,9 @@ body_t *body_init_with_info(list_t *shape, double mass, rgb_color_t color,
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
   body->removed = false;
+  body->kinematic = false;
   body->rotation = 0;
+  body->angular_velocity = 0;
   body->info = info;
   body->info_freer = info_freer;
   return body;
@@ -88,6 +92,14 @@ void body_set_rotation(body_t *body, double angle) {
   body->rotation = angle;
 }
 
+double body_get_angular_velocity(body_t *body) {
+  return body->angular_velocity;
+}
+
+void body_set_angular_velocity(body_t *body, double omega) {
+  body->angular_velocity = omega;
+}
+
 void body_free(body_t *body) {
   polygon_free(body->poly);
   if (body->info_freer != NULL) {
@@ -101,6 +113,11 @@ body_t *body_init(list_t *shape, double mass, rgb_color_t color) {
 }
 
 void body_tick(body_t *body, double dt) {
+  if (body->kinematic) {
+    polygon_translate(body->poly, vec_multiply(dt, body_get_velocity(body)));
+    body_reset(body);
+    return;
+  }
   vector_t old_vel = body_get_velocity(body);
   vector_t dv1 = vec_multiply(dt / body->mass, body->force);
   vector_t dv2 = vec_multiply(1 / body->mass, body->impulse);
@@ -110,6 +127,9 @@ void body_tick(body_t *body, double dt) {
   vector_t displacement = integrate_simpson(old_vel, mid_vel, new_vel, dt);
   polygon_translate(body->poly, displacement);
   body_set_velocity(body, new_vel);
+  if (body->angular_velocity != 0) {
+    body_set_rotation(body, body->rotation + body->angular_velocity * dt);
+  }
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
 }
@@ -128,6 +148,12 @@ void body_remove(body_t *body) { body->removed = true; }
 
 bool body_is_removed(body_t *body) { return body->removed; }
 
+void body_set_kinematic(body_t *body, bool kinematic) {
+  body->kinematic = kinematic;
+}
+
+bool body_is_kinematic(body_t *body) { return body->kinematic; }
+
 void body_reset(body_t *body) {
   body->force = VEC_ZERO;
   body->impulse = VEC_ZERO;
@@ -1,12 +1,17 @@
 #include "car.h"
-#include "asset.h"
+#include "asset_body.h"
 #include "body.h"
 #include "checkpoints.h"
+#include "collision.h"
+#include "forces.h"
+#include "surface.h"
+#include "track.h"
 #include <assert.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 const double CAR_WIDTH = 30.0;
 const double CAR_HEIGHT = 60.0;
@@ -26,199 +31,417 @@ const char *PICKUP_IMG = "assets/pickup_truck.png";
 const char *AI_IMG = "assets/ai_minimap.png";
 const char *GHOST_IMG = "assets/ghost.png";
 
+// Accelerations are the engine's at full throttle, in pixels per second^2,
+// and have to beat the drag of the asphalt at the top speed
 const double F1_MASS = 180.0;
 const double F1_FRICTION = 5;
 const double F1_TOP_SPEED = 250.0;
-const double F1_ACCELERATION = 15.0;
+const double F1_ACCELERATION = 900.0;
 
 const double GOLF_CART_MASS = 20.0;
 const double GOLF_CART_FRICTION = 2;
 const double GOLF_CART_TOP_SPEED = 200.0;
-const double GOLF_CART_ACCELERATION = 30.0;
+const double GOLF_CART_ACCELERATION = 1200.0;
 
 const double PICKUP_MASS = 500.0;
 const double PICKUP_FRICTION = 3.5;
 const double PICKUP_TOP_SPEED = 150.0;
-const double PICKUP_ACCELERATION = 7.5;
+const double PICKUP_ACCELERATION = 600.0;
+
+// Gravity, which sets how hard a car can corner for its tires' friction
+const double G = 9.81;
+// The tightest circle a car can turn in at walking pace
+const double MIN_TURN_RADIUS = 20.0;
+// How fast a car slides sideways before its tires push back with all their
+// grip; slower slides are resisted in proportion
+const double TIRE_SLIP_SPEED = 2.0;
 
-const double ZERO_TOL = 0.01;
 const double WRONG_WAY_TIME_TOL = 5.0;
+const double RESPAWN_MARGIN = 30.0;
+const double RESPAWN_SNAP_DIST = 120.0;
+const double SURFACE_STOP_SPEED = 5.0;
+const double WALL_RADIUS = 2.0;
+// Slack on the distance field lookup before testing the wall segments
+const double WALL_CHECK_MARGIN = 20.0;
+// The most walls a car is tested against in a tick, far more than fit
+// around a car on any track
+#define WALL_MAX_CANDIDATES 64
+// The most walls a car remembers touching
+#define WALL_MAX_CONTACTS 16
+// How fast a stunned car spins, in radians per second
+const double STUN_ROT_SPEED = 2 * M_PI;
+
+// A car body's info: where its state is kept
+typedef struct kart_ref {
+  kart_store_t *store;
+  size_t id;
+} kart_ref_t;
+
+typedef struct surface_aux {
+  double force_const; // unused; the scene frees aux as a body_aux_t
+  list_t *bodies;
+  track_t *track;
+} surface_aux_t;
+
+typedef struct wall_aux {
+  double force_const; // elasticity; the scene frees aux as a body_aux_t
+  list_t *bodies;
+  track_t *track;
+  size_t *hits; // counts new contacts, if not NULL
+  // The walls the body touched last tick
+  size_t num_touching;
+  size_t touching[WALL_MAX_CONTACTS];
+} wall_aux_t;
+
+typedef struct vehicle_aux {
+  double force_const; // unused; the scene frees aux as a body_aux_t
+  list_t *bodies;
+} vehicle_aux_t;
+
+static void free_kart_ref(kart_ref_t *ref) {
+  kart_store_remove(ref->store, ref->id);
+  free(ref);
+}
+
+kart_store_t *car_get_store(body_t *car) {
+  kart_ref_t *ref = body_get_info(car);
+  return ref->store;
+}
+
+size_t car_get_id(body_t *car) {
+  kart_ref_t *ref = body_get_info(car);
+  return ref->id;
+}
+
+static kart_stats_t *stats_of(body_t *car) {
+  kart_ref_t *ref = body_get_info(car);
+  return &kart_store_get_stats(ref->store)[ref->id];
+}
 
-typedef struct car_info {
-  car_type_t type;
-  double friction;
-  double top_speed;
-  double acceleration;
-  power_up_info_t power_up_state;
-  checkpoint_state_t *checkpoint_state;
-  uint8_t laps_done;
-} car_info_t;
-
-car_info_t *make_car_info(car_type_t type, double friction, double top_speed,
-                          double acceleration) {
-  car_info_t *info = malloc(sizeof(car_info_t));
-  assert(info != NULL);
-  info->type = type;
-  info->friction = friction;
-  info->top_speed = top_speed;
-  info->acceleration = acceleration;
-  info->laps_done = 0;
-  info->power_up_state = (power_up_info_t){0, 0, 0, 0, 0};
-  info->checkpoint_state = NULL;
-  return info;
-}
-
-void free_car_info(car_info_t *car_info) {
-  checkpoint_state_free(car_info->checkpoint_state);
-  free(car_info);
+static kart_progress_t *progress_of(body_t *car) {
+  kart_ref_t *ref = body_get_info(car);
+  return &kart_store_get_progress(ref->store)[ref->id];
+}
+
+static car_controls_t *controls_of(body_t *car) {
+  kart_ref_t *ref = body_get_info(car);
+  return &kart_store_get_controls(ref->store)[ref->id];
 }
 
 checkpoint_state_t *car_get_checkpoint_state(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->checkpoint_state;
+  return progress_of(car)->checkpoint_state;
 }
 
 void change_top_speed(body_t *car, double new_top_speed) {
-  car_info_t *info = body_get_info(car);
-  info->top_speed = new_top_speed;
+  stats_of(car)->top_speed = new_top_speed;
 }
 
-uint8_t car_get_laps_done(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->laps_done;
-}
+uint8_t car_get_laps_done(body_t *car) { return progress_of(car)->laps_done; }
 
 void car_set_laps_done(body_t *car, uint8_t laps_done) {
-  car_info_t *info = body_get_info(car);
-  info->laps_done = laps_done;
+  progress_of(car)->laps_done = laps_done;
 }
 
 void car_set_checkpoint_state(body_t *car,
                               checkpoint_state_t *checkpoint_state) {
-  car_info_t *info = body_get_info(car);
-  info->checkpoint_state = checkpoint_state;
+  progress_of(car)->checkpoint_state = checkpoint_state;
 }
 
+size_t car_get_kart_hits(body_t *car) { return progress_of(car)->kart_hits; }
+
+void car_add_kart_hit(body_t *car) { progress_of(car)->kart_hits++; }
+
 power_up_info_t car_get_powerup_state(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->power_up_state;
+  kart_ref_t *ref = body_get_info(car);
+  return kart_store_get_items(ref->store)[ref->id];
 }
 
 void car_set_powerup_state(body_t *car, power_up_info_t power_up_info) {
-  car_info_t *info = body_get_info(car);
-  info->power_up_state = power_up_info;
+  kart_ref_t *ref = body_get_info(car);
+  kart_store_get_items(ref->store)[ref->id] = power_up_info;
+}
+
+double car_get_speed_multiplier(body_t *car) {
+  if (car_has_effect(car, EFFECT_FAST)) {
+    return get_speed_multiplier();
+  } else if (car_has_effect(car, EFFECT_IMMUNE)) {
+    return get_star_multiplier();
+  }
+  return 1;
 }
 
-car_type_t car_get_type(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->type;
+void car_start_effect(body_t *car, timer_wheel_t *timers, car_effect_t effect,
+                      double duration) {
+  kart_ref_t *ref = body_get_info(car);
+  kart_store_start_effect(ref->store, ref->id, timers, effect, duration);
 }
 
-double car_get_friction(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->friction;
+bool car_has_effect(body_t *car, car_effect_t effect) {
+  kart_ref_t *ref = body_get_info(car);
+  return kart_store_get_effects(ref->store)[ref->id].effects[effect].on;
 }
 
+car_type_t car_get_type(body_t *car) { return stats_of(car)->type; }
+
+double car_get_friction(body_t *car) { return stats_of(car)->friction; }
+
 double car_get_acceleration(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->acceleration;
+  return stats_of(car)->acceleration;
+}
+
+double car_get_top_speed(body_t *car) { return stats_of(car)->top_speed; }
+
+double car_get_grip(body_t *car) { return car_get_friction(car) * G; }
+
+void car_set_controls(body_t *car, car_controls_t controls) {
+  car_controls_t *stored = controls_of(car);
+  stored->throttle = fmax(fmin(controls.throttle, 1), -1);
+  stored->steer = fmax(fmin(controls.steer, 1), -1);
+}
+
+car_controls_t car_get_controls(body_t *car) { return *controls_of(car); }
+
+double car_get_turn_rate(body_t *car) {
+  double theta = body_get_rotation(car);
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  double speed = fabs(vec_dot(body_get_velocity(car), heading));
+  if (speed == 0) {
+    return 0;
+  }
+  // The tightest turn the tires can hold has a radius of v^2 / (mu g), and
+  // the steering cannot turn tighter than the smallest circle
+  return fmin(car_get_grip(car) / speed, speed / MIN_TURN_RADIUS);
 }
 
-double car_get_top_speed(body_t *car) {
-  car_info_t *info = body_get_info(car);
-  return info->top_speed;
+bool car_respawn(body_t *car) {
+  checkpoint_state_t *checkpoint_state = car_get_checkpoint_state(car);
+  track_t *track = get_track(checkpoint_state);
+  vector_t car_cent = body_get_centroid(car);
+  bool on_road = track_on_road(track, car_cent);
+  // Cars on the road are left alone, and so are cars going the wrong way off
+  // it, until they have been going the wrong way for too long
+  if (get_wrong_way_time(checkpoint_state) < WRONG_WAY_TIME_TOL &&
+      (on_road || get_wrong_way(car, checkpoint_state))) {
+    return false;
+  }
+  spawn_t respawn = track_respawn_at(track, get_progress(checkpoint_state));
+  body_set_velocity(car, VEC_ZERO);
+  body_set_rotation(car, respawn.rotation);
+
+  // Pull the car back to the closest point on the road, unless that point is
+  // far enough away to be on another part of the track
+  if (!on_road) {
+    vector_t nearest = track_nearest_on_road(track, car_cent, RESPAWN_MARGIN);
+    if (vec_get_length(vec_subtract(nearest, car_cent)) < RESPAWN_SNAP_DIST) {
+      respawn.position = nearest;
+    }
+  }
+  body_set_centroid(car, respawn.position);
+  return true;
 }
 
 /**
- * Helper function to check if car centre not in bound of line 1 and 2
+ * The force creator for surfaces. Looks up the surface under the car and
+ * applies its drag, friction and thrust.
+ *
+ * @param info the surface aux for the car
  */
-bool check_in_bounds(vector_t car_cent, vector_t in_1, vector_t in_2,
-                     vector_t out_1, vector_t out_2, vector_t direction) {
-
-  double x_min = fmin(fmin(in_1.x, in_2.x), fmin(out_1.x, out_2.x));
-  double x_max = fmax(fmax(in_1.x, in_2.x), fmax(out_1.x, out_2.x));
-  double y_min = fmin(fmin(in_1.y, in_2.y), fmin(out_1.y, out_2.y));
-  double y_max = fmax(fmax(in_1.y, in_2.y), fmax(out_1.y, out_2.y));
-
-  // Check if straight
-  if ((-ZERO_TOL < direction.x && direction.x < ZERO_TOL) ||
-      (-ZERO_TOL < direction.y && direction.y < ZERO_TOL)) {
-    return x_min <= car_cent.x && car_cent.x <= x_max && y_min <= car_cent.y &&
-           car_cent.y <= y_max;
+static void surface_force(void *info) {
+  surface_aux_t *aux = info;
+  body_t *car = list_get(aux->bodies, 0);
+  if (body_is_kinematic(car)) {
+    return;
   }
+  surface_properties_t surface = surface_get_properties(
+      track_get_surface(aux->track, body_get_centroid(car)));
+  double mass = body_get_mass(car);
+  vector_t vel = body_get_velocity(car);
+  vector_t force = vec_multiply(-surface.drag * mass, vel);
+  double speed = vec_get_length(vel);
+  if (speed > 0) {
+    // Fade friction out near a stop so it cannot reverse the car
+    double friction = surface.friction * fmin(speed / SURFACE_STOP_SPEED, 1);
+    force = vec_add(
+        force, vec_multiply((surface.thrust - friction) * mass / speed, vel));
+  }
+  body_add_force(car, force);
+}
 
-  // else its 45 degreess
-
-  double cos_t = direction.x;
-  double sin_t = direction.y;
+void create_surface_forces(scene_t *scene, track_t *track, body_t *car) {
+  surface_aux_t *aux = malloc(sizeof(surface_aux_t));
+  assert(aux != NULL);
+  aux->force_const = 0;
+  aux->bodies = list_init(1, NULL);
+  list_add(aux->bodies, car);
+  aux->track = track;
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, car);
+  scene_add_bodies_force_creator(scene, surface_force, aux, bodies);
+}
 
-  vector_t in_1_rot = (vector_t){.x = in_1.x * cos_t - in_1.y * sin_t,
-                                 .y = in_1.x * sin_t + in_1.y * cos_t};
-  vector_t in_2_rot = (vector_t){.x = in_2.x * cos_t - in_2.y * sin_t,
-                                 .y = in_2.x * sin_t + in_2.y * cos_t};
-  vector_t out_1_rot = (vector_t){.x = out_1.x * cos_t - out_1.y * sin_t,
-                                  .y = out_1.x * sin_t + out_1.y * cos_t};
-  vector_t out_2_rot = (vector_t){.x = out_2.x * cos_t - out_2.y * sin_t,
-                                  .y = out_2.x * sin_t + out_2.y * cos_t};
-  vector_t car_cent_rot =
-      (vector_t){.x = car_cent.x * cos_t - car_cent.y * sin_t,
-                 .y = car_cent.x * sin_t + car_cent.y * cos_t};
+/**
+ * The force creator for the vehicle controller. Drives the car with its
+ * controls: the engine pushes it along its heading, the tires hold it
+ * against sliding sideways, and the steering turns it as fast as the tires
+ * allow at its speed.
+ *
+ * @param info the vehicle aux for the car
+ */
+static void vehicle_force(void *info) {
+  vehicle_aux_t *aux = info;
+  body_t *car = list_get(aux->bodies, 0);
+  if (body_is_kinematic(car)) {
+    return;
+  }
+  kart_stats_t *stats = stats_of(car);
+  // A stunned car spins out of control
+  bool stunned = car_has_effect(car, EFFECT_STUN);
+  car_controls_t controls = *controls_of(car);
+  if (stunned) {
+    controls = (car_controls_t){.throttle = 0, .steer = 0};
+  }
+  double theta = body_get_rotation(car);
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  vector_t left = {.x = -heading.y, .y = heading.x};
+  vector_t vel = body_get_velocity(car);
+  double forward = vec_dot(vel, heading);
+  double sideways = vec_dot(vel, left);
+  double mass = body_get_mass(car);
+
+  // The engine stops pushing at the top speed, and anything faster, left
+  // over from a boost, is cut back to it at once
+  double top_speed = car_get_speed_multiplier(car) * stats->top_speed;
+  double thrust = controls.throttle * stats->acceleration;
+  if (fabs(forward) >= top_speed) {
+    double excess = forward - copysign(top_speed, forward);
+    body_add_impulse(car, vec_multiply(-mass * excess, heading));
+    if (thrust * forward > 0) {
+      thrust = 0;
+    }
+  }
+  double grip = car_get_grip(car) *
+                fmax(fmin(sideways / TIRE_SLIP_SPEED, 1), -1);
+  body_add_force(car, vec_add(vec_multiply(mass * thrust, heading),
+                              vec_multiply(-mass * grip, left)));
+
+  // Reversing turns the car the other way
+  double turn_rate = controls.steer * car_get_turn_rate(car);
+  if (forward < 0) {
+    turn_rate = -turn_rate;
+  }
+  body_set_angular_velocity(car, stunned ? STUN_ROT_SPEED : turn_rate);
+}
 
-  x_min = fmin(fmin(in_1_rot.x, in_2_rot.x), fmin(out_1_rot.x, out_2_rot.x));
-  x_max = fmax(fmax(in_1_rot.x, in_2_rot.x), fmax(out_1_rot.x, out_2_rot.x));
-  y_min = fmin(fmin(in_1_rot.y, in_2_rot.y), fmin(out_1_rot.y, out_2_rot.y));
-  y_max = fmax(fmax(in_1_rot.y, in_2_rot.y), fmax(out_1_rot.y, out_2_rot.y));
+void create_vehicle_controller(scene_t *scene, body_t *car) {
+  vehicle_aux_t *aux = malloc(sizeof(vehicle_aux_t));
+  assert(aux != NULL);
+  aux->force_const = 0;
+  aux->bodies = list_init(1, NULL);
+  list_add(aux->bodies, car);
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, car);
+  scene_add_bodies_force_creator(scene, vehicle_force, aux, bodies);
+}
 
-  return x_min <= car_cent_rot.x && car_cent_rot.x <= x_max &&
-         y_min <= car_cent_rot.y && car_cent_rot.y <= y_max;
+/**
+ * Whether the body was touching the given wall last tick.
+ */
+static bool was_touching(wall_aux_t *aux, size_t wall) {
+  for (size_t i = 0; i < aux->num_touching; i++) {
+    if (aux->touching[i] == wall) {
+      return true;
+    }
+  }
+  return false;
 }
 
-void car_respawn(body_t *car) {
-  checkpoint_state_t *checkpoint_state = car_get_checkpoint_state(car);
-  list_t *checkpoints = get_checkpoints(checkpoint_state);
-  size_t curr = get_current_checkpoint(checkpoint_state);
-  size_t next = (curr + 1) % list_size(checkpoints);
-  body_t *cpoint_1 = list_get(checkpoints, curr);
-  body_t *cpoint_2 = list_get(checkpoints, next);
-  list_t *points_1 = polygon_get_points(body_get_polygon(cpoint_1));
-  list_t *points_2 = polygon_get_points(body_get_polygon(cpoint_2));
-  vector_t car_cent = body_get_centroid(car);
-  vector_t in_1 = *(vector_t *)list_get(points_1, 0);
-  vector_t out_1 = *(vector_t *)list_get(points_1, 1);
-  vector_t in_2 = *(vector_t *)list_get(points_2, 0);
-  vector_t out_2 = *(vector_t *)list_get(points_2, 1);
-  vector_t turn_direction = get_right_way(checkpoint_state);
-  if (get_wrong_way(car, checkpoint_state) &&
-      get_wrong_way_time(checkpoint_state) < WRONG_WAY_TIME_TOL) {
+/**
+ * The force creator for the track walls. Bounces the body off any wall it
+ * has just hit, and stops it pushing further into walls it is still
+ * touching. Only the walls near the body, found in the track's wall tree,
+ * are tested.
+ *
+ * @param info the wall aux for the body
+ */
+static void wall_force(void *info) {
+  wall_aux_t *aux = info;
+  body_t *body = list_get(aux->bodies, 0);
+  track_t *track = aux->track;
+  if (body_is_kinematic(body)) {
+    aux->num_touching = 0;
     return;
   }
-  if (!check_in_bounds(car_cent, in_1, in_2, out_1, out_2, turn_direction)) {
-    printf("Stay On Track!!\n");
-    body_set_velocity(car, VEC_ZERO);
-    double theta = body_get_rotation(car);
-    vector_t car_dir = {.x = sin(theta), .y = -cos(theta)};
-    theta = theta + atan2(turn_direction.y, turn_direction.x) -
-            atan2(car_dir.y, car_dir.x);
-    body_set_rotation(car, theta);
-    body_set_centroid(
-        car, vec_multiply(0.5, vec_add(*(vector_t *)list_get(points_1, 1),
-                                       *(vector_t *)list_get(points_1, 0))));
+  vector_t center = body_get_centroid(body);
+
+  // Skip the segment tests when the distance field says no wall is in reach
+  list_t *points = polygon_get_points(body_get_polygon(body));
+  double reach = 0;
+  for (size_t i = 0; i < list_size(points); i++) {
+    vector_t offset = vec_subtract(*(vector_t *)list_get(points, i), center);
+    reach = fmax(reach, vec_get_length(offset));
+  }
+  if (track_get_distance(track, center) >
+      reach + WALL_RADIUS + WALL_CHECK_MARGIN) {
+    aux->num_touching = 0;
+    return;
   }
-  if (get_wrong_way_time(checkpoint_state) >= WRONG_WAY_TIME_TOL) {
-    printf("Stay On Track!!\n");
-    body_set_velocity(car, VEC_ZERO);
-    double theta = body_get_rotation(car);
-    vector_t car_dir = {.x = sin(theta), .y = -cos(theta)};
-    theta = theta + atan2(turn_direction.y, turn_direction.x) -
-            atan2(car_dir.y, car_dir.x);
-    body_set_rotation(car, theta);
-    body_set_centroid(
-        car, vec_multiply(0.5, vec_add(*(vector_t *)list_get(points_1, 1),
-                                       *(vector_t *)list_get(points_1, 0))));
+
+  size_t candidates[WALL_MAX_CANDIDATES];
+  size_t num_candidates = track_find_walls(
+      track, center, reach + WALL_RADIUS, candidates, WALL_MAX_CANDIDATES);
+  num_candidates = num_candidates < WALL_MAX_CANDIDATES ? num_candidates
+                                                        : WALL_MAX_CANDIDATES;
+  size_t touching[WALL_MAX_CONTACTS];
+  size_t num_touching = 0;
+  double mass = body_get_mass(body);
+  for (size_t i = 0; i < num_candidates; i++) {
+    size_t wall = candidates[i];
+    collision_info_t collision =
+        find_segment_collision(body, track_get_wall(track, wall), WALL_RADIUS);
+    if (!collision.collided) {
+      continue;
+    }
+    // Bounce off a new contact, and only stop pushing into an old one
+    bool old = was_touching(aux, wall);
+    double speed = vec_dot(collision.axis, body_get_velocity(body));
+    double bounce = old ? 1 : 1 + aux->force_const;
+    if (!old && aux->hits != NULL) {
+      (*aux->hits)++;
+    }
+    if (speed > 0) {
+      body_add_impulse(body,
+                       vec_multiply(-mass * bounce * speed, collision.axis));
+    }
+    if (num_touching < WALL_MAX_CONTACTS) {
+      touching[num_touching++] = wall;
+    }
   }
+  memcpy(aux->touching, touching, num_touching * sizeof(size_t));
+  aux->num_touching = num_touching;
 }
 
-body_t *make_car(car_type_t type) {
+void create_wall_collision(scene_t *scene, track_t *track, body_t *body,
+                           double elasticity) {
+  create_counted_wall_collision(scene, track, body, elasticity, NULL);
+}
+
+void create_counted_wall_collision(scene_t *scene, track_t *track,
+                                   body_t *body, double elasticity,
+                                   size_t *hits) {
+  wall_aux_t *aux = malloc(sizeof(wall_aux_t));
+  assert(aux != NULL);
+  aux->force_const = elasticity;
+  aux->bodies = list_init(1, NULL);
+  list_add(aux->bodies, body);
+  aux->track = track;
+  aux->hits = hits;
+  aux->num_touching = 0;
+  list_t *bodies = list_init(1, NULL);
+  list_add(bodies, body);
+  scene_add_bodies_force_creator(scene, wall_force, aux, bodies);
+}
+
+body_t *make_car_in_store(kart_store_t *store, car_type_t type) {
   double mass = 0.0;
   double friction = 0.0;
   double acceleration = 0.0;
@@ -247,9 +470,24 @@ body_t *make_car(car_type_t type) {
     break;
   }
   list_t *shape = make_rectangle(VEC_ZERO, CAR_WIDTH, CAR_HEIGHT);
-  car_info_t *info = make_car_info(type, friction, top_speed, acceleration);
-  body_t *car = body_init_with_info(shape, mass, get_blue(), info,
-                                    (free_func_t)free_car_info);
+  kart_stats_t stats = {.type = type,
+                        .friction = friction,
+                        .top_speed = top_speed,
+                        .acceleration = acceleration};
+  kart_ref_t *ref = malloc(sizeof(kart_ref_t));
+  assert(ref != NULL);
+  ref->store = store;
+  ref->id = kart_store_add(store, stats);
+  body_t *car = body_init_with_info(shape, mass, get_blue(), ref,
+                                    (free_func_t)free_kart_ref);
+  return car;
+}
+
+body_t *make_car(car_type_t type) {
+  kart_store_t *store = kart_store_init(1);
+  body_t *car = make_car_in_store(store, type);
+  // Freed with the car
+  kart_store_free(store);
   return car;
 }
 
@@ -1,5 +1,6 @@
 #include "collision.h"
 #include "body.h"
+#include "polygon.h"
 
 #include <assert.h>
 #include <math.h>
@@ -116,3 +117,110 @@ collision_info_t find_collision(body_t *body1, body_t *body2) {
   }
   return collision2;
 }
+
+/**
+ * Clips the segment from a to b against the box [-hx, hx] x [-hy, hy] and
+ * returns whether any part of it is inside the box.
+ */
+static bool segment_hits_box(vector_t a, vector_t b, double hx, double hy) {
+  vector_t d = vec_subtract(b, a);
+  double t_min = 0;
+  double t_max = 1;
+  double starts[2] = {a.x, a.y};
+  double deltas[2] = {d.x, d.y};
+  double halves[2] = {hx, hy};
+  for (size_t i = 0; i < 2; i++) {
+    if (deltas[i] == 0) {
+      if (fabs(starts[i]) > halves[i]) {
+        return false;
+      }
+      continue;
+    }
+    double t1 = (-halves[i] - starts[i]) / deltas[i];
+    double t2 = (halves[i] - starts[i]) / deltas[i];
+    t_min = fmax(t_min, fmin(t1, t2));
+    t_max = fmin(t_max, fmax(t1, t2));
+    if (t_min > t_max) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Returns the point on the segment from a to b closest to p.
+ */
+static vector_t closest_on_segment(vector_t p, vector_t a, vector_t b) {
+  vector_t d = vec_subtract(b, a);
+  double length_sq = vec_dot(d, d);
+  if (length_sq == 0) {
+    return a;
+  }
+  double t = fmin(fmax(vec_dot(vec_subtract(p, a), d) / length_sq, 0), 1);
+  return vec_add(a, vec_multiply(t, d));
+}
+
+collision_info_t find_segment_collision(body_t *body, segment_t segment,
+                                        double radius) {
+  collision_info_t collision = {.axis = VEC_ZERO, .collided = false};
+  list_t *points = polygon_get_points(body_get_polygon(body));
+  assert(list_size(points) == 4);
+  vector_t p0 = *(vector_t *)list_get(points, 0);
+  vector_t p1 = *(vector_t *)list_get(points, 1);
+  vector_t p3 = *(vector_t *)list_get(points, 3);
+  vector_t center = body_get_centroid(body);
+
+  // Work in the frame of the box, where it spans [-hx, hx] x [-hy, hy]
+  vector_t x_axis = vec_subtract(p1, p0);
+  vector_t y_axis = vec_subtract(p3, p0);
+  double hx = vec_get_length(x_axis) / 2;
+  double hy = vec_get_length(y_axis) / 2;
+  x_axis = vec_multiply(0.5 / hx, x_axis);
+  y_axis = vec_multiply(0.5 / hy, y_axis);
+  vector_t start = vec_subtract(segment.start, center);
+  vector_t end = vec_subtract(segment.end, center);
+  vector_t a = {vec_dot(start, x_axis), vec_dot(start, y_axis)};
+  vector_t b = {vec_dot(end, x_axis), vec_dot(end, y_axis)};
+
+  if (segment_hits_box(a, b, hx, hy)) {
+    collision.collided = true;
+    collision.axis = vec_negate(segment.normal);
+    return collision;
+  }
+
+  // Apart, the closest pair of points includes an end of the segment or a
+  // corner of the box
+  double best = INFINITY;
+  vector_t from = VEC_ZERO;
+  vector_t to = VEC_ZERO;
+  vector_t ends[2] = {a, b};
+  for (size_t i = 0; i < 2; i++) {
+    vector_t on_box = {fmin(fmax(ends[i].x, -hx), hx),
+                       fmin(fmax(ends[i].y, -hy), hy)};
+    double dist = vec_get_length(vec_subtract(ends[i], on_box));
+    if (dist < best) {
+      best = dist;
+      from = on_box;
+      to = ends[i];
+    }
+  }
+  for (size_t i = 0; i < 4; i++) {
+    vector_t corner = {i & 1 ? hx : -hx, i & 2 ? hy : -hy};
+    vector_t on_segment = closest_on_segment(corner, a, b);
+    double dist = vec_get_length(vec_subtract(on_segment, corner));
+    if (dist < best) {
+      best = dist;
+      from = corner;
+      to = on_segment;
+    }
+  }
+  if (best >= radius) {
+    return collision;
+  }
+
+  vector_t local = vec_multiply(1 / best, vec_subtract(to, from));
+  collision.collided = true;
+  collision.axis = vec_add(vec_multiply(local.x, x_axis),
+                           vec_multiply(local.y, y_axis));
+  return collision;
+}
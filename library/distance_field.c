@@ -0,0 +1,190 @@
+#include "distance_field.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t NEAREST_ITERATIONS = 4;
+// Distances are only computed this close to a boundary; further away the
+// field holds this value with the right sign
+const double DISTANCE_BAND = 200.0;
+
+struct distance_field {
+  vector_t min;
+  double cell_size;
+  size_t width;
+  size_t height;
+  float *values; // width * height nodes, row by row
+};
+
+/**
+ * Lowers the stored distance of every node within DISTANCE_BAND of the
+ * segment from a to b to the node's distance from the segment.
+ */
+static void rasterize_segment(distance_field_t *field, vector_t a, vector_t b) {
+  vector_t d = vec_subtract(b, a);
+  double length_sq = vec_dot(d, d);
+  double cell = field->cell_size;
+  double i_min = ceil((fmin(a.x, b.x) - DISTANCE_BAND - field->min.x) / cell);
+  double i_max = floor((fmax(a.x, b.x) + DISTANCE_BAND - field->min.x) / cell);
+  double j_min = ceil((fmin(a.y, b.y) - DISTANCE_BAND - field->min.y) / cell);
+  double j_max = floor((fmax(a.y, b.y) + DISTANCE_BAND - field->min.y) / cell);
+  i_min = fmax(i_min, 0);
+  j_min = fmax(j_min, 0);
+  i_max = fmin(i_max, field->width - 1.0);
+  j_max = fmin(j_max, field->height - 1.0);
+  for (double j = j_min; j <= j_max; j++) {
+    for (double i = i_min; i <= i_max; i++) {
+      vector_t point = {field->min.x + i * cell, field->min.y + j * cell};
+      double t = 0;
+      if (length_sq > 0) {
+        t = fmin(fmax(vec_dot(vec_subtract(point, a), d) / length_sq, 0), 1);
+      }
+      vector_t diff = vec_subtract(point, vec_add(a, vec_multiply(t, d)));
+      float *value = &field->values[(size_t)j * field->width + (size_t)i];
+      *value = fmin(*value, vec_get_length(diff));
+    }
+  }
+}
+
+static int compare_doubles(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+/**
+ * Flips the sign of every node in row j that is inside the closed polygon,
+ * using the crossings of the row with the polygon's edges. `crossings` must
+ * have room for `size` values.
+ */
+static void flip_inside(distance_field_t *field, size_t j,
+                        const vector_t *points, size_t size,
+                        double *crossings) {
+  double y = field->min.y + j * field->cell_size;
+  size_t count = 0;
+  for (size_t k = 0; k < size; k++) {
+    vector_t a = points[k];
+    vector_t b = points[(k + 1) % size];
+    if ((a.y > y) != (b.y > y)) {
+      crossings[count++] = a.x + (y - a.y) / (b.y - a.y) * (b.x - a.x);
+    }
+  }
+  qsort(crossings, count, sizeof(double), compare_doubles);
+  float *row = &field->values[j * field->width];
+  size_t next = 0;
+  bool inside = false;
+  for (size_t i = 0; i < field->width; i++) {
+    double x = field->min.x + i * field->cell_size;
+    while (next < count && crossings[next] <= x) {
+      inside = !inside;
+      next++;
+    }
+    if (inside) {
+      row[i] = -row[i];
+    }
+  }
+}
+
+distance_field_t *distance_field_init(vector_t min, vector_t max,
+                                      double cell_size, const vector_t *inner,
+                                      const vector_t *outer, size_t size) {
+  assert(cell_size > 0);
+  distance_field_t *field = malloc(sizeof(distance_field_t));
+  assert(field != NULL);
+  field->min = min;
+  field->cell_size = cell_size;
+  field->width = (size_t)ceil((max.x - min.x) / cell_size) + 1;
+  field->height = (size_t)ceil((max.y - min.y) / cell_size) + 1;
+  size_t num_nodes = field->width * field->height;
+  field->values = malloc(num_nodes * sizeof(float));
+  assert(field->values != NULL);
+
+  // Unsigned distances, exact near the boundaries and clamped further away
+  for (size_t i = 0; i < num_nodes; i++) {
+    field->values[i] = DISTANCE_BAND;
+  }
+  for (size_t k = 0; k < size; k++) {
+    rasterize_segment(field, inner[k], inner[(k + 1) % size]);
+    rasterize_segment(field, outer[k], outer[(k + 1) % size]);
+  }
+
+  // The road is inside the outer boundary and outside the inner one, so
+  // flipping the sign inside each boundary leaves only the road positive
+  for (size_t i = 0; i < num_nodes; i++) {
+    field->values[i] = -field->values[i];
+  }
+  double *crossings = malloc(size * sizeof(double));
+  assert(crossings != NULL);
+  for (size_t j = 0; j < field->height; j++) {
+    flip_inside(field, j, outer, size, crossings);
+    flip_inside(field, j, inner, size, crossings);
+  }
+  free(crossings);
+  return field;
+}
+
+void distance_field_free(distance_field_t *field) {
+  free(field->values);
+  free(field);
+}
+
+/**
+ * Finds the grid cell containing a point, clamped to the grid. Stores the
+ * four corner values in `corners` (bottom left, bottom right, top left,
+ * top right) and the position inside the cell in `fx` and `fy`.
+ */
+static void find_cell(distance_field_t *field, vector_t point,
+                      double corners[4], double *fx, double *fy) {
+  double x = (point.x - field->min.x) / field->cell_size;
+  double y = (point.y - field->min.y) / field->cell_size;
+  x = fmin(fmax(x, 0), field->width - 1);
+  y = fmin(fmax(y, 0), field->height - 1);
+  size_t i = fmin(floor(x), field->width - 2);
+  size_t j = fmin(floor(y), field->height - 2);
+  *fx = x - i;
+  *fy = y - j;
+  float *row = &field->values[j * field->width + i];
+  corners[0] = row[0];
+  corners[1] = row[1];
+  corners[2] = row[field->width];
+  corners[3] = row[field->width + 1];
+}
+
+double distance_field_sample(distance_field_t *field, vector_t point) {
+  double c[4];
+  double fx;
+  double fy;
+  find_cell(field, point, c, &fx, &fy);
+  double bottom = c[0] + fx * (c[1] - c[0]);
+  double top = c[2] + fx * (c[3] - c[2]);
+  return bottom + fy * (top - bottom);
+}
+
+vector_t distance_field_gradient(distance_field_t *field, vector_t point) {
+  double c[4];
+  double fx;
+  double fy;
+  find_cell(field, point, c, &fx, &fy);
+  double dx = (c[1] - c[0]) * (1 - fy) + (c[3] - c[2]) * fy;
+  double dy = (c[2] - c[0]) * (1 - fx) + (c[3] - c[1]) * fx;
+  return vec_multiply(1 / field->cell_size, (vector_t){dx, dy});
+}
+
+vector_t distance_field_nearest(distance_field_t *field, vector_t point,
+                                double margin) {
+  for (size_t i = 0; i < NEAREST_ITERATIONS; i++) {
+    double distance = distance_field_sample(field, point);
+    if (distance >= margin) {
+      break;
+    }
+    vector_t gradient = distance_field_gradient(field, point);
+    double length = vec_get_length(gradient);
+    if (length == 0) {
+      break;
+    }
+    point = vec_add(point,
+                    vec_multiply((margin - distance) / length, gradient));
+  }
+  return point;
+}
@@ -26,6 +26,18 @@ typedef struct collision_aux {
   void *aux; // aux (if allocated in memory) should be free'd by the caller
 } collision_aux_t;
 
+typedef struct group_collision_aux {
+  double force_const; // the scene frees aux as a body_aux_t
+  list_t *bodies;     // the group, then the others
+  collision_handler_t handler;
+  void *aux;
+  size_t group_size;
+  // Whether each pair touched last tick, indexed by i * size + j
+  bool *touching;
+  // How far each body's vertices reach from its centroid
+  double radii[];
+} group_collision_aux_t;
+
 body_aux_t *body_aux_init(double force_const, list_t *bodies) {
   body_aux_t *aux = malloc(sizeof(body_aux_t));
   assert(aux);
@@ -259,6 +271,85 @@ void create_collision(scene_t *scene, body_t *body1, body_t *body2,
                                  bodies);
 }
 
+/**
+ * The force creator for group collisions. Pairs whose bounding circles are
+ * apart cannot be touching, so only the others get the full polygon test.
+ *
+ * @param info auxiliary information about the force and associated bodies
+ */
+static void group_collision_force_creator(void *info) {
+  group_collision_aux_t *aux = info;
+  size_t size = list_size(aux->bodies);
+  bool within_group = aux->group_size == size;
+  for (size_t i = 0; i < aux->group_size; i++) {
+    body_t *body1 = list_get(aux->bodies, i);
+    vector_t center1 = body_get_centroid(body1);
+    for (size_t j = within_group ? i + 1 : aux->group_size; j < size; j++) {
+      body_t *body2 = list_get(aux->bodies, j);
+      vector_t offset = vec_subtract(body_get_centroid(body2), center1);
+      double reach = aux->radii[i] + aux->radii[j];
+      collision_info_t collision = {.axis = VEC_ZERO, .collided = false};
+      if (vec_dot(offset, offset) <= reach * reach) {
+        collision = find_collision(body1, body2);
+      }
+      bool *touching = &aux->touching[i * size + j];
+      if (collision.collided && !*touching) {
+        aux->handler(body1, body2, collision.axis, aux->aux, aux->force_const);
+      }
+      *touching = collision.collided;
+    }
+  }
+}
+
+/**
+ * Returns the distance from a body's centroid to its furthest vertex.
+ */
+static double bounding_radius(body_t *body) {
+  vector_t center = body_get_centroid(body);
+  list_t *shape = body_get_shape(body);
+  double radius = 0;
+  for (size_t i = 0; i < list_size(shape); i++) {
+    vector_t *vertex = list_get(shape, i);
+    radius = fmax(radius, vec_get_length(vec_subtract(*vertex, center)));
+  }
+  list_free(shape);
+  return radius;
+}
+
+void create_group_collision(scene_t *scene, list_t *group, list_t *others,
+                            collision_handler_t handler, void *aux,
+                            double force_const) {
+  size_t group_size = list_size(group);
+  size_t size = group_size + (others != NULL ? list_size(others) : 0);
+  list_t *bodies = list_init(size, NULL);
+  list_t *aux_bodies = list_init(size, NULL);
+  for (size_t i = 0; i < size; i++) {
+    body_t *body = i < group_size ? list_get(group, i)
+                                  : list_get(others, i - group_size);
+    list_add(bodies, body);
+    list_add(aux_bodies, body);
+  }
+
+  group_collision_aux_t *group_aux =
+      malloc(sizeof(group_collision_aux_t) + size * sizeof(double) +
+             size * size * sizeof(bool));
+  assert(group_aux != NULL);
+  group_aux->force_const = force_const;
+  group_aux->bodies = aux_bodies;
+  group_aux->handler = handler;
+  group_aux->aux = aux;
+  group_aux->group_size = group_size;
+  group_aux->touching = (bool *)(group_aux->radii + size);
+  for (size_t i = 0; i < size; i++) {
+    group_aux->radii[i] = bounding_radius(list_get(bodies, i));
+  }
+  for (size_t i = 0; i < size * size; i++) {
+    group_aux->touching[i] = false;
+  }
+  scene_add_bodies_force_creator(scene, group_collision_force_creator,
+                                 group_aux, bodies);
+}
+
 /**
  * The collision handler for destructive collisions.
  */
@@ -0,0 +1,398 @@
+#include "ghost.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char GHOST_MAGIC[8] = "CKGHOST";
+const uint32_t GHOST_VERSION = 1;
+// Poses are sampled at 10 Hz, positions to a quarter of a unit and rotations
+// to a 65536th of a turn
+const double GHOST_INTERVAL = 0.1;
+const double GHOST_POSITION_STEP = 0.25;
+const double GHOST_ROTATION_STEPS = 65536.0;
+const size_t GHOST_INITIAL_CAPACITY = 1024;
+// A pose's quantized components: x, y and rotation
+#define GHOST_COMPONENTS 3
+// The samples the player keeps for a Catmull-Rom segment
+#define GHOST_RING_SIZE 4
+
+struct ghost {
+  double interval;
+  double lap_time;
+  size_t num_samples;
+  uint8_t *bytes;
+  size_t size;
+  size_t capacity;
+  // The last two quantized samples, which predict the next one
+  int32_t history[2][GHOST_COMPONENTS];
+  // The pose and time of the last call to ghost_record()
+  bool has_last;
+  double last_time;
+  ghost_pose_t last_pose;
+};
+
+struct ghost_player {
+  ghost_t *ghost;
+  size_t offset;
+  size_t num_decoded;
+  int32_t history[2][GHOST_COMPONENTS];
+  // Sample i is at ring[i % GHOST_RING_SIZE]
+  ghost_pose_t ring[GHOST_RING_SIZE];
+};
+
+/**
+ * The header at the start of a ghost file. It is followed by the encoded
+ * samples (size bytes).
+ */
+typedef struct ghost_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_samples;
+  uint32_t size;
+  double interval;
+  double lap_time;
+} ghost_header_t;
+
+static ghost_t *ghost_alloc(size_t capacity) {
+  ghost_t *ghost = malloc(sizeof(ghost_t));
+  assert(ghost != NULL);
+  ghost->interval = GHOST_INTERVAL;
+  ghost->lap_time = INFINITY;
+  ghost->num_samples = 0;
+  ghost->size = 0;
+  ghost->capacity = capacity;
+  ghost->bytes = malloc(capacity);
+  assert(ghost->bytes != NULL);
+  memset(ghost->history, 0, sizeof(ghost->history));
+  ghost->has_last = false;
+  return ghost;
+}
+
+ghost_t *ghost_init(void) { return ghost_alloc(GHOST_INITIAL_CAPACITY); }
+
+void ghost_free(ghost_t *ghost) {
+  free(ghost->bytes);
+  free(ghost);
+}
+
+double ghost_get_lap_time(ghost_t *ghost) { return ghost->lap_time; }
+
+size_t ghost_get_num_samples(ghost_t *ghost) { return ghost->num_samples; }
+
+size_t ghost_get_size(ghost_t *ghost) { return ghost->size; }
+
+/**
+ * Wraps a difference of quantized rotations into half a turn either way.
+ */
+static int32_t wrap_rotation(int32_t steps) {
+  int32_t half = (int32_t)GHOST_ROTATION_STEPS / 2;
+  return ((steps + half) & ((int32_t)GHOST_ROTATION_STEPS - 1)) - half;
+}
+
+static void quantize(ghost_pose_t pose, int32_t *q) {
+  q[0] = (int32_t)lround(pose.position.x / GHOST_POSITION_STEP);
+  q[1] = (int32_t)lround(pose.position.y / GHOST_POSITION_STEP);
+  double turns = pose.rotation / (2 * M_PI);
+  int32_t steps = lround((turns - floor(turns)) * GHOST_ROTATION_STEPS);
+  q[2] = steps & ((int32_t)GHOST_ROTATION_STEPS - 1);
+}
+
+static ghost_pose_t dequantize(const int32_t *q) {
+  return (ghost_pose_t){
+      .position = {.x = q[0] * GHOST_POSITION_STEP,
+                   .y = q[1] * GHOST_POSITION_STEP},
+      .rotation = q[2] * (2 * M_PI / GHOST_ROTATION_STEPS)};
+}
+
+/**
+ * Predicts sample k from samples k - 1 and k - 2 by assuming the kart keeps
+ * its velocity. The first sample is predicted as zero and the second as the
+ * first.
+ */
+static void predict(int32_t history[2][GHOST_COMPONENTS], size_t k,
+                    int32_t *prediction) {
+  for (size_t c = 0; c < GHOST_COMPONENTS; c++) {
+    if (k == 0) {
+      prediction[c] = 0;
+    } else if (k == 1) {
+      prediction[c] = history[1][c];
+    } else {
+      prediction[c] = 2 * history[1][c] - history[0][c];
+    }
+  }
+}
+
+static void push_history(int32_t history[2][GHOST_COMPONENTS],
+                         const int32_t *q) {
+  memcpy(history[0], history[1], sizeof(history[0]));
+  memcpy(history[1], q, sizeof(history[1]));
+}
+
+/**
+ * Writes a residual zigzag-encoded, so small residuals of either sign are
+ * small, seven bits to a byte with the top bit set on all but the last.
+ */
+static void put_residual(ghost_t *ghost, int32_t residual) {
+  uint32_t value = ((uint32_t)residual << 1) ^ -(uint32_t)(residual < 0);
+  do {
+    if (ghost->size == ghost->capacity) {
+      ghost->capacity *= 2;
+      ghost->bytes = realloc(ghost->bytes, ghost->capacity);
+      assert(ghost->bytes != NULL);
+    }
+    uint8_t byte = value & 0x7F;
+    value >>= 7;
+    ghost->bytes[ghost->size++] = byte | (value != 0 ? 0x80 : 0);
+  } while (value != 0);
+}
+
+/**
+ * Reads a residual written by put_residual(), advancing the offset.
+ *
+ * @return whether a whole residual fit before the end of the bytes
+ */
+static bool get_residual(const uint8_t *bytes, size_t size, size_t *offset,
+                         int32_t *residual) {
+  uint32_t value = 0;
+  for (size_t shift = 0; shift < 32; shift += 7) {
+    if (*offset >= size) {
+      return false;
+    }
+    uint8_t byte = bytes[(*offset)++];
+    value |= (uint32_t)(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      *residual = (int32_t)((value >> 1) ^ -(value & 1));
+      return true;
+    }
+  }
+  return false;
+}
+
+static void emit_sample(ghost_t *ghost, ghost_pose_t pose) {
+  int32_t q[GHOST_COMPONENTS];
+  int32_t prediction[GHOST_COMPONENTS];
+  quantize(pose, q);
+  predict(ghost->history, ghost->num_samples, prediction);
+  put_residual(ghost, q[0] - prediction[0]);
+  put_residual(ghost, q[1] - prediction[1]);
+  put_residual(ghost, wrap_rotation(q[2] - prediction[2]));
+  push_history(ghost->history, q);
+  ghost->num_samples++;
+}
+
+/**
+ * Decodes the next sample of a stream, given the samples before it.
+ */
+static bool decode_sample(const uint8_t *bytes, size_t size, size_t *offset,
+                          int32_t history[2][GHOST_COMPONENTS], size_t k,
+                          int32_t *q) {
+  int32_t residuals[GHOST_COMPONENTS];
+  for (size_t c = 0; c < GHOST_COMPONENTS; c++) {
+    if (!get_residual(bytes, size, offset, &residuals[c])) {
+      return false;
+    }
+  }
+  predict(history, k, q);
+  q[0] += residuals[0];
+  q[1] += residuals[1];
+  q[2] = (q[2] + residuals[2]) & ((int32_t)GHOST_ROTATION_STEPS - 1);
+  push_history(history, q);
+  return true;
+}
+
+/**
+ * Returns the pose a fraction of the way from one pose to another, turning
+ * the short way round.
+ */
+static ghost_pose_t lerp_pose(ghost_pose_t from, ghost_pose_t to,
+                              double fraction) {
+  double turn = remainder(to.rotation - from.rotation, 2 * M_PI);
+  return (ghost_pose_t){
+      .position = vec_add(from.position,
+                          vec_multiply(fraction, vec_subtract(to.position,
+                                                              from.position))),
+      .rotation = from.rotation + fraction * turn};
+}
+
+void ghost_record(ghost_t *ghost, double time, ghost_pose_t pose) {
+  while (ghost->num_samples * ghost->interval <= time) {
+    double sample_time = ghost->num_samples * ghost->interval;
+    ghost_pose_t sample = pose;
+    if (ghost->has_last && time > ghost->last_time) {
+      double fraction =
+          (sample_time - ghost->last_time) / (time - ghost->last_time);
+      sample = lerp_pose(ghost->last_pose, pose, fmax(fraction, 0));
+    }
+    emit_sample(ghost, sample);
+  }
+  ghost->has_last = true;
+  ghost->last_time = time;
+  ghost->last_pose = pose;
+}
+
+void ghost_finish(ghost_t *ghost, double lap_time) {
+  assert(ghost->num_samples > 0);
+  double sample_time = (ghost->num_samples - 1) * ghost->interval;
+  if (sample_time < lap_time) {
+    // The line falls after the last sample, so carry on to the next one the
+    // way the kart was going
+    ghost_pose_t sample = dequantize(ghost->history[1]);
+    ghost_pose_t end = ghost->last_pose;
+    if (ghost->last_time > sample_time) {
+      double fraction =
+          ghost->interval / (ghost->last_time - sample_time);
+      end = lerp_pose(sample, ghost->last_pose, fraction);
+    }
+    emit_sample(ghost, end);
+  }
+  ghost->lap_time = lap_time;
+}
+
+ghost_t *ghost_read(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  ghost_header_t header;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, GHOST_MAGIC, sizeof(GHOST_MAGIC)) != 0 ||
+      header.version != GHOST_VERSION || header.num_samples == 0 ||
+      !(header.interval > 0)) {
+    fprintf(stderr, "Malformed ghost '%s'\n", path);
+    fclose(file);
+    return NULL;
+  }
+  ghost_t *ghost = ghost_alloc(header.size > 0 ? header.size : 1);
+  ghost->interval = header.interval;
+  ghost->lap_time = header.lap_time;
+  ghost->num_samples = header.num_samples;
+  ghost->size = header.size;
+  bool read = fread(ghost->bytes, 1, ghost->size, file) == ghost->size;
+  fclose(file);
+
+  // Decode the stream once so playback can trust it
+  size_t offset = 0;
+  int32_t history[2][GHOST_COMPONENTS] = {{0}};
+  int32_t q[GHOST_COMPONENTS];
+  for (size_t k = 0; read && k < ghost->num_samples; k++) {
+    read = decode_sample(ghost->bytes, ghost->size, &offset, history, k, q);
+  }
+  if (!read || offset != ghost->size) {
+    fprintf(stderr, "Truncated ghost '%s'\n", path);
+    ghost_free(ghost);
+    return NULL;
+  }
+  return ghost;
+}
+
+bool ghost_write(ghost_t *ghost, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  ghost_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, GHOST_MAGIC, sizeof(GHOST_MAGIC));
+  header.version = GHOST_VERSION;
+  header.num_samples = ghost->num_samples;
+  header.size = ghost->size;
+  header.interval = ghost->interval;
+  header.lap_time = ghost->lap_time;
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(ghost->bytes, 1, ghost->size, file) == ghost->size;
+  return fclose(file) == 0 && written;
+}
+
+static void player_rewind(ghost_player_t *player) {
+  player->offset = 0;
+  player->num_decoded = 0;
+  memset(player->history, 0, sizeof(player->history));
+}
+
+ghost_player_t *ghost_player_init(ghost_t *ghost) {
+  assert(ghost->num_samples > 0);
+  ghost_player_t *player = malloc(sizeof(ghost_player_t));
+  assert(player != NULL);
+  player->ghost = ghost;
+  player_rewind(player);
+  return player;
+}
+
+void ghost_player_free(ghost_player_t *player) { free(player); }
+
+/**
+ * Returns sample i, which must be in the ring or after it, decoding up to it.
+ */
+static ghost_pose_t player_sample(ghost_player_t *player, size_t i) {
+  ghost_t *ghost = player->ghost;
+  while (player->num_decoded <= i) {
+    int32_t q[GHOST_COMPONENTS];
+    bool decoded =
+        decode_sample(ghost->bytes, ghost->size, &player->offset,
+                      player->history, player->num_decoded, q);
+    assert(decoded);
+    player->ring[player->num_decoded % GHOST_RING_SIZE] = dequantize(q);
+    player->num_decoded++;
+  }
+  assert(i + GHOST_RING_SIZE >= player->num_decoded);
+  return player->ring[i % GHOST_RING_SIZE];
+}
+
+static double catmull_rom(double p0, double p1, double p2, double p3,
+                          double t) {
+  return 0.5 * (2 * p1 + (p2 - p0) * t +
+                (2 * p0 - 5 * p1 + 4 * p2 - p3) * t * t +
+                (3 * (p1 - p2) + p3 - p0) * t * t * t);
+}
+
+ghost_pose_t ghost_player_pose_at(ghost_player_t *player, double time) {
+  size_t last = player->ghost->num_samples - 1;
+  if (last == 0) {
+    return player_sample(player, 0);
+  }
+  double position = fmin(fmax(time / player->ghost->interval, 0), last);
+  size_t k = position < last ? (size_t)position : last - 1;
+  size_t first = k > 0 ? k - 1 : 0;
+  if (player->num_decoded > first + GHOST_RING_SIZE) {
+    player_rewind(player);
+  }
+  // The segment from sample k to k + 1, with the samples either side of it
+  double x[GHOST_RING_SIZE], y[GHOST_RING_SIZE], rotation[GHOST_RING_SIZE];
+  for (size_t j = 0; j < GHOST_RING_SIZE; j++) {
+    if ((k == 0 && j == 0) || k + j - 1 > last) {
+      continue;
+    }
+    ghost_pose_t sample = player_sample(player, k + j - 1);
+    x[j] = sample.position.x;
+    y[j] = sample.position.y;
+    rotation[j] = sample.rotation;
+  }
+  // Unwind the rotations around sample k so the spline turns the short way,
+  // and past either end of the lap carry on at the speed of the last segment
+  for (size_t j = 0; j < GHOST_RING_SIZE; j++) {
+    if (!(k == 0 && j == 0) && k + j - 1 <= last) {
+      rotation[j] =
+          rotation[1] + remainder(rotation[j] - rotation[1], 2 * M_PI);
+    }
+  }
+  if (k == 0) {
+    x[0] = 2 * x[1] - x[2];
+    y[0] = 2 * y[1] - y[2];
+    rotation[0] = 2 * rotation[1] - rotation[2];
+  }
+  if (k + 1 == last) {
+    x[3] = 2 * x[2] - x[1];
+    y[3] = 2 * y[2] - y[1];
+    rotation[3] = 2 * rotation[2] - rotation[1];
+  }
+  double t = position - k;
+  return (ghost_pose_t){
+      .position = {.x = catmull_rom(x[0], x[1], x[2], x[3], t),
+                   .y = catmull_rom(y[0], y[1], y[2], y[3], t)},
+      .rotation = catmull_rom(rotation[0], rotation[1], rotation[2],
+                              rotation[3], t)};
+}
@@ -0,0 +1,58 @@
+#include "input.h"
+#include <assert.h>
+#include <stdlib.h>
+
+struct input {
+  uint8_t held;
+  uint8_t pressed;
+  // When each held action was pressed
+  double start_times[NUM_ACTIONS];
+};
+
+input_t *input_init(void) {
+  input_t *input = malloc(sizeof(input_t));
+  assert(input != NULL);
+  input->held = 0;
+  input->pressed = 0;
+  for (size_t i = 0; i < NUM_ACTIONS; i++) {
+    input->start_times[i] = 0;
+  }
+  return input;
+}
+
+void input_free(input_t *input) { free(input); }
+
+void input_press(input_t *input, action_t action, double time) {
+  assert(action < NUM_ACTIONS);
+  uint8_t bit = 1 << action;
+  if (input->held & bit) {
+    return;
+  }
+  input->held |= bit;
+  input->pressed |= bit;
+  input->start_times[action] = time;
+}
+
+void input_release(input_t *input, action_t action) {
+  assert(action < NUM_ACTIONS);
+  input->held &= ~(1 << action);
+}
+
+input_snapshot_t input_take_snapshot(input_t *input, double time) {
+  input_snapshot_t snapshot = {.held = input->held,
+                               .pressed = input->pressed};
+  for (size_t i = 0; i < NUM_ACTIONS; i++) {
+    snapshot.held_times[i] =
+        input->held & (1 << i) ? time - input->start_times[i] : 0;
+  }
+  input->pressed = 0;
+  return snapshot;
+}
+
+bool input_is_held(const input_snapshot_t *snapshot, action_t action) {
+  return snapshot->held & (1 << action);
+}
+
+bool input_was_pressed(const input_snapshot_t *snapshot, action_t action) {
+  return snapshot->pressed & (1 << action);
+}
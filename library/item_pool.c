@@ -0,0 +1,785 @@
+#include "item_pool.h"
+#include "asset_body.h"
+#include "car.h"
+#include "color.h"
+#include "polygon.h"
+#include "power_up.h"
+#include "rng.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// The sprite and the width of each kind of item, indexed by item_kind_t.
+// Items touch what they overlap as circles of half their width.
+const char *ITEM_SPRITE_PATHS[] = {"assets/box.png", "assets/box.png",
+                                   "assets/shell.png", "assets/boost_pad.png"};
+const double ITEM_SIZES[] = {30.0, 30.0, 20.0, 60.0};
+const size_t ITEM_INITIAL_CAPACITY = 64;
+// How long a box takes to refill once a kart has taken its item
+const double ITEM_BOX_REFILL = 10.0;
+// How far a held shell circles from its kart's center
+const double ITEM_SHELL_DISTANCE = 50.0;
+// The thickness of the walls loose shells bounce off, and the slack on the
+// distance field lookup before sweeping them through the walls
+const double ITEM_WALL_RADIUS = 2.0;
+const double ITEM_WALL_MARGIN = 20.0;
+// The most walls a loose shell bounces off in one tick
+const size_t ITEM_MAX_BOUNCES = 4;
+// A homing shell's speed and how fast it turns, in radians per second, and
+// how long it flies before it breaks
+const double ITEM_HOMING_SPEED = 400.0;
+const double ITEM_HOMING_TURN = 5.0;
+const double ITEM_HOMING_LIFETIME = 8.0;
+// How far in front of its kart's nose a homing shell is fired
+const double ITEM_HOMING_CLEARANCE = 5.0;
+// Homing shells follow the road this far ahead of them until they are this
+// close to their target along the road, then go straight for it
+const double ITEM_HOMING_LOOKAHEAD = 150.0;
+const double ITEM_HOMING_LOCK = 250.0;
+// The side of a grid cell. Anything that can touch an item in a cell is in
+// that cell or one next to it, so it must be at least the reach of a kart
+// plus the radius of the largest item.
+const double ITEM_CELL_SIZE = 128.0;
+const size_t NO_OWNER = SIZE_MAX;
+// Item flags: a shell circling its owner, an item used up this tick, a
+// boost pad its owner is on this tick or was on last tick, a box that is
+// refilling and a shell that seeks a kart
+const uint8_t ITEM_HELD = 1;
+const uint8_t ITEM_DEAD = 2;
+const uint8_t ITEM_TOUCHING = 4;
+const uint8_t ITEM_WAS_TOUCHING = 8;
+const uint8_t ITEM_EMPTY = 16;
+const uint8_t ITEM_HOMING = 32;
+
+// What a box's refill timer needs to find the box again. Boxes are the
+// first items in the pool and are never removed, so their indices last.
+typedef struct box_refill {
+  item_pool_t *pool;
+  size_t idx;
+  timer_id_t timer;
+} box_refill_t;
+
+struct item_pool {
+  track_t *track;
+  list_t *karts;
+  bool *switches;
+  // The state of the random numbers the boxes draw items with
+  uint64_t random;
+  // How far each kart reaches from its center along and across its heading,
+  // and how far it is round the lap with the centerline segment it was last
+  // found on, indexed by kart
+  vector_t *kart_extents;
+  double *kart_progress;
+  size_t *kart_segments;
+  // Each item's state, indexed by item. Positions are in track coordinates.
+  // Angles are where a held shell is on its circle, or which way a boost pad
+  // faces; spins are how fast a shell circles. Homing shells have a target
+  // kart, the centerline segment they were last found on and how long they
+  // have left to fly.
+  size_t size;
+  size_t capacity;
+  uint8_t *kinds;
+  uint8_t *flags;
+  size_t *owners;
+  vector_t *positions;
+  vector_t *velocities;
+  float *angles;
+  float *spins;
+  size_t *targets;
+  size_t *segments;
+  float *lives;
+  size_t num_homing;
+  // The clock that times the boxes' refills and the karts' effects, and
+  // each box's refill timer, indexed by item
+  timer_wheel_t *timers;
+  size_t num_boxes;
+  box_refill_t *refills;
+  // The items sorted by grid cell: the items in cell c are
+  // cell_items[cell_starts[c]] up to cell_items[cell_starts[c + 1]]
+  vector_t grid_min;
+  size_t grid_width;
+  size_t grid_height;
+  size_t *cell_starts;
+  size_t *cell_items;
+  size_t *item_cells;
+  // One sprite per kind, drawn at each item of that kind in turn, or NULL
+  // until the first item of the kind is drawn
+  body_t *stamps[NUM_ITEM_KINDS];
+  asset_t *sprites[NUM_ITEM_KINDS];
+};
+
+static void *checked_realloc(void *ptr, size_t size) {
+  void *resized = realloc(ptr, size);
+  assert(resized != NULL);
+  return resized;
+}
+
+static void reserve(item_pool_t *pool, size_t capacity) {
+  pool->capacity = capacity;
+  pool->kinds = checked_realloc(pool->kinds, capacity * sizeof(uint8_t));
+  pool->flags = checked_realloc(pool->flags, capacity * sizeof(uint8_t));
+  pool->owners = checked_realloc(pool->owners, capacity * sizeof(size_t));
+  pool->positions =
+      checked_realloc(pool->positions, capacity * sizeof(vector_t));
+  pool->velocities =
+      checked_realloc(pool->velocities, capacity * sizeof(vector_t));
+  pool->angles = checked_realloc(pool->angles, capacity * sizeof(float));
+  pool->spins = checked_realloc(pool->spins, capacity * sizeof(float));
+  pool->targets = checked_realloc(pool->targets, capacity * sizeof(size_t));
+  pool->segments =
+      checked_realloc(pool->segments, capacity * sizeof(size_t));
+  pool->lives = checked_realloc(pool->lives, capacity * sizeof(float));
+  pool->cell_items =
+      checked_realloc(pool->cell_items, capacity * sizeof(size_t));
+  pool->item_cells =
+      checked_realloc(pool->item_cells, capacity * sizeof(size_t));
+}
+
+/**
+ * Appends an item at rest, and returns its index.
+ */
+static size_t add_item(item_pool_t *pool, item_kind_t kind,
+                       vector_t position, size_t owner) {
+  if (pool->size == pool->capacity) {
+    reserve(pool, 2 * pool->capacity);
+  }
+  size_t idx = pool->size++;
+  pool->kinds[idx] = kind;
+  pool->flags[idx] = 0;
+  pool->owners[idx] = owner;
+  pool->positions[idx] = position;
+  pool->velocities[idx] = VEC_ZERO;
+  pool->angles[idx] = 0;
+  pool->spins[idx] = 0;
+  pool->targets[idx] = NO_OWNER;
+  pool->segments[idx] = SIZE_MAX;
+  pool->lives[idx] = 0;
+  return idx;
+}
+
+/**
+ * Returns how far a kart's corners reach along and across its heading.
+ */
+static vector_t kart_extent(body_t *kart) {
+  vector_t center = body_get_centroid(kart);
+  double theta = body_get_rotation(kart);
+  list_t *points = polygon_get_points(body_get_polygon(kart));
+  vector_t extent = VEC_ZERO;
+  for (size_t i = 0; i < list_size(points); i++) {
+    vector_t offset = vec_rotate(
+        vec_subtract(*(vector_t *)list_get(points, i), center), -theta);
+    extent.x = fmax(extent.x, fabs(offset.x));
+    extent.y = fmax(extent.y, fabs(offset.y));
+  }
+  return extent;
+}
+
+item_pool_t *item_pool_init(track_t *track, list_t *karts, bool *switches,
+                            timer_wheel_t *timers, uint64_t seed) {
+  item_pool_t *pool = malloc(sizeof(item_pool_t));
+  assert(pool != NULL);
+  pool->track = track;
+  pool->karts = karts;
+  pool->switches = switches;
+  pool->random = rng_seed(seed);
+  pool->timers = timers;
+  size_t num_karts = list_size(karts);
+  pool->kart_extents = malloc(num_karts * sizeof(vector_t));
+  pool->kart_progress = malloc(num_karts * sizeof(double));
+  pool->kart_segments = malloc(num_karts * sizeof(size_t));
+  assert(num_karts == 0 ||
+         (pool->kart_extents != NULL && pool->kart_progress != NULL &&
+          pool->kart_segments != NULL));
+  for (size_t i = 0; i < num_karts; i++) {
+    pool->kart_extents[i] = kart_extent(list_get(karts, i));
+    pool->kart_progress[i] = 0;
+    pool->kart_segments[i] = SIZE_MAX;
+  }
+
+  pool->size = 0;
+  pool->kinds = NULL;
+  pool->flags = NULL;
+  pool->owners = NULL;
+  pool->positions = NULL;
+  pool->velocities = NULL;
+  pool->angles = NULL;
+  pool->spins = NULL;
+  pool->targets = NULL;
+  pool->segments = NULL;
+  pool->lives = NULL;
+  pool->num_homing = 0;
+  pool->cell_items = NULL;
+  pool->item_cells = NULL;
+  size_t num_boxes = track_get_num_boxes(track);
+  reserve(pool, num_boxes + ITEM_INITIAL_CAPACITY);
+  const vector_t *boxes = track_get_boxes(track);
+  pool->num_boxes = num_boxes;
+  pool->refills = malloc(num_boxes * sizeof(box_refill_t));
+  assert(num_boxes == 0 || pool->refills != NULL);
+  for (size_t i = 0; i < num_boxes; i++) {
+    add_item(pool, ITEM_BOX, boxes[i], NO_OWNER);
+    pool->refills[i] =
+        (box_refill_t){.pool = pool, .idx = i, .timer = NO_TIMER};
+  }
+
+  pool->grid_min = track_get_min(track);
+  vector_t span = vec_subtract(track_get_max(track), pool->grid_min);
+  pool->grid_width = (size_t)fmax(ceil(span.x / ITEM_CELL_SIZE), 1);
+  pool->grid_height = (size_t)fmax(ceil(span.y / ITEM_CELL_SIZE), 1);
+  pool->cell_starts =
+      malloc((pool->grid_width * pool->grid_height + 1) * sizeof(size_t));
+  assert(pool->cell_starts != NULL);
+
+  for (size_t kind = 0; kind < NUM_ITEM_KINDS; kind++) {
+    pool->stamps[kind] = NULL;
+    pool->sprites[kind] = NULL;
+  }
+  return pool;
+}
+
+void item_pool_free(item_pool_t *pool) {
+  for (size_t kind = 0; kind < NUM_ITEM_KINDS; kind++) {
+    if (pool->sprites[kind] != NULL) {
+      asset_destroy(pool->sprites[kind]);
+      body_free(pool->stamps[kind]);
+    }
+  }
+  free(pool->kart_extents);
+  free(pool->kart_progress);
+  free(pool->kart_segments);
+  free(pool->kinds);
+  free(pool->flags);
+  free(pool->owners);
+  free(pool->positions);
+  free(pool->velocities);
+  free(pool->angles);
+  free(pool->spins);
+  free(pool->targets);
+  free(pool->segments);
+  free(pool->lives);
+  for (size_t i = 0; i < pool->num_boxes; i++) {
+    timer_wheel_cancel(pool->timers, pool->refills[i].timer);
+  }
+  free(pool->refills);
+  free(pool->cell_starts);
+  free(pool->cell_items);
+  free(pool->item_cells);
+  free(pool);
+}
+
+size_t item_pool_size(item_pool_t *pool) { return pool->size; }
+
+item_kind_t item_pool_get_kind(item_pool_t *pool, size_t idx) {
+  assert(idx < pool->size);
+  return pool->kinds[idx];
+}
+
+vector_t item_pool_get_position(item_pool_t *pool, size_t idx) {
+  assert(idx < pool->size);
+  return vec_add(pool->positions[idx], track_get_origin(pool->track));
+}
+
+vector_t item_pool_get_velocity(item_pool_t *pool, size_t idx) {
+  assert(idx < pool->size);
+  return pool->velocities[idx];
+}
+
+double item_pool_get_radius(item_pool_t *pool, size_t idx) {
+  assert(idx < pool->size);
+  return ITEM_SIZES[pool->kinds[idx]] / 2;
+}
+
+bool item_pool_is_hazard(item_pool_t *pool, size_t idx) {
+  assert(idx < pool->size);
+  return pool->kinds[idx] == ITEM_FAKE ||
+         (pool->kinds[idx] == ITEM_SHELL && !(pool->flags[idx] & ITEM_HELD));
+}
+
+static size_t kart_index(item_pool_t *pool, body_t *car) {
+  for (size_t i = 0; i < list_size(pool->karts); i++) {
+    if (list_get(pool->karts, i) == car) {
+      return i;
+    }
+  }
+  assert(false && "Not one of the pool's karts");
+  return NO_OWNER;
+}
+
+/**
+ * Returns the index of the shell circling the kart at the given index, or
+ * NO_OWNER if it has none.
+ */
+static size_t held_shell(item_pool_t *pool, size_t kart) {
+  for (size_t i = 0; i < pool->size; i++) {
+    if ((pool->flags[i] & ITEM_HELD) && pool->owners[i] == kart) {
+      return i;
+    }
+  }
+  return NO_OWNER;
+}
+
+static void set_has_shell(body_t *car, bool shell) {
+  power_up_info_t info = car_get_powerup_state(car);
+  info.shell = shell;
+  car_set_powerup_state(car, info);
+}
+
+void item_pool_add_fake(item_pool_t *pool, vector_t center) {
+  add_item(pool, ITEM_FAKE,
+           vec_subtract(center, track_get_origin(pool->track)), NO_OWNER);
+}
+
+/**
+ * Moves a held shell to its place on its kart's circle, moving with the
+ * kart.
+ */
+static void place_held_shell(item_pool_t *pool, size_t idx) {
+  body_t *car = list_get(pool->karts, pool->owners[idx]);
+  vector_t offset =
+      vec_rotate((vector_t){0, ITEM_SHELL_DISTANCE}, pool->angles[idx]);
+  vector_t center = vec_subtract(body_get_centroid(car),
+                                 track_get_origin(pool->track));
+  pool->positions[idx] = vec_add(center, offset);
+  vector_t circling =
+      vec_multiply(pool->spins[idx], vec_rotate(offset, M_PI / 2));
+  pool->velocities[idx] = vec_add(circling, body_get_velocity(car));
+}
+
+void item_pool_add_shell(item_pool_t *pool, body_t *car, double angle,
+                         double spin) {
+  size_t kart = kart_index(pool, car);
+  assert(held_shell(pool, kart) == NO_OWNER);
+  size_t idx = add_item(pool, ITEM_SHELL, VEC_ZERO, kart);
+  pool->flags[idx] |= ITEM_HELD;
+  pool->angles[idx] = angle;
+  pool->spins[idx] = spin;
+  place_held_shell(pool, idx);
+  set_has_shell(car, true);
+}
+
+void item_pool_throw_shell(item_pool_t *pool, body_t *car) {
+  size_t idx = held_shell(pool, kart_index(pool, car));
+  if (idx != NO_OWNER) {
+    pool->flags[idx] &= ~ITEM_HELD;
+    set_has_shell(car, false);
+  }
+}
+
+void item_pool_flip_shell(item_pool_t *pool, body_t *car) {
+  size_t idx = held_shell(pool, kart_index(pool, car));
+  if (idx != NO_OWNER) {
+    pool->spins[idx] *= -1;
+  }
+}
+
+void item_pool_add_boost(item_pool_t *pool, body_t *car) {
+  vector_t center = vec_subtract(body_get_centroid(car),
+                                 track_get_origin(pool->track));
+  size_t idx = add_item(pool, ITEM_BOOST, center, kart_index(pool, car));
+  // The pad's sprite faces right
+  pool->angles[idx] = body_get_rotation(car) - M_PI / 2;
+}
+
+/**
+ * Measures how far each kart is round the lap.
+ */
+static void update_kart_progress(item_pool_t *pool) {
+  for (size_t kart = 0; kart < list_size(pool->karts); kart++) {
+    body_t *car = list_get(pool->karts, kart);
+    pool->kart_progress[kart] = track_project(
+        pool->track, body_get_centroid(car), &pool->kart_segments[kart]);
+  }
+}
+
+/**
+ * Returns the kart that is the least far ahead of the given one round the
+ * lap, or NO_OWNER if it is the only kart.
+ */
+static size_t kart_ahead(item_pool_t *pool, size_t kart) {
+  double length = track_get_length(pool->track);
+  size_t ahead = NO_OWNER;
+  double best = INFINITY;
+  for (size_t other = 0; other < list_size(pool->karts); other++) {
+    double gap = fmod(pool->kart_progress[other] - pool->kart_progress[kart] +
+                          length,
+                      length);
+    if (other != kart && gap < best) {
+      ahead = other;
+      best = gap;
+    }
+  }
+  return ahead;
+}
+
+void item_pool_add_homing_shell(item_pool_t *pool, body_t *car) {
+  size_t kart = kart_index(pool, car);
+  update_kart_progress(pool);
+  double theta = body_get_rotation(car);
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  double nose = pool->kart_extents[kart].y + ITEM_SIZES[ITEM_SHELL] / 2 +
+                ITEM_HOMING_CLEARANCE;
+  vector_t center = vec_subtract(body_get_centroid(car),
+                                 track_get_origin(pool->track));
+  size_t idx = add_item(pool, ITEM_SHELL,
+                        vec_add(center, vec_multiply(nose, heading)), kart);
+  pool->flags[idx] |= ITEM_HOMING;
+  pool->velocities[idx] = vec_multiply(ITEM_HOMING_SPEED, heading);
+  pool->targets[idx] = kart_ahead(pool, kart);
+  pool->segments[idx] = pool->kart_segments[kart];
+  pool->lives[idx] = ITEM_HOMING_LIFETIME;
+  pool->num_homing++;
+}
+
+/**
+ * Turns every homing shell towards where it is headed: a point on the road
+ * ahead of it, or its target once it is close to it round the lap. The
+ * karts are measured once for all the shells. Shells that have flown for
+ * too long break.
+ */
+static void steer_homing_shells(item_pool_t *pool, double dt) {
+  track_t *track = pool->track;
+  double length = track_get_length(track);
+  vector_t origin = track_get_origin(track);
+  update_kart_progress(pool);
+  for (size_t i = 0; i < pool->size; i++) {
+    if (!(pool->flags[i] & ITEM_HOMING)) {
+      continue;
+    }
+    pool->lives[i] -= dt;
+    if (pool->lives[i] <= 0) {
+      pool->flags[i] |= ITEM_DEAD;
+      continue;
+    }
+    vector_t center = vec_add(pool->positions[i], origin);
+    double progress = track_project(track, center, &pool->segments[i]);
+    size_t target = pool->targets[i];
+    vector_t aim;
+    double gap =
+        target != NO_OWNER
+            ? fmod(pool->kart_progress[target] - progress + length, length)
+            : length / 2;
+    // Close ahead, or just passed
+    if (gap < ITEM_HOMING_LOCK || gap > length - ITEM_HOMING_LOCK) {
+      aim = body_get_centroid(list_get(pool->karts, target));
+    } else {
+      aim = track_point_at(track,
+                           fmod(progress + ITEM_HOMING_LOOKAHEAD, length));
+    }
+    vector_t velocity = pool->velocities[i];
+    vector_t to_aim = vec_subtract(aim, center);
+    double error =
+        atan2(vec_cross(velocity, to_aim), vec_dot(velocity, to_aim));
+    double max_turn = ITEM_HOMING_TURN * dt;
+    pool->velocities[i] =
+        vec_rotate(velocity, fmax(fmin(error, max_turn), -max_turn));
+  }
+}
+
+/**
+ * Moves a loose shell for the tick, sweeping it through the walls and
+ * bouncing it off each one it runs into on the way, so that no speed takes
+ * it through a wall.
+ */
+static void move_loose_shell(item_pool_t *pool, size_t idx, double dt) {
+  track_t *track = pool->track;
+  vector_t origin = track_get_origin(track);
+  vector_t center = vec_add(pool->positions[idx], origin);
+  vector_t velocity = pool->velocities[idx];
+  double reach = ITEM_SIZES[ITEM_SHELL] / 2 + ITEM_WALL_RADIUS;
+  double travel = vec_get_length(velocity) * dt;
+  // Only shells near a wall can reach one this tick
+  bool clear =
+      track_get_distance(track, center) > reach + travel + ITEM_WALL_MARGIN;
+  size_t bounces = 0;
+  wall_hit_t hit;
+  while (!clear &&
+         track_sweep(track, center, vec_add(center, vec_multiply(dt, velocity)),
+                     reach, &hit)) {
+    center = hit.center;
+    double speed = vec_dot(velocity, hit.normal);
+    velocity = vec_subtract(velocity, vec_multiply(2 * speed, hit.normal));
+    dt *= 1 - hit.time;
+    if (++bounces == ITEM_MAX_BOUNCES) {
+      // Wedged in a corner, so it waits there for the next tick
+      dt = 0;
+      break;
+    }
+  }
+  pool->positions[idx] =
+      vec_subtract(vec_add(center, vec_multiply(dt, velocity)), origin);
+  pool->velocities[idx] = velocity;
+}
+
+static size_t cell_coord(double x, double min, size_t cells) {
+  double cell = floor((x - min) / ITEM_CELL_SIZE);
+  return (size_t)fmax(fmin(cell, cells - 1), 0);
+}
+
+/**
+ * Sorts the items into the grid, counting the items in each cell and then
+ * placing each item after those of the cells before its own.
+ */
+static void build_grid(item_pool_t *pool) {
+  size_t num_cells = pool->grid_width * pool->grid_height;
+  for (size_t c = 0; c <= num_cells; c++) {
+    pool->cell_starts[c] = 0;
+  }
+  for (size_t i = 0; i < pool->size; i++) {
+    vector_t p = pool->positions[i];
+    size_t cell =
+        cell_coord(p.y, pool->grid_min.y, pool->grid_height) *
+            pool->grid_width +
+        cell_coord(p.x, pool->grid_min.x, pool->grid_width);
+    pool->item_cells[i] = cell;
+    pool->cell_starts[cell + 1]++;
+  }
+  for (size_t c = 0; c < num_cells; c++) {
+    pool->cell_starts[c + 1] += pool->cell_starts[c];
+  }
+  for (size_t i = 0; i < pool->size; i++) {
+    // Each cell's start is moved on as it is filled, then moved back
+    pool->cell_items[pool->cell_starts[pool->item_cells[i]]++] = i;
+  }
+  for (size_t c = num_cells; c > 0; c--) {
+    pool->cell_starts[c] = pool->cell_starts[c - 1];
+  }
+  pool->cell_starts[0] = 0;
+}
+
+/**
+ * Whether a kart, in track coordinates, overlaps the item at the given
+ * index: the item's center is within its radius of the kart's rectangle.
+ */
+static bool kart_touches(item_pool_t *pool, size_t kart, vector_t center,
+                         double theta, size_t idx) {
+  vector_t extent = pool->kart_extents[kart];
+  vector_t offset =
+      vec_rotate(vec_subtract(pool->positions[idx], center), -theta);
+  double dx = fmax(fabs(offset.x) - extent.x, 0);
+  double dy = fmax(fabs(offset.y) - extent.y, 0);
+  double radius = ITEM_SIZES[pool->kinds[idx]] / 2;
+  return dx * dx + dy * dy < radius * radius;
+}
+
+/**
+ * The timer callback that refills a box.
+ *
+ * @param aux the box's box_refill_t
+ */
+static void refill_box(void *aux) {
+  box_refill_t *refill = aux;
+  refill->pool->flags[refill->idx] &= ~ITEM_EMPTY;
+  refill->timer = NO_TIMER;
+}
+
+/**
+ * What happens when a kart touches the item at the given index.
+ */
+static void kart_hits_item(item_pool_t *pool, size_t kart, size_t idx) {
+  body_t *car = list_get(pool->karts, kart);
+  switch ((item_kind_t)pool->kinds[idx]) {
+  case ITEM_BOX: {
+    if (!(pool->flags[idx] & ITEM_EMPTY)) {
+      car_draw_item(car, pool->switches, &pool->random);
+      pool->flags[idx] |= ITEM_EMPTY;
+      box_refill_t *refill = &pool->refills[idx];
+      refill->timer = timer_wheel_schedule(pool->timers, ITEM_BOX_REFILL,
+                                           refill_box, refill);
+    }
+    break;
+  }
+  case ITEM_FAKE: {
+    car_stun(car, pool->timers);
+    pool->flags[idx] |= ITEM_DEAD;
+    break;
+  }
+  case ITEM_SHELL: {
+    // A held shell only hits the other karts
+    if (!(pool->flags[idx] & ITEM_HELD) || pool->owners[idx] != kart) {
+      car_stun(car, pool->timers);
+      pool->flags[idx] |= ITEM_DEAD;
+    }
+    break;
+  }
+  case ITEM_BOOST: {
+    // Only the kart that put the pad down is boosted, once each time it
+    // drives onto it
+    if (pool->owners[idx] == kart) {
+      if (!(pool->flags[idx] & ITEM_WAS_TOUCHING)) {
+        car_boost(car, pool->timers);
+      }
+      pool->flags[idx] |= ITEM_TOUCHING;
+    }
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+/**
+ * Calls the visit function on each live item in the cells around a point,
+ * in track coordinates, until it returns false.
+ */
+static void visit_near(item_pool_t *pool, vector_t point,
+                       bool (*visit)(item_pool_t *pool, size_t idx,
+                                     void *aux),
+                       void *aux) {
+  size_t cx = cell_coord(point.x, pool->grid_min.x, pool->grid_width);
+  size_t cy = cell_coord(point.y, pool->grid_min.y, pool->grid_height);
+  for (size_t y = cy > 0 ? cy - 1 : 0;
+       y <= cy + 1 && y < pool->grid_height; y++) {
+    for (size_t x = cx > 0 ? cx - 1 : 0;
+         x <= cx + 1 && x < pool->grid_width; x++) {
+      size_t cell = y * pool->grid_width + x;
+      for (size_t k = pool->cell_starts[cell]; k < pool->cell_starts[cell + 1];
+           k++) {
+        size_t idx = pool->cell_items[k];
+        if (!(pool->flags[idx] & ITEM_DEAD) && !visit(pool, idx, aux)) {
+          return;
+        }
+      }
+    }
+  }
+}
+
+typedef struct kart_query {
+  size_t kart;
+  vector_t center;
+  double theta;
+} kart_query_t;
+
+static bool visit_kart(item_pool_t *pool, size_t idx, void *aux) {
+  kart_query_t *query = aux;
+  if (kart_touches(pool, query->kart, query->center, query->theta, idx)) {
+    kart_hits_item(pool, query->kart, idx);
+  }
+  return true;
+}
+
+static bool visit_shell(item_pool_t *pool, size_t idx, void *aux) {
+  size_t shell = *(size_t *)aux;
+  if (idx <= shell || pool->kinds[idx] != ITEM_SHELL) {
+    return true;
+  }
+  vector_t offset = vec_subtract(pool->positions[idx], pool->positions[shell]);
+  double reach = ITEM_SIZES[ITEM_SHELL];
+  if (vec_dot(offset, offset) < reach * reach) {
+    pool->flags[idx] |= ITEM_DEAD;
+    pool->flags[shell] |= ITEM_DEAD;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * Drops the items that were used up, keeping the rest in order, and lets go
+ * of the karts' lost shells.
+ */
+static void remove_dead(item_pool_t *pool) {
+  size_t kept = 0;
+  for (size_t i = 0; i < pool->size; i++) {
+    if (pool->flags[i] & ITEM_DEAD) {
+      if (pool->flags[i] & ITEM_HELD) {
+        set_has_shell(list_get(pool->karts, pool->owners[i]), false);
+      }
+      if (pool->flags[i] & ITEM_HOMING) {
+        pool->num_homing--;
+      }
+      continue;
+    }
+    pool->kinds[kept] = pool->kinds[i];
+    pool->flags[kept] = pool->flags[i];
+    pool->owners[kept] = pool->owners[i];
+    pool->positions[kept] = pool->positions[i];
+    pool->velocities[kept] = pool->velocities[i];
+    pool->angles[kept] = pool->angles[i];
+    pool->spins[kept] = pool->spins[i];
+    pool->targets[kept] = pool->targets[i];
+    pool->segments[kept] = pool->segments[i];
+    pool->lives[kept] = pool->lives[i];
+    kept++;
+  }
+  pool->size = kept;
+}
+
+void item_pool_update(item_pool_t *pool, double dt) {
+  if (pool->num_homing > 0) {
+    steer_homing_shells(pool, dt);
+  }
+  for (size_t i = 0; i < pool->size; i++) {
+    switch ((item_kind_t)pool->kinds[i]) {
+    case ITEM_SHELL: {
+      if (pool->flags[i] & ITEM_HELD) {
+        pool->angles[i] += pool->spins[i] * dt;
+        place_held_shell(pool, i);
+      } else {
+        move_loose_shell(pool, i, dt);
+      }
+      break;
+    }
+    case ITEM_BOOST: {
+      bool touching = pool->flags[i] & ITEM_TOUCHING;
+      pool->flags[i] &= ~(ITEM_TOUCHING | ITEM_WAS_TOUCHING);
+      pool->flags[i] |= touching ? ITEM_WAS_TOUCHING : 0;
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  build_grid(pool);
+  vector_t origin = track_get_origin(pool->track);
+  for (size_t kart = 0; kart < list_size(pool->karts); kart++) {
+    body_t *car = list_get(pool->karts, kart);
+    kart_query_t query = {
+        .kart = kart,
+        .center = vec_subtract(body_get_centroid(car), origin),
+        .theta = body_get_rotation(car)};
+    visit_near(pool, query.center, visit_kart, &query);
+  }
+  for (size_t i = 0; i < pool->size; i++) {
+    if (pool->kinds[i] == ITEM_SHELL && !(pool->flags[i] & ITEM_DEAD)) {
+      visit_near(pool, pool->positions[i], visit_shell, &i);
+    }
+  }
+  remove_dead(pool);
+}
+
+/**
+ * Returns the sprite for a kind of item, loading it the first time it is
+ * drawn so that a pool that is never drawn needs no renderer.
+ */
+static asset_t *get_sprite(item_pool_t *pool, item_kind_t kind) {
+  if (pool->sprites[kind] == NULL) {
+    list_t *shape =
+        make_rectangle(VEC_ZERO, ITEM_SIZES[kind], ITEM_SIZES[kind]);
+    body_t *stamp = body_init(shape, INFINITY, get_blue());
+    pool->stamps[kind] = stamp;
+    pool->sprites[kind] =
+        kind == ITEM_BOOST
+            ? asset_make_rotatable_image_with_body(ITEM_SPRITE_PATHS[kind],
+                                                   stamp)
+            : asset_make_image_with_body(ITEM_SPRITE_PATHS[kind], stamp);
+  }
+  return pool->sprites[kind];
+}
+
+void item_pool_render(item_pool_t *pool) {
+  vector_t origin = track_get_origin(pool->track);
+  for (size_t i = 0; i < pool->size; i++) {
+    item_kind_t kind = pool->kinds[i];
+    if (pool->flags[i] & ITEM_EMPTY) {
+      continue;
+    }
+    asset_t *sprite = get_sprite(pool, kind);
+    body_t *stamp = pool->stamps[kind];
+    body_set_centroid(stamp, vec_add(pool->positions[i], origin));
+    if (kind == ITEM_BOOST) {
+      body_set_rotation(stamp, pool->angles[i]);
+    }
+    asset_render(sprite);
+  }
+}
@@ -0,0 +1,128 @@
+#include "kart_store.h"
+#include <assert.h>
+#include <stdlib.h>
+
+struct kart_store {
+  size_t size;
+  size_t capacity;
+  // The karts that have been added and not removed, and whether the store
+  // has been released by its owner; the memory is freed once neither holds
+  size_t num_live;
+  bool released;
+  // Indexed by kart ID
+  kart_stats_t *stats;
+  car_controls_t *controls;
+  power_up_info_t *items;
+  kart_effects_t *effects;
+  kart_progress_t *progress;
+};
+
+kart_store_t *kart_store_init(size_t capacity) {
+  kart_store_t *store = malloc(sizeof(kart_store_t));
+  assert(store != NULL);
+  store->size = 0;
+  store->capacity = capacity;
+  store->num_live = 0;
+  store->released = false;
+  store->stats = malloc(capacity * sizeof(kart_stats_t));
+  store->controls = malloc(capacity * sizeof(car_controls_t));
+  store->items = malloc(capacity * sizeof(power_up_info_t));
+  store->effects = malloc(capacity * sizeof(kart_effects_t));
+  store->progress = malloc(capacity * sizeof(kart_progress_t));
+  assert(capacity == 0 ||
+         (store->stats != NULL && store->controls != NULL &&
+          store->items != NULL && store->effects != NULL &&
+          store->progress != NULL));
+  return store;
+}
+
+/**
+ * Frees the store's memory if its owner and all its karts are done with it.
+ */
+static void free_if_unused(kart_store_t *store) {
+  if (!store->released || store->num_live > 0) {
+    return;
+  }
+  free(store->stats);
+  free(store->controls);
+  free(store->items);
+  free(store->effects);
+  free(store->progress);
+  free(store);
+}
+
+void kart_store_free(kart_store_t *store) {
+  assert(!store->released);
+  store->released = true;
+  free_if_unused(store);
+}
+
+size_t kart_store_add(kart_store_t *store, kart_stats_t stats) {
+  assert(store->size < store->capacity);
+  size_t id = store->size++;
+  store->stats[id] = stats;
+  store->controls[id] = (car_controls_t){.throttle = 0, .steer = 0};
+  store->items[id] = (power_up_info_t){.power_up = 0, .shell = false};
+  for (size_t i = 0; i < NUM_EFFECTS; i++) {
+    store->effects[id].effects[i] =
+        (effect_timer_t){.on = false, .id = NO_TIMER};
+  }
+  store->progress[id] = (kart_progress_t){
+      .checkpoint_state = NULL, .laps_done = 0, .kart_hits = 0};
+  store->num_live++;
+  return id;
+}
+
+void kart_store_remove(kart_store_t *store, size_t id) {
+  assert(id < store->size && store->num_live > 0);
+  checkpoint_state_free(store->progress[id].checkpoint_state);
+  store->progress[id].checkpoint_state = NULL;
+  store->num_live--;
+  free_if_unused(store);
+}
+
+size_t kart_store_size(kart_store_t *store) { return store->size; }
+
+kart_stats_t *kart_store_get_stats(kart_store_t *store) {
+  return store->stats;
+}
+
+car_controls_t *kart_store_get_controls(kart_store_t *store) {
+  return store->controls;
+}
+
+power_up_info_t *kart_store_get_items(kart_store_t *store) {
+  return store->items;
+}
+
+kart_effects_t *kart_store_get_effects(kart_store_t *store) {
+  return store->effects;
+}
+
+kart_progress_t *kart_store_get_progress(kart_store_t *store) {
+  return store->progress;
+}
+
+/**
+ * The timer callback that switches an effect off.
+ *
+ * @param aux the kart's effect_timer_t for the effect
+ */
+static void end_effect(void *aux) {
+  effect_timer_t *effect = aux;
+  effect->on = false;
+  effect->id = NO_TIMER;
+}
+
+void kart_store_start_effect(kart_store_t *store, size_t id,
+                             timer_wheel_t *timers, car_effect_t effect,
+                             double duration) {
+  assert(id < store->size);
+  effect_timer_t *timer = &store->effects[id].effects[effect];
+  if (timer->on && timer_wheel_get_remaining(timers, timer->id) >= duration) {
+    return;
+  }
+  timer_wheel_cancel(timers, timer->id);
+  timer->on = true;
+  timer->id = timer_wheel_schedule(timers, duration, end_effect, timer);
+}
@@ -0,0 +1,222 @@
+#include "lap_timer.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Distance between the samples of the distance-time table
+const double LAP_TIMER_SAMPLE_SPACING = 25.0;
+
+struct lap_timer {
+  track_t *track;
+  double length;
+  size_t num_sectors;
+  size_t num_samples;
+  size_t max_laps;
+  size_t num_laps;
+  // Time into the lap and progress at the last update
+  double time;
+  double progress;
+  size_t next_sample;
+  size_t sector;
+  double sector_start;
+  // Time at which each sample was passed, on this lap and on the best lap
+  double *current;
+  double *best;
+  double best_lap;
+  double *sector_times;
+  double *best_sectors;
+  // One row per kept lap: the lap time, then each sector time
+  float *records;
+};
+
+lap_timer_t *lap_timer_init(track_t *track, size_t max_laps) {
+  assert(max_laps > 0);
+  lap_timer_t *timer = malloc(sizeof(lap_timer_t));
+  assert(timer != NULL);
+  timer->track = track;
+  timer->length = track_get_length(track);
+  timer->num_sectors = track_get_num_sectors(track);
+  // Sample k sits at progress k * spacing; the finish line closes the table
+  timer->num_samples =
+      (size_t)ceil(timer->length / LAP_TIMER_SAMPLE_SPACING);
+  timer->max_laps = max_laps;
+  timer->num_laps = 0;
+  timer->current = malloc(timer->num_samples * sizeof(double));
+  timer->best = malloc(timer->num_samples * sizeof(double));
+  timer->sector_times = malloc(timer->num_sectors * sizeof(double));
+  timer->best_sectors = malloc(timer->num_sectors * sizeof(double));
+  timer->records =
+      malloc(max_laps * (timer->num_sectors + 1) * sizeof(float));
+  assert(timer->current != NULL && timer->best != NULL);
+  assert(timer->sector_times != NULL && timer->best_sectors != NULL);
+  assert(timer->records != NULL);
+  timer->best_lap = INFINITY;
+  for (size_t i = 0; i < timer->num_sectors; i++) {
+    timer->best_sectors[i] = INFINITY;
+  }
+  timer->time = 0;
+  timer->progress = 0;
+  timer->next_sample = 1;
+  timer->sector = 0;
+  timer->sector_start = 0;
+  timer->current[0] = 0;
+  return timer;
+}
+
+void lap_timer_free(lap_timer_t *timer) {
+  free(timer->current);
+  free(timer->best);
+  free(timer->sector_times);
+  free(timer->best_sectors);
+  free(timer->records);
+  free(timer);
+}
+
+/**
+ * Returns the time at which the kart passed the given progress, assuming it
+ * moved steadily from the last update to the new one.
+ */
+static double crossing_time(lap_timer_t *timer, double target, double progress,
+                            double time) {
+  if (progress <= timer->progress) {
+    return time;
+  }
+  double t = (target - timer->progress) / (progress - timer->progress);
+  return timer->time + fmin(fmax(t, 0), 1) * (time - timer->time);
+}
+
+/**
+ * Records the samples and sector ends passed since the last update, then
+ * makes the kart's progress and time the last update.
+ */
+static void advance(lap_timer_t *timer, double progress, double time) {
+  if (progress > timer->progress) {
+    while (timer->next_sample < timer->num_samples &&
+           timer->next_sample * LAP_TIMER_SAMPLE_SPACING <= progress) {
+      double target = timer->next_sample * LAP_TIMER_SAMPLE_SPACING;
+      timer->current[timer->next_sample] =
+          crossing_time(timer, target, progress, time);
+      timer->next_sample++;
+    }
+    while (timer->sector + 1 < timer->num_sectors &&
+           track_get_sector_progress(timer->track, timer->sector + 1) <=
+               progress) {
+      double target =
+          track_get_sector_progress(timer->track, timer->sector + 1);
+      double end = crossing_time(timer, target, progress, time);
+      double sector_time = end - timer->sector_start;
+      timer->sector_times[timer->sector] = sector_time;
+      timer->best_sectors[timer->sector] =
+          fmin(timer->best_sectors[timer->sector], sector_time);
+      timer->sector_start = end;
+      timer->sector++;
+    }
+  }
+  timer->progress = progress;
+  timer->time = time;
+}
+
+void lap_timer_update(lap_timer_t *timer, double progress, double dt) {
+  advance(timer, progress, timer->time + dt);
+}
+
+double lap_timer_finish_lap(lap_timer_t *timer, double progress, double dt) {
+  // Unwrap the progress past the line so the crossing can be interpolated
+  double end = timer->time + dt;
+  double finish = timer->length;
+  double unwrapped = finish + fmax(progress, 0);
+  double lap_time = crossing_time(timer, finish, unwrapped, end);
+  advance(timer, unwrapped, end);
+  // Every sample and sector start has been passed, which leaves the last
+  // sector to end at the line
+  size_t last = timer->num_sectors - 1;
+  timer->sector_times[last] = lap_time - timer->sector_start;
+  timer->best_sectors[last] =
+      fmin(timer->best_sectors[last], timer->sector_times[last]);
+
+  float *record =
+      &timer->records[(timer->num_laps % timer->max_laps) *
+                      (timer->num_sectors + 1)];
+  record[0] = lap_time;
+  for (size_t i = 0; i < timer->num_sectors; i++) {
+    record[i + 1] = timer->sector_times[i];
+  }
+  timer->num_laps++;
+
+  if (lap_time < timer->best_lap) {
+    double *swap = timer->best;
+    timer->best = timer->current;
+    timer->current = swap;
+    timer->best_lap = lap_time;
+  }
+
+  // The next lap started when the kart crossed the line
+  timer->time = 0;
+  timer->progress = 0;
+  timer->next_sample = 1;
+  timer->sector = 0;
+  timer->sector_start = 0;
+  timer->current[0] = 0;
+  advance(timer, fmax(progress, 0), end - lap_time);
+  return lap_time;
+}
+
+double lap_timer_get_lap_time(lap_timer_t *timer) { return timer->time; }
+
+double lap_timer_get_best_lap(lap_timer_t *timer) { return timer->best_lap; }
+
+double lap_timer_get_delta(lap_timer_t *timer) {
+  if (timer->best_lap == INFINITY) {
+    return 0;
+  }
+  double progress = fmin(fmax(timer->progress, 0), timer->length);
+  size_t k = (size_t)(progress / LAP_TIMER_SAMPLE_SPACING);
+  if (k >= timer->num_samples) {
+    k = timer->num_samples - 1;
+  }
+  double start = k * LAP_TIMER_SAMPLE_SPACING;
+  double end = fmin(start + LAP_TIMER_SAMPLE_SPACING, timer->length);
+  double next =
+      k + 1 < timer->num_samples ? timer->best[k + 1] : timer->best_lap;
+  double t = end > start ? (progress - start) / (end - start) : 0;
+  double best_time = timer->best[k] + t * (next - timer->best[k]);
+  return timer->time - best_time;
+}
+
+size_t lap_timer_get_sector(lap_timer_t *timer) { return timer->sector; }
+
+double lap_timer_get_sector_time(lap_timer_t *timer, size_t sector) {
+  assert(sector < timer->num_sectors);
+  if (sector < timer->sector) {
+    return timer->sector_times[sector];
+  }
+  if (sector == timer->sector) {
+    return timer->time - timer->sector_start;
+  }
+  return 0;
+}
+
+double lap_timer_get_best_sector(lap_timer_t *timer, size_t sector) {
+  assert(sector < timer->num_sectors);
+  return timer->best_sectors[sector];
+}
+
+size_t lap_timer_get_num_laps(lap_timer_t *timer) { return timer->num_laps; }
+
+/**
+ * Returns the record row of a kept lap.
+ */
+static const float *get_record(lap_timer_t *timer, size_t lap) {
+  assert(lap < timer->num_laps && lap + timer->max_laps >= timer->num_laps);
+  return &timer->records[(lap % timer->max_laps) * (timer->num_sectors + 1)];
+}
+
+double lap_timer_get_record(lap_timer_t *timer, size_t lap) {
+  return get_record(timer, lap)[0];
+}
+
+double lap_timer_get_record_sector(lap_timer_t *timer, size_t lap,
+                                   size_t sector) {
+  assert(sector < timer->num_sectors);
+  return get_record(timer, lap)[sector + 1];
+}
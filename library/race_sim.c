@@ -0,0 +1,363 @@
+#include "race_sim.h"
+#include "ai_field.h"
+#include "checkpoints.h"
+#include "item_pool.h"
+#include "kart_store.h"
+#include "lap_timer.h"
+#include "power_up.h"
+#include "rng.h"
+#include "scene.h"
+#include "timer_wheel.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const size_t SIM_NUM_KART_TYPES = PICKUP + 1;
+// The slots of the clock that times the karts' effects
+const double SIM_TIMER_TICK = 1.0 / 60;
+const size_t SIM_TIMER_SLOTS = 512;
+
+struct race_result {
+  size_t num_karts;
+  size_t num_laps;
+  double duration;
+  size_t peak_shells;
+  // Indexed by grid slot
+  car_type_t *types;
+  double *skills;
+  double *lap_times; // num_laps per kart
+  double *finish_times;
+  double *distances;
+  size_t *wall_hits;
+  size_t *kart_hits;
+  size_t *positions;
+  // Indexed by finishing position - 1
+  size_t *order;
+};
+
+static race_result_t *race_result_init(size_t num_karts, size_t num_laps) {
+  race_result_t *result = malloc(sizeof(race_result_t));
+  assert(result != NULL);
+  result->num_karts = num_karts;
+  result->num_laps = num_laps;
+  result->duration = 0;
+  result->peak_shells = 0;
+  result->types = malloc(num_karts * sizeof(car_type_t));
+  result->skills = malloc(num_karts * sizeof(double));
+  result->lap_times = malloc(num_karts * num_laps * sizeof(double));
+  result->finish_times = malloc(num_karts * sizeof(double));
+  result->distances = malloc(num_karts * sizeof(double));
+  result->wall_hits = calloc(num_karts, sizeof(size_t));
+  result->kart_hits = calloc(num_karts, sizeof(size_t));
+  result->positions = malloc(num_karts * sizeof(size_t));
+  result->order = malloc(num_karts * sizeof(size_t));
+  assert(result->types != NULL && result->skills != NULL &&
+         result->lap_times != NULL && result->finish_times != NULL &&
+         result->distances != NULL && result->wall_hits != NULL &&
+         result->kart_hits != NULL && result->positions != NULL &&
+         result->order != NULL);
+  for (size_t i = 0; i < num_karts * num_laps; i++) {
+    result->lap_times[i] = INFINITY;
+  }
+  for (size_t i = 0; i < num_karts; i++) {
+    result->finish_times[i] = INFINITY;
+    result->distances[i] = 0;
+  }
+  return result;
+}
+
+void race_result_free(race_result_t *result) {
+  free(result->types);
+  free(result->skills);
+  free(result->lap_times);
+  free(result->finish_times);
+  free(result->distances);
+  free(result->wall_hits);
+  free(result->kart_hits);
+  free(result->positions);
+  free(result->order);
+  free(result);
+}
+
+/**
+ * Whether kart a finished ahead of kart b: the earlier finish, or the longer
+ * distance between karts that did not finish.
+ */
+static bool finished_ahead(race_result_t *result, size_t a, size_t b) {
+  double time_a = result->finish_times[a];
+  double time_b = result->finish_times[b];
+  if (time_a != time_b) {
+    return time_a < time_b;
+  }
+  return result->distances[a] > result->distances[b];
+}
+
+/**
+ * Sorts the karts into their finishing order with an insertion sort, which
+ * keeps karts that tied in grid order.
+ */
+static void rank_karts(race_result_t *result) {
+  for (size_t i = 0; i < result->num_karts; i++) {
+    size_t kart = i;
+    size_t j = i;
+    while (j > 0 && finished_ahead(result, kart, result->order[j - 1])) {
+      result->order[j] = result->order[j - 1];
+      j--;
+    }
+    result->order[j] = kart;
+  }
+  for (size_t i = 0; i < result->num_karts; i++) {
+    result->positions[result->order[i]] = i + 1;
+  }
+}
+
+// What a kart's firing timer needs to fire its next shell
+typedef struct shell_firing {
+  item_pool_t *items;
+  body_t *car;
+  timer_wheel_t *timers;
+  double interval;
+} shell_firing_t;
+
+/**
+ * The timer callback that fires a homing shell from a kart and starts the
+ * timer for the next one.
+ *
+ * @param aux the kart's shell_firing_t
+ */
+static void fire_shell(void *aux) {
+  shell_firing_t *firing = aux;
+  item_pool_add_homing_shell(firing->items, firing->car);
+  timer_wheel_schedule(firing->timers, firing->interval, fire_shell, firing);
+}
+
+static size_t count_shells(item_pool_t *items) {
+  size_t count = 0;
+  for (size_t i = 0; i < item_pool_size(items); i++) {
+    count += item_pool_get_kind(items, i) == ITEM_SHELL;
+  }
+  return count;
+}
+
+/**
+ * Lines the karts up on the grid with their forces and drivers. Each kart's
+ * ID in the store is its index in the list.
+ */
+static void create_karts(scene_t *scene, track_t *track,
+                         const race_config_t *config, uint64_t *random,
+                         kart_store_t *store, list_t *karts, ai_field_t *field,
+                         timer_wheel_t *timers, race_result_t *result,
+                         size_t *wall_hits) {
+  size_t num_karts = config->num_karts;
+  for (size_t i = 0; i < num_karts; i++) {
+    car_type_t type = config->kart_type >= 0
+                          ? (car_type_t)config->kart_type
+                          : rng_next(random) % SIM_NUM_KART_TYPES;
+    double skill = config->skill *
+                       (1 - config->skill_spread * i / num_karts) +
+                   config->skill_jitter * rng_signed(random);
+    body_t *car = make_car_in_store(store, type);
+    spawn_t spawn = track_get_grid_slot(track, i);
+    body_set_centroid(car, spawn.position);
+    body_set_rotation(car, spawn.rotation);
+    scene_add_body(scene, car);
+    create_surface_forces(scene, track, car);
+    create_vehicle_controller(scene, car);
+    create_counted_wall_collision(scene, track, car, config->wall_elasticity,
+                                  &wall_hits[i]);
+    if (config->top_speed > 0) {
+      change_top_speed(car, config->top_speed);
+    }
+    car_set_checkpoint_state(car, checkpoint_state_init(track));
+    list_add(karts, car);
+    ai_field_add(field, car, skill);
+    result->types[i] = type;
+    result->skills[i] = skill;
+  }
+  create_kart_collisions(scene, karts, timers);
+}
+
+race_result_t *race_sim_run(track_t *track, const race_config_t *config,
+                            uint64_t seed) {
+  size_t num_karts = config->num_karts;
+  size_t num_laps = config->num_laps;
+  assert(num_karts > 0 && num_laps > 0 && config->dt > 0);
+  uint64_t random = rng_seed(seed);
+  race_result_t *result = race_result_init(num_karts, num_laps);
+  track_set_origin(track, VEC_ZERO);
+  double lap_length = track_get_length(track);
+
+  scene_t *scene = scene_init();
+  kart_store_t *store = kart_store_init(num_karts);
+  list_t *karts = list_init(num_karts, NULL);
+  ai_field_t *field = ai_field_init(track, num_karts);
+  timer_wheel_t *effect_timers =
+      timer_wheel_init(SIM_TIMER_TICK, SIM_TIMER_SLOTS);
+  size_t *wall_hits = calloc(num_karts, sizeof(size_t));
+  lap_timer_t **timers = malloc(num_karts * sizeof(lap_timer_t *));
+  assert(wall_hits != NULL && timers != NULL);
+  create_karts(scene, track, config, &random, store, karts, field,
+               effect_timers, result, wall_hits);
+  kart_progress_t *progress = kart_store_get_progress(store);
+  for (size_t i = 0; i < num_karts; i++) {
+    timers[i] = lap_timer_init(track, num_laps);
+  }
+  // The item boxes give every power up, though the drivers never use them
+  bool switches[] = {true, true, true, true, true, true};
+  item_pool_t *items = NULL;
+  shell_firing_t *firings = NULL;
+  if (config->shell_interval > 0) {
+    items = item_pool_init(track, karts, switches, effect_timers,
+                           rng_next(&random));
+    firings = malloc(num_karts * sizeof(shell_firing_t));
+    assert(firings != NULL);
+    // The karts take turns to fire, spread evenly over the interval
+    for (size_t i = 0; i < num_karts; i++) {
+      firings[i] = (shell_firing_t){.items = items,
+                                    .car = list_get(karts, i),
+                                    .timers = effect_timers,
+                                    .interval = config->shell_interval};
+      timer_wheel_schedule(effect_timers,
+                           config->shell_interval * (i + 1) / num_karts,
+                           fire_shell, &firings[i]);
+    }
+  }
+
+  // Finished karts drive on, since they are still in the others' way, but
+  // their results are kept from the moment they crossed the line
+  size_t num_finished = 0;
+  double time = 0;
+  while (num_finished < num_karts && time < config->time_limit) {
+    double dt = config->dt;
+    time += dt;
+    timer_wheel_advance(effect_timers, dt);
+    scene_tick(scene, dt);
+    for (size_t i = 0; i < num_karts; i++) {
+      checkpoint_state_update(progress[i].checkpoint_state,
+                              list_get(karts, i));
+    }
+    ai_field_update(field, dt);
+    if (items != NULL) {
+      item_pool_update(items, dt);
+      size_t shells = count_shells(items);
+      if (shells > result->peak_shells) {
+        result->peak_shells = shells;
+      }
+    }
+    for (size_t i = 0; i < num_karts; i++) {
+      car_respawn(list_get(karts, i));
+      checkpoint_state_t *checkpoint_state = progress[i].checkpoint_state;
+      double lap_progress = get_lap_progress(checkpoint_state);
+      size_t laps = progress[i].laps_done;
+      if (!get_lap_over(checkpoint_state)) {
+        lap_timer_update(timers[i], lap_progress, dt);
+        if (laps < num_laps) {
+          result->distances[i] = laps * lap_length + lap_progress;
+        }
+        continue;
+      }
+      double lap_time = lap_timer_finish_lap(timers[i], lap_progress, dt);
+      reset_checkpoint_state(checkpoint_state);
+      progress[i].laps_done = laps + 1;
+      if (laps >= num_laps) {
+        continue;
+      }
+      result->lap_times[i * num_laps + laps] = lap_time;
+      if (laps + 1 == num_laps) {
+        // The line was crossed part way through the tick
+        result->finish_times[i] = time - lap_timer_get_lap_time(timers[i]);
+        result->distances[i] = num_laps * lap_length;
+        result->wall_hits[i] = wall_hits[i];
+        result->kart_hits[i] = progress[i].kart_hits;
+        num_finished++;
+      }
+    }
+  }
+  result->duration = time;
+  for (size_t i = 0; i < num_karts; i++) {
+    if (result->finish_times[i] == INFINITY) {
+      result->wall_hits[i] = wall_hits[i];
+      result->kart_hits[i] = progress[i].kart_hits;
+    }
+  }
+  rank_karts(result);
+
+  for (size_t i = 0; i < num_karts; i++) {
+    lap_timer_free(timers[i]);
+  }
+  free(timers);
+  if (items != NULL) {
+    item_pool_free(items);
+    free(firings);
+  }
+  ai_field_free(field);
+  timer_wheel_free(effect_timers);
+  list_free(karts);
+  // The karts are removed from the store as the scene frees them
+  kart_store_free(store);
+  scene_free(scene);
+  free(wall_hits);
+  return result;
+}
+
+size_t race_result_get_num_karts(race_result_t *result) {
+  return result->num_karts;
+}
+
+size_t race_result_get_num_laps(race_result_t *result) {
+  return result->num_laps;
+}
+
+double race_result_get_duration(race_result_t *result) {
+  return result->duration;
+}
+
+size_t race_result_get_peak_shells(race_result_t *result) {
+  return result->peak_shells;
+}
+
+car_type_t race_result_get_kart_type(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->types[kart];
+}
+
+double race_result_get_skill(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->skills[kart];
+}
+
+size_t race_result_get_position(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->positions[kart];
+}
+
+size_t race_result_get_kart(race_result_t *result, size_t position) {
+  assert(position >= 1 && position <= result->num_karts);
+  return result->order[position - 1];
+}
+
+double race_result_get_lap_time(race_result_t *result, size_t kart,
+                                size_t lap) {
+  assert(kart < result->num_karts && lap < result->num_laps);
+  return result->lap_times[kart * result->num_laps + lap];
+}
+
+double race_result_get_finish_time(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->finish_times[kart];
+}
+
+double race_result_get_distance(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->distances[kart];
+}
+
+size_t race_result_get_wall_hits(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->wall_hits[kart];
+}
+
+size_t race_result_get_kart_hits(race_result_t *result, size_t kart) {
+  assert(kart < result->num_karts);
+  return result->kart_hits[kart];
+}
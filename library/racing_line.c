@@ -0,0 +1,250 @@
+#include "racing_line.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// The distance between stations along the centerline
+const double RACING_LINE_SPACING = 40.0;
+// Stations are optimized on this many levels, each twice as fine as the last
+const size_t RACING_LINE_LEVELS = 4;
+const size_t RACING_LINE_ITERATIONS = 200;
+// How close the line may come to either boundary
+const double RACING_LINE_MARGIN = 40.0;
+// The search for the edge of the road along a station's normal stops once it
+// is this close to the margin
+const double BOUND_TOLERANCE = 1.0;
+const size_t MAX_BOUND_STEPS = 32;
+
+struct racing_line {
+  track_t *track;
+  size_t size;
+  double spacing;
+  // Track positions of the stations, before the track's origin is added
+  vector_t *points;
+  float *offsets;
+  float *speeds;
+};
+
+/**
+ * Returns how far the road extends from `start` in the given direction
+ * before reaching the margin, by stepping along it as far as the distance
+ * field says is clear.
+ */
+static double trace_bound(track_t *track, vector_t start,
+                          vector_t direction) {
+  double t = 0;
+  for (size_t i = 0; i < MAX_BOUND_STEPS; i++) {
+    vector_t point = vec_add(start, vec_multiply(t, direction));
+    double clear = track_get_distance(track, point) - RACING_LINE_MARGIN;
+    if (clear < BOUND_TOLERANCE) {
+      break;
+    }
+    t += clear;
+  }
+  return t;
+}
+
+/**
+ * Returns station i moved `alpha` along its normal.
+ */
+static vector_t station(const vector_t *centers, const vector_t *normals,
+                        const double *alpha, size_t i) {
+  return vec_add(centers[i], vec_multiply(alpha[i], normals[i]));
+}
+
+/**
+ * Runs projected Gauss-Seidel on every `stride`th station. Each sweep moves a
+ * station to where it minimizes the squared second differences of the line
+ * around it, then clamps it to the road.
+ */
+static void smooth_offsets(const vector_t *centers, const vector_t *normals,
+                           const double *left, const double *right,
+                           double *alpha, size_t size, size_t stride) {
+  size_t m = size / stride;
+  for (size_t iter = 0; iter < RACING_LINE_ITERATIONS; iter++) {
+    for (size_t j = 0; j < m; j++) {
+      size_t i = j * stride;
+      vector_t prev2 =
+          station(centers, normals, alpha, ((j + m - 2) % m) * stride);
+      vector_t prev =
+          station(centers, normals, alpha, ((j + m - 1) % m) * stride);
+      vector_t next = station(centers, normals, alpha, ((j + 1) % m) * stride);
+      vector_t next2 =
+          station(centers, normals, alpha, ((j + 2) % m) * stride);
+      vector_t target = vec_multiply(
+          1.0 / 6, vec_subtract(vec_multiply(4, vec_add(prev, next)),
+                                vec_add(prev2, next2)));
+      double offset = vec_dot(vec_subtract(target, centers[i]), normals[i]);
+      alpha[i] = fmin(fmax(offset, -right[i]), left[i]);
+    }
+  }
+}
+
+/**
+ * Returns the curvature of the circle through three points.
+ */
+static double curvature(vector_t a, vector_t b, vector_t c) {
+  double cross = fabs(vec_cross(vec_subtract(b, a), vec_subtract(c, a)));
+  double ab = vec_get_length(vec_subtract(b, a));
+  double bc = vec_get_length(vec_subtract(c, b));
+  double ca = vec_get_length(vec_subtract(a, c));
+  double denominator = ab * bc * ca;
+  return denominator > 0 ? 2 * cross / denominator : 0;
+}
+
+/**
+ * Fills in the speed at each station: the cornering limit, lowered to what
+ * the kart can reach by braking for the stations ahead and by accelerating
+ * from the ones behind. Each pass runs twice around the lap so the limits
+ * carry across the start line.
+ */
+static void make_speeds(racing_line_t *line, racing_limits_t limits) {
+  size_t size = line->size;
+  double *speeds = malloc(size * sizeof(double));
+  assert(speeds != NULL);
+  for (size_t i = 0; i < size; i++) {
+    double k = curvature(line->points[(i + size - 1) % size], line->points[i],
+                         line->points[(i + 1) % size]);
+    speeds[i] = limits.top_speed;
+    if (k > 0) {
+      speeds[i] = fmin(speeds[i], sqrt(limits.lateral_accel / k));
+    }
+  }
+  for (size_t k = 2 * size; k-- > 0;) {
+    size_t i = k % size;
+    size_t next = (i + 1) % size;
+    double d =
+        vec_get_length(vec_subtract(line->points[next], line->points[i]));
+    double braking = speeds[next] * speeds[next] + 2 * limits.braking * d;
+    speeds[i] = fmin(speeds[i], sqrt(braking));
+  }
+  for (size_t k = 0; k < 2 * size; k++) {
+    size_t i = k % size;
+    size_t next = (i + 1) % size;
+    double d =
+        vec_get_length(vec_subtract(line->points[next], line->points[i]));
+    double accelerating = speeds[i] * speeds[i] + 2 * limits.acceleration * d;
+    speeds[next] = fmin(speeds[next], sqrt(accelerating));
+  }
+  for (size_t i = 0; i < size; i++) {
+    line->speeds[i] = speeds[i];
+  }
+  free(speeds);
+}
+
+racing_line_t *racing_line_init(track_t *track, racing_limits_t limits) {
+  racing_line_t *line = malloc(sizeof(racing_line_t));
+  assert(line != NULL);
+  double length = track_get_length(track);
+  // A whole number of coarsest stations, so every level closes the loop
+  size_t block = (size_t)1 << (RACING_LINE_LEVELS - 1);
+  size_t size = (size_t)round(length / RACING_LINE_SPACING / block) * block;
+  if (size < 4 * block) {
+    size = 4 * block;
+  }
+  line->track = track;
+  line->size = size;
+  line->spacing = length / size;
+  line->points = malloc(size * sizeof(vector_t));
+  line->offsets = malloc(size * sizeof(float));
+  line->speeds = malloc(size * sizeof(float));
+  assert(line->points != NULL && line->offsets != NULL &&
+         line->speeds != NULL);
+
+  vector_t *centers = malloc(size * sizeof(vector_t));
+  vector_t *normals = malloc(size * sizeof(vector_t));
+  double *left = malloc(size * sizeof(double));
+  double *right = malloc(size * sizeof(double));
+  double *alpha = malloc(size * sizeof(double));
+  assert(centers != NULL && normals != NULL && left != NULL &&
+         right != NULL && alpha != NULL);
+  for (size_t i = 0; i < size; i++) {
+    centers[i] = track_point_at(track, i * line->spacing);
+  }
+  for (size_t i = 0; i < size; i++) {
+    vector_t tangent = vec_subtract(centers[(i + 1) % size],
+                                    centers[(i + size - 1) % size]);
+    tangent = vec_multiply(1 / vec_get_length(tangent), tangent);
+    normals[i] = (vector_t){-tangent.y, tangent.x};
+    left[i] = trace_bound(track, centers[i], normals[i]);
+    right[i] = trace_bound(track, centers[i], vec_negate(normals[i]));
+    alpha[i] = 0;
+  }
+
+  // Smooth the coarsest stations, then fill in the stations halfway between
+  // them and smooth again, down to every station
+  for (size_t level = RACING_LINE_LEVELS; level-- > 0;) {
+    size_t stride = (size_t)1 << level;
+    if (stride < block) {
+      for (size_t i = stride; i < size; i += 2 * stride) {
+        double mid = 0.5 * (alpha[i - stride] + alpha[(i + stride) % size]);
+        alpha[i] = fmin(fmax(mid, -right[i]), left[i]);
+      }
+    }
+    smooth_offsets(centers, normals, left, right, alpha, size, stride);
+  }
+
+  vector_t origin = track_get_origin(track);
+  for (size_t i = 0; i < size; i++) {
+    vector_t point = station(centers, normals, alpha, i);
+    line->points[i] = vec_subtract(point, origin);
+    line->offsets[i] = alpha[i];
+  }
+  free(centers);
+  free(normals);
+  free(left);
+  free(right);
+  free(alpha);
+
+  make_speeds(line, limits);
+  return line;
+}
+
+void racing_line_free(racing_line_t *line) {
+  free(line->points);
+  free(line->offsets);
+  free(line->speeds);
+  free(line);
+}
+
+size_t racing_line_get_size(racing_line_t *line) { return line->size; }
+
+double racing_line_get_offset(racing_line_t *line, size_t idx) {
+  assert(idx < line->size);
+  return line->offsets[idx];
+}
+
+/**
+ * Finds the station at or before the given progress and how far it is
+ * towards the next one.
+ */
+static size_t find_station(racing_line_t *line, double progress, double *t) {
+  double x = progress / line->spacing;
+  if (x < 0 || x >= line->size) {
+    x = fmod(x, line->size);
+    x += x < 0 ? line->size : 0;
+  }
+  size_t i = (size_t)x;
+  if (i >= line->size) {
+    i = line->size - 1;
+  }
+  *t = x - i;
+  return i;
+}
+
+vector_t racing_line_point_at(racing_line_t *line, double progress) {
+  double t;
+  size_t i = find_station(line, progress, &t);
+  vector_t a = line->points[i];
+  vector_t b = line->points[(i + 1) % line->size];
+  vector_t local = vec_add(a, vec_multiply(t, vec_subtract(b, a)));
+  return vec_add(local, track_get_origin(line->track));
+}
+
+double racing_line_speed_at(racing_line_t *line, double progress) {
+  double t;
+  size_t i = find_station(line, progress, &t);
+  double a = line->speeds[i];
+  double b = line->speeds[(i + 1) % line->size];
+  return a + t * (b - a);
+}
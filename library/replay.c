@@ -0,0 +1,223 @@
+#include "replay.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char REPLAY_MAGIC[8] = "CKREPLY";
+const uint32_t REPLAY_VERSION = 1;
+const size_t REPLAY_INITIAL_CAPACITY = 4096;
+// The flags at the start of each tick, saying what follows
+const uint8_t REPLAY_NEW_DT = 1;
+const uint8_t REPLAY_NEW_HELD = 2;
+const uint8_t REPLAY_PRESSED = 4;
+
+struct replay {
+  replay_setup_t setup;
+  size_t num_ticks;
+  uint8_t *bytes;
+  size_t size;
+  size_t capacity;
+  // The tick length and held actions of the last tick recorded
+  double last_dt;
+  uint8_t last_held;
+  // Where playback is up to, and the last tick played
+  size_t offset;
+  size_t num_played;
+  double played_dt;
+  uint8_t played_held;
+};
+
+/**
+ * The header at the start of a replay file. It is followed by the encoded
+ * ticks (size bytes).
+ */
+typedef struct replay_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_ticks;
+  uint32_t size;
+  replay_setup_t setup;
+} replay_header_t;
+
+static void rewind_replay(replay_t *replay) {
+  replay->offset = 0;
+  replay->num_played = 0;
+  replay->played_dt = 0;
+  replay->played_held = 0;
+}
+
+static replay_t *replay_alloc(const replay_setup_t *setup, size_t capacity) {
+  replay_t *replay = malloc(sizeof(replay_t));
+  assert(replay != NULL);
+  replay->setup = *setup;
+  replay->num_ticks = 0;
+  replay->size = 0;
+  replay->capacity = capacity;
+  replay->bytes = malloc(capacity);
+  assert(replay->bytes != NULL);
+  replay->last_dt = 0;
+  replay->last_held = 0;
+  rewind_replay(replay);
+  return replay;
+}
+
+replay_t *replay_init(const replay_setup_t *setup) {
+  return replay_alloc(setup, REPLAY_INITIAL_CAPACITY);
+}
+
+void replay_free(replay_t *replay) {
+  free(replay->bytes);
+  free(replay);
+}
+
+replay_setup_t replay_get_setup(replay_t *replay) { return replay->setup; }
+
+size_t replay_size(replay_t *replay) { return replay->num_ticks; }
+
+static void put_bytes(replay_t *replay, const void *bytes, size_t size) {
+  if (replay->size + size > replay->capacity) {
+    while (replay->size + size > replay->capacity) {
+      replay->capacity *= 2;
+    }
+    replay->bytes = realloc(replay->bytes, replay->capacity);
+    assert(replay->bytes != NULL);
+  }
+  memcpy(replay->bytes + replay->size, bytes, size);
+  replay->size += size;
+}
+
+void replay_record(replay_t *replay, double dt, const input_snapshot_t *input) {
+  uint8_t flags = 0;
+  if (dt != replay->last_dt) {
+    flags |= REPLAY_NEW_DT;
+  }
+  if (input->held != replay->last_held) {
+    flags |= REPLAY_NEW_HELD;
+  }
+  if (input->pressed != 0) {
+    flags |= REPLAY_PRESSED;
+  }
+  put_bytes(replay, &flags, sizeof(flags));
+  if (flags & REPLAY_NEW_DT) {
+    put_bytes(replay, &dt, sizeof(dt));
+  }
+  if (flags & REPLAY_NEW_HELD) {
+    put_bytes(replay, &input->held, sizeof(input->held));
+  }
+  if (flags & REPLAY_PRESSED) {
+    put_bytes(replay, &input->pressed, sizeof(input->pressed));
+  }
+  for (size_t i = 0; i < NUM_ACTIONS; i++) {
+    if (input->held & (1 << i)) {
+      put_bytes(replay, &input->held_times[i], sizeof(float));
+    }
+  }
+  replay->last_dt = dt;
+  replay->last_held = input->held;
+  replay->num_ticks++;
+}
+
+static bool get_bytes(replay_t *replay, void *bytes, size_t size) {
+  if (replay->offset + size > replay->size) {
+    return false;
+  }
+  memcpy(bytes, replay->bytes + replay->offset, size);
+  replay->offset += size;
+  return true;
+}
+
+bool replay_next(replay_t *replay, double *dt, input_snapshot_t *input) {
+  if (replay->num_played >= replay->num_ticks) {
+    return false;
+  }
+  uint8_t flags;
+  double tick_dt = replay->played_dt;
+  input_snapshot_t tick = {.held = replay->played_held, .pressed = 0};
+  if (!get_bytes(replay, &flags, sizeof(flags)) ||
+      ((flags & REPLAY_NEW_DT) &&
+       !get_bytes(replay, &tick_dt, sizeof(tick_dt))) ||
+      ((flags & REPLAY_NEW_HELD) &&
+       !get_bytes(replay, &tick.held, sizeof(tick.held))) ||
+      ((flags & REPLAY_PRESSED) &&
+       !get_bytes(replay, &tick.pressed, sizeof(tick.pressed)))) {
+    return false;
+  }
+  for (size_t i = 0; i < NUM_ACTIONS; i++) {
+    tick.held_times[i] = 0;
+    if ((tick.held & (1 << i)) &&
+        !get_bytes(replay, &tick.held_times[i], sizeof(float))) {
+      return false;
+    }
+  }
+  replay->played_dt = tick_dt;
+  replay->played_held = tick.held;
+  replay->num_played++;
+  *dt = tick_dt;
+  *input = tick;
+  return true;
+}
+
+replay_t *replay_read(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return NULL;
+  }
+  replay_header_t header;
+  // The ticks must fill the rest of the file, and take a byte each at least
+  long body_start = -1;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               memcmp(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC)) == 0 &&
+               header.version == REPLAY_VERSION &&
+               header.num_ticks <= header.size &&
+               (body_start = ftell(file)) >= 0 &&
+               fseek(file, 0, SEEK_END) == 0 &&
+               ftell(file) - body_start == (long)header.size &&
+               fseek(file, body_start, SEEK_SET) == 0;
+  if (!valid) {
+    fprintf(stderr, "Malformed replay '%s'\n", path);
+    fclose(file);
+    return NULL;
+  }
+  replay_t *replay =
+      replay_alloc(&header.setup, header.size > 0 ? header.size : 1);
+  replay->num_ticks = header.num_ticks;
+  replay->size = header.size;
+  bool read = fread(replay->bytes, 1, replay->size, file) == replay->size;
+  fclose(file);
+
+  // Decode the stream once so playback can trust it
+  double dt;
+  input_snapshot_t input;
+  while (read && replay_next(replay, &dt, &input)) {
+  }
+  if (!read || replay->num_played != replay->num_ticks ||
+      replay->offset != replay->size) {
+    fprintf(stderr, "Truncated replay '%s'\n", path);
+    replay_free(replay);
+    return NULL;
+  }
+  // Further ticks are recorded after the last one
+  replay->last_dt = replay->played_dt;
+  replay->last_held = replay->played_held;
+  rewind_replay(replay);
+  return replay;
+}
+
+bool replay_write(replay_t *replay, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  replay_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, REPLAY_MAGIC, sizeof(REPLAY_MAGIC));
+  header.version = REPLAY_VERSION;
+  header.num_ticks = replay->num_ticks;
+  header.size = replay->size;
+  header.setup = replay->setup;
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(replay->bytes, 1, replay->size, file) == replay->size;
+  return fclose(file) == 0 && written;
+}
@@ -0,0 +1,22 @@
+#include "rng.h"
+
+uint64_t rng_seed(uint64_t seed) {
+  uint64_t z = seed + UINT64_C(0x9E3779B97F4A7C15);
+  z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+  z ^= z >> 31;
+  return z != 0 ? z : 1;
+}
+
+uint64_t rng_next(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return x;
+}
+
+double rng_signed(uint64_t *state) {
+  return (rng_next(state) >> 11) * (2.0 / (UINT64_C(1) << 53)) - 1;
+}
@@ -0,0 +1,96 @@
+#include "rubber_band.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+struct rubber_band {
+  ai_field_t *field;
+  rubber_band_config_t config;
+  size_t player;
+  // Time since the scales were last updated
+  double elapsed;
+  // Indexed by kart in the field
+  size_t *standings_idx;
+  float *base_skills;
+  float *scales;
+};
+
+/**
+ * Returns the index of a kart in the list of all karts.
+ */
+static size_t find_kart(list_t *karts, body_t *car) {
+  for (size_t i = 0; i < list_size(karts); i++) {
+    if (list_get(karts, i) == car) {
+      return i;
+    }
+  }
+  assert(false);
+  return 0;
+}
+
+rubber_band_t *rubber_band_init(ai_field_t *field, list_t *karts,
+                                body_t *player,
+                                const rubber_band_config_t *config) {
+  assert(config->min_scale <= 1 && config->max_scale >= 1);
+  assert(config->gap_range > 0 && config->rate > 0);
+  rubber_band_t *band = malloc(sizeof(rubber_band_t));
+  assert(band != NULL);
+  size_t size = ai_field_size(field);
+  band->field = field;
+  band->config = *config;
+  band->player = find_kart(karts, player);
+  band->elapsed = 0;
+  band->standings_idx = malloc(size * sizeof(size_t));
+  band->base_skills = malloc(size * sizeof(float));
+  band->scales = malloc(size * sizeof(float));
+  assert(band->standings_idx != NULL && band->base_skills != NULL &&
+         band->scales != NULL);
+  for (size_t i = 0; i < size; i++) {
+    band->standings_idx[i] = find_kart(karts, ai_field_get_car(field, i));
+    band->base_skills[i] = ai_field_get_skill(field, i);
+    band->scales[i] = 1;
+  }
+  return band;
+}
+
+void rubber_band_free(rubber_band_t *band) {
+  free(band->standings_idx);
+  free(band->base_skills);
+  free(band->scales);
+  free(band);
+}
+
+double rubber_band_get_scale(rubber_band_t *band, size_t idx) {
+  assert(idx < ai_field_size(band->field));
+  return band->scales[idx];
+}
+
+/**
+ * Returns the scale a driver the given distance behind the player is pulled
+ * towards. The distance is negative for a driver ahead.
+ */
+static double target_scale(rubber_band_config_t *config, double gap) {
+  double pull = fmax(fmin(gap / config->gap_range, 1), -1);
+  if (pull > 0) {
+    return 1 + pull * (config->max_scale - 1);
+  }
+  return 1 + pull * (1 - config->min_scale);
+}
+
+void rubber_band_update(rubber_band_t *band, standings_t *standings,
+                        double dt) {
+  band->elapsed += dt;
+  if (band->elapsed < 1 / band->config.rate) {
+    return;
+  }
+  double ease = 1 - exp(-band->config.response * band->elapsed);
+  band->elapsed = 0;
+  double player = standings_get_distance(standings, band->player);
+  for (size_t i = 0; i < ai_field_size(band->field); i++) {
+    double gap =
+        player - standings_get_distance(standings, band->standings_idx[i]);
+    double target = target_scale(&band->config, gap);
+    band->scales[i] += ease * (target - band->scales[i]);
+    ai_field_set_skill(band->field, i, band->base_skills[i] * band->scales[i]);
+  }
+}
@@ -3,6 +3,7 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL2_gfxPrimitives.h>
 #include <assert.h>
+#include <limits.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -34,10 +35,15 @@ SDL_Renderer *renderer;
  */
 key_handler_t key_handler = NULL;
 /**
- * SDL's timestamp when a key was last pressed or released.
- * Used to mesasure how long a key has been held.
+ * The player's controls, updated by key events and read once per tick.
  */
-uint32_t key_start_timestamp;
+input_t *input = NULL;
+/**
+ * SDL's timestamp when each key was pressed, indexed by the key's char
+ * value, or 0 if it is not held. Used to measure how long a key has been
+ * held.
+ */
+uint32_t key_start_timestamps[1 << CHAR_BIT];
 /**
  * The value of clock() when time_since_last_tick() was last called.
  * Initially 0.
@@ -106,6 +112,28 @@ char get_keycode(SDL_Keycode key) {
   }
 }
 
+/**
+ * Returns the action a key drives, or NUM_ACTIONS if it drives none.
+ */
+action_t get_action(char key) {
+  switch (key) {
+  case LEFT_ARROW:
+    return ACTION_LEFT;
+  case UP_ARROW:
+    return ACTION_AHEAD;
+  case RIGHT_ARROW:
+    return ACTION_RIGHT;
+  case DOWN_ARROW:
+    return ACTION_BACK;
+  case SPACE_BAR:
+    return ACTION_ITEM;
+  case R:
+    return ACTION_FLIP;
+  default:
+    return NUM_ACTIONS;
+  }
+}
+
 void sdl_init(vector_t min, vector_t max) {
   // Check parameters
   assert(min.x < max.x);
@@ -119,74 +147,63 @@ void sdl_init(vector_t min, vector_t max) {
                             SDL_WINDOW_RESIZABLE);
   renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_PRESENTVSYNC);
   TTF_Init();
+  input = input_init();
 }
 
-uint32_t key_start_timestamps[SDL_NUM_SCANCODES];
-
 bool sdl_is_done(void *state) {
-  SDL_Event *event = malloc(sizeof(*event));
-  const Uint8 *keyboard = SDL_GetKeyboardState(NULL);
-  assert(event != NULL);
-  while (SDL_PollEvent(event)) {
-    switch (event->type) {
+  SDL_Event event;
+  while (SDL_PollEvent(&event)) {
+    switch (event.type) {
     case SDL_QUIT:
-      free(event);
       return true;
     case SDL_KEYDOWN:
-      if (key_start_timestamps[event->key.keysym.sym] == 0) {
-        key_start_timestamps[event->key.keysym.sym] = event->key.timestamp;
-      }
-      uint32_t timestamp = event->key.timestamp;
-      if (key_handler == NULL) {
-        break;
-      }
-      if (get_keycode(event->key.keysym.sym) == '\0') {
+    case SDL_KEYUP: {
+      char key = get_keycode(event.key.keysym.sym);
+      if (key == '\0') {
         break;
       }
-      for (size_t i = 0; i < SDL_NUM_SCANCODES; i++) {
-        if (keyboard[i]) {
-          char key = get_keycode(SDL_GetKeyFromScancode((SDL_Scancode)i));
-          if (key != '\0') {
-            double held_time = (timestamp - key_start_timestamps[i]) / MS_PER_S;
-            key_handler(key, KEY_PRESSED, held_time, state);
-          }
+      uint32_t timestamp = event.key.timestamp;
+      uint32_t *start = &key_start_timestamps[(unsigned char)key];
+      action_t action = get_action(key);
+      if (event.type == SDL_KEYDOWN) {
+        if (*start == 0) {
+          *start = timestamp;
+        }
+        if (action != NUM_ACTIONS) {
+          input_press(input, action, *start / MS_PER_S);
+        }
+        if (key_handler != NULL) {
+          double held_time = (timestamp - *start) / MS_PER_S;
+          key_handler(key, KEY_PRESSED, held_time, state);
+        }
+      } else {
+        *start = 0;
+        if (action != NUM_ACTIONS) {
+          input_release(input, action);
+        }
+        if (key_handler != NULL) {
+          key_handler(key, KEY_RELEASED, 0, state);
         }
       }
       break;
-
-    case SDL_KEYUP:
-      if (key_handler == NULL) {
-        break;
-      }
-      char key = get_keycode(event->key.keysym.sym);
-      if (key == '\0') {
-        break;
-      }
-      key_start_timestamps[event->key.keysym.sym] = 0;
-      break;
+    }
     case SDL_MOUSEBUTTONDOWN: {
-      SDL_MouseButtonEvent *click = (SDL_MouseButtonEvent *)event;
+      SDL_MouseButtonEvent *click = (SDL_MouseButtonEvent *)&event;
       asset_cache_handle_buttons(state, click->x, click->y);
       break;
     }
     }
   }
+  return false;
+}
 
-  if (key_handler != NULL) {
-    uint32_t timestamp = SDL_GetTicks();
-    for (size_t i = 0; i < SDL_NUM_SCANCODES; i++) {
-      if (key_start_timestamps[i]) {
-        char key = get_keycode(SDL_GetKeyFromScancode((SDL_Scancode)i));
-        if (key != '\0' && key_start_timestamps[i]) {
-          double held_time = (timestamp - key_start_timestamps[i]) / MS_PER_S;
-          key_handler(key, KEY_PRESSED, held_time, state);
-        }
-      }
-    }
-  }
+void sdl_request_quit(void) {
+  SDL_Event event = {.type = SDL_QUIT};
+  SDL_PushEvent(&event);
+}
 
-  free(event);
-  return false;
+input_snapshot_t sdl_take_input(void) {
+  return input_take_snapshot(input, SDL_GetTicks() / MS_PER_S);
 }
 
 void sdl_clear(void) {
@@ -0,0 +1,91 @@
+#include "standings.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MAX_KARTS 64
+
+const size_t STANDINGS_MAX_KARTS = MAX_KARTS;
+
+struct standings {
+  size_t num_karts;
+  double lap_length;
+  double distance[MAX_KARTS];
+  // order[i] is the kart in position i + 1, rank[k] is the index of kart k
+  // in order
+  uint8_t order[MAX_KARTS];
+  uint8_t rank[MAX_KARTS];
+};
+
+standings_t *standings_init(size_t num_karts, double lap_length) {
+  assert(num_karts > 0 && num_karts <= STANDINGS_MAX_KARTS);
+  standings_t *standings = malloc(sizeof(standings_t));
+  assert(standings != NULL);
+  standings->num_karts = num_karts;
+  standings->lap_length = lap_length;
+  for (size_t i = 0; i < num_karts; i++) {
+    standings->distance[i] = 0;
+    standings->order[i] = i;
+    standings->rank[i] = i;
+  }
+  return standings;
+}
+
+void standings_free(standings_t *standings) { free(standings); }
+
+size_t standings_get_num_karts(standings_t *standings) {
+  return standings->num_karts;
+}
+
+void standings_set_progress(standings_t *standings, size_t kart, size_t laps,
+                            double progress) {
+  assert(kart < standings->num_karts);
+  standings->distance[kart] = laps * standings->lap_length + progress;
+}
+
+void standings_update(standings_t *standings) {
+  uint8_t *order = standings->order;
+  double *distance = standings->distance;
+  // Insertion sort from the previous order; karts that tie keep their places
+  for (size_t i = 1; i < standings->num_karts; i++) {
+    uint8_t kart = order[i];
+    size_t j = i;
+    while (j > 0 && distance[order[j - 1]] < distance[kart]) {
+      order[j] = order[j - 1];
+      standings->rank[order[j]] = j;
+      j--;
+    }
+    order[j] = kart;
+    standings->rank[kart] = j;
+  }
+}
+
+size_t standings_get_position(standings_t *standings, size_t kart) {
+  assert(kart < standings->num_karts);
+  return standings->rank[kart] + 1;
+}
+
+size_t standings_get_kart(standings_t *standings, size_t position) {
+  assert(position >= 1 && position <= standings->num_karts);
+  return standings->order[position - 1];
+}
+
+double standings_get_distance(standings_t *standings, size_t kart) {
+  assert(kart < standings->num_karts);
+  return standings->distance[kart];
+}
+
+double standings_gap_to_leader(standings_t *standings, size_t kart) {
+  assert(kart < standings->num_karts);
+  return standings->distance[standings->order[0]] - standings->distance[kart];
+}
+
+double standings_gap_to_next(standings_t *standings, size_t kart) {
+  assert(kart < standings->num_karts);
+  size_t rank = standings->rank[kart];
+  if (rank == 0) {
+    return 0;
+  }
+  return standings->distance[standings->order[rank - 1]] -
+         standings->distance[kart];
+}
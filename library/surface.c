@@ -0,0 +1,100 @@
+#include "surface.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char *SURFACE_NAMES[] = {"asphalt", "grass", "sand", "boost"};
+const surface_properties_t SURFACE_PROPERTIES[] = {
+    {.drag = 2.0, .friction = 0.0, .thrust = 0.0},
+    {.drag = 4.0, .friction = 30.0, .thrust = 0.0},
+    {.drag = 6.0, .friction = 60.0, .thrust = 0.0},
+    {.drag = 1.0, .friction = 0.0, .thrust = 120.0}};
+const surface_type_t OFF_MAP_SURFACE = SURFACE_GRASS;
+
+struct surface_map {
+  vector_t min;
+  double cell_size;
+  size_t width;
+  size_t height;
+  uint8_t *cells; // width * height surface types, row by row
+};
+
+surface_properties_t surface_get_properties(surface_type_t type) {
+  assert(type < NUM_SURFACES);
+  return SURFACE_PROPERTIES[type];
+}
+
+bool surface_parse_type(const char *name, surface_type_t *type) {
+  for (size_t i = 0; i < NUM_SURFACES; i++) {
+    if (strcmp(name, SURFACE_NAMES[i]) == 0) {
+      *type = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+surface_map_t *surface_map_init(vector_t min, vector_t max, double cell_size,
+                                surface_type_t fill) {
+  assert(cell_size > 0);
+  surface_map_t *map = malloc(sizeof(surface_map_t));
+  assert(map != NULL);
+  map->min = min;
+  map->cell_size = cell_size;
+  map->width = (size_t)ceil((max.x - min.x) / cell_size);
+  map->height = (size_t)ceil((max.y - min.y) / cell_size);
+  map->cells = malloc(map->width * map->height);
+  assert(map->cells != NULL);
+  memset(map->cells, fill, map->width * map->height);
+  return map;
+}
+
+void surface_map_free(surface_map_t *map) {
+  free(map->cells);
+  free(map);
+}
+
+size_t surface_map_get_width(surface_map_t *map) { return map->width; }
+
+size_t surface_map_get_height(surface_map_t *map) { return map->height; }
+
+vector_t surface_map_get_cell_center(surface_map_t *map, size_t col,
+                                     size_t row) {
+  return (vector_t){map->min.x + (col + 0.5) * map->cell_size,
+                    map->min.y + (row + 0.5) * map->cell_size};
+}
+
+void surface_map_set_cell(surface_map_t *map, size_t col, size_t row,
+                          surface_type_t type) {
+  assert(col < map->width && row < map->height);
+  map->cells[row * map->width + col] = type;
+}
+
+void surface_map_fill(surface_map_t *map, surface_region_t region) {
+  // Columns and rows whose centers fall inside the region
+  double col_min = ceil((region.min.x - map->min.x) / map->cell_size - 0.5);
+  double col_max = floor((region.max.x - map->min.x) / map->cell_size - 0.5);
+  double row_min = ceil((region.min.y - map->min.y) / map->cell_size - 0.5);
+  double row_max = floor((region.max.y - map->min.y) / map->cell_size - 0.5);
+  col_min = fmax(col_min, 0);
+  row_min = fmax(row_min, 0);
+  col_max = fmin(col_max, map->width - 1.0);
+  row_max = fmin(row_max, map->height - 1.0);
+  for (double row = row_min; row <= row_max; row++) {
+    for (double col = col_min; col <= col_max; col++) {
+      map->cells[(size_t)row * map->width + (size_t)col] = region.type;
+    }
+  }
+}
+
+surface_type_t surface_map_get(surface_map_t *map, vector_t point) {
+  double col = floor((point.x - map->min.x) / map->cell_size);
+  double row = floor((point.y - map->min.y) / map->cell_size);
+  if (col < 0 || row < 0 || col >= map->width || row >= map->height) {
+    return OFF_MAP_SURFACE;
+  }
+  return map->cells[(size_t)row * map->width + (size_t)col];
+}
@@ -0,0 +1,208 @@
+#include "timer_wheel.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const timer_id_t NO_TIMER = 0;
+const size_t TIMER_INITIAL_CAPACITY = 16;
+// Ends the slots' lists and the free list
+const size_t TIMER_NIL = SIZE_MAX;
+
+typedef struct wheel_timer {
+  double expiry;
+  // The tick the timer is looked at on, which is never before the tick the
+  // clock was on when the timer was scheduled
+  uint64_t tick;
+  timer_callback_t callback;
+  void *aux;
+  // Bumped each time the entry is freed, so old IDs no longer match it
+  uint32_t generation;
+  bool pending;
+  // Neighbours in the slot's list, or the next free entry
+  size_t prev;
+  size_t next;
+} wheel_timer_t;
+
+struct timer_wheel {
+  double tick_length;
+  size_t num_slots;
+  // The first timer in each slot, or TIMER_NIL
+  size_t *slots;
+  wheel_timer_t *timers;
+  size_t capacity;
+  size_t size;
+  size_t free_list;
+  double time;
+  // Every timer on an earlier tick has been called
+  uint64_t cursor;
+};
+
+timer_wheel_t *timer_wheel_init(double tick, size_t num_slots) {
+  assert(tick > 0 && num_slots > 0);
+  timer_wheel_t *wheel = malloc(sizeof(timer_wheel_t));
+  assert(wheel != NULL);
+  wheel->tick_length = tick;
+  wheel->num_slots = num_slots;
+  wheel->slots = malloc(num_slots * sizeof(size_t));
+  assert(wheel->slots != NULL);
+  for (size_t i = 0; i < num_slots; i++) {
+    wheel->slots[i] = TIMER_NIL;
+  }
+  wheel->timers = NULL;
+  wheel->capacity = 0;
+  wheel->size = 0;
+  wheel->free_list = TIMER_NIL;
+  wheel->time = 0;
+  wheel->cursor = 0;
+  return wheel;
+}
+
+void timer_wheel_free(timer_wheel_t *wheel) {
+  free(wheel->slots);
+  free(wheel->timers);
+  free(wheel);
+}
+
+double timer_wheel_get_time(timer_wheel_t *wheel) { return wheel->time; }
+
+size_t timer_wheel_size(timer_wheel_t *wheel) { return wheel->size; }
+
+/**
+ * Returns the index of a free entry, growing the pool if there is none.
+ */
+static size_t take_entry(timer_wheel_t *wheel) {
+  if (wheel->free_list == TIMER_NIL) {
+    size_t old_capacity = wheel->capacity;
+    size_t capacity =
+        old_capacity == 0 ? TIMER_INITIAL_CAPACITY : 2 * old_capacity;
+    assert(capacity <= UINT32_MAX);
+    wheel->timers =
+        realloc(wheel->timers, capacity * sizeof(wheel_timer_t));
+    assert(wheel->timers != NULL);
+    for (size_t i = old_capacity; i < capacity; i++) {
+      wheel->timers[i].generation = 1;
+      wheel->timers[i].pending = false;
+      wheel->timers[i].next = i + 1 < capacity ? i + 1 : TIMER_NIL;
+    }
+    wheel->free_list = old_capacity;
+    wheel->capacity = capacity;
+  }
+  size_t idx = wheel->free_list;
+  wheel->free_list = wheel->timers[idx].next;
+  return idx;
+}
+
+/**
+ * Takes a pending timer out of its slot and frees its entry.
+ */
+static void release(timer_wheel_t *wheel, size_t idx) {
+  wheel_timer_t *timer = &wheel->timers[idx];
+  if (timer->prev == TIMER_NIL) {
+    wheel->slots[timer->tick % wheel->num_slots] = timer->next;
+  } else {
+    wheel->timers[timer->prev].next = timer->next;
+  }
+  if (timer->next != TIMER_NIL) {
+    wheel->timers[timer->next].prev = timer->prev;
+  }
+  timer->pending = false;
+  timer->generation++;
+  timer->next = wheel->free_list;
+  wheel->free_list = idx;
+  wheel->size--;
+}
+
+/**
+ * Returns the index of the pending timer with the given ID, or TIMER_NIL.
+ */
+static size_t find(timer_wheel_t *wheel, timer_id_t id) {
+  size_t idx = (size_t)(id & UINT32_MAX);
+  if (id == NO_TIMER || idx >= wheel->capacity) {
+    return TIMER_NIL;
+  }
+  wheel_timer_t *timer = &wheel->timers[idx];
+  if (!timer->pending || timer->generation != (uint32_t)(id >> 32)) {
+    return TIMER_NIL;
+  }
+  return idx;
+}
+
+timer_id_t timer_wheel_schedule(timer_wheel_t *wheel, double delay,
+                                timer_callback_t callback, void *aux) {
+  size_t idx = take_entry(wheel);
+  wheel_timer_t *timer = &wheel->timers[idx];
+  timer->expiry = wheel->time + delay;
+  double tick = floor(timer->expiry / wheel->tick_length);
+  timer->tick =
+      tick > (double)wheel->cursor ? (uint64_t)tick : wheel->cursor;
+  timer->callback = callback;
+  timer->aux = aux;
+  timer->pending = true;
+  size_t slot = timer->tick % wheel->num_slots;
+  timer->prev = TIMER_NIL;
+  timer->next = wheel->slots[slot];
+  if (timer->next != TIMER_NIL) {
+    wheel->timers[timer->next].prev = idx;
+  }
+  wheel->slots[slot] = idx;
+  wheel->size++;
+  return ((timer_id_t)timer->generation << 32) | idx;
+}
+
+bool timer_wheel_cancel(timer_wheel_t *wheel, timer_id_t id) {
+  size_t idx = find(wheel, id);
+  if (idx == TIMER_NIL) {
+    return false;
+  }
+  release(wheel, idx);
+  return true;
+}
+
+double timer_wheel_get_remaining(timer_wheel_t *wheel, timer_id_t id) {
+  size_t idx = find(wheel, id);
+  if (idx == TIMER_NIL) {
+    return 0;
+  }
+  return fmax(wheel->timers[idx].expiry - wheel->time, 0);
+}
+
+/**
+ * Returns the timer in the cursor's slot that runs out first, on the
+ * cursor's tick and by the given time, or TIMER_NIL if there is none.
+ */
+static size_t next_due(timer_wheel_t *wheel, double end) {
+  size_t due = TIMER_NIL;
+  size_t idx = wheel->slots[wheel->cursor % wheel->num_slots];
+  while (idx != TIMER_NIL) {
+    wheel_timer_t *timer = &wheel->timers[idx];
+    if (timer->tick <= wheel->cursor && timer->expiry <= end &&
+        (due == TIMER_NIL || timer->expiry < wheel->timers[due].expiry)) {
+      due = idx;
+    }
+    idx = timer->next;
+  }
+  return due;
+}
+
+void timer_wheel_advance(timer_wheel_t *wheel, double dt) {
+  double end = wheel->time + dt;
+  uint64_t last = (uint64_t)fmax(floor(end / wheel->tick_length), 0);
+  while (true) {
+    size_t idx;
+    while ((idx = next_due(wheel, end)) != TIMER_NIL) {
+      wheel_timer_t *timer = &wheel->timers[idx];
+      timer_callback_t callback = timer->callback;
+      void *aux = timer->aux;
+      // Timers the callback schedules start from the moment this one ran
+      // out
+      wheel->time = fmax(wheel->time, timer->expiry);
+      release(wheel, idx);
+      callback(aux);
+    }
+    if (wheel->cursor >= last) {
+      break;
+    }
+    wheel->cursor++;
+  }
+  wheel->time = end;
+}
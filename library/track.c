@@ -0,0 +1,1330 @@
+#include "track.h"
+#include "distance_field.h"
+#include "surface.h"
+#include "list.h"
+#include "vector.h"
+#include <assert.h>
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char TRACK_MAGIC[8] = "CKTRACK";
+const uint32_t TRACK_VERSION = 5;
+const size_t TRACK_TOKEN_SIZE = 64;
+// The bytes a binary track file takes for each surface region: its corners
+// as four doubles, then its type
+const size_t TRACK_REGION_BYTES = 4 * sizeof(double) + sizeof(uint32_t);
+// The most entries a section of a text track file may have, which keeps a
+// malformed count from overflowing the size of the section's array
+const size_t TRACK_MAX_SECTION_SIZE = 1 << 20;
+const size_t TRACK_CACHE_CAPACITY = 2;
+const size_t BOXES_PER_ROW = 3;
+const size_t BOX_ROW_STRIDE = 2;
+const size_t DEFAULT_SPAWNS = 2;
+const size_t DEFAULT_SECTORS = 3;
+const double DISTANCE_CELL_SIZE = 20.0;
+const double SURFACE_CELL_SIZE = 40.0;
+const double RESPAWN_SPACING = 50.0;
+// The gap between rows of karts that start behind the spawn grid
+const double GRID_ROW_SPACING = 90.0;
+
+static list_t *TRACK_CACHE = NULL;
+
+struct track {
+  char *name;
+  char *path;
+  double verge_width;
+  vector_t min;
+  vector_t max;
+  size_t size;
+  size_t num_checkpoints;
+  size_t num_boxes;
+  size_t num_spawns;
+  size_t num_regions;
+  size_t num_sectors;
+  vector_t *inner;
+  vector_t *outer;
+  vector_t *centerline;
+  segment_t *walls;
+  vector_t *checkpoints;
+  vector_t *boxes;
+  spawn_t *spawns;
+  surface_region_t *regions;
+  // The checkpoint each sector starts at, beginning with the start line
+  uint32_t *sectors;
+  void *block;
+  size_t block_size;
+  // Arc-length parameterization of the centerline, built after loading
+  double *arc;
+  double *checkpoint_progress;
+  // Where to put a car back on the road, every RESPAWN_SPACING of progress
+  spawn_t *respawns;
+  size_t num_respawns;
+  double length;
+  double start;
+  vector_t origin;
+  distance_field_t *field;
+  surface_map_t *surfaces;
+  wall_bvh_t *wall_tree;
+};
+
+/**
+ * The header at the start of a binary track file. It is written field by
+ * field, with no padding, in the order declared here: the magic, the eight
+ * counts and then the doubles. It is followed by the name (name_length
+ * bytes, no terminator) and then by the baked block, with its surface
+ * regions written field by field too.
+ *
+ * Every number is little-endian, and the doubles are IEEE 754, so a file
+ * reads the same on any machine.
+ */
+typedef struct track_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t size;
+  uint32_t num_checkpoints;
+  uint32_t num_boxes;
+  uint32_t num_spawns;
+  uint32_t num_regions;
+  uint32_t num_sectors;
+  uint32_t name_length;
+  double verge_width;
+  vector_t min;
+  vector_t max;
+} track_header_t;
+
+/**
+ * The contents of a text track file before it is baked. Optional sections
+ * that were not present in the file are NULL.
+ */
+typedef struct track_source {
+  char *name;
+  double scale;
+  double verge_width;
+  vector_t min;
+  vector_t max;
+  vector_t start_in;
+  vector_t start_out;
+  size_t start_offset;
+  size_t size;
+  vector_t *inner;
+  vector_t *outer;
+  vector_t *centerline;
+  size_t num_checkpoints;
+  vector_t *checkpoints;
+  size_t num_boxes;
+  vector_t *boxes;
+  size_t num_spawns;
+  spawn_t *spawns;
+  size_t num_regions;
+  surface_region_t *regions;
+  size_t num_sectors;
+  size_t *sectors;
+} track_source_t;
+
+static char *copy_string(const char *str) {
+  char *copy = malloc(strlen(str) + 1);
+  assert(copy != NULL);
+  strcpy(copy, str);
+  return copy;
+}
+
+/**
+ * Allocates the track and its block, and points each array into the block.
+ */
+static track_t *track_alloc(size_t size, size_t num_checkpoints,
+                            size_t num_boxes, size_t num_spawns,
+                            size_t num_regions, size_t num_sectors) {
+  track_t *track = malloc(sizeof(track_t));
+  assert(track != NULL);
+  track->name = NULL;
+  track->path = NULL;
+  track->arc = NULL;
+  track->checkpoint_progress = NULL;
+  track->respawns = NULL;
+  track->field = NULL;
+  track->surfaces = NULL;
+  track->wall_tree = NULL;
+  track->origin = VEC_ZERO;
+  track->size = size;
+  track->num_checkpoints = num_checkpoints;
+  track->num_boxes = num_boxes;
+  track->num_spawns = num_spawns;
+  track->num_regions = num_regions;
+  track->num_sectors = num_sectors;
+
+  // inner, outer, centerline, checkpoint pairs and boxes, then one wall
+  // segment per boundary edge
+  size_t num_vectors = 3 * size + 2 * num_checkpoints + num_boxes;
+  track->block_size = num_vectors * sizeof(vector_t) +
+                      2 * size * sizeof(segment_t) +
+                      num_spawns * sizeof(spawn_t) +
+                      num_regions * sizeof(surface_region_t) +
+                      num_sectors * sizeof(uint32_t);
+  track->block = malloc(track->block_size);
+  assert(track->block != NULL);
+
+  vector_t *vectors = track->block;
+  track->inner = vectors;
+  track->outer = track->inner + size;
+  track->centerline = track->outer + size;
+  track->checkpoints = track->centerline + size;
+  track->boxes = track->checkpoints + 2 * num_checkpoints;
+  track->walls = (segment_t *)(track->boxes + num_boxes);
+  track->spawns = (spawn_t *)(track->walls + 2 * size);
+  track->regions = (surface_region_t *)(track->spawns + num_spawns);
+  track->sectors = (uint32_t *)(track->regions + num_regions);
+  return track;
+}
+
+void track_free(track_t *track) {
+  free(track->arc);
+  free(track->checkpoint_progress);
+  free(track->respawns);
+  if (track->field != NULL) {
+    distance_field_free(track->field);
+  }
+  if (track->surfaces != NULL) {
+    surface_map_free(track->surfaces);
+  }
+  if (track->wall_tree != NULL) {
+    wall_bvh_free(track->wall_tree);
+  }
+  free(track->name);
+  free(track->path);
+  free(track->block);
+  free(track);
+}
+
+static void track_source_free(track_source_t *src) {
+  free(src->name);
+  free(src->inner);
+  free(src->outer);
+  free(src->centerline);
+  free(src->checkpoints);
+  free(src->boxes);
+  free(src->spawns);
+  free(src->regions);
+  free(src->sectors);
+}
+
+/**
+ * Makes the wall along the boundary edge from `points[i]` to `points[i + 1]`,
+ * facing the matching vertex on the opposite boundary.
+ */
+static segment_t bake_wall(const vector_t *points, const vector_t *opposite,
+                           size_t size, size_t i) {
+  vector_t p1 = points[i];
+  vector_t p2 = points[(i + 1) % size];
+  // Get wall vector and rotate 90 degrees
+  vector_t normal = vec_subtract(p2, p1);
+  normal = (vector_t){-normal.y, normal.x};
+  normal = vec_multiply(1 / vec_get_length(normal), normal);
+  // Ensuring the normal faces the road
+  if (vec_dot(normal, vec_subtract(opposite[i], p1)) < 0) {
+    normal = vec_negate(normal);
+  }
+  return (segment_t){.start = p1, .end = p2, .normal = normal};
+}
+
+/**
+ * Returns the body rotation that faces along the given direction. Cars face
+ * (sin(theta), -cos(theta)) for a rotation theta.
+ */
+static double heading_rotation(vector_t direction) {
+  return atan2(direction.x, -direction.y);
+}
+
+/**
+ * Returns the number of checkpoints the source bakes into: the listed ones,
+ * or the start line and one per boundary vertex.
+ */
+static size_t source_num_checkpoints(const track_source_t *src) {
+  return src->checkpoints != NULL ? src->num_checkpoints : src->size + 1;
+}
+
+/**
+ * Returns the number of sectors the source bakes into: the listed ones, or
+ * up to DEFAULT_SECTORS of roughly equal checkpoint counts.
+ */
+static size_t source_num_sectors(const track_source_t *src) {
+  if (src->sectors != NULL) {
+    return src->num_sectors;
+  }
+  size_t num_checkpoints = source_num_checkpoints(src);
+  return num_checkpoints < DEFAULT_SECTORS ? num_checkpoints
+                                           : DEFAULT_SECTORS;
+}
+
+static track_t *track_bake(track_source_t *src) {
+  size_t size = src->size;
+  size_t num_checkpoints = source_num_checkpoints(src);
+  size_t num_boxes = src->boxes != NULL
+                         ? src->num_boxes
+                         : (size + BOX_ROW_STRIDE - 1) / BOX_ROW_STRIDE *
+                               BOXES_PER_ROW;
+  size_t num_spawns = src->spawns != NULL ? src->num_spawns : DEFAULT_SPAWNS;
+  size_t num_sectors = source_num_sectors(src);
+  track_t *track = track_alloc(size, num_checkpoints, num_boxes, num_spawns,
+                               src->num_regions, num_sectors);
+  double scale = src->scale;
+
+  track->name = copy_string(src->name != NULL ? src->name : "Untitled");
+  track->verge_width = scale * src->verge_width;
+  track->min = vec_multiply(scale, src->min);
+  track->max = vec_multiply(scale, src->max);
+
+  for (size_t i = 0; i < size; i++) {
+    track->inner[i] = vec_multiply(scale, src->inner[i]);
+    track->outer[i] = vec_multiply(scale, src->outer[i]);
+    if (src->centerline != NULL) {
+      track->centerline[i] = vec_multiply(scale, src->centerline[i]);
+    } else {
+      track->centerline[i] =
+          vec_multiply(0.5, vec_add(track->inner[i], track->outer[i]));
+    }
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    track->walls[i] = bake_wall(track->inner, track->outer, size, i);
+    track->walls[size + i] = bake_wall(track->outer, track->inner, size, i);
+  }
+
+  if (src->checkpoints != NULL) {
+    for (size_t i = 0; i < 2 * num_checkpoints; i++) {
+      track->checkpoints[i] = vec_multiply(scale, src->checkpoints[i]);
+    }
+  } else {
+    track->checkpoints[0] = vec_multiply(scale, src->start_in);
+    track->checkpoints[1] = vec_multiply(scale, src->start_out);
+    for (size_t i = 1; i < num_checkpoints; i++) {
+      size_t idx = (src->start_offset + i - 1) % size;
+      track->checkpoints[2 * i] = track->inner[idx];
+      track->checkpoints[2 * i + 1] = track->outer[idx];
+    }
+  }
+
+  if (src->boxes != NULL) {
+    for (size_t i = 0; i < num_boxes; i++) {
+      track->boxes[i] = vec_multiply(scale, src->boxes[i]);
+    }
+  } else {
+    // Rows of boxes across the road at every other boundary vertex
+    size_t idx = 0;
+    for (size_t i = 0; i < size; i += BOX_ROW_STRIDE) {
+      for (size_t j = 1; j <= BOXES_PER_ROW; j++) {
+        vector_t center =
+            vec_add(vec_multiply(j, track->inner[i]),
+                    vec_multiply(BOXES_PER_ROW + 1 - j, track->outer[i]));
+        track->boxes[idx++] =
+            vec_multiply(1.0 / (BOXES_PER_ROW + 1.0), center);
+      }
+    }
+  }
+
+  if (src->spawns != NULL) {
+    for (size_t i = 0; i < num_spawns; i++) {
+      track->spawns[i].position = vec_multiply(scale, src->spawns[i].position);
+      track->spawns[i].rotation = src->spawns[i].rotation;
+    }
+  } else {
+    // Side by side on the start line, facing the first checkpoint
+    vector_t start_in = track->checkpoints[0];
+    vector_t start_out = track->checkpoints[1];
+    vector_t start = vec_multiply(0.5, vec_add(start_in, start_out));
+    vector_t next = vec_multiply(
+        0.5, vec_add(track->checkpoints[2], track->checkpoints[3]));
+    double rotation = heading_rotation(vec_subtract(next, start));
+    for (size_t i = 0; i < num_spawns; i++) {
+      double t = (i + 1.0) / (num_spawns + 1.0);
+      track->spawns[i].position =
+          vec_add(start_in, vec_multiply(t, vec_subtract(start_out, start_in)));
+      track->spawns[i].rotation = rotation;
+    }
+  }
+
+  for (size_t i = 0; i < src->num_regions; i++) {
+    track->regions[i] = src->regions[i];
+    track->regions[i].min = vec_multiply(scale, src->regions[i].min);
+    track->regions[i].max = vec_multiply(scale, src->regions[i].max);
+  }
+
+  for (size_t i = 0; i < num_sectors; i++) {
+    track->sectors[i] = src->sectors != NULL
+                            ? src->sectors[i]
+                            : i * num_checkpoints / num_sectors;
+  }
+  return track;
+}
+
+/**
+ * Returns the squared distance from a point to the centerline segment starting
+ * at vertex i, and stores the raw arc length of the closest point in `arc`.
+ */
+static double segment_distance(track_t *track, vector_t point, size_t i,
+                               double *arc) {
+  vector_t a = track->centerline[i];
+  vector_t d = vec_subtract(track->centerline[(i + 1) % track->size], a);
+  double seg_length = track->arc[i + 1] - track->arc[i];
+  double t = 0;
+  if (seg_length > 0) {
+    t = vec_dot(vec_subtract(point, a), d) / (seg_length * seg_length);
+    t = fmin(fmax(t, 0), 1);
+  }
+  vector_t diff = vec_subtract(point, vec_add(a, vec_multiply(t, d)));
+  *arc = track->arc[i] + t * seg_length;
+  return vec_dot(diff, diff);
+}
+
+/**
+ * Wraps a raw centerline arc length into progress past the start line.
+ */
+static double wrap_progress(track_t *track, double raw) {
+  double s = fmod(raw - track->start, track->length);
+  return s < 0 ? s + track->length : s;
+}
+
+/**
+ * Projects a point given in track coordinates onto the whole centerline.
+ */
+static double project_local(track_t *track, vector_t point, size_t *segment) {
+  double best = INFINITY;
+  double best_arc = 0;
+  for (size_t i = 0; i < track->size; i++) {
+    double arc;
+    double dist = segment_distance(track, point, i, &arc);
+    if (dist < best) {
+      best = dist;
+      best_arc = arc;
+      *segment = i;
+    }
+  }
+  return wrap_progress(track, best_arc);
+}
+
+/**
+ * Finds the centerline segment containing the given progress by binary
+ * search on the cumulative arc lengths. Stores the raw arc length in `raw`.
+ */
+static size_t find_segment(track_t *track, double progress, double *raw) {
+  double arc = fmod(progress + track->start, track->length);
+  if (arc < 0) {
+    arc += track->length;
+  }
+  size_t lo = 0;
+  size_t hi = track->size;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (track->arc[mid] <= arc) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  *raw = arc;
+  return lo;
+}
+
+/**
+ * Returns the track position of the centerline point at the given progress
+ * and stores the segment it is on.
+ */
+static vector_t local_point_at(track_t *track, double progress,
+                               size_t *segment) {
+  double raw;
+  size_t i = find_segment(track, progress, &raw);
+  vector_t a = track->centerline[i];
+  vector_t b = track->centerline[(i + 1) % track->size];
+  double seg_length = track->arc[i + 1] - track->arc[i];
+  double t = seg_length > 0 ? (raw - track->arc[i]) / seg_length : 0;
+  *segment = i;
+  return vec_add(a, vec_multiply(t, vec_subtract(b, a)));
+}
+
+/**
+ * Builds the arc-length parameterization of the centerline, measures where
+ * the start line and checkpoints fall on it, and bakes the respawn table, the
+ * distance field, the surface map and the tree over the walls.
+ */
+static void track_finish(track_t *track) {
+  size_t size = track->size;
+  track->arc = malloc((size + 1) * sizeof(double));
+  assert(track->arc != NULL);
+  track->arc[0] = 0;
+  for (size_t i = 0; i < size; i++) {
+    vector_t d = vec_subtract(track->centerline[(i + 1) % size],
+                              track->centerline[i]);
+    track->arc[i + 1] = track->arc[i] + vec_get_length(d);
+  }
+  track->length = track->arc[size];
+
+  size_t segment;
+  const vector_t *start = track->checkpoints;
+  track->start = 0;
+  track->start = project_local(
+      track, vec_multiply(0.5, vec_add(start[0], start[1])), &segment);
+
+  track->checkpoint_progress = malloc(track->num_checkpoints * sizeof(double));
+  assert(track->checkpoint_progress != NULL);
+  track->checkpoint_progress[0] = 0;
+  for (size_t i = 1; i < track->num_checkpoints; i++) {
+    const vector_t *line = &track->checkpoints[2 * i];
+    track->checkpoint_progress[i] = project_local(
+        track, vec_multiply(0.5, vec_add(line[0], line[1])), &segment);
+  }
+
+  track->num_respawns = (size_t)ceil(track->length / RESPAWN_SPACING);
+  track->respawns = malloc(track->num_respawns * sizeof(spawn_t));
+  assert(track->respawns != NULL);
+  for (size_t i = 0; i < track->num_respawns; i++) {
+    spawn_t *respawn = &track->respawns[i];
+    respawn->position = local_point_at(track, i * RESPAWN_SPACING, &segment);
+    respawn->rotation =
+        heading_rotation(track_segment_direction(track, segment));
+  }
+
+  track->field = distance_field_init(track->min, track->max,
+                                     DISTANCE_CELL_SIZE, track->inner,
+                                     track->outer, size);
+
+  // Grass off the road and along its edges, then the track's own regions
+  track->surfaces = surface_map_init(track->min, track->max,
+                                     SURFACE_CELL_SIZE, SURFACE_ASPHALT);
+  size_t width = surface_map_get_width(track->surfaces);
+  size_t height = surface_map_get_height(track->surfaces);
+  for (size_t row = 0; row < height; row++) {
+    for (size_t col = 0; col < width; col++) {
+      vector_t center = surface_map_get_cell_center(track->surfaces, col, row);
+      if (distance_field_sample(track->field, center) < track->verge_width) {
+        surface_map_set_cell(track->surfaces, col, row, SURFACE_GRASS);
+      }
+    }
+  }
+  for (size_t i = 0; i < track->num_regions; i++) {
+    surface_map_fill(track->surfaces, track->regions[i]);
+  }
+
+  track->wall_tree = wall_bvh_init(track->walls, 2 * size);
+}
+
+/**
+ * Reads the next token from the file, skipping comments that run from a '#'
+ * to the end of the line. Returns false at the end of the file.
+ */
+static bool read_token(FILE *file, char *token) {
+  while (fscanf(file, "%63s", token) == 1) {
+    if (token[0] != '#') {
+      return true;
+    }
+    int c;
+    while ((c = fgetc(file)) != '\n' && c != EOF) {
+    }
+  }
+  return false;
+}
+
+/**
+ * Reads the rest of the line as a name, so names may contain spaces. Leading
+ * and trailing whitespace and a trailing comment are dropped, as is anything
+ * past the token size.
+ */
+static bool read_name(FILE *file, char *name) {
+  if (fgets(name, TRACK_TOKEN_SIZE, file) == NULL) {
+    return false;
+  }
+  if (strchr(name, '\n') == NULL) {
+    int c;
+    while ((c = fgetc(file)) != '\n' && c != EOF) {
+    }
+  }
+  name[strcspn(name, "#\n")] = '\0';
+  size_t start = strspn(name, " \t\r");
+  size_t end = strlen(name);
+  while (end > start && isspace((unsigned char)name[end - 1])) {
+    end--;
+  }
+  name[end] = '\0';
+  memmove(name, name + start, end - start + 1);
+  return name[0] != '\0';
+}
+
+static bool read_size(FILE *file, size_t *size) {
+  char token[TRACK_TOKEN_SIZE];
+  if (!read_token(file, token)) {
+    return false;
+  }
+  char *end;
+  unsigned long value = strtoul(token, &end, 10);
+  *size = value;
+  return *end == '\0';
+}
+
+/**
+ * Reads the number of entries in a section, which must be at least one and
+ * at most TRACK_MAX_SECTION_SIZE.
+ */
+static bool read_count(FILE *file, size_t *count) {
+  return read_size(file, count) && *count > 0 &&
+         *count <= TRACK_MAX_SECTION_SIZE;
+}
+
+static bool read_doubles(FILE *file, double *values, size_t count) {
+  char token[TRACK_TOKEN_SIZE];
+  for (size_t i = 0; i < count; i++) {
+    if (!read_token(file, token)) {
+      return false;
+    }
+    char *end;
+    values[i] = strtod(token, &end);
+    if (*end != '\0') {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Reads a section header count followed by `count` surface regions, each a
+ * surface name and the corners of its rectangle.
+ */
+static surface_region_t *read_regions(FILE *file, size_t *count) {
+  if (!read_count(file, count)) {
+    return NULL;
+  }
+  surface_region_t *regions = malloc(*count * sizeof(surface_region_t));
+  assert(regions != NULL);
+  char token[TRACK_TOKEN_SIZE];
+  for (size_t i = 0; i < *count; i++) {
+    surface_type_t type;
+    double corners[4];
+    if (!read_token(file, token) || !surface_parse_type(token, &type) ||
+        !read_doubles(file, corners, 4)) {
+      free(regions);
+      return NULL;
+    }
+    regions[i] = (surface_region_t){.min = {corners[0], corners[1]},
+                                    .max = {corners[2], corners[3]},
+                                    .type = type};
+  }
+  return regions;
+}
+
+/**
+ * Reads a section header count followed by `count` sector starts, each the
+ * index of the checkpoint the sector begins at. The first sector must begin
+ * at the start line and the rest must follow in lap order.
+ */
+static size_t *read_sectors(FILE *file, size_t *count) {
+  if (!read_count(file, count)) {
+    return NULL;
+  }
+  size_t *sectors = malloc(*count * sizeof(size_t));
+  assert(sectors != NULL);
+  for (size_t i = 0; i < *count; i++) {
+    if (!read_size(file, &sectors[i]) ||
+        (i == 0 ? sectors[i] != 0 : sectors[i] <= sectors[i - 1])) {
+      free(sectors);
+      return NULL;
+    }
+  }
+  return sectors;
+}
+
+/**
+ * Reads a section header count followed by `count` entries of `stride`
+ * doubles each into a newly allocated array.
+ */
+static double *read_section(FILE *file, size_t *count, size_t stride) {
+  if (!read_count(file, count)) {
+    return NULL;
+  }
+  double *values = malloc(*count * stride * sizeof(double));
+  assert(values != NULL);
+  if (!read_doubles(file, values, *count * stride)) {
+    free(values);
+    return NULL;
+  }
+  return values;
+}
+
+static bool parse_text(FILE *file, track_source_t *src) {
+  char token[TRACK_TOKEN_SIZE];
+  size_t inner_size = 0;
+  size_t outer_size = 0;
+  size_t centerline_size = 0;
+  bool has_bounds = false;
+  bool has_start = false;
+  while (read_token(file, token)) {
+    if (strcmp(token, "name") == 0) {
+      if (!read_name(file, token)) {
+        return false;
+      }
+      free(src->name);
+      src->name = copy_string(token);
+    } else if (strcmp(token, "scale") == 0) {
+      if (!read_doubles(file, &src->scale, 1)) {
+        return false;
+      }
+    } else if (strcmp(token, "verge_width") == 0) {
+      if (!read_doubles(file, &src->verge_width, 1)) {
+        return false;
+      }
+    } else if (strcmp(token, "surfaces") == 0) {
+      free(src->regions);
+      src->regions = read_regions(file, &src->num_regions);
+      if (src->regions == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "bounds") == 0) {
+      double bounds[4];
+      if (!read_doubles(file, bounds, 4)) {
+        return false;
+      }
+      src->min = (vector_t){bounds[0], bounds[1]};
+      src->max = (vector_t){bounds[2], bounds[3]};
+      has_bounds = true;
+    } else if (strcmp(token, "start") == 0) {
+      double start[4];
+      if (!read_doubles(file, start, 4) ||
+          !read_size(file, &src->start_offset)) {
+        return false;
+      }
+      src->start_in = (vector_t){start[0], start[1]};
+      src->start_out = (vector_t){start[2], start[3]};
+      has_start = true;
+    } else if (strcmp(token, "inner") == 0) {
+      free(src->inner);
+      src->inner = (vector_t *)read_section(file, &inner_size, 2);
+      if (src->inner == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "outer") == 0) {
+      free(src->outer);
+      src->outer = (vector_t *)read_section(file, &outer_size, 2);
+      if (src->outer == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "centerline") == 0) {
+      free(src->centerline);
+      src->centerline = (vector_t *)read_section(file, &centerline_size, 2);
+      if (src->centerline == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "checkpoints") == 0) {
+      free(src->checkpoints);
+      src->checkpoints =
+          (vector_t *)read_section(file, &src->num_checkpoints, 4);
+      if (src->checkpoints == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "boxes") == 0) {
+      free(src->boxes);
+      src->boxes = (vector_t *)read_section(file, &src->num_boxes, 2);
+      if (src->boxes == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "sectors") == 0) {
+      free(src->sectors);
+      src->sectors = read_sectors(file, &src->num_sectors);
+      if (src->sectors == NULL) {
+        return false;
+      }
+    } else if (strcmp(token, "spawn") == 0) {
+      free(src->spawns);
+      src->spawns = (spawn_t *)read_section(file, &src->num_spawns, 3);
+      if (src->spawns == NULL) {
+        return false;
+      }
+    } else {
+      fprintf(stderr, "Unknown track section '%s'\n", token);
+      return false;
+    }
+  }
+  src->size = inner_size;
+  if (inner_size < 3 || inner_size != outer_size || !has_bounds) {
+    return false;
+  }
+  if (src->centerline != NULL && centerline_size != inner_size) {
+    return false;
+  }
+  // Without an explicit start line there is nothing to derive checkpoints from
+  if (src->checkpoints == NULL && !has_start) {
+    return false;
+  }
+  if (src->checkpoints != NULL && src->num_checkpoints < 2) {
+    return false;
+  }
+  // Sector starts are increasing, so checking the last one bounds them all
+  return src->sectors == NULL ||
+         src->sectors[src->num_sectors - 1] < source_num_checkpoints(src);
+}
+
+track_t *track_read_text(const char *path) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open track '%s'\n", path);
+    return NULL;
+  }
+  track_source_t src = {.name = NULL, .scale = 1.0};
+  bool parsed = parse_text(file, &src);
+  fclose(file);
+  track_t *track = NULL;
+  if (parsed) {
+    track = track_bake(&src);
+    track_finish(track);
+  } else {
+    fprintf(stderr, "Malformed track '%s'\n", path);
+  }
+  track_source_free(&src);
+  return track;
+}
+
+track_t *track_init(const track_desc_t *desc) {
+  assert(desc->size >= 3);
+  assert(desc->num_checkpoints >= 2);
+  assert(desc->sectors == NULL ||
+         (desc->num_sectors > 0 && desc->sectors[0] == 0 &&
+          desc->sectors[desc->num_sectors - 1] < desc->num_checkpoints));
+  // Baking only reads the source, so the description's arrays can be shared
+  track_source_t src = {
+      .name = (char *)desc->name,
+      .scale = 1.0,
+      .verge_width = desc->verge_width,
+      .min = desc->min,
+      .max = desc->max,
+      .size = desc->size,
+      .inner = (vector_t *)desc->inner,
+      .outer = (vector_t *)desc->outer,
+      .centerline = (vector_t *)desc->centerline,
+      .num_checkpoints = desc->num_checkpoints,
+      .checkpoints = (vector_t *)desc->checkpoints,
+      .num_boxes = desc->num_boxes,
+      .boxes = (vector_t *)desc->boxes,
+      .num_sectors = desc->num_sectors,
+      .sectors = (size_t *)desc->sectors,
+  };
+  track_t *track = track_bake(&src);
+  track_finish(track);
+  return track;
+}
+
+static bool host_is_little_endian(void) {
+  uint16_t one = 1;
+  return *(uint8_t *)&one == 1;
+}
+
+/**
+ * Converts `count` numbers of `width` bytes each between the host's byte
+ * order and little-endian, in place. The conversion is its own inverse.
+ */
+static void swap_to_little_endian(void *data, size_t width, size_t count) {
+  if (host_is_little_endian()) {
+    return;
+  }
+  uint8_t *bytes = data;
+  for (size_t i = 0; i < count; i++, bytes += width) {
+    for (size_t j = 0; j < width / 2; j++) {
+      uint8_t byte = bytes[j];
+      bytes[j] = bytes[width - 1 - j];
+      bytes[width - 1 - j] = byte;
+    }
+  }
+}
+
+/**
+ * Reads `count` little-endian numbers of `width` bytes each.
+ */
+static bool read_numbers(FILE *file, void *data, size_t width, size_t count) {
+  if (fread(data, width, count, file) != count) {
+    return false;
+  }
+  swap_to_little_endian(data, width, count);
+  return true;
+}
+
+/**
+ * Writes `count` numbers of `width` bytes each in little-endian order.
+ */
+static bool write_numbers(FILE *file, const void *data, size_t width,
+                          size_t count) {
+  if (host_is_little_endian()) {
+    return fwrite(data, width, count, file) == count;
+  }
+  const uint8_t *bytes = data;
+  for (size_t i = 0; i < count; i++, bytes += width) {
+    uint8_t number[sizeof(double)];
+    assert(width <= sizeof(number));
+    memcpy(number, bytes, width);
+    swap_to_little_endian(number, width, 1);
+    if (fwrite(number, width, 1, file) != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Reads the header, field by field.
+ */
+static bool read_header(FILE *file, track_header_t *header) {
+  uint32_t counts[8];
+  double doubles[5];
+  if (fread(header->magic, 1, sizeof(header->magic), file) !=
+          sizeof(header->magic) ||
+      !read_numbers(file, counts, sizeof(uint32_t), 8) ||
+      !read_numbers(file, doubles, sizeof(double), 5)) {
+    return false;
+  }
+  header->version = counts[0];
+  header->size = counts[1];
+  header->num_checkpoints = counts[2];
+  header->num_boxes = counts[3];
+  header->num_spawns = counts[4];
+  header->num_regions = counts[5];
+  header->num_sectors = counts[6];
+  header->name_length = counts[7];
+  header->verge_width = doubles[0];
+  header->min = (vector_t){doubles[1], doubles[2]};
+  header->max = (vector_t){doubles[3], doubles[4]};
+  return true;
+}
+
+/**
+ * Returns the number of doubles at the start of the baked block: the
+ * vectors, walls and spawns before the surface regions are made only of
+ * doubles.
+ */
+static size_t block_num_doubles(track_t *track) {
+  size_t num_vectors =
+      3 * track->size + 2 * track->num_checkpoints + track->num_boxes;
+  return (num_vectors * sizeof(vector_t) +
+          2 * track->size * sizeof(segment_t) +
+          track->num_spawns * sizeof(spawn_t)) /
+         sizeof(double);
+}
+
+/**
+ * Checks the header's counts as the text parser and track_init() check a
+ * track's source, and that the rest of the file is exactly as long as the
+ * header says.
+ */
+static bool header_valid(const track_header_t *header, long remaining) {
+  if (memcmp(header->magic, TRACK_MAGIC, sizeof(TRACK_MAGIC)) != 0 ||
+      header->version != TRACK_VERSION || header->size < 3 ||
+      header->num_checkpoints < 2 || header->num_spawns == 0 ||
+      header->num_sectors == 0 || remaining < 0) {
+    return false;
+  }
+  uint64_t num_vectors = 3 * (uint64_t)header->size +
+                         2 * (uint64_t)header->num_checkpoints +
+                         header->num_boxes;
+  uint64_t bytes = header->name_length +
+                   num_vectors * sizeof(vector_t) +
+                   2 * (uint64_t)header->size * sizeof(segment_t) +
+                   (uint64_t)header->num_spawns * sizeof(spawn_t) +
+                   (uint64_t)header->num_regions * TRACK_REGION_BYTES +
+                   (uint64_t)header->num_sectors * sizeof(uint32_t);
+  return bytes == (uint64_t)remaining;
+}
+
+/**
+ * Checks what the header cannot: that the regions are real surfaces and the
+ * sectors start at the start line and follow in lap order.
+ */
+static bool block_valid(track_t *track) {
+  for (size_t i = 0; i < track->num_regions; i++) {
+    if (track->regions[i].type >= NUM_SURFACES) {
+      return false;
+    }
+  }
+  if (track->sectors[0] != 0) {
+    return false;
+  }
+  for (size_t i = 1; i < track->num_sectors; i++) {
+    if (track->sectors[i] <= track->sectors[i - 1]) {
+      return false;
+    }
+  }
+  return track->sectors[track->num_sectors - 1] < track->num_checkpoints;
+}
+
+/**
+ * Reads the name and the baked block into a track allocated for the header.
+ */
+static bool read_body(FILE *file, const track_header_t *header,
+                      track_t *track) {
+  if (fread(track->name, 1, header->name_length, file) !=
+          header->name_length ||
+      !read_numbers(file, track->block, sizeof(double),
+                    block_num_doubles(track))) {
+    return false;
+  }
+  for (size_t i = 0; i < track->num_regions; i++) {
+    double corners[4];
+    uint32_t type;
+    if (!read_numbers(file, corners, sizeof(double), 4) ||
+        !read_numbers(file, &type, sizeof(uint32_t), 1)) {
+      return false;
+    }
+    track->regions[i] = (surface_region_t){.min = {corners[0], corners[1]},
+                                           .max = {corners[2], corners[3]},
+                                           .type = type};
+  }
+  return read_numbers(file, track->sectors, sizeof(uint32_t),
+                      track->num_sectors);
+}
+
+track_t *track_read_binary(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Could not open track '%s'\n", path);
+    return NULL;
+  }
+  track_header_t header;
+  bool valid = read_header(file, &header);
+  if (valid) {
+    long body_start = ftell(file);
+    valid = fseek(file, 0, SEEK_END) == 0 &&
+            header_valid(&header, ftell(file) - body_start) &&
+            fseek(file, body_start, SEEK_SET) == 0;
+  }
+  if (!valid) {
+    fprintf(stderr, "Malformed track '%s'\n", path);
+    fclose(file);
+    return NULL;
+  }
+  track_t *track =
+      track_alloc(header.size, header.num_checkpoints, header.num_boxes,
+                  header.num_spawns, header.num_regions, header.num_sectors);
+  track->verge_width = header.verge_width;
+  track->min = header.min;
+  track->max = header.max;
+  track->name = malloc(header.name_length + 1);
+  assert(track->name != NULL);
+  bool read = read_body(file, &header, track);
+  track->name[read ? header.name_length : 0] = '\0';
+  fclose(file);
+  if (!read || !block_valid(track)) {
+    fprintf(stderr, "Malformed track '%s'\n", path);
+    track_free(track);
+    return NULL;
+  }
+  track_finish(track);
+  return track;
+}
+
+bool track_write_binary(track_t *track, const char *path) {
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return false;
+  }
+  uint32_t name_length = strlen(track->name);
+  uint32_t counts[] = {TRACK_VERSION, track->size, track->num_checkpoints,
+                       track->num_boxes, track->num_spawns, track->num_regions,
+                       track->num_sectors, name_length};
+  double doubles[] = {track->verge_width, track->min.x, track->min.y,
+                      track->max.x, track->max.y};
+  bool written =
+      fwrite(TRACK_MAGIC, 1, sizeof(TRACK_MAGIC), file) ==
+          sizeof(TRACK_MAGIC) &&
+      write_numbers(file, counts, sizeof(uint32_t), 8) &&
+      write_numbers(file, doubles, sizeof(double), 5) &&
+      fwrite(track->name, 1, name_length, file) == name_length &&
+      write_numbers(file, track->block, sizeof(double),
+                    block_num_doubles(track));
+  for (size_t i = 0; written && i < track->num_regions; i++) {
+    surface_region_t region = track->regions[i];
+    double corners[] = {region.min.x, region.min.y, region.max.x,
+                        region.max.y};
+    written = write_numbers(file, corners, sizeof(double), 4) &&
+              write_numbers(file, &region.type, sizeof(uint32_t), 1);
+  }
+  written = written && write_numbers(file, track->sectors, sizeof(uint32_t),
+                                     track->num_sectors);
+  return fclose(file) == 0 && written;
+}
+
+/**
+ * Checks whether the file at the given path starts with the binary magic.
+ */
+static bool is_binary(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (file == NULL) {
+    return false;
+  }
+  char magic[sizeof(TRACK_MAGIC)];
+  bool binary = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                memcmp(magic, TRACK_MAGIC, sizeof(magic)) == 0;
+  fclose(file);
+  return binary;
+}
+
+track_t *track_read(const char *path) {
+  return is_binary(path) ? track_read_binary(path) : track_read_text(path);
+}
+
+track_t *track_load(const char *path) {
+  if (TRACK_CACHE == NULL) {
+    TRACK_CACHE = list_init(TRACK_CACHE_CAPACITY, (free_func_t)track_free);
+  }
+  for (size_t i = 0; i < list_size(TRACK_CACHE); i++) {
+    track_t *track = list_get(TRACK_CACHE, i);
+    if (strcmp(track->path, path) == 0) {
+      return track;
+    }
+  }
+  track_t *track = track_read(path);
+  if (track == NULL) {
+    return NULL;
+  }
+  track->path = copy_string(path);
+  list_add(TRACK_CACHE, track);
+  return track;
+}
+
+void track_cache_destroy(void) {
+  if (TRACK_CACHE != NULL) {
+    list_free(TRACK_CACHE);
+    TRACK_CACHE = NULL;
+  }
+}
+
+const char *track_get_name(track_t *track) { return track->name; }
+
+size_t track_get_size(track_t *track) { return track->size; }
+
+const vector_t *track_get_inner(track_t *track) { return track->inner; }
+
+const vector_t *track_get_outer(track_t *track) { return track->outer; }
+
+const vector_t *track_get_centerline(track_t *track) {
+  return track->centerline;
+}
+
+size_t track_get_num_walls(track_t *track) { return 2 * track->size; }
+
+segment_t track_get_wall(track_t *track, size_t idx) {
+  assert(idx < 2 * track->size);
+  segment_t wall = track->walls[idx];
+  wall.start = vec_add(wall.start, track->origin);
+  wall.end = vec_add(wall.end, track->origin);
+  return wall;
+}
+
+size_t track_get_num_checkpoints(track_t *track) {
+  return track->num_checkpoints;
+}
+
+const vector_t *track_get_checkpoint(track_t *track, size_t idx) {
+  assert(idx < track->num_checkpoints);
+  return &track->checkpoints[2 * idx];
+}
+
+size_t track_get_num_boxes(track_t *track) { return track->num_boxes; }
+
+const vector_t *track_get_boxes(track_t *track) { return track->boxes; }
+
+size_t track_get_num_spawns(track_t *track) { return track->num_spawns; }
+
+spawn_t track_get_spawn(track_t *track, size_t idx) {
+  assert(idx < track->num_spawns);
+  return track->spawns[idx];
+}
+
+spawn_t track_get_grid_slot(track_t *track, size_t idx) {
+  if (idx < track->num_spawns) {
+    return track->spawns[idx];
+  }
+  // Keep the spawn's distance from the centerline, further back along it
+  spawn_t front = track->spawns[idx % track->num_spawns];
+  size_t row = idx / track->num_spawns;
+  size_t segment;
+  double progress = project_local(track, front.position, &segment);
+  vector_t center = local_point_at(track, progress, &segment);
+  vector_t direction = track_segment_direction(track, segment);
+  vector_t normal = {.x = -direction.y, .y = direction.x};
+  double lane = vec_dot(vec_subtract(front.position, center), normal);
+
+  center = local_point_at(track, progress - row * GRID_ROW_SPACING, &segment);
+  direction = track_segment_direction(track, segment);
+  normal = (vector_t){.x = -direction.y, .y = direction.x};
+  return (spawn_t){.position = vec_add(center, vec_multiply(lane, normal)),
+                   .rotation = heading_rotation(direction)};
+}
+
+vector_t track_get_min(track_t *track) { return track->min; }
+
+vector_t track_get_max(track_t *track) { return track->max; }
+
+list_t *track_make_shape(const vector_t *points, size_t size) {
+  list_t *shape = list_init(size, free);
+  for (size_t i = 0; i < size; i++) {
+    vector_t *point = malloc(sizeof(vector_t));
+    assert(point != NULL);
+    *point = points[i];
+    list_add(shape, point);
+  }
+  return shape;
+}
+
+list_t *track_make_background(track_t *track) {
+  vector_t corners[] = {{track->min.x, track->max.y},
+                        {track->min.x, track->min.y},
+                        {track->max.x, track->min.y},
+                        {track->max.x, track->max.y}};
+  return track_make_shape(corners, 4);
+}
+
+void track_set_origin(track_t *track, vector_t origin) {
+  track->origin = origin;
+}
+
+vector_t track_get_origin(track_t *track) { return track->origin; }
+
+double track_get_length(track_t *track) { return track->length; }
+
+double track_get_checkpoint_progress(track_t *track, size_t idx) {
+  assert(idx < track->num_checkpoints);
+  return track->checkpoint_progress[idx];
+}
+
+size_t track_get_num_sectors(track_t *track) { return track->num_sectors; }
+
+size_t track_get_sector_checkpoint(track_t *track, size_t idx) {
+  assert(idx < track->num_sectors);
+  return track->sectors[idx];
+}
+
+double track_get_sector_progress(track_t *track, size_t idx) {
+  return track->checkpoint_progress[track_get_sector_checkpoint(track, idx)];
+}
+
+size_t track_find_checkpoint(track_t *track, double progress) {
+  // Last checkpoint at or before the given progress
+  size_t lo = 0;
+  size_t hi = track->num_checkpoints;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (track->checkpoint_progress[mid] <= progress) {
+      lo = mid;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+double track_project(track_t *track, vector_t point, size_t *segment) {
+  vector_t local = vec_subtract(point, track->origin);
+  if (*segment >= track->size) {
+    return project_local(track, local, segment);
+  }
+  // Walk from the previous segment towards the closest one. Karts move far
+  // less than a segment per tick, so this usually stops after one step.
+  size_t size = track->size;
+  size_t i = *segment;
+  double arc;
+  double best = segment_distance(track, local, i, &arc);
+  for (size_t steps = 0; steps < size; steps++) {
+    double next_arc;
+    double prev_arc;
+    size_t next = (i + 1) % size;
+    size_t prev = (i + size - 1) % size;
+    double next_dist = segment_distance(track, local, next, &next_arc);
+    double prev_dist = segment_distance(track, local, prev, &prev_arc);
+    if (next_dist < best && next_dist <= prev_dist) {
+      i = next;
+      best = next_dist;
+      arc = next_arc;
+    } else if (prev_dist < best) {
+      i = prev;
+      best = prev_dist;
+      arc = prev_arc;
+    } else {
+      break;
+    }
+  }
+  *segment = i;
+  return wrap_progress(track, arc);
+}
+
+size_t track_segment_at(track_t *track, double progress) {
+  double raw;
+  return find_segment(track, progress, &raw);
+}
+
+vector_t track_point_at(track_t *track, double progress) {
+  size_t segment;
+  return vec_add(local_point_at(track, progress, &segment), track->origin);
+}
+
+spawn_t track_respawn_at(track_t *track, double progress) {
+  if (progress < 0 || progress >= track->length) {
+    progress = fmod(progress, track->length);
+    progress += progress < 0 ? track->length : 0;
+  }
+  size_t idx = (size_t)(progress / RESPAWN_SPACING);
+  spawn_t respawn = track->respawns[idx < track->num_respawns
+                                        ? idx
+                                        : track->num_respawns - 1];
+  respawn.position = vec_add(respawn.position, track->origin);
+  return respawn;
+}
+
+vector_t track_segment_direction(track_t *track, size_t segment) {
+  vector_t a = track->centerline[segment];
+  vector_t b = track->centerline[(segment + 1) % track->size];
+  vector_t d = vec_subtract(b, a);
+  double length = vec_get_length(d);
+  return length > 0 ? vec_multiply(1 / length, d) : VEC_ZERO;
+}
+
+vector_t track_direction_at(track_t *track, double progress) {
+  return track_segment_direction(track, track_segment_at(track, progress));
+}
+
+double track_get_distance(track_t *track, vector_t point) {
+  return distance_field_sample(track->field,
+                               vec_subtract(point, track->origin));
+}
+
+vector_t track_get_distance_gradient(track_t *track, vector_t point) {
+  return distance_field_gradient(track->field,
+                                 vec_subtract(point, track->origin));
+}
+
+bool track_on_road(track_t *track, vector_t point) {
+  return track_get_distance(track, point) >= 0;
+}
+
+vector_t track_nearest_on_road(track_t *track, vector_t point, double margin) {
+  vector_t local = distance_field_nearest(
+      track->field, vec_subtract(point, track->origin), margin);
+  return vec_add(local, track->origin);
+}
+
+surface_type_t track_get_surface(track_t *track, vector_t point) {
+  return surface_map_get(track->surfaces, vec_subtract(point, track->origin));
+}
+
+bool track_sweep(track_t *track, vector_t start, vector_t end, double radius,
+                 wall_hit_t *hit) {
+  vector_t origin = track->origin;
+  bool touched = wall_bvh_sweep(track->wall_tree, vec_subtract(start, origin),
+                                vec_subtract(end, origin), radius, hit);
+  if (touched) {
+    hit->center = vec_add(hit->center, origin);
+  }
+  return touched;
+}
+
+size_t track_find_walls(track_t *track, vector_t center, double radius,
+                        size_t *walls, size_t max_walls) {
+  vector_t local = vec_subtract(center, track->origin);
+  vector_t corner = {radius, radius};
+  return wall_bvh_query(track->wall_tree, vec_subtract(local, corner),
+                        vec_add(local, corner), walls, max_walls);
+}
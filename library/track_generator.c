@@ -0,0 +1,269 @@
+#include "track_generator.h"
+#include "vector.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Spline samples per output vertex before resampling by arc length
+const size_t GENERATOR_OVERSAMPLE = 4;
+// How far control points may move around the circle, in corner spacings
+const double MAX_ANGLE_JITTER = 0.25;
+// How far control points may move towards or away from the center, as a
+// fraction of the radius or of the corner spacing, whichever is smaller
+const double MAX_RADIUS_JITTER = 0.5;
+// Corners must be at least this many road widths wide, which keeps the inner
+// boundary from folding over itself
+const double MIN_CORNER_RADIUS = 1.0;
+// Circuits with tighter corners are redrawn with half the wobble, up to this
+// many times before falling back to a circle
+const size_t MAX_GENERATE_ATTEMPTS = 8;
+const size_t GENERATOR_BOXES_PER_ROW = 3;
+const double GENERATOR_VERGE_WIDTH = 8.0;
+
+/**
+ * Returns a pseudo-random number in [0, 1) and advances the state. Uses a
+ * local xorshift generator so tracks do not depend on the global rand() seed.
+ */
+static double next_random(uint32_t *state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x / 4294967296.0;
+}
+
+/**
+ * Returns the point a fraction of the way from a at time ta to b at time tb.
+ */
+static vector_t lerp_knots(vector_t a, vector_t b, double ta, double tb,
+                           double t) {
+  if (tb == ta) {
+    return a;
+  }
+  return vec_add(vec_multiply((tb - t) / (tb - ta), a),
+                 vec_multiply((t - ta) / (tb - ta), b));
+}
+
+/**
+ * Evaluates the centripetal Catmull-Rom segment between p1 and p2 at u in
+ * [0, 1]. Unlike the uniform spline, the centripetal one never forms cusps or
+ * loops when the control points are unevenly spaced.
+ */
+static vector_t catmull_rom(vector_t p0, vector_t p1, vector_t p2, vector_t p3,
+                            double u) {
+  double t0 = 0;
+  double t1 = t0 + sqrt(vec_get_length(vec_subtract(p1, p0)));
+  double t2 = t1 + sqrt(vec_get_length(vec_subtract(p2, p1)));
+  double t3 = t2 + sqrt(vec_get_length(vec_subtract(p3, p2)));
+  double t = t1 + u * (t2 - t1);
+  vector_t a1 = lerp_knots(p0, p1, t0, t1, t);
+  vector_t a2 = lerp_knots(p1, p2, t1, t2, t);
+  vector_t a3 = lerp_knots(p2, p3, t2, t3, t);
+  vector_t b1 = lerp_knots(a1, a2, t0, t2, t);
+  vector_t b2 = lerp_knots(a2, a3, t1, t3, t);
+  return lerp_knots(b1, b2, t1, t2, t);
+}
+
+/**
+ * Scatters the control points around a circle.
+ */
+static vector_t *make_control_points(const track_params_t *params,
+                                     double wobble) {
+  size_t corners = params->corners;
+  vector_t *points = malloc(corners * sizeof(vector_t));
+  assert(points != NULL);
+  uint32_t state = params->seed != 0 ? params->seed : 1;
+  double radius = params->length / (2 * M_PI);
+  double step = 2 * M_PI / corners;
+  double spread = wobble * MAX_RADIUS_JITTER * fmin(radius, radius * step);
+  for (size_t i = 0; i < corners; i++) {
+    double angle = step * (i + wobble * MAX_ANGLE_JITTER *
+                                   (2 * next_random(&state) - 1));
+    double r = radius + spread * (2 * next_random(&state) - 1);
+    points[i] = (vector_t){r * cos(angle), r * sin(angle)};
+  }
+  return points;
+}
+
+/**
+ * Samples the closed spline through the control points into `size` vertices
+ * spaced evenly along it, scaled so the loop has the requested length.
+ */
+static vector_t *make_centerline(const track_params_t *params, double wobble) {
+  size_t corners = params->corners;
+  vector_t *controls = make_control_points(params, wobble);
+  size_t num_samples = params->size * GENERATOR_OVERSAMPLE;
+  vector_t *samples = malloc((num_samples + 1) * sizeof(vector_t));
+  double *arc = malloc((num_samples + 1) * sizeof(double));
+  assert(samples != NULL && arc != NULL);
+  for (size_t i = 0; i <= num_samples; i++) {
+    double u = (double)(i % num_samples) * corners / num_samples;
+    size_t k = (size_t)u;
+    samples[i] = catmull_rom(controls[(k + corners - 1) % corners],
+                             controls[k], controls[(k + 1) % corners],
+                             controls[(k + 2) % corners], u - k);
+    if (i > 0) {
+      vector_t step = vec_subtract(samples[i], samples[i - 1]);
+      arc[i] = arc[i - 1] + vec_get_length(step);
+    } else {
+      arc[i] = 0;
+    }
+  }
+  free(controls);
+
+  double scale = params->length / arc[num_samples];
+  vector_t *centerline = malloc(params->size * sizeof(vector_t));
+  assert(centerline != NULL);
+  size_t j = 0;
+  for (size_t i = 0; i < params->size; i++) {
+    double target = arc[num_samples] * i / params->size;
+    while (arc[j + 1] < target) {
+      j++;
+    }
+    double span = arc[j + 1] - arc[j];
+    double t = span > 0 ? (target - arc[j]) / span : 0;
+    vector_t point =
+        vec_add(samples[j],
+                vec_multiply(t, vec_subtract(samples[j + 1], samples[j])));
+    centerline[i] = vec_multiply(scale, point);
+  }
+  free(samples);
+  free(arc);
+  return centerline;
+}
+
+/**
+ * Places `size` vertices evenly around a circle with the lap length as its
+ * circumference, whose corners are as wide as a circuit of that length can
+ * have.
+ */
+static vector_t *make_circle(const track_params_t *params) {
+  vector_t *centerline = malloc(params->size * sizeof(vector_t));
+  assert(centerline != NULL);
+  double radius = params->length / (2 * M_PI);
+  for (size_t i = 0; i < params->size; i++) {
+    double angle = 2 * M_PI * i / params->size;
+    centerline[i] = (vector_t){radius * cos(angle), radius * sin(angle)};
+  }
+  return centerline;
+}
+
+/**
+ * Returns the radius of the tightest corner on the closed polyline, measured
+ * by the circle through each vertex and its neighbors.
+ */
+static double tightest_corner(const vector_t *points, size_t size) {
+  double tightest = INFINITY;
+  for (size_t i = 0; i < size; i++) {
+    vector_t a = points[(i + size - 1) % size];
+    vector_t b = points[i];
+    vector_t c = points[(i + 1) % size];
+    double cross = fabs(vec_cross(vec_subtract(b, a), vec_subtract(c, a)));
+    if (cross > 0) {
+      double ab = vec_get_length(vec_subtract(b, a));
+      double bc = vec_get_length(vec_subtract(c, b));
+      double ca = vec_get_length(vec_subtract(a, c));
+      tightest = fmin(tightest, ab * bc * ca / (2 * cross));
+    }
+  }
+  return tightest;
+}
+
+track_t *track_generate(const track_params_t *params) {
+  assert(params->corners >= 3);
+  // Even a circle would be too tight for the road
+  assert(params->length >= 2 * M_PI * MIN_CORNER_RADIUS * params->width);
+  assert(params->size >= params->corners);
+  assert(params->num_checkpoints >= 2 &&
+         params->num_checkpoints <= params->size);
+  assert(params->num_box_rows <= params->size);
+  size_t size = params->size;
+  double wobble = fmin(fmax(params->wobble, 0), 1);
+  vector_t *centerline = make_centerline(params, wobble);
+  double min_radius = MIN_CORNER_RADIUS * params->width;
+  for (size_t attempt = 1; attempt <= MAX_GENERATE_ATTEMPTS &&
+                           tightest_corner(centerline, size) < min_radius;
+       attempt++) {
+    free(centerline);
+    wobble *= 0.5;
+    centerline = attempt < MAX_GENERATE_ATTEMPTS
+                     ? make_centerline(params, wobble)
+                     : make_circle(params);
+  }
+
+  // The inner boundary is on the side of the loop's interior
+  double area = 0;
+  for (size_t i = 0; i < size; i++) {
+    vector_t a = centerline[i];
+    vector_t b = centerline[(i + 1) % size];
+    area += a.x * b.y - b.x * a.y;
+  }
+  double side = area > 0 ? 0.5 * params->width : -0.5 * params->width;
+
+  vector_t *inner = malloc(size * sizeof(vector_t));
+  vector_t *outer = malloc(size * sizeof(vector_t));
+  assert(inner != NULL && outer != NULL);
+  vector_t min = {INFINITY, INFINITY};
+  vector_t max = {-INFINITY, -INFINITY};
+  for (size_t i = 0; i < size; i++) {
+    vector_t tangent = vec_subtract(centerline[(i + 1) % size],
+                                    centerline[(i + size - 1) % size]);
+    tangent = vec_multiply(1 / vec_get_length(tangent), tangent);
+    vector_t offset = vec_multiply(side, (vector_t){-tangent.y, tangent.x});
+    inner[i] = vec_add(centerline[i], offset);
+    outer[i] = vec_subtract(centerline[i], offset);
+    min.x = fmin(min.x, fmin(inner[i].x, outer[i].x));
+    min.y = fmin(min.y, fmin(inner[i].y, outer[i].y));
+    max.x = fmax(max.x, fmax(inner[i].x, outer[i].x));
+    max.y = fmax(max.y, fmax(inner[i].y, outer[i].y));
+  }
+  // Leave a road's width of grass around the outside wall
+  vector_t margin = {params->width, params->width};
+  min = vec_subtract(min, margin);
+  max = vec_add(max, margin);
+
+  size_t num_checkpoints = params->num_checkpoints;
+  vector_t *checkpoints = malloc(2 * num_checkpoints * sizeof(vector_t));
+  assert(checkpoints != NULL);
+  for (size_t i = 0; i < num_checkpoints; i++) {
+    size_t idx = i * size / num_checkpoints;
+    checkpoints[2 * i] = inner[idx];
+    checkpoints[2 * i + 1] = outer[idx];
+  }
+
+  // Rows of boxes spread evenly around the lap, clear of the start line
+  size_t num_boxes = params->num_box_rows * GENERATOR_BOXES_PER_ROW;
+  vector_t *boxes = malloc((num_boxes + 1) * sizeof(vector_t));
+  assert(boxes != NULL);
+  for (size_t row = 0; row < params->num_box_rows; row++) {
+    size_t idx = (2 * row + 1) * size / (2 * params->num_box_rows);
+    for (size_t j = 0; j < GENERATOR_BOXES_PER_ROW; j++) {
+      double t = (j + 1.0) / (GENERATOR_BOXES_PER_ROW + 1.0);
+      boxes[row * GENERATOR_BOXES_PER_ROW + j] = vec_add(
+          inner[idx], vec_multiply(t, vec_subtract(outer[idx], inner[idx])));
+    }
+  }
+
+  track_desc_t desc = {
+      .name = "Generated",
+      .verge_width = GENERATOR_VERGE_WIDTH,
+      .min = min,
+      .max = max,
+      .size = size,
+      .inner = inner,
+      .outer = outer,
+      .centerline = centerline,
+      .num_checkpoints = num_checkpoints,
+      .checkpoints = checkpoints,
+      .num_boxes = num_boxes,
+      .boxes = boxes,
+  };
+  track_t *track = track_init(&desc);
+  free(inner);
+  free(outer);
+  free(centerline);
+  free(checkpoints);
+  free(boxes);
+  return track;
+}
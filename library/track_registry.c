@@ -0,0 +1,62 @@
+#include "track_registry.h"
+#include "asset_cache.h"
+#include "track.h"
+#include <assert.h>
+
+#define NUM_TRACKS 3
+
+static const track_entry_t TRACKS[NUM_TRACKS] = {
+    {.name = "Caltech",
+     .track_path = "assets/tracks/caltech.trk",
+     .background_path = "assets/new_track.png",
+     .minimap_path = "assets/minimap.png",
+     .ghost_path = "assets/ghosts/caltech.ghost"},
+    {.name = "Caltech Sketch",
+     .track_path = "assets/tracks/caltech.trk",
+     .background_path = "assets/track4.png",
+     .minimap_path = "assets/track4.png",
+     .ghost_path = "assets/ghosts/caltech.ghost"},
+    {.name = "Caltech Classic",
+     .track_path = "assets/tracks/caltech_classic.trk",
+     .background_path = "assets/track5.png",
+     .minimap_path = "assets/track5.png",
+     .ghost_path = "assets/ghosts/caltech_classic.ghost"},
+};
+
+typedef enum {
+  PREFETCH_GEOMETRY,
+  PREFETCH_BACKGROUND,
+  PREFETCH_MINIMAP,
+  PREFETCH_DONE
+} prefetch_stage_t;
+
+// How far each track has been prefetched. Resources stay in their caches
+// until the game exits, so a track never has to be fetched twice.
+static prefetch_stage_t PREFETCHED[NUM_TRACKS];
+
+size_t track_registry_size(void) { return NUM_TRACKS; }
+
+const track_entry_t *track_registry_get(size_t idx) {
+  assert(idx < NUM_TRACKS);
+  return &TRACKS[idx];
+}
+
+bool track_registry_prefetch(size_t idx) {
+  assert(idx < NUM_TRACKS);
+  const track_entry_t *entry = &TRACKS[idx];
+  switch (PREFETCHED[idx]) {
+  case PREFETCH_GEOMETRY:
+    track_load(entry->track_path);
+    break;
+  case PREFETCH_BACKGROUND:
+    asset_cache_obj_get_or_create(ASSET_IMAGE, entry->background_path);
+    break;
+  case PREFETCH_MINIMAP:
+    asset_cache_obj_get_or_create(ASSET_IMAGE, entry->minimap_path);
+    break;
+  case PREFETCH_DONE:
+    return true;
+  }
+  PREFETCHED[idx]++;
+  return PREFETCHED[idx] == PREFETCH_DONE;
+}
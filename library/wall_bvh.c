@@ -0,0 +1,303 @@
+#include "wall_bvh.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// The most walls in a leaf; boxes with more are split
+const size_t WALL_LEAF_SIZE = 4;
+// Deep enough for any tree of median splits that fits in memory
+#define WALL_STACK_SIZE 64
+
+typedef struct bvh_node {
+  vector_t min;
+  vector_t max;
+  // A leaf holds walls[first] up to walls[first + count]. The first child of
+  // an inner node follows it in the array, and `right` is the second.
+  size_t first;
+  size_t count;
+  size_t right;
+} bvh_node_t;
+
+// A wall and where it was in the array the tree was built from
+typedef struct bvh_wall {
+  segment_t segment;
+  size_t index;
+} bvh_wall_t;
+
+struct wall_bvh {
+  // Sorted so each leaf's walls are next to each other
+  bvh_wall_t *walls;
+  size_t num_walls;
+  bvh_node_t *nodes;
+  size_t num_nodes;
+};
+
+static vector_t midpoint(const void *wall) {
+  segment_t segment = ((const bvh_wall_t *)wall)->segment;
+  return vec_multiply(0.5, vec_add(segment.start, segment.end));
+}
+
+static int compare_x(const void *a, const void *b) {
+  double xa = midpoint(a).x;
+  double xb = midpoint(b).x;
+  return (xa > xb) - (xa < xb);
+}
+
+static int compare_y(const void *a, const void *b) {
+  double ya = midpoint(a).y;
+  double yb = midpoint(b).y;
+  return (ya > yb) - (ya < yb);
+}
+
+/**
+ * Builds the subtree over walls[first] up to walls[first + count], and
+ * returns the index of its root.
+ */
+static size_t build(wall_bvh_t *bvh, size_t first, size_t count) {
+  size_t idx = bvh->num_nodes++;
+  vector_t min = {INFINITY, INFINITY};
+  vector_t max = {-INFINITY, -INFINITY};
+  vector_t mid_min = min;
+  vector_t mid_max = max;
+  for (size_t i = first; i < first + count; i++) {
+    segment_t wall = bvh->walls[i].segment;
+    min.x = fmin(min.x, fmin(wall.start.x, wall.end.x));
+    min.y = fmin(min.y, fmin(wall.start.y, wall.end.y));
+    max.x = fmax(max.x, fmax(wall.start.x, wall.end.x));
+    max.y = fmax(max.y, fmax(wall.start.y, wall.end.y));
+    vector_t mid = midpoint(&bvh->walls[i]);
+    mid_min = (vector_t){fmin(mid_min.x, mid.x), fmin(mid_min.y, mid.y)};
+    mid_max = (vector_t){fmax(mid_max.x, mid.x), fmax(mid_max.y, mid.y)};
+  }
+  bvh->nodes[idx].min = min;
+  bvh->nodes[idx].max = max;
+  bvh->nodes[idx].first = first;
+  if (count <= WALL_LEAF_SIZE) {
+    bvh->nodes[idx].count = count;
+    return idx;
+  }
+  bool wide = mid_max.x - mid_min.x >= mid_max.y - mid_min.y;
+  qsort(&bvh->walls[first], count, sizeof(bvh_wall_t),
+        wide ? compare_x : compare_y);
+  size_t half = count / 2;
+  bvh->nodes[idx].count = 0;
+  build(bvh, first, half);
+  bvh->nodes[idx].right = build(bvh, first + half, count - half);
+  return idx;
+}
+
+wall_bvh_t *wall_bvh_init(const segment_t *walls, size_t num_walls) {
+  wall_bvh_t *bvh = malloc(sizeof(wall_bvh_t));
+  assert(bvh != NULL);
+  bvh->num_walls = num_walls;
+  bvh->walls = malloc((num_walls + 1) * sizeof(bvh_wall_t));
+  // A tree of n leaves has 2n - 1 nodes, and there is a leaf per wall at
+  // most
+  bvh->nodes = malloc(2 * (num_walls + 1) * sizeof(bvh_node_t));
+  assert(bvh->walls != NULL && bvh->nodes != NULL);
+  for (size_t i = 0; i < num_walls; i++) {
+    bvh->walls[i] = (bvh_wall_t){.segment = walls[i], .index = i};
+  }
+  bvh->num_nodes = 0;
+  build(bvh, 0, num_walls);
+  return bvh;
+}
+
+void wall_bvh_free(wall_bvh_t *bvh) {
+  free(bvh->walls);
+  free(bvh->nodes);
+  free(bvh);
+}
+
+/**
+ * Whether the path from start along d, up to time t_max, crosses a node's
+ * box grown by the given radius.
+ */
+static bool crosses_box(const bvh_node_t *node, vector_t start, vector_t d,
+                        double radius, double t_max) {
+  double t_min = 0;
+  double starts[] = {start.x, start.y};
+  double ds[] = {d.x, d.y};
+  double mins[] = {node->min.x - radius, node->min.y - radius};
+  double maxes[] = {node->max.x + radius, node->max.y + radius};
+  for (size_t axis = 0; axis < 2; axis++) {
+    if (ds[axis] == 0) {
+      if (starts[axis] < mins[axis] || starts[axis] > maxes[axis]) {
+        return false;
+      }
+      continue;
+    }
+    double t1 = (mins[axis] - starts[axis]) / ds[axis];
+    double t2 = (maxes[axis] - starts[axis]) / ds[axis];
+    t_min = fmax(t_min, fmin(t1, t2));
+    t_max = fmin(t_max, fmax(t1, t2));
+    if (t_min > t_max) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * Finds when a circle moving from start along d first touches the end of a
+ * wall at the given point, if it does by time t_max.
+ */
+static bool sweep_end(vector_t point, vector_t start, vector_t d,
+                      double radius, double *t_max, vector_t *normal) {
+  vector_t m = vec_subtract(start, point);
+  double b = vec_dot(m, d);
+  if (b >= 0) {
+    // Not moving towards the point
+    return false;
+  }
+  double c = vec_dot(m, m) - radius * radius;
+  double t = 0;
+  if (c > 0) {
+    double a = vec_dot(d, d);
+    double discriminant = b * b - a * c;
+    if (discriminant < 0) {
+      return false;
+    }
+    t = (-b - sqrt(discriminant)) / a;
+  }
+  if (t > *t_max) {
+    return false;
+  }
+  vector_t away = vec_add(m, vec_multiply(t, d));
+  double distance = vec_get_length(away);
+  if (distance == 0) {
+    return false;
+  }
+  *t_max = t;
+  *normal = vec_multiply(1 / distance, away);
+  return true;
+}
+
+/**
+ * Finds when a circle moving from start along d first touches a wall while
+ * moving towards it, if it does by time t_max: either the side of the wall
+ * facing the circle, or one of its ends.
+ */
+static bool sweep_wall(segment_t wall, vector_t start, vector_t d,
+                       double radius, double *t_max, vector_t *normal) {
+  vector_t along = vec_subtract(wall.end, wall.start);
+  double length = vec_get_length(along);
+  if (length > 0) {
+    vector_t unit = vec_multiply(1 / length, along);
+    vector_t side = {-unit.y, unit.x};
+    vector_t offset = vec_subtract(start, wall.start);
+    double height = vec_dot(offset, side);
+    if (height < 0) {
+      side = vec_negate(side);
+      height = -height;
+    }
+    double approach = vec_dot(d, side);
+    if (height >= radius && approach >= 0) {
+      // Moving away from the line through the wall, and clear of it
+      return false;
+    }
+    double t = height < radius ? 0 : (radius - height) / approach;
+    vector_t contact = vec_add(offset, vec_multiply(t, d));
+    double foot = vec_dot(contact, unit);
+    if (foot >= 0 && foot <= length) {
+      if (approach >= 0 || t > *t_max) {
+        // Moving along or away from a wall it already touches, or too late
+        return false;
+      }
+      *t_max = t;
+      *normal = side;
+      return true;
+    }
+  }
+  bool hit = sweep_end(wall.start, start, d, radius, t_max, normal);
+  return sweep_end(wall.end, start, d, radius, t_max, normal) || hit;
+}
+
+bool wall_bvh_sweep(wall_bvh_t *bvh, vector_t start, vector_t end,
+                    double radius, wall_hit_t *hit) {
+  if (bvh->num_walls == 0) {
+    return false;
+  }
+  vector_t d = vec_subtract(end, start);
+  double t_max = 1;
+  size_t found = bvh->num_walls;
+  vector_t normal = VEC_ZERO;
+  size_t stack[WALL_STACK_SIZE];
+  size_t depth = 0;
+  stack[depth++] = 0;
+  while (depth > 0) {
+    size_t idx = stack[--depth];
+    const bvh_node_t *node = &bvh->nodes[idx];
+    if (!crosses_box(node, start, d, radius, t_max)) {
+      continue;
+    }
+    if (node->count == 0) {
+      assert(depth + 2 <= WALL_STACK_SIZE);
+      stack[depth++] = node->right;
+      stack[depth++] = idx + 1;
+      continue;
+    }
+    for (size_t i = node->first; i < node->first + node->count; i++) {
+      segment_t wall = bvh->walls[i].segment;
+      if (sweep_wall(wall, start, d, radius, &t_max, &normal)) {
+        found = i;
+      }
+    }
+  }
+  if (found == bvh->num_walls) {
+    return false;
+  }
+  hit->time = t_max;
+  hit->center = vec_add(start, vec_multiply(t_max, d));
+  hit->normal = normal;
+  hit->wall = bvh->walls[found].index;
+  return true;
+}
+
+/**
+ * Whether two axis-aligned boxes overlap.
+ */
+static bool boxes_overlap(vector_t min1, vector_t max1, vector_t min2,
+                          vector_t max2) {
+  return min1.x <= max2.x && min2.x <= max1.x && min1.y <= max2.y &&
+         min2.y <= max1.y;
+}
+
+size_t wall_bvh_query(wall_bvh_t *bvh, vector_t min, vector_t max,
+                      size_t *walls, size_t max_walls) {
+  if (bvh->num_walls == 0) {
+    return 0;
+  }
+  size_t found = 0;
+  size_t stack[WALL_STACK_SIZE];
+  size_t depth = 0;
+  stack[depth++] = 0;
+  while (depth > 0) {
+    size_t idx = stack[--depth];
+    const bvh_node_t *node = &bvh->nodes[idx];
+    if (!boxes_overlap(node->min, node->max, min, max)) {
+      continue;
+    }
+    if (node->count == 0) {
+      assert(depth + 2 <= WALL_STACK_SIZE);
+      stack[depth++] = node->right;
+      stack[depth++] = idx + 1;
+      continue;
+    }
+    for (size_t i = node->first; i < node->first + node->count; i++) {
+      segment_t wall = bvh->walls[i].segment;
+      vector_t wall_min = {fmin(wall.start.x, wall.end.x),
+                           fmin(wall.start.y, wall.end.y)};
+      vector_t wall_max = {fmax(wall.start.x, wall.end.x),
+                           fmax(wall.start.y, wall.end.y)};
+      if (!boxes_overlap(wall_min, wall_max, min, max)) {
+        continue;
+      }
+      if (found < max_walls) {
+        walls[found] = bvh->walls[i].index;
+      }
+      found++;
+    }
+  }
+  return found;
+}
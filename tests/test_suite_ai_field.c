@@ -0,0 +1,264 @@
+#include "ai_field.h"
+#include "car.h"
+#include "checkpoints.h"
+#include "color.h"
+#include "polygon.h"
+#include "scene.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *FIELD_TRACK = "assets/tracks/caltech.trk";
+const double FIELD_DT = 1.0 / 60;
+
+/**
+ * Puts a kart of the given type in a grid slot, with the forces and
+ * checkpoint state a race gives it.
+ */
+body_t *add_kart(scene_t *scene, track_t *track, car_type_t type,
+                 size_t slot) {
+  body_t *car = make_car(type);
+  spawn_t spawn = track_get_grid_slot(track, slot);
+  body_set_centroid(car, spawn.position);
+  body_set_rotation(car, spawn.rotation);
+  scene_add_body(scene, car);
+  create_surface_forces(scene, track, car);
+  create_vehicle_controller(scene, car);
+  create_wall_collision(scene, track, car, 1);
+  car_set_checkpoint_state(car, checkpoint_state_init(track));
+  return car;
+}
+
+// Tests that karts with the same limits share a racing line
+void test_shared_lines() {
+  track_t *track = track_read_text(FIELD_TRACK);
+  scene_t *scene = scene_init();
+  ai_field_t *field = ai_field_init(track, 3);
+  body_t *karts[] = {add_kart(scene, track, F1, 0),
+                     add_kart(scene, track, F1, 1),
+                     add_kart(scene, track, (F1 + 1) % 3, 2)};
+  for (size_t i = 0; i < 3; i++) {
+    assert(ai_field_add(field, karts[i], 1) == i);
+    assert(ai_field_get_car(field, i) == karts[i]);
+  }
+  assert(ai_field_size(field) == 3);
+  assert(ai_field_get_line(field, 0) == ai_field_get_line(field, 1));
+  assert(ai_field_get_line(field, 0) != ai_field_get_line(field, 2));
+  ai_field_free(field);
+  scene_free(scene);
+  track_free(track);
+}
+
+// Tests that a field of karts drives off the grid and stays on the road
+void test_field_drives() {
+  track_t *track = track_read_text(FIELD_TRACK);
+  scene_t *scene = scene_init();
+  size_t num_karts = 4;
+  ai_field_t *field = ai_field_init(track, num_karts);
+  for (size_t i = 0; i < num_karts; i++) {
+    ai_field_add(field, add_kart(scene, track, i % 3, i), 1 - 0.05 * i);
+  }
+  for (size_t tick = 0; tick < 30 / FIELD_DT; tick++) {
+    scene_tick(scene, FIELD_DT);
+    for (size_t i = 0; i < num_karts; i++) {
+      body_t *car = ai_field_get_car(field, i);
+      checkpoint_state_update(car_get_checkpoint_state(car), car);
+      assert(track_on_road(track, body_get_centroid(car)));
+    }
+    ai_field_update(field, FIELD_DT);
+  }
+  // Well round the first corners by now
+  for (size_t i = 0; i < num_karts; i++) {
+    body_t *car = ai_field_get_car(field, i);
+    assert(get_lap_progress(car_get_checkpoint_state(car)) > 3000);
+  }
+  ai_field_free(field);
+  scene_free(scene);
+  track_free(track);
+}
+
+// Tests that a stunned kart is left alone
+void test_stunned_kart() {
+  track_t *track = track_read_text(FIELD_TRACK);
+  scene_t *scene = scene_init();
+  ai_field_t *field = ai_field_init(track, 1);
+  body_t *car = add_kart(scene, track, F1, 0);
+  ai_field_add(field, car, 1);
+  timer_wheel_t *timers = timer_wheel_init(FIELD_DT, 8);
+  car_start_effect(car, timers, EFFECT_STUN, FIELD_DT);
+  ai_field_update(field, FIELD_DT);
+  scene_tick(scene, FIELD_DT);
+  assert(vec_equal(body_get_velocity(car), VEC_ZERO));
+  timer_wheel_advance(timers, FIELD_DT);
+  assert(!car_has_effect(car, EFFECT_STUN));
+  ai_field_update(field, FIELD_DT);
+  assert(car_get_controls(car).throttle > 0);
+  scene_tick(scene, FIELD_DT);
+  assert(vec_get_length(body_get_velocity(car)) > 0);
+  timer_wheel_free(timers);
+  ai_field_free(field);
+  scene_free(scene);
+  track_free(track);
+}
+
+/**
+ * Returns a small block most of the way from a kart standing still to the
+ * point on its racing line it aims for.
+ */
+body_t *block_kart(ai_field_t *field, size_t idx) {
+  body_t *car = ai_field_get_car(field, idx);
+  checkpoint_state_t *checkpoint_state = car_get_checkpoint_state(car);
+  vector_t target = racing_line_point_at(ai_field_get_line(field, idx),
+                                         get_progress(checkpoint_state) + 80);
+  vector_t start = body_get_centroid(car);
+  vector_t center =
+      vec_add(start, vec_multiply(0.8, vec_subtract(target, start)));
+  return body_init(make_rectangle(center, 10, 10), 1, get_blue());
+}
+
+// Tests that karts aim around items, taking turns when short of time
+void test_avoid_items() {
+  track_t *track = track_read_text(FIELD_TRACK);
+  scene_t *scene = scene_init();
+  size_t slots[] = {0, 4};
+  ai_field_t *field = ai_field_init(track, 2);
+  for (size_t i = 0; i < 2; i++) {
+    body_t *car = add_kart(scene, track, F1, slots[i]);
+    checkpoint_state_update(car_get_checkpoint_state(car), car);
+    ai_field_add(field, car, 1);
+  }
+  ai_field_update(field, 0);
+  for (size_t i = 0; i < 2; i++) {
+    assert(ai_field_get_aim_offset(field, i) == 0);
+  }
+  body_t *blocks[] = {block_kart(field, 0), block_kart(field, 1)};
+
+  // With no time to spare, one kart is planned each update
+  ai_field_set_perception_budget(field, 1e-9);
+  for (size_t update = 0; update < 2; update++) {
+    for (size_t i = 0; i < 2; i++) {
+      ai_field_add_obstacle(field, blocks[i], OBSTACLE_HAZARD);
+    }
+    ai_field_update(field, 0);
+    for (size_t i = 0; i < 2; i++) {
+      assert((ai_field_get_aim_offset(field, i) != 0) == (i <= update));
+    }
+  }
+  // Once the items are gone the karts return to the line
+  ai_field_set_perception_budget(field, 0);
+  ai_field_update(field, 0);
+  for (size_t i = 0; i < 2; i++) {
+    assert(ai_field_get_aim_offset(field, i) == 0);
+    body_free(blocks[i]);
+  }
+  ai_field_free(field);
+  scene_free(scene);
+  track_free(track);
+}
+
+/**
+ * Returns how long a kart takes to drive a lap from pole, simulated around
+ * the given focus.
+ */
+double time_lap(track_t *track, body_t *focus) {
+  scene_t *scene = scene_init();
+  ai_field_t *field = ai_field_init(track, 1);
+  body_t *car = add_kart(scene, track, F1, 0);
+  ai_field_add(field, car, 1);
+  ai_field_set_focus(field, focus);
+  checkpoint_state_t *checkpoint_state = car_get_checkpoint_state(car);
+  double time = 0;
+  while (!get_lap_over(checkpoint_state)) {
+    assert(time < 300);
+    scene_tick(scene, FIELD_DT);
+    checkpoint_state_update(checkpoint_state, car);
+    ai_field_update(field, FIELD_DT);
+    assert(ai_field_is_gliding(field, 0) == (focus != NULL));
+    time += FIELD_DT;
+  }
+  ai_field_free(field);
+  scene_free(scene);
+  return time;
+}
+
+// Tests that a kart far from the focus glides round a lap about as fast as
+// it drives one
+void test_glide_lap() {
+  track_t *track = track_read_text(FIELD_TRACK);
+  body_t *focus =
+      body_init(make_rectangle((vector_t){-1e5, -1e5}, 10, 10), 1,
+                get_blue());
+  double driven = time_lap(track, NULL);
+  double glided = time_lap(track, focus);
+  assert(fabs(glided - driven) < 0.05 * driven);
+  body_free(focus);
+  track_free(track);
+}
+
+// Tests that karts are simulated again near the focus and each other
+void test_glide_switch() {
+  track_t *track = track_read_text(FIELD_TRACK);
+  scene_t *scene = scene_init();
+  body_t *focus =
+      body_init(make_rectangle((vector_t){-1e5, -1e5}, 10, 10), 1,
+                get_blue());
+  ai_field_t *field = ai_field_init(track, 2);
+  size_t slots[] = {0, 8};
+  for (size_t i = 0; i < 2; i++) {
+    body_t *car = add_kart(scene, track, F1, slots[i]);
+    checkpoint_state_update(car_get_checkpoint_state(car), car);
+    ai_field_add(field, car, 1);
+  }
+  ai_field_set_focus(field, focus);
+  ai_field_update(field, FIELD_DT);
+  for (size_t i = 0; i < 2; i++) {
+    assert(ai_field_is_gliding(field, i));
+    assert(body_is_kinematic(ai_field_get_car(field, i)));
+  }
+
+  // The kart behind is let go near the other
+  body_t *back = ai_field_get_car(field, 1);
+  body_set_centroid(back, vec_add(body_get_centroid(ai_field_get_car(field, 0)),
+                                  (vector_t){0, -150}));
+  ai_field_update(field, FIELD_DT);
+  assert(ai_field_is_gliding(field, 0) == false);
+  assert(ai_field_is_gliding(field, 1) == false);
+  assert(!body_is_kinematic(back));
+  ai_field_free(field);
+
+  // and dropping the focus simulates every kart
+  field = ai_field_init(track, 1);
+  ai_field_add(field, back, 1);
+  ai_field_set_focus(field, focus);
+  ai_field_update(field, FIELD_DT);
+  assert(body_is_kinematic(back));
+  vector_t velocity = body_get_velocity(back);
+  ai_field_set_focus(field, NULL);
+  assert(!body_is_kinematic(back));
+  assert(vec_equal(body_get_velocity(back), velocity));
+  ai_field_free(field);
+  body_free(focus);
+  scene_free(scene);
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_shared_lines)
+  DO_TEST(test_field_drives)
+  DO_TEST(test_stunned_kart)
+  DO_TEST(test_avoid_items)
+  DO_TEST(test_glide_lap)
+  DO_TEST(test_glide_switch)
+
+  puts("ai_field_test PASS");
+}
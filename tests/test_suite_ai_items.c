@@ -0,0 +1,201 @@
+#include "ai_items.h"
+#include "car.h"
+#include "checkpoints.h"
+#include "power_up.h"
+#include "scene.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *ITEMS_TRACK = "assets/tracks/caltech.trk";
+const double ITEMS_DT = 1.0 / 60;
+const size_t ITEMS_NUM_AI = 4;
+
+/**
+ * A race with the player's kart followed by the AI karts in the karts list,
+ * all parked on the grid in slot order.
+ */
+typedef struct race {
+  track_t *track;
+  scene_t *scene;
+  list_t *karts;
+  ai_field_t *field;
+  standings_t *standings;
+  ai_items_t *items;
+} race_t;
+
+race_t make_race(size_t num_ai) {
+  race_t race;
+  race.track = track_read(ITEMS_TRACK);
+  race.scene = scene_init();
+  race.karts = list_init(num_ai + 1, NULL);
+  race.field = ai_field_init(race.track, num_ai);
+  for (size_t i = 0; i <= num_ai; i++) {
+    body_t *car = make_car(F1);
+    spawn_t spawn = track_get_grid_slot(race.track, i);
+    body_set_centroid(car, spawn.position);
+    body_set_rotation(car, spawn.rotation);
+    car_set_checkpoint_state(car, checkpoint_state_init(race.track));
+    scene_add_body(race.scene, car);
+    list_add(race.karts, car);
+    if (i > 0) {
+      ai_field_add(race.field, car, 1);
+    }
+  }
+  race.standings =
+      standings_init(num_ai + 1, track_get_length(race.track));
+  race.items = ai_items_init(race.field, race.karts, list_get(race.karts, 0));
+  return race;
+}
+
+void free_race(race_t race) {
+  ai_items_free(race.items);
+  standings_free(race.standings);
+  ai_field_free(race.field);
+  list_free(race.karts);
+  scene_free(race.scene);
+  track_free(race.track);
+}
+
+void give_item(body_t *car, power_up_type_t power_up) {
+  power_up_info_t info = car_get_powerup_state(car);
+  info.power_up = power_up;
+  car_set_powerup_state(car, info);
+}
+
+/**
+ * Puts the karts in the race order given by their distances.
+ */
+void set_order(race_t race, const double *distances) {
+  for (size_t i = 0; i < list_size(race.karts); i++) {
+    standings_set_progress(race.standings, i, 0, distances[i]);
+  }
+  standings_update(race.standings);
+}
+
+// Tests that controls are only scrambled when the player is ahead
+void test_reverse() {
+  race_t race = make_race(2);
+  give_item(ai_field_get_car(race.field, 0), REVERSE);
+  set_order(race, (double[]){300, 200, 100});
+  assert(ai_items_wants_use(race.items, 0, race.standings));
+  set_order(race, (double[]){100, 200, 300});
+  assert(!ai_items_wants_use(race.items, 0, race.standings));
+  free_race(race);
+}
+
+// Tests that shells are readied at once and thrown only at a kart ahead
+void test_shell() {
+  race_t race = make_race(2);
+  set_order(race, (double[]){300, 200, 100});
+  // The karts in slots 0 and 2 are one behind the other
+  body_t *back = ai_field_get_car(race.field, 1);
+  give_item(back, SHELL);
+  assert(ai_items_wants_use(race.items, 1, race.standings));
+
+  power_up_info_t info = car_get_powerup_state(back);
+  info.power_up = NONE;
+  info.shell = true;
+  car_set_powerup_state(back, info);
+  assert(ai_items_wants_use(race.items, 1, race.standings));
+  // Nobody ahead once the kart is turned around
+  body_set_rotation(back, body_get_rotation(back) + M_PI);
+  assert(!ai_items_wants_use(race.items, 1, race.standings));
+  free_race(race);
+}
+
+// Tests that fake boxes are dropped on a kart behind, or by the leader
+void test_fake() {
+  race_t race = make_race(2);
+  body_t *car = ai_field_get_car(race.field, 0);
+  body_t *other = ai_field_get_car(race.field, 1);
+  give_item(car, FAKE);
+  double theta = body_get_rotation(car);
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  vector_t center = body_get_centroid(car);
+  body_set_centroid(other, vec_subtract(center, vec_multiply(100, heading)));
+  set_order(race, (double[]){300, 200, 100});
+  assert(ai_items_wants_use(race.items, 0, race.standings));
+  // Nobody close behind
+  body_set_centroid(other, vec_subtract(center, vec_multiply(1000, heading)));
+  assert(!ai_items_wants_use(race.items, 0, race.standings));
+  // unless the kart is leading
+  set_order(race, (double[]){200, 300, 100});
+  assert(ai_items_wants_use(race.items, 0, race.standings));
+  free_race(race);
+}
+
+// Tests that stunned karts hold on to their items
+void test_stunned() {
+  race_t race = make_race(1);
+  body_t *car = ai_field_get_car(race.field, 0);
+  give_item(car, SHELL);
+  timer_wheel_t *timers = timer_wheel_init(0.1, 8);
+  car_start_effect(car, timers, EFFECT_STUN, 1);
+  assert(!ai_items_wants_use(race.items, 0, race.standings));
+  // and use them once it wears off
+  timer_wheel_advance(timers, 1);
+  assert(ai_items_wants_use(race.items, 0, race.standings));
+  timer_wheel_free(timers);
+  free_race(race);
+}
+
+typedef struct uses {
+  size_t frame;
+  double times[4];
+  size_t frames[4];
+  list_t *karts;
+} uses_t;
+
+void record_use(body_t *car, void *aux) {
+  uses_t *uses = aux;
+  for (size_t i = 0; i < list_size(uses->karts); i++) {
+    if (list_get(uses->karts, i) == car) {
+      uses->times[i - 1] = uses->frame * ITEMS_DT;
+      uses->frames[i - 1] = uses->frame;
+    }
+  }
+  give_item(car, NONE);
+}
+
+// Tests that drivers hold items for a moment and take turns deciding
+void test_turns() {
+  race_t race = make_race(ITEMS_NUM_AI);
+  uses_t uses = {.frame = 0, .karts = race.karts};
+  for (size_t i = 0; i < ITEMS_NUM_AI; i++) {
+    give_item(ai_field_get_car(race.field, i), SHELL);
+    uses.times[i] = INFINITY;
+  }
+  for (; uses.frame < 2 / ITEMS_DT; uses.frame++) {
+    ai_items_update(race.items, race.standings, ITEMS_DT, record_use, &uses);
+  }
+  for (size_t i = 0; i < ITEMS_NUM_AI; i++) {
+    assert(uses.times[i] > 0.5 && uses.times[i] < 1.5);
+    assert(car_get_powerup_state(ai_field_get_car(race.field, i)).power_up ==
+           NONE);
+    for (size_t j = 0; j < i; j++) {
+      assert(uses.frames[i] != uses.frames[j]);
+    }
+  }
+  free_race(race);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_reverse)
+  DO_TEST(test_shell)
+  DO_TEST(test_fake)
+  DO_TEST(test_stunned)
+  DO_TEST(test_turns)
+
+  puts("ai_items_test PASS");
+}
@@ -0,0 +1,205 @@
+#include "ai_perception.h"
+#include "color.h"
+#include "polygon.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *VIEW_TRACK = "assets/tracks/caltech.trk";
+const double VIEW_KART_WIDTH = 30.0;
+const double VIEW_KART_HEIGHT = 60.0;
+const double VIEW_SPEED = 200.0;
+const double VIEW_RANGE = 150.0;
+
+body_t *make_block(vector_t center, double width, double height) {
+  return body_init(make_rectangle(center, width, height), 1, get_blue());
+}
+
+/**
+ * Puts a kart in the second grid slot, well clear of the walls, driving up
+ * the straight.
+ */
+body_t *make_kart(track_t *track, vector_t *heading) {
+  spawn_t spawn = track_get_grid_slot(track, 1);
+  *heading = (vector_t){.x = sin(spawn.rotation), .y = -cos(spawn.rotation)};
+  body_t *kart = make_block(spawn.position, VIEW_KART_WIDTH, VIEW_KART_HEIGHT);
+  body_set_rotation(kart, spawn.rotation);
+  body_set_velocity(kart, vec_multiply(VIEW_SPEED, *heading));
+  return kart;
+}
+
+// Tests the bounding radius of a rectangle
+void test_radius() {
+  body_t *block = make_block((vector_t){100, -40}, 30, 60);
+  assert(isclose(ai_perception_radius(block), sqrt(15 * 15 + 30 * 30)));
+  body_set_rotation(block, 1.0);
+  assert(isclose(ai_perception_radius(block), sqrt(15 * 15 + 30 * 30)));
+  body_free(block);
+}
+
+// Tests that sweeps along the road are clear and sweeps across it are not
+void test_cast_wall() {
+  track_t *track = track_read(VIEW_TRACK);
+  track_set_origin(track, VEC_ZERO);
+  ai_perception_t *perception = ai_perception_init(track);
+  vector_t heading;
+  body_t *kart = make_kart(track, &heading);
+  vector_t from = body_get_centroid(kart);
+  double radius = ai_perception_radius(kart);
+  vector_t ahead = vec_add(from, vec_multiply(VIEW_RANGE, heading));
+  assert(ai_perception_cast_wall(perception, from, ahead, radius) == 1);
+  assert(ai_perception_cast_wall(perception, from, from, radius) == 1);
+
+  vector_t side = {.x = -heading.y, .y = heading.x};
+  double across[2];
+  for (size_t i = 0; i < 2; i++) {
+    vector_t to = vec_add(from, vec_multiply(i == 0 ? 1000 : -1000, side));
+    across[i] = ai_perception_cast_wall(perception, from, to, radius);
+    assert(across[i] > 0 && across[i] < 1);
+    // The sweep stops short of the wall by about the radius
+    vector_t path = vec_subtract(to, from);
+    vector_t stop = vec_add(from, vec_multiply(across[i], path));
+    double clear = track_get_distance(track, stop);
+    assert(clear > radius - 2 && clear < radius + 2);
+  }
+  ai_perception_free(perception);
+  body_free(kart);
+  track_free(track);
+}
+
+// Tests that obstacles cost more the sooner they are hit
+void test_cast_obstacles() {
+  track_t *track = track_read(VIEW_TRACK);
+  track_set_origin(track, VEC_ZERO);
+  ai_perception_t *perception = ai_perception_init(track);
+  vector_t heading;
+  body_t *kart = make_kart(track, &heading);
+  vector_t from = body_get_centroid(kart);
+  vector_t to = vec_add(from, vec_multiply(VIEW_RANGE, heading));
+  vector_t side = {.x = -heading.y, .y = heading.x};
+
+  // A kart never gets in its own way
+  ai_perception_add(perception, kart, OBSTACLE_KART);
+  assert(ai_perception_size(perception) == 1);
+  assert(ai_perception_cast_obstacles(perception, kart, to, VIEW_SPEED) == 0);
+
+  // Off to the side of the path
+  body_t *aside = make_block(vec_add(to, vec_multiply(100, side)), 20, 20);
+  ai_perception_add(perception, aside, OBSTACLE_HAZARD);
+  assert(ai_perception_cast_obstacles(perception, kart, to, VIEW_SPEED) == 0);
+
+  // On the path, near and far
+  double costs[2];
+  for (size_t i = 0; i < 2; i++) {
+    ai_perception_clear(perception);
+    assert(ai_perception_size(perception) == 0);
+    double distance = i == 0 ? 50 : 140;
+    body_t *block = make_block(vec_add(from, vec_multiply(distance, heading)),
+                               20, 20);
+    ai_perception_add(perception, block, OBSTACLE_HAZARD);
+    body_free(block);
+    costs[i] = ai_perception_cast_obstacles(perception, kart, to, VIEW_SPEED);
+    assert(costs[i] > 0);
+  }
+  assert(costs[0] > costs[1]);
+  // A circle costs the same as a body of the same size
+  ai_perception_clear(perception);
+  ai_perception_add_circle(perception,
+                           vec_add(from, vec_multiply(50, heading)), VEC_ZERO,
+                           ai_perception_radius(aside), OBSTACLE_HAZARD);
+  assert(isclose(ai_perception_cast_obstacles(perception, kart, to,
+                                              VIEW_SPEED),
+                 costs[0]));
+
+  // A kart pulling away at the same speed is never caught
+  ai_perception_clear(perception);
+  body_t *leader = make_block(vec_add(from, vec_multiply(100, heading)),
+                              VIEW_KART_WIDTH, VIEW_KART_HEIGHT);
+  body_set_velocity(leader, vec_multiply(VIEW_SPEED + 1, heading));
+  ai_perception_add(perception, leader, OBSTACLE_KART);
+  assert(ai_perception_cast_obstacles(perception, kart, to, VIEW_SPEED) == 0);
+  // but one that is stopped is
+  body_set_velocity(leader, VEC_ZERO);
+  ai_perception_clear(perception);
+  ai_perception_add(perception, leader, OBSTACLE_KART);
+  double kart_cost =
+      ai_perception_cast_obstacles(perception, kart, to, VIEW_SPEED);
+  assert(kart_cost > 0);
+  // and costs less to hit than an item in the same place
+  ai_perception_clear(perception);
+  ai_perception_add(perception, leader, OBSTACLE_HAZARD);
+  assert(ai_perception_cast_obstacles(perception, kart, to, VIEW_SPEED) >
+         kart_cost);
+
+  ai_perception_free(perception);
+  body_free(leader);
+  body_free(aside);
+  body_free(kart);
+  track_free(track);
+}
+
+// Tests that a driver swerves around an item but not into a wall
+void test_choose() {
+  track_t *track = track_read(VIEW_TRACK);
+  track_set_origin(track, VEC_ZERO);
+  ai_perception_t *perception = ai_perception_init(track);
+  vector_t heading;
+  body_t *kart = make_kart(track, &heading);
+  vector_t from = body_get_centroid(kart);
+  vector_t ahead = vec_add(from, vec_multiply(VIEW_RANGE, heading));
+  vector_t side = {.x = -heading.y, .y = heading.x};
+  // Straight ahead, or far enough to either side to pass an item by the
+  // target. The kart is nearer one wall than the other, so one side is
+  // blocked.
+  double offsets[] = {0, -60, 60};
+  double bias[] = {0, 1, 1};
+  vector_t targets[3];
+  for (size_t i = 0; i < 3; i++) {
+    targets[i] = vec_add(ahead, vec_multiply(offsets[i], side));
+  }
+  double radius = ai_perception_radius(kart);
+  size_t open = track_get_distance(track, targets[1]) >
+                        track_get_distance(track, targets[2])
+                    ? 1
+                    : 2;
+  size_t blocked = 3 - open;
+  assert(ai_perception_cast_wall(perception, from, targets[open], radius) ==
+         1);
+  assert(ai_perception_cast_wall(perception, from, targets[blocked], radius) <
+         1);
+  assert(ai_perception_choose(perception, kart, targets, bias, 3) == 0);
+
+  body_t *block =
+      make_block(vec_add(from, vec_multiply(VIEW_RANGE - 10, heading)), 20,
+                 20);
+  ai_perception_add(perception, block, OBSTACLE_HAZARD);
+  assert(ai_perception_choose(perception, kart, targets, bias, 3) == open);
+  // Even a strong preference does not send the kart into the wall
+  bias[blocked] = 0;
+  bias[open] = 0.5;
+  assert(ai_perception_choose(perception, kart, targets, bias, 3) == open);
+
+  ai_perception_free(perception);
+  body_free(block);
+  body_free(kart);
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_radius)
+  DO_TEST(test_cast_wall)
+  DO_TEST(test_cast_obstacles)
+  DO_TEST(test_choose)
+
+  puts("ai_perception_test PASS");
+}
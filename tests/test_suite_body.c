@@ -122,6 +122,36 @@ void test_body_tick() {
   body_free(body);
 }
 
+void test_angular_velocity() {
+  const double OMEGA = M_PI / 2;
+  const double DT = 0.01;
+  const int STEPS = 100;
+  vector_t corners[] = {{-1, -1}, {+1, -1}, {+1, +1}, {-1, +1}};
+  list_t *shape = list_init(4, free);
+  for (size_t i = 0; i < 4; i++) {
+    vector_t *v = malloc(sizeof(*v));
+    *v = corners[i];
+    list_add(shape, v);
+  }
+  body_t *body = body_init(shape, 1, (rgb_color_t){0, 0, 0});
+  body_set_centroid(body, (vector_t){5, 5});
+  body_set_angular_velocity(body, OMEGA);
+  assert(body_get_angular_velocity(body) == OMEGA);
+
+  // Turning at a steady rate leaves the centroid where it is
+  for (int i = 0; i < STEPS; i++) {
+    body_tick(body, DT);
+  }
+  assert(isclose(body_get_rotation(body), OMEGA * STEPS * DT));
+  assert(vec_isclose(body_get_centroid(body), (vector_t){5, 5}));
+
+  // Kinematic bodies are only moved by whoever sets their pose
+  body_set_kinematic(body, true);
+  body_tick(body, DT);
+  assert(isclose(body_get_rotation(body), OMEGA * STEPS * DT));
+  body_free(body);
+}
+
 void test_infinite_mass() {
   list_t *shape = list_init(10, free);
   vector_t *v = malloc(sizeof(*v));
@@ -260,6 +290,7 @@ int main(int argc, char *argv[]) {
   DO_TEST(test_body_init)
   DO_TEST(test_body_setters)
   DO_TEST(test_body_tick)
+  DO_TEST(test_angular_velocity)
   DO_TEST(test_infinite_mass)
   DO_TEST(test_forces)
   DO_TEST(test_body_remove)
@@ -0,0 +1,167 @@
+#include "car.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+/**
+ * Puts a car of the given type in an empty scene with its vehicle
+ * controller, facing up the screen.
+ */
+body_t *add_car(scene_t *scene, car_type_t type) {
+  body_t *car = make_car(type);
+  scene_add_body(scene, car);
+  create_vehicle_controller(scene, car);
+  return car;
+}
+
+/**
+ * Drives a car with the given controls for the given time, in ticks of the
+ * given length, and returns its speed.
+ */
+double drive_for(car_type_t type, car_controls_t controls, double time,
+                 double dt) {
+  scene_t *scene = scene_init();
+  body_t *car = add_car(scene, type);
+  car_set_controls(car, controls);
+  size_t ticks = (size_t)round(time / dt);
+  for (size_t i = 0; i < ticks; i++) {
+    scene_tick(scene, dt);
+  }
+  double speed = vec_get_length(body_get_velocity(car));
+  scene_free(scene);
+  return speed;
+}
+
+// Tests that controls are clamped to their ranges
+void test_controls() {
+  scene_t *scene = scene_init();
+  body_t *car = add_car(scene, F1);
+  car_controls_t controls = car_get_controls(car);
+  assert(controls.throttle == 0 && controls.steer == 0);
+  car_set_controls(car, (car_controls_t){.throttle = 2, .steer = -3});
+  controls = car_get_controls(car);
+  assert(controls.throttle == 1 && controls.steer == -1);
+  scene_free(scene);
+}
+
+// Tests that the throttle gives the same speed at any frame rate
+void test_frame_rate() {
+  car_controls_t throttle = {.throttle = 1, .steer = 0};
+  for (car_type_t type = F1; type <= PICKUP; type++) {
+    double slow = drive_for(type, throttle, 0.1, 1.0 / 20);
+    double fast = drive_for(type, throttle, 0.1, 1.0 / 120);
+    assert(isclose(slow, fast));
+    // Half throttle is half the push
+    double half = drive_for(type, (car_controls_t){.throttle = 0.5}, 0.1,
+                            1.0 / 60);
+    assert(isclose(half, slow / 2));
+  }
+}
+
+// Tests that the engine stops pushing at the top speed
+void test_top_speed() {
+  car_controls_t throttle = {.throttle = 1, .steer = 0};
+  car_controls_t reverse = {.throttle = -1, .steer = 0};
+  for (car_type_t type = F1; type <= PICKUP; type++) {
+    scene_t *scene = scene_init();
+    body_t *car = add_car(scene, type);
+    double top_speed = car_get_top_speed(car);
+    double dt = 1.0 / 60;
+    double slack = car_get_acceleration(car) * dt;
+    scene_free(scene);
+    assert(within(slack, drive_for(type, throttle, 5, dt), top_speed));
+    assert(within(slack, drive_for(type, reverse, 5, dt), top_speed));
+  }
+}
+
+// Tests that a car turns as tightly as its tires allow, and that the tires
+// carry its velocity round with it
+void test_turning() {
+  const double SPEED = 100;
+  const double TIME = 1;
+  const double DT = 1.0 / 120;
+  scene_t *scene = scene_init();
+  body_t *car = add_car(scene, F1);
+  body_set_velocity(car, (vector_t){.x = 0, .y = -SPEED});
+  double turn_rate = car_get_turn_rate(car);
+  assert(isclose(turn_rate, car_get_grip(car) / SPEED));
+  car_set_controls(car, (car_controls_t){.throttle = 0, .steer = 1});
+  for (size_t i = 0; i < (size_t)(TIME / DT); i++) {
+    scene_tick(scene, DT);
+  }
+  // Steering left turns the car counterclockwise on the screen
+  double theta = body_get_rotation(car);
+  assert(within(0.02, theta, turn_rate * TIME));
+  vector_t heading = {.x = sin(theta), .y = -cos(theta)};
+  vector_t vel = body_get_velocity(car);
+  assert(within(1, vec_get_length(vel), SPEED));
+  assert(vec_dot(vel, heading) > vec_get_length(vel) * cos(0.05));
+
+  // A car standing still does not turn
+  body_set_velocity(car, VEC_ZERO);
+  assert(car_get_turn_rate(car) == 0);
+  scene_tick(scene, DT);
+  assert(body_get_rotation(car) == theta);
+  scene_free(scene);
+}
+
+// Tests that a stunned car is not driven, but spins on the spot
+void test_stunned() {
+  scene_t *scene = scene_init();
+  timer_wheel_t *timers = timer_wheel_init(0.1, 8);
+  body_t *car = add_car(scene, GOLF_CART);
+  car_start_effect(car, timers, EFFECT_STUN, 1);
+  car_set_controls(car, (car_controls_t){.throttle = 1, .steer = -1});
+  scene_tick(scene, 0.1);
+  assert(vec_equal(body_get_velocity(car), VEC_ZERO));
+  assert(body_get_rotation(car) > 0);
+  timer_wheel_free(timers);
+  scene_free(scene);
+}
+
+// Tests that effects wear off once they have lasted their longest start
+void test_effects() {
+  scene_t *scene = scene_init();
+  timer_wheel_t *timers = timer_wheel_init(0.1, 8);
+  body_t *car = add_car(scene, F1);
+  assert(!car_has_effect(car, EFFECT_FAST));
+  assert(car_get_speed_multiplier(car) == 1);
+  car_start_effect(car, timers, EFFECT_FAST, 2);
+  car_start_effect(car, timers, EFFECT_FAST, 1);
+  assert(car_has_effect(car, EFFECT_FAST));
+  assert(!car_has_effect(car, EFFECT_IMMUNE));
+  assert(car_get_speed_multiplier(car) > 1);
+  assert(timer_wheel_size(timers) == 1);
+  timer_wheel_advance(timers, 1.5);
+  assert(car_has_effect(car, EFFECT_FAST));
+  car_start_effect(car, timers, EFFECT_FAST, 1);
+  timer_wheel_advance(timers, 0.75);
+  assert(car_has_effect(car, EFFECT_FAST));
+  timer_wheel_advance(timers, 0.25);
+  assert(!car_has_effect(car, EFFECT_FAST));
+  assert(car_get_speed_multiplier(car) == 1);
+  assert(timer_wheel_size(timers) == 0);
+  timer_wheel_free(timers);
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_controls)
+  DO_TEST(test_frame_rate)
+  DO_TEST(test_top_speed)
+  DO_TEST(test_turning)
+  DO_TEST(test_stunned)
+  DO_TEST(test_effects)
+
+  puts("car_test PASS");
+}
@@ -0,0 +1,100 @@
+#include "body.h"
+#include "checkpoints.h"
+#include "color.h"
+#include "polygon.h"
+#include "test_util.h"
+#include "track_generator.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// A long lap with a checkpoint every 8 pixels
+const track_params_t DENSE_CIRCUIT = {.length = 12000,
+                                      .corners = 12,
+                                      .width = 220,
+                                      .wobble = 0.5,
+                                      .size = 1500,
+                                      .num_checkpoints = 1500,
+                                      .num_box_rows = 4,
+                                      .seed = 11};
+// A fast kart's distance in one coarse tick: 500 pixels per second at 20 Hz
+const double COARSE_STEP = 25;
+
+body_t *make_marker(vector_t position) {
+  body_t *body =
+      body_init(make_rectangle(position, 10, 10), 1, (rgb_color_t){0, 0, 0});
+  return body;
+}
+
+/**
+ * Moves the body along the centerline from `from` to `to` in steps of at
+ * most the given length, updating the checkpoint state at each step.
+ */
+void drive(checkpoint_state_t *state, body_t *body, track_t *track,
+           double from, double to, double step) {
+  double s = from;
+  while (true) {
+    body_set_centroid(body, track_point_at(track, s));
+    checkpoint_state_update(state, body);
+    if (s >= to) {
+      return;
+    }
+    s = fmin(s + step, to);
+  }
+}
+
+// Tests that a kart passing several checkpoints each tick finishes its laps
+void test_dense_checkpoints() {
+  track_t *track = track_generate(&DENSE_CIRCUIT);
+  double length = track_get_length(track);
+  size_t num_checkpoints = track_get_num_checkpoints(track);
+  assert(length / num_checkpoints < COARSE_STEP / 2);
+  body_t *body = make_marker(track_point_at(track, 0));
+  checkpoint_state_t *state = checkpoint_state_init(track);
+  for (size_t lap = 0; lap < 2; lap++) {
+    drive(state, body, track, 1, length - 1, COARSE_STEP);
+    assert(get_furthest_checkpoint(state) == num_checkpoints - 1);
+    assert(!get_lap_over(state));
+    drive(state, body, track, length + 1, length + COARSE_STEP,
+          COARSE_STEP);
+    assert(get_lap_over(state));
+    reset_checkpoint_state(state);
+  }
+  checkpoint_state_free(state);
+  body_free(body);
+  track_free(track);
+}
+
+// Tests that progress jumping a long way ahead, as when cutting across the
+// infield, does not count the checkpoints in between
+void test_no_shortcuts() {
+  track_t *track = track_generate(&DENSE_CIRCUIT);
+  double length = track_get_length(track);
+  body_t *body = make_marker(track_point_at(track, 0));
+  checkpoint_state_t *state = checkpoint_state_init(track);
+  drive(state, body, track, 1, 400, COARSE_STEP);
+  size_t furthest = get_furthest_checkpoint(state);
+  assert(furthest > 0);
+  drive(state, body, track, length / 2, length / 2, COARSE_STEP);
+  assert(get_furthest_checkpoint(state) == furthest);
+  drive(state, body, track, length - 10, length + 10, 20);
+  assert(!get_lap_over(state));
+  checkpoint_state_free(state);
+  body_free(body);
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_dense_checkpoints)
+  DO_TEST(test_no_shortcuts)
+
+  puts("checkpoints_test PASS");
+}
@@ -1,3 +1,4 @@
+#include "collision.h"
 #include "forces.h"
 #include "test_util.h"
 #include <assert.h>
@@ -95,6 +96,42 @@ void test_forces_removed() {
   scene_free(scene);
 }
 
+// Tests box-versus-capsule contacts and their normals
+void test_segment_collision() {
+  // A 4 x 2 box centered on (10, 0), turned a quarter turn so it is 2 wide
+  body_t *box = body_init(make_rectangle(VEC_ZERO, 4, 2), 1,
+                          (rgb_color_t){0, 0, 0});
+  body_set_centroid(box, (vector_t){10, 0});
+  body_set_rotation(box, M_PI / 2);
+  segment_t wall = {.start = {12, -5}, .end = {12, 5}, .normal = {-1, 0}};
+
+  // Out of reach of the capsule
+  assert(!find_segment_collision(box, wall, 0.5).collided);
+  // Within the capsule radius of the side of the box
+  collision_info_t info = find_segment_collision(box, wall, 1.5);
+  assert(info.collided);
+  assert(vec_isclose(info.axis, (vector_t){1, 0}));
+
+  // Crossing the segment pushes back against the wall's normal
+  body_set_centroid(box, (vector_t){11.5, 0});
+  info = find_segment_collision(box, wall, 0);
+  assert(info.collided);
+  assert(vec_isclose(info.axis, (vector_t){1, 0}));
+  body_set_centroid(box, (vector_t){12.5, 0});
+  info = find_segment_collision(box, wall, 0);
+  assert(info.collided);
+  assert(vec_isclose(info.axis, (vector_t){1, 0}));
+
+  // The rounded end of the capsule touches a corner diagonally
+  body_set_centroid(box, (vector_t){10, -7.5});
+  info = find_segment_collision(box, wall, 1.2);
+  assert(info.collided);
+  assert(vec_within(1e-6, info.axis,
+                    vec_multiply(1 / sqrt(1.25), (vector_t){1, 0.5})));
+  assert(!find_segment_collision(box, wall, 1.1).collided);
+  body_free(box);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -106,6 +143,7 @@ int main(int argc, char *argv[]) {
 
   DO_TEST(test_collisions)
   DO_TEST(test_forces_removed)
+  DO_TEST(test_segment_collision)
 
   puts("collision_test PASS");
 }
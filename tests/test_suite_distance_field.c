@@ -0,0 +1,77 @@
+#include "distance_field.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// A square road 20 wide around a 60 x 60 infield
+const vector_t INNER[] = {{20, 20}, {80, 20}, {80, 80}, {20, 80}};
+const vector_t OUTER[] = {{0, 0}, {100, 0}, {100, 100}, {0, 100}};
+const size_t RING_SIZE = 4;
+
+distance_field_t *make_ring() {
+  return distance_field_init((vector_t){-20, -20}, (vector_t){120, 120}, 5,
+                             INNER, OUTER, RING_SIZE);
+}
+
+// Tests the sign and size of distances on and off the road
+void test_sample() {
+  distance_field_t *field = make_ring();
+  // Middle of the road
+  assert(within(1e-6, distance_field_sample(field, (vector_t){50, 10}), 10));
+  assert(within(1e-6, distance_field_sample(field, (vector_t){90, 50}), 10));
+  // Between grid nodes the field is interpolated
+  assert(within(1e-6, distance_field_sample(field, (vector_t){52.5, 7.5}),
+                7.5));
+  // Infield and outside the outer boundary are negative
+  assert(within(1e-6, distance_field_sample(field, (vector_t){50, 50}), -30));
+  assert(within(1e-6, distance_field_sample(field, (vector_t){50, -10}), -10));
+  // Points off the grid use the edge of the grid
+  assert(within(1e-6, distance_field_sample(field, (vector_t){50, -500}),
+                -20));
+  distance_field_free(field);
+}
+
+// Tests that the gradient points away from the nearest boundary
+void test_gradient() {
+  distance_field_t *field = make_ring();
+  vector_t gradient = distance_field_gradient(field, (vector_t){50, 4});
+  assert(vec_within(1e-6, gradient, (vector_t){0, 1}));
+  gradient = distance_field_gradient(field, (vector_t){16, 50});
+  assert(vec_within(1e-6, gradient, (vector_t){-1, 0}));
+  gradient = distance_field_gradient(field, (vector_t){50, 60});
+  assert(vec_within(1e-6, gradient, (vector_t){0, 1}));
+  distance_field_free(field);
+}
+
+// Tests that points are moved onto the road with the requested margin
+void test_nearest() {
+  distance_field_t *field = make_ring();
+  // Already far enough from the walls
+  vector_t point = distance_field_nearest(field, (vector_t){50, 10}, 5);
+  assert(vec_equal(point, (vector_t){50, 10}));
+  // Past the outer boundary
+  point = distance_field_nearest(field, (vector_t){40, -12}, 5);
+  assert(vec_within(1e-6, point, (vector_t){40, 5}));
+  // Inside the infield, close to one side
+  point = distance_field_nearest(field, (vector_t){30, 50}, 5);
+  assert(vec_within(1e-6, point, (vector_t){15, 50}));
+  assert(distance_field_sample(field, point) >= 5 - 1e-6);
+  distance_field_free(field);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_sample)
+  DO_TEST(test_gradient)
+  DO_TEST(test_nearest)
+
+  puts("distance_field_test PASS");
+}
@@ -77,6 +77,79 @@ void test_energy_conservation() {
   scene_free(scene);
 }
 
+typedef struct collision_log {
+  size_t count;
+  body_t *body1;
+  body_t *body2;
+} collision_log_t;
+
+void log_collision(body_t *body1, body_t *body2, vector_t axis, void *aux,
+                   double force_const) {
+  collision_log_t *log = aux;
+  log->count++;
+  log->body1 = body1;
+  log->body2 = body2;
+}
+
+// Tests that a group collision fires once per contact for each pair
+void test_group_collision() {
+  scene_t *scene = scene_init();
+  list_t *group = list_init(3, NULL);
+  for (size_t i = 0; i < 3; i++) {
+    body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_centroid(body, (vector_t){100 * i, 0});
+    scene_add_body(scene, body);
+    list_add(group, body);
+  }
+  body_t *a = list_get(group, 0);
+  body_t *b = list_get(group, 1);
+  body_t *c = list_get(group, 2);
+  collision_log_t log = {0};
+  create_group_collision(scene, group, NULL, log_collision, &log, 0);
+
+  scene_tick(scene, 0);
+  assert(log.count == 0);
+  body_set_centroid(c, (vector_t){1.5, 0.5});
+  scene_tick(scene, 0);
+  assert(log.count == 1 && log.body1 == a && log.body2 == c);
+  // Still touching, so the handler is not called again
+  scene_tick(scene, 0);
+  assert(log.count == 1);
+  body_set_centroid(c, (vector_t){100, 1});
+  scene_tick(scene, 0);
+  assert(log.count == 2 && log.body1 == b && log.body2 == c);
+  body_set_centroid(c, (vector_t){200, 0});
+  scene_tick(scene, 0);
+  body_set_centroid(c, (vector_t){0, 1});
+  scene_tick(scene, 0);
+  assert(log.count == 3 && log.body1 == a && log.body2 == c);
+  list_free(group);
+  scene_free(scene);
+}
+
+// Tests that a group is only tested against the others, not among itself
+void test_group_against_others() {
+  scene_t *scene = scene_init();
+  list_t *group = list_init(2, NULL);
+  list_t *others = list_init(2, NULL);
+  for (size_t i = 0; i < 4; i++) {
+    body_t *body = body_init(make_shape(), 1, (rgb_color_t){0, 0, 0});
+    body_set_centroid(body, (vector_t){0.1 * i, 0});
+    scene_add_body(scene, body);
+    list_add(i % 2 == 0 ? group : others, body);
+  }
+  collision_log_t log = {0};
+  create_group_collision(scene, group, others, log_collision, &log, 0);
+  scene_tick(scene, 0);
+  // Every body overlaps every other, but only the four pairs across the
+  // lists count
+  assert(log.count == 4);
+  assert(list_get(group, 0) == log.body1 || list_get(group, 1) == log.body1);
+  list_free(group);
+  list_free(others);
+  scene_free(scene);
+}
+
 int main(int argc, char *argv[]) {
   // Run all tests if there are no command-line arguments
   bool all_tests = argc == 1;
@@ -88,6 +161,8 @@ int main(int argc, char *argv[]) {
 
   DO_TEST(test_spring_sinusoid)
   DO_TEST(test_energy_conservation)
+  DO_TEST(test_group_collision)
+  DO_TEST(test_group_against_others)
 
   puts("forces_test PASS");
 }
@@ -0,0 +1,141 @@
+#include "ghost.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char *GHOST_FILE = "/tmp/ghost_test.ghost";
+const double GHOST_DT = 1.0 / 60;
+const double GHOST_LAP = 150.0;
+// A kart circling at 300 units per second
+const vector_t GHOST_CENTER = {.x = 1000, .y = 800};
+const double GHOST_RADIUS = 500.0;
+const double GHOST_SPEED = 300.0;
+// Quantization and the spline between samples together stay within these
+const double GHOST_POSITION_TOLERANCE = 0.5;
+const double GHOST_ROTATION_TOLERANCE = 1e-2;
+
+ghost_pose_t circling_pose(double time) {
+  double angle = GHOST_SPEED / GHOST_RADIUS * time;
+  vector_t offset = {.x = cos(angle), .y = sin(angle)};
+  vector_t velocity = {.x = -offset.y, .y = offset.x};
+  return (ghost_pose_t){
+      .position = vec_add(GHOST_CENTER, vec_multiply(GHOST_RADIUS, offset)),
+      .rotation = atan2(velocity.x, -velocity.y)};
+}
+
+ghost_t *record_lap(double lap_time) {
+  ghost_t *ghost = ghost_init();
+  double time = 0;
+  for (; time < lap_time; time += GHOST_DT) {
+    ghost_record(ghost, time, circling_pose(time));
+  }
+  // The line is found on the first frame over it
+  ghost_record(ghost, time, circling_pose(time));
+  ghost_finish(ghost, lap_time);
+  return ghost;
+}
+
+void assert_pose_near(ghost_pose_t actual, ghost_pose_t expected) {
+  assert(vec_within(GHOST_POSITION_TOLERANCE, actual.position,
+                    expected.position));
+  double turn = remainder(actual.rotation - expected.rotation, 2 * M_PI);
+  assert(fabs(turn) < GHOST_ROTATION_TOLERANCE);
+}
+
+void assert_plays_back(ghost_t *ghost) {
+  ghost_player_t *player = ghost_player_init(ghost);
+  for (double time = 0; time <= GHOST_LAP; time += GHOST_DT) {
+    assert_pose_near(ghost_player_pose_at(player, time), circling_pose(time));
+  }
+  ghost_player_free(player);
+}
+
+// Tests that a lap plays back along the path it was recorded on
+void test_round_trip() {
+  ghost_t *ghost = record_lap(GHOST_LAP);
+  assert(isclose(ghost_get_lap_time(ghost), GHOST_LAP));
+  assert(ghost_get_num_samples(ghost) >= GHOST_LAP * 10);
+  assert_plays_back(ghost);
+  ghost_free(ghost);
+}
+
+// Tests that a steady lap takes about three bytes a sample
+void test_size() {
+  ghost_t *ghost = record_lap(GHOST_LAP);
+  size_t size = ghost_get_size(ghost);
+  assert(size < 4 * ghost_get_num_samples(ghost));
+  assert(size < 8 * 1024);
+  ghost_free(ghost);
+}
+
+// Tests that playback can jump around the lap and clamps at its ends
+void test_seeking() {
+  ghost_t *ghost = record_lap(GHOST_LAP);
+  ghost_player_t *player = ghost_player_init(ghost);
+  double times[] = {100, 100.05, 3, 140, 0.5, 0, GHOST_LAP};
+  for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+    assert_pose_near(ghost_player_pose_at(player, times[i]),
+                     circling_pose(times[i]));
+  }
+  assert_pose_near(ghost_player_pose_at(player, -1), circling_pose(0));
+  assert_pose_near(ghost_player_pose_at(player, GHOST_LAP + 5),
+                   circling_pose(GHOST_LAP));
+  ghost_player_free(player);
+  ghost_free(ghost);
+}
+
+// Tests that a ghost survives being written to and read from a file
+void test_file() {
+  ghost_t *ghost = record_lap(GHOST_LAP);
+  assert(ghost_write(ghost, GHOST_FILE));
+  ghost_t *read = ghost_read(GHOST_FILE);
+  assert(read != NULL);
+  assert(ghost_get_lap_time(read) == ghost_get_lap_time(ghost));
+  assert(ghost_get_num_samples(read) == ghost_get_num_samples(ghost));
+  assert(ghost_get_size(read) == ghost_get_size(ghost));
+  assert_plays_back(read);
+  ghost_free(read);
+
+  // A truncated file is rejected
+  FILE *file = fopen(GHOST_FILE, "r+b");
+  assert(file != NULL);
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fclose(file);
+  assert(truncate(GHOST_FILE, length - 1) == 0);
+  assert(ghost_read(GHOST_FILE) == NULL);
+  remove(GHOST_FILE);
+  assert(ghost_read(GHOST_FILE) == NULL);
+  ghost_free(ghost);
+}
+
+// Tests a lap too short to fill the interpolation window
+void test_short_lap() {
+  ghost_t *ghost = record_lap(0.15);
+  ghost_player_t *player = ghost_player_init(ghost);
+  assert_pose_near(ghost_player_pose_at(player, 0), circling_pose(0));
+  assert_pose_near(ghost_player_pose_at(player, 0.15), circling_pose(0.15));
+  ghost_player_free(player);
+  ghost_free(ghost);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_round_trip)
+  DO_TEST(test_size)
+  DO_TEST(test_seeking)
+  DO_TEST(test_file)
+  DO_TEST(test_short_lap)
+
+  puts("ghost_test PASS");
+}
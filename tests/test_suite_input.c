@@ -0,0 +1,72 @@
+#include "input.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Tests that held actions are seen every tick until they are released
+void test_held() {
+  input_t *input = input_init();
+  input_snapshot_t snapshot = input_take_snapshot(input, 0);
+  assert(snapshot.held == 0 && snapshot.pressed == 0);
+
+  input_press(input, ACTION_AHEAD, 1.0);
+  input_press(input, ACTION_LEFT, 1.5);
+  for (size_t i = 0; i < 3; i++) {
+    snapshot = input_take_snapshot(input, 2.0 + i);
+    assert(input_is_held(&snapshot, ACTION_AHEAD));
+    assert(input_is_held(&snapshot, ACTION_LEFT));
+    assert(!input_is_held(&snapshot, ACTION_BACK));
+    assert(isclose(snapshot.held_times[ACTION_AHEAD], 1.0 + i));
+    assert(isclose(snapshot.held_times[ACTION_LEFT], 0.5 + i));
+    assert(snapshot.held_times[ACTION_BACK] == 0);
+  }
+
+  input_release(input, ACTION_AHEAD);
+  snapshot = input_take_snapshot(input, 5.0);
+  assert(!input_is_held(&snapshot, ACTION_AHEAD));
+  assert(snapshot.held_times[ACTION_AHEAD] == 0);
+  assert(input_is_held(&snapshot, ACTION_LEFT));
+  input_free(input);
+}
+
+// Tests that a press is reported once, even if released within the tick
+void test_pressed() {
+  input_t *input = input_init();
+  input_press(input, ACTION_ITEM, 1.0);
+  input_snapshot_t snapshot = input_take_snapshot(input, 1.0);
+  assert(input_was_pressed(&snapshot, ACTION_ITEM));
+  snapshot = input_take_snapshot(input, 1.1);
+  assert(!input_was_pressed(&snapshot, ACTION_ITEM));
+  assert(input_is_held(&snapshot, ACTION_ITEM));
+
+  // Key repeat does not press again or restart the hold
+  input_press(input, ACTION_ITEM, 1.2);
+  snapshot = input_take_snapshot(input, 1.5);
+  assert(!input_was_pressed(&snapshot, ACTION_ITEM));
+  assert(isclose(snapshot.held_times[ACTION_ITEM], 0.5));
+
+  input_release(input, ACTION_ITEM);
+  input_press(input, ACTION_FLIP, 2.0);
+  input_release(input, ACTION_FLIP);
+  snapshot = input_take_snapshot(input, 2.1);
+  assert(input_was_pressed(&snapshot, ACTION_FLIP));
+  assert(!input_is_held(&snapshot, ACTION_FLIP));
+  assert(!input_is_held(&snapshot, ACTION_ITEM));
+  input_free(input);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_held)
+  DO_TEST(test_pressed)
+
+  puts("input_test PASS");
+}
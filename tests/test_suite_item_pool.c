@@ -0,0 +1,338 @@
+#include "car.h"
+#include "item_pool.h"
+#include "power_up.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *POOL_TRACK = "assets/tracks/caltech.trk";
+const double POOL_DT = 1.0 / 60;
+const double POOL_SPIN = 6.0;
+
+typedef struct pool_race {
+  track_t *track;
+  list_t *karts;
+  bool switches[6];
+  timer_wheel_t *timers;
+  item_pool_t *pool;
+} pool_race_t;
+
+/**
+ * Puts karts on the first grid slots.
+ */
+pool_race_t *make_race(size_t num_karts) {
+  pool_race_t *race = malloc(sizeof(pool_race_t));
+  assert(race != NULL);
+  race->track = track_read(POOL_TRACK);
+  race->karts = list_init(num_karts, (free_func_t)body_free);
+  for (size_t i = 0; i < num_karts; i++) {
+    spawn_t spawn = track_get_grid_slot(race->track, i);
+    body_t *kart = make_car(F1);
+    body_set_centroid(kart, spawn.position);
+    body_set_rotation(kart, spawn.rotation);
+    list_add(race->karts, kart);
+  }
+  for (size_t i = 0; i < 6; i++) {
+    race->switches[i] = true;
+  }
+  track_set_origin(race->track, VEC_ZERO);
+  race->timers = timer_wheel_init(POOL_DT, 64);
+  race->pool = item_pool_init(race->track, race->karts, race->switches,
+                              race->timers, 1);
+  return race;
+}
+
+void free_race(pool_race_t *race) {
+  item_pool_free(race->pool);
+  timer_wheel_free(race->timers);
+  list_free(race->karts);
+  track_free(race->track);
+  free(race);
+}
+
+/**
+ * Moves the origin and everything in the scene by the same offset, as
+ * re-centering the scene does.
+ */
+void shift_scene(pool_race_t *race, vector_t offset) {
+  track_set_origin(race->track,
+                   vec_add(track_get_origin(race->track), offset));
+  for (size_t i = 0; i < list_size(race->karts); i++) {
+    body_t *kart = list_get(race->karts, i);
+    body_set_centroid(kart, vec_add(body_get_centroid(kart), offset));
+  }
+}
+
+bool is_stunned(body_t *kart) { return car_has_effect(kart, EFFECT_STUN); }
+
+size_t count_kind(item_pool_t *pool, item_kind_t kind) {
+  size_t count = 0;
+  for (size_t i = 0; i < item_pool_size(pool); i++) {
+    count += item_pool_get_kind(pool, i) == kind;
+  }
+  return count;
+}
+
+// Tests that a box gives an item, then refills
+void test_box() {
+  pool_race_t *race = make_race(1);
+  item_pool_t *pool = race->pool;
+  size_t num_boxes = track_get_num_boxes(race->track);
+  assert(num_boxes > 0);
+  assert(item_pool_size(pool) == num_boxes);
+  shift_scene(race, (vector_t){.x = 300, .y = -200});
+  assert(vec_equal(item_pool_get_position(pool, 0),
+                   vec_add(track_get_boxes(race->track)[0],
+                           track_get_origin(race->track))));
+
+  body_t *kart = list_get(race->karts, 0);
+  item_pool_update(pool, POOL_DT);
+  assert(car_get_powerup_state(kart).power_up == NONE);
+  body_set_centroid(kart, item_pool_get_position(pool, 0));
+  item_pool_update(pool, POOL_DT);
+  assert(car_get_powerup_state(kart).power_up != NONE);
+  assert(item_pool_size(pool) == num_boxes);
+
+  // An empty box gives nothing until it refills
+  power_up_info_t info = car_get_powerup_state(kart);
+  info.power_up = NONE;
+  car_set_powerup_state(kart, info);
+  assert(timer_wheel_size(race->timers) == 1);
+  timer_wheel_advance(race->timers, 5);
+  item_pool_update(pool, POOL_DT);
+  assert(car_get_powerup_state(kart).power_up == NONE);
+  timer_wheel_advance(race->timers, 5);
+  item_pool_update(pool, POOL_DT);
+  assert(car_get_powerup_state(kart).power_up != NONE);
+  free_race(race);
+}
+
+// Tests that a fake box stuns the first kart to touch it and is used up
+void test_fake() {
+  pool_race_t *race = make_race(2);
+  item_pool_t *pool = race->pool;
+  size_t num_boxes = item_pool_size(pool);
+  body_t *kart = list_get(race->karts, 1);
+  vector_t center = body_get_centroid(kart);
+  item_pool_add_fake(pool, vec_add(center, (vector_t){.x = 0, .y = 200}));
+  assert(item_pool_is_hazard(pool, num_boxes));
+  item_pool_update(pool, POOL_DT);
+  assert(!is_stunned(kart));
+  assert(count_kind(pool, ITEM_FAKE) == 1);
+
+  // A corner of the kart is enough
+  item_pool_add_fake(pool, vec_add(center, (vector_t){.x = 20, .y = 40}));
+  item_pool_update(pool, POOL_DT);
+  assert(is_stunned(kart));
+  assert(!is_stunned(list_get(race->karts, 0)));
+  assert(count_kind(pool, ITEM_FAKE) == 1);
+
+  // The stun wears off, and the kart can't be stunned again for a while
+  timer_wheel_advance(race->timers, 3);
+  assert(!is_stunned(kart));
+  item_pool_add_fake(pool, center);
+  item_pool_update(pool, POOL_DT);
+  assert(!is_stunned(kart));
+  timer_wheel_advance(race->timers, 2);
+  item_pool_add_fake(pool, center);
+  item_pool_update(pool, POOL_DT);
+  assert(is_stunned(kart));
+  free_race(race);
+}
+
+// Tests that a held shell circles its kart and hits only the other karts
+void test_held_shell() {
+  pool_race_t *race = make_race(2);
+  item_pool_t *pool = race->pool;
+  body_t *holder = list_get(race->karts, 0);
+  body_t *other = list_get(race->karts, 1);
+  item_pool_add_shell(pool, holder, 0, POOL_SPIN);
+  assert(car_has_shell(holder));
+  size_t shell = item_pool_size(pool) - 1;
+  assert(!item_pool_is_hazard(pool, shell));
+  for (size_t i = 0; i < 30; i++) {
+    item_pool_update(pool, POOL_DT);
+    vector_t offset = vec_subtract(item_pool_get_position(pool, shell),
+                                   body_get_centroid(holder));
+    assert(isclose(vec_get_length(offset), 50));
+  }
+  assert(!is_stunned(holder));
+
+  body_set_centroid(other, item_pool_get_position(pool, shell));
+  item_pool_update(pool, POOL_DT);
+  assert(is_stunned(other));
+  assert(!car_has_shell(holder));
+  assert(count_kind(pool, ITEM_SHELL) == 0);
+  free_race(race);
+}
+
+// Tests that a thrown shell flies on, bouncing off the walls
+void test_thrown_shell() {
+  pool_race_t *race = make_race(1);
+  item_pool_t *pool = race->pool;
+  body_t *kart = list_get(race->karts, 0);
+  item_pool_add_shell(pool, kart, 0, POOL_SPIN);
+  size_t shell = item_pool_size(pool) - 1;
+  vector_t velocity = item_pool_get_velocity(pool, shell);
+  item_pool_flip_shell(pool, kart);
+  item_pool_update(pool, 0);
+  // Flipped, the shell circles the other way round
+  assert(vec_equal(item_pool_get_velocity(pool, shell), vec_negate(velocity)));
+  velocity = vec_negate(velocity);
+  item_pool_throw_shell(pool, kart);
+  assert(!car_has_shell(kart));
+  assert(item_pool_is_hazard(pool, shell));
+
+  // Move the kart out of the shell's way
+  body_set_centroid(kart, (vector_t){.x = 1e6, .y = 1e6});
+  for (size_t i = 0; i < 600; i++) {
+    item_pool_update(pool, POOL_DT);
+    assert(count_kind(pool, ITEM_SHELL) == 1);
+    vector_t position = item_pool_get_position(pool, shell);
+    assert(track_on_road(race->track, position) ||
+           track_get_distance(race->track, position) < 10);
+    assert(isclose(vec_get_length(item_pool_get_velocity(pool, shell)),
+                   vec_get_length(velocity)));
+  }
+  free_race(race);
+}
+
+// Tests that a homing shell follows the road to the kart ahead of its
+// thrower, a long way round the lap
+void test_homing_shell() {
+  pool_race_t *race = make_race(2);
+  item_pool_t *pool = race->pool;
+  body_t *thrower = list_get(race->karts, 1);
+  body_t *target = list_get(race->karts, 0);
+  size_t segment = SIZE_MAX;
+  double progress = track_project(race->track, body_get_centroid(thrower),
+                                  &segment);
+  spawn_t ahead = track_respawn_at(
+      race->track, fmod(progress + 1500, track_get_length(race->track)));
+  body_set_centroid(target, ahead.position);
+  body_set_rotation(target, ahead.rotation);
+
+  item_pool_add_homing_shell(pool, thrower);
+  size_t shell = item_pool_size(pool) - 1;
+  assert(item_pool_get_kind(pool, shell) == ITEM_SHELL);
+  assert(item_pool_is_hazard(pool, shell));
+  assert(!car_has_shell(thrower));
+  size_t ticks = 0;
+  while (count_kind(pool, ITEM_SHELL) == 1) {
+    item_pool_update(pool, POOL_DT);
+    assert(++ticks < 8 / POOL_DT);
+    if (count_kind(pool, ITEM_SHELL) == 1) {
+      vector_t position = item_pool_get_position(pool, shell);
+      assert(track_get_distance(race->track, position) > -10);
+    }
+  }
+  assert(is_stunned(target));
+  assert(!is_stunned(thrower));
+  free_race(race);
+}
+
+// Tests that a homing shell with no kart to seek follows the road until it
+// breaks
+void test_homing_lifetime() {
+  pool_race_t *race = make_race(1);
+  item_pool_t *pool = race->pool;
+  body_t *kart = list_get(race->karts, 0);
+  item_pool_add_homing_shell(pool, kart);
+  item_pool_add_homing_shell(pool, kart);
+  // Fired from the same place, the two shells break each other
+  item_pool_update(pool, 0);
+  assert(count_kind(pool, ITEM_SHELL) == 0);
+
+  item_pool_add_homing_shell(pool, kart);
+  size_t shell = item_pool_size(pool) - 1;
+  body_set_centroid(kart, (vector_t){.x = 1e6, .y = 1e6});
+  for (size_t i = 0; i < 7.9 / POOL_DT; i++) {
+    item_pool_update(pool, POOL_DT);
+    assert(count_kind(pool, ITEM_SHELL) == 1);
+    vector_t position = item_pool_get_position(pool, shell);
+    assert(track_get_distance(race->track, position) > -10);
+  }
+  for (size_t i = 0; i < 0.2 / POOL_DT; i++) {
+    item_pool_update(pool, POOL_DT);
+  }
+  assert(count_kind(pool, ITEM_SHELL) == 0);
+  free_race(race);
+}
+
+// Tests that two shells that touch destroy each other
+void test_shells_collide() {
+  pool_race_t *race = make_race(2);
+  item_pool_t *pool = race->pool;
+  body_t *first = list_get(race->karts, 0);
+  body_t *second = list_get(race->karts, 1);
+  item_pool_add_shell(pool, first, 0, POOL_SPIN);
+  item_pool_add_shell(pool, second, M_PI, POOL_SPIN);
+  vector_t between = vec_multiply(
+      0.5, vec_add(body_get_centroid(first), body_get_centroid(second)));
+  body_set_centroid(first, vec_add(between, (vector_t){.x = 0, .y = -50}));
+  body_set_centroid(second, vec_add(between, (vector_t){.x = 0, .y = 50}));
+  body_set_rotation(first, 0);
+  body_set_rotation(second, 0);
+  // Both shells sit halfway between the karts, out of their reach
+  item_pool_update(pool, 0);
+  assert(count_kind(pool, ITEM_SHELL) == 0);
+  assert(!is_stunned(first) && !is_stunned(second));
+  assert(!car_has_shell(first) && !car_has_shell(second));
+  free_race(race);
+}
+
+// Tests that a boost pad speeds up only the kart that put it down, once
+// each time it drives onto it
+void test_boost() {
+  pool_race_t *race = make_race(2);
+  item_pool_t *pool = race->pool;
+  body_t *owner = list_get(race->karts, 0);
+  body_t *other = list_get(race->karts, 1);
+  item_pool_add_boost(pool, owner);
+  size_t pad = item_pool_size(pool) - 1;
+  item_pool_update(pool, POOL_DT);
+  double boosted = vec_get_length(body_get_velocity(owner));
+  assert(isclose(boosted, 1.5 * car_get_top_speed(owner)));
+  assert(car_has_effect(owner, EFFECT_FAST));
+
+  // Staying on the pad is not boosted again
+  body_set_velocity(owner, VEC_ZERO);
+  item_pool_update(pool, POOL_DT);
+  assert(vec_equal(body_get_velocity(owner), VEC_ZERO));
+  // but driving back onto it is
+  vector_t center = item_pool_get_position(pool, pad);
+  body_set_centroid(owner, vec_add(center, (vector_t){.x = 300, .y = 0}));
+  item_pool_update(pool, POOL_DT);
+  body_set_centroid(owner, center);
+  item_pool_update(pool, POOL_DT);
+  assert(vec_get_length(body_get_velocity(owner)) > 0);
+
+  body_set_centroid(other, center);
+  item_pool_update(pool, POOL_DT);
+  assert(vec_equal(body_get_velocity(other), VEC_ZERO));
+  assert(count_kind(pool, ITEM_BOOST) == 1);
+  free_race(race);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_box)
+  DO_TEST(test_fake)
+  DO_TEST(test_held_shell)
+  DO_TEST(test_thrown_shell)
+  DO_TEST(test_homing_shell)
+  DO_TEST(test_homing_lifetime)
+  DO_TEST(test_shells_collide)
+  DO_TEST(test_boost)
+
+  puts("item_pool_test PASS");
+}
@@ -0,0 +1,114 @@
+#include "car.h"
+#include "kart_store.h"
+#include "scene.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdlib.h>
+
+const kart_stats_t TEST_STATS = {
+    .type = PICKUP, .friction = 1, .top_speed = 100, .acceleration = 10};
+
+// Tests that karts get IDs in order, and start at rest with nothing
+void test_add() {
+  kart_store_t *store = kart_store_init(3);
+  assert(kart_store_size(store) == 0);
+  for (size_t i = 0; i < 3; i++) {
+    kart_stats_t stats = TEST_STATS;
+    stats.top_speed = i;
+    assert(kart_store_add(store, stats) == i);
+  }
+  assert(kart_store_size(store) == 3);
+  for (size_t i = 0; i < 3; i++) {
+    assert(kart_store_get_stats(store)[i].top_speed == i);
+    assert(kart_store_get_controls(store)[i].throttle == 0);
+    assert(kart_store_get_items(store)[i].power_up == 0);
+    assert(!kart_store_get_items(store)[i].shell);
+    assert(!kart_store_get_effects(store)[i].effects[EFFECT_STUN].on);
+    assert(kart_store_get_progress(store)[i].laps_done == 0);
+    assert(kart_store_get_progress(store)[i].kart_hits == 0);
+  }
+  for (size_t i = 0; i < 3; i++) {
+    kart_store_remove(store, i);
+  }
+  kart_store_free(store);
+}
+
+// Tests that the car functions read and write the store's arrays
+void test_cars_in_store() {
+  kart_store_t *store = kart_store_init(2);
+  body_t *f1 = make_car_in_store(store, F1);
+  body_t *pickup = make_car_in_store(store, PICKUP);
+  assert(car_get_store(pickup) == store && car_get_id(pickup) == 1);
+  assert(kart_store_get_stats(store)[0].type == F1);
+  assert(kart_store_get_stats(store)[1].type == PICKUP);
+  car_set_laps_done(pickup, 2);
+  car_add_kart_hit(f1);
+  car_set_controls(f1, (car_controls_t){.throttle = 2, .steer = 0.5});
+  kart_progress_t *progress = kart_store_get_progress(store);
+  assert(progress[0].laps_done == 0 && progress[0].kart_hits == 1);
+  assert(progress[1].laps_done == 2 && progress[1].kart_hits == 0);
+  assert(kart_store_get_controls(store)[0].throttle == 1);
+  assert(kart_store_get_controls(store)[0].steer == 0.5);
+  kart_store_get_items(store)[1].shell = true;
+  assert(car_get_powerup_state(pickup).shell);
+  assert(!car_get_powerup_state(f1).shell);
+  body_free(f1);
+  body_free(pickup);
+  kart_store_free(store);
+}
+
+// Tests that effects are switched off in the store by the clock
+void test_effects() {
+  kart_store_t *store = kart_store_init(2);
+  timer_wheel_t *timers = timer_wheel_init(0.1, 8);
+  kart_store_add(store, TEST_STATS);
+  kart_store_add(store, TEST_STATS);
+  kart_store_start_effect(store, 1, timers, EFFECT_FAST, 1);
+  kart_effects_t *effects = kart_store_get_effects(store);
+  assert(!effects[0].effects[EFFECT_FAST].on);
+  assert(effects[1].effects[EFFECT_FAST].on);
+  // A shorter start does not cut the effect short
+  kart_store_start_effect(store, 1, timers, EFFECT_FAST, 0.5);
+  timer_wheel_advance(timers, 0.75);
+  assert(effects[1].effects[EFFECT_FAST].on);
+  timer_wheel_advance(timers, 0.5);
+  assert(!effects[1].effects[EFFECT_FAST].on);
+  assert(timer_wheel_size(timers) == 0);
+  timer_wheel_free(timers);
+  kart_store_remove(store, 0);
+  kart_store_remove(store, 1);
+  kart_store_free(store);
+}
+
+// Tests that a released store lives on until the scene frees its karts
+void test_release_before_karts() {
+  scene_t *scene = scene_init();
+  kart_store_t *store = kart_store_init(2);
+  for (size_t i = 0; i < 2; i++) {
+    body_t *car = make_car_in_store(store, GOLF_CART);
+    scene_add_body(scene, car);
+    create_vehicle_controller(scene, car);
+    body_remove(car);
+  }
+  kart_store_free(store);
+  // The vehicle controllers still run on the removed karts
+  scene_tick(scene, 0.1);
+  scene_free(scene);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_add)
+  DO_TEST(test_cars_in_store)
+  DO_TEST(test_effects)
+  DO_TEST(test_release_before_karts)
+
+  puts("kart_store_test PASS");
+}
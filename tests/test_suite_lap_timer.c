@@ -0,0 +1,138 @@
+#include "lap_timer.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *TIMER_TRACK = "assets/tracks/caltech.trk";
+const double STEADY_SPEED = 400;
+const double TIMER_DT = 1.0 / 60;
+
+/**
+ * Drives from the given progress to the end of the lap at a steady speed and
+ * returns the time of the finished lap. Leaves the progress past the line in
+ * `progress`.
+ */
+double drive_lap(lap_timer_t *timer, double length, double *progress,
+                 double speed) {
+  while (true) {
+    *progress += speed * TIMER_DT;
+    if (*progress >= length) {
+      *progress -= length;
+      return lap_timer_finish_lap(timer, *progress, TIMER_DT);
+    }
+    lap_timer_update(timer, *progress, TIMER_DT);
+  }
+}
+
+// Tests that lap and sector times are interpolated to the line crossings
+void test_steady_lap() {
+  track_t *track = track_read_text(TIMER_TRACK);
+  double length = track_get_length(track);
+  lap_timer_t *timer = lap_timer_init(track, 3);
+  assert(lap_timer_get_best_lap(timer) == INFINITY);
+  assert(lap_timer_get_delta(timer) == 0);
+
+  double progress = 0;
+  double lap_time = drive_lap(timer, length, &progress, STEADY_SPEED);
+  assert(within(1e-9, lap_time, length / STEADY_SPEED));
+  assert(lap_timer_get_best_lap(timer) == lap_time);
+  assert(lap_timer_get_num_laps(timer) == 1);
+  // The new lap started when the kart crossed the line, not on the tick after
+  assert(lap_timer_get_lap_time(timer) < TIMER_DT);
+  assert(lap_timer_get_sector(timer) == 0);
+
+  size_t num_sectors = track_get_num_sectors(track);
+  double total = 0;
+  for (size_t i = 0; i < num_sectors; i++) {
+    double end = i + 1 < num_sectors ? track_get_sector_progress(track, i + 1)
+                                     : length;
+    double expected = (end - track_get_sector_progress(track, i)) /
+                      STEADY_SPEED;
+    assert(within(1e-9, lap_timer_get_best_sector(timer, i), expected));
+    assert(within(1e-5, lap_timer_get_record_sector(timer, 0, i), expected));
+    total += lap_timer_get_record_sector(timer, 0, i);
+  }
+  assert(within(1e-4, total, lap_timer_get_record(timer, 0)));
+  lap_timer_free(timer);
+  track_free(track);
+}
+
+// Tests the live delta against the fastest lap
+void test_delta() {
+  track_t *track = track_read_text(TIMER_TRACK);
+  double length = track_get_length(track);
+  lap_timer_t *timer = lap_timer_init(track, 3);
+  double progress = 0;
+  double best = drive_lap(timer, length, &progress, STEADY_SPEED);
+
+  // A faster lap gains time on the best one all the way around
+  double fast = 1.25 * STEADY_SPEED;
+  double delta = lap_timer_get_delta(timer);
+  while (progress < 0.5 * length) {
+    progress += fast * TIMER_DT;
+    lap_timer_update(timer, progress, TIMER_DT);
+    double expected =
+        lap_timer_get_lap_time(timer) - progress / STEADY_SPEED;
+    assert(within(1e-9, lap_timer_get_delta(timer), expected));
+    assert(lap_timer_get_delta(timer) < delta);
+    delta = lap_timer_get_delta(timer);
+  }
+  assert(lap_timer_get_sector(timer) == 1);
+  assert(lap_timer_get_sector_time(timer, 2) == 0);
+  // The faster first sector became the best one as soon as it ended
+  assert(lap_timer_get_sector_time(timer, 0) ==
+         lap_timer_get_best_sector(timer, 0));
+  assert(within(TIMER_DT, lap_timer_get_best_sector(timer, 0),
+                track_get_sector_progress(track, 1) / fast));
+
+  // Standing still loses time, and backing up does not rewrite the samples
+  lap_timer_update(timer, progress, best);
+  assert(within(1e-9, lap_timer_get_delta(timer), delta + best));
+  progress -= 500;
+  lap_timer_update(timer, progress, 1.0);
+  assert(lap_timer_get_delta(timer) > delta + best + 1.0);
+
+  double slow = drive_lap(timer, length, &progress, fast);
+  assert(slow > best);
+  assert(lap_timer_get_best_lap(timer) == best);
+  assert(lap_timer_get_num_laps(timer) == 2);
+  lap_timer_free(timer);
+  track_free(track);
+}
+
+// Tests that only the most recent laps keep a record
+void test_records() {
+  track_t *track = track_read_text(TIMER_TRACK);
+  double length = track_get_length(track);
+  lap_timer_t *timer = lap_timer_init(track, 2);
+  double progress = 0;
+  double times[4];
+  for (size_t lap = 0; lap < 4; lap++) {
+    double speed = STEADY_SPEED * (1 + 0.1 * lap);
+    times[lap] = drive_lap(timer, length, &progress, speed);
+  }
+  assert(lap_timer_get_num_laps(timer) == 4);
+  assert(within(1e-4, lap_timer_get_record(timer, 2), times[2]));
+  assert(within(1e-4, lap_timer_get_record(timer, 3), times[3]));
+  assert(lap_timer_get_best_lap(timer) == times[3]);
+  lap_timer_free(timer);
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_steady_lap)
+  DO_TEST(test_delta)
+  DO_TEST(test_records)
+
+  puts("lap_timer_test PASS");
+}
@@ -0,0 +1,119 @@
+#include "race_sim.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *SIM_TRACK = "assets/tracks/caltech.trk";
+const race_config_t SIM_CONFIG = {.num_karts = 4,
+                                  .num_laps = 1,
+                                  .skill = 1.0,
+                                  .skill_spread = 0.2,
+                                  .skill_jitter = 0,
+                                  .kart_type = F1,
+                                  .top_speed = 0,
+                                  .wall_elasticity = 1,
+                                  .time_limit = 300,
+                                  .dt = 1.0 / 60};
+
+/**
+ * Asserts that every kart has exactly one finishing position.
+ */
+void assert_ranked(race_result_t *result) {
+  size_t num_karts = race_result_get_num_karts(result);
+  for (size_t position = 1; position <= num_karts; position++) {
+    size_t kart = race_result_get_kart(result, position);
+    assert(race_result_get_position(result, kart) == position);
+  }
+}
+
+// Tests that a short race finishes with the karts in skill order
+void test_race_finishes() {
+  track_t *track = track_read(SIM_TRACK);
+  race_result_t *result = race_sim_run(track, &SIM_CONFIG, 1);
+  assert(race_result_get_num_karts(result) == SIM_CONFIG.num_karts);
+  assert_ranked(result);
+  double lap_length = track_get_length(track);
+  double last_finish = 0;
+  for (size_t kart = 0; kart < SIM_CONFIG.num_karts; kart++) {
+    assert(race_result_get_kart_type(result, kart) == F1);
+    double finish = race_result_get_finish_time(result, kart);
+    assert(isfinite(finish));
+    assert(within(1e-6, race_result_get_lap_time(result, kart, 0), finish));
+    assert(isclose(race_result_get_distance(result, kart), lap_length));
+    last_finish = fmax(last_finish, finish);
+  }
+  // A spread of a fifth leaves the back of the grid well behind
+  assert(race_result_get_kart(result, 1) == 0);
+  assert(race_result_get_kart(result, SIM_CONFIG.num_karts) ==
+         SIM_CONFIG.num_karts - 1);
+  assert(race_result_get_duration(result) >= last_finish);
+  assert(race_result_get_duration(result) < last_finish + SIM_CONFIG.dt);
+  race_result_free(result);
+  track_free(track);
+}
+
+// Tests that a seed always gives the same race
+void test_race_repeats() {
+  track_t *track = track_read(SIM_TRACK);
+  race_config_t config = SIM_CONFIG;
+  config.kart_type = -1;
+  config.skill_jitter = 0.05;
+  config.time_limit = 30;
+  race_result_t *first = race_sim_run(track, &config, 7);
+  race_result_t *second = race_sim_run(track, &config, 7);
+  for (size_t kart = 0; kart < config.num_karts; kart++) {
+    assert(race_result_get_kart_type(first, kart) ==
+           race_result_get_kart_type(second, kart));
+    assert(race_result_get_skill(first, kart) ==
+           race_result_get_skill(second, kart));
+    assert(race_result_get_distance(first, kart) ==
+           race_result_get_distance(second, kart));
+    assert(race_result_get_wall_hits(first, kart) ==
+           race_result_get_wall_hits(second, kart));
+    assert(race_result_get_kart_hits(first, kart) ==
+           race_result_get_kart_hits(second, kart));
+  }
+  race_result_free(first);
+  race_result_free(second);
+  track_free(track);
+}
+
+// Tests that karts still racing at the time limit are ranked by distance
+void test_time_limit() {
+  track_t *track = track_read(SIM_TRACK);
+  race_config_t config = SIM_CONFIG;
+  config.time_limit = 20;
+  race_result_t *result = race_sim_run(track, &config, 1);
+  assert(within(SIM_CONFIG.dt, race_result_get_duration(result), 20));
+  assert_ranked(result);
+  for (size_t position = 1; position <= config.num_karts; position++) {
+    size_t kart = race_result_get_kart(result, position);
+    assert(race_result_get_finish_time(result, kart) == INFINITY);
+    assert(race_result_get_lap_time(result, kart, 0) == INFINITY);
+    if (position > 1) {
+      size_t ahead = race_result_get_kart(result, position - 1);
+      assert(race_result_get_distance(result, ahead) >=
+             race_result_get_distance(result, kart));
+    }
+  }
+  race_result_free(result);
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_race_finishes)
+  DO_TEST(test_race_repeats)
+  DO_TEST(test_time_limit)
+
+  puts("race_sim_test PASS");
+}
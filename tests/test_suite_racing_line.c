@@ -0,0 +1,166 @@
+#include "racing_line.h"
+#include "test_util.h"
+#include "track.h"
+#include "track_generator.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *LINE_TRACK = "assets/tracks/caltech.trk";
+const racing_limits_t LINE_LIMITS = {.top_speed = 300,
+                                     .lateral_accel = 10,
+                                     .acceleration = 300,
+                                     .braking = 300};
+const double LINE_SAMPLE_SPACING = 10.0;
+// The line keeps 40 units from the edge, less what linear interpolation
+// between stations cuts off a corner
+const double LINE_MIN_CLEARANCE = 30.0;
+
+const track_params_t LINE_CIRCUIT = {.length = 8000,
+                                     .corners = 20,
+                                     .width = 200,
+                                     .wobble = 0.9,
+                                     .size = 400,
+                                     .num_checkpoints = 40,
+                                     .num_box_rows = 4,
+                                     .seed = 3};
+
+/**
+ * Returns the sum of the squared turning angles between points sampled every
+ * LINE_SAMPLE_SPACING along the line, or along the centerline if `line` is
+ * NULL.
+ */
+double total_bending(track_t *track, racing_line_t *line) {
+  double length = track_get_length(track);
+  size_t n = (size_t)(length / LINE_SAMPLE_SPACING);
+  double total = 0;
+  for (size_t i = 0; i < n; i++) {
+    vector_t points[3];
+    for (size_t j = 0; j < 3; j++) {
+      double progress = (i + j) * LINE_SAMPLE_SPACING;
+      points[j] = line == NULL ? track_point_at(track, progress)
+                               : racing_line_point_at(line, progress);
+    }
+    vector_t a = vec_subtract(points[1], points[0]);
+    vector_t b = vec_subtract(points[2], points[1]);
+    double angle = atan2(vec_cross(a, b), vec_dot(a, b));
+    total += angle * angle;
+  }
+  return total;
+}
+
+/**
+ * Asserts that the line stays clear of the walls all the way around.
+ */
+void assert_on_road(track_t *track, racing_line_t *line) {
+  double length = track_get_length(track);
+  for (double progress = 0; progress < length;
+       progress += LINE_SAMPLE_SPACING) {
+    vector_t point = racing_line_point_at(line, progress);
+    assert(track_get_distance(track, point) > LINE_MIN_CLEARANCE);
+  }
+}
+
+// Tests that the line stays on the road and bends less than the centerline
+void test_line_shape() {
+  track_t *track = track_read_text(LINE_TRACK);
+  racing_line_t *line = racing_line_init(track, LINE_LIMITS);
+  assert_on_road(track, line);
+  assert(total_bending(track, line) < 0.5 * total_bending(track, NULL));
+
+  // The line cuts corners, so it leaves the centerline somewhere
+  double widest = 0;
+  for (size_t i = 0; i < racing_line_get_size(line); i++) {
+    widest = fmax(widest, fabs(racing_line_get_offset(line, i)));
+  }
+  assert(widest > LINE_MIN_CLEARANCE);
+  racing_line_free(line);
+  track_free(track);
+}
+
+// Tests that the line follows the track as the scene scrolls
+void test_line_origin() {
+  track_t *track = track_read_text(LINE_TRACK);
+  racing_line_t *line = racing_line_init(track, LINE_LIMITS);
+  vector_t before = racing_line_point_at(line, 1000);
+  vector_t shift = {.x = -350, .y = 125};
+  track_set_origin(track, shift);
+  vector_t after = racing_line_point_at(line, 1000);
+  assert(vec_isclose(after, vec_add(before, shift)));
+  // Progress wraps around the lap
+  double length = track_get_length(track);
+  assert(vec_isclose(racing_line_point_at(line, 1000 + length), after));
+  assert(vec_isclose(racing_line_point_at(line, 1000 - length), after));
+  racing_line_free(line);
+  track_free(track);
+}
+
+// Tests that the speed profile respects the kart's limits
+void test_line_speeds() {
+  track_t *track = track_read_text(LINE_TRACK);
+  racing_line_t *line = racing_line_init(track, LINE_LIMITS);
+  double length = track_get_length(track);
+  size_t size = racing_line_get_size(line);
+  double spacing = length / size;
+  double slowest = INFINITY;
+  double fastest = 0;
+  for (size_t i = 0; i < size; i++) {
+    double speed = racing_line_speed_at(line, i * spacing);
+    assert(speed > 0 && speed <= LINE_LIMITS.top_speed + 1e-3);
+    // Neither speeding up nor slowing down faster than the kart can over the
+    // distance to the next station
+    double next = racing_line_speed_at(line, (i + 1) * spacing);
+    double d = vec_get_length(vec_subtract(
+        racing_line_point_at(line, (i + 1) * spacing),
+        racing_line_point_at(line, i * spacing)));
+    double dv2 = next * next - speed * speed;
+    assert(dv2 <= 2 * LINE_LIMITS.acceleration * d + 1);
+    assert(-dv2 <= 2 * LINE_LIMITS.braking * d + 1);
+    slowest = fmin(slowest, speed);
+    fastest = fmax(fastest, speed);
+  }
+  assert(within(1e-3, fastest, LINE_LIMITS.top_speed));
+  assert(slowest < 0.5 * LINE_LIMITS.top_speed);
+
+  // A grippier kart corners faster
+  racing_limits_t grippy = LINE_LIMITS;
+  grippy.lateral_accel *= 2;
+  racing_line_t *fast_line = racing_line_init(track, grippy);
+  double fast_slowest = INFINITY;
+  for (double progress = 0; progress < length;
+       progress += LINE_SAMPLE_SPACING) {
+    double speed = racing_line_speed_at(fast_line, progress);
+    fast_slowest = fmin(fast_slowest, speed);
+  }
+  assert(fast_slowest > slowest);
+  racing_line_free(fast_line);
+  racing_line_free(line);
+  track_free(track);
+}
+
+// Tests a twisty generated circuit
+void test_generated_line() {
+  track_t *track = track_generate(&LINE_CIRCUIT);
+  racing_line_t *line = racing_line_init(track, LINE_LIMITS);
+  assert_on_road(track, line);
+  assert(total_bending(track, line) < total_bending(track, NULL));
+  racing_line_free(line);
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_line_shape)
+  DO_TEST(test_line_origin)
+  DO_TEST(test_line_speeds)
+  DO_TEST(test_generated_line)
+
+  puts("racing_line_test PASS");
+}
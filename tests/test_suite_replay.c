@@ -0,0 +1,142 @@
+#include "replay.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+const char *REPLAY_FILE = "/tmp/replay_test.ckr";
+const size_t REPLAY_TICKS = 600;
+const replay_setup_t REPLAY_SETUP = {
+    .seed = 12345, .track_idx = 2, .car_type = 1, .villain_type = 3};
+
+/**
+ * The controls at a tick of a made-up race: the throttle held throughout,
+ * steering now and then, an item used every second and a frame rate that
+ * changes every few seconds.
+ */
+void make_tick(size_t tick, double *dt, input_snapshot_t *input) {
+  *dt = tick / 200 % 2 == 0 ? 1.0 / 60 : 1.0 / 30 + tick * 1e-6;
+  input->held = 1 << ACTION_AHEAD;
+  if (tick % 90 < 20) {
+    input->held |= 1 << ACTION_LEFT;
+  }
+  input->pressed = tick % 60 == 0 ? 1 << ACTION_ITEM : 0;
+  for (size_t i = 0; i < NUM_ACTIONS; i++) {
+    input->held_times[i] = input->held & (1 << i) ? tick * 0.01f + i : 0;
+  }
+}
+
+replay_t *record_race() {
+  replay_t *replay = replay_init(&REPLAY_SETUP);
+  for (size_t tick = 0; tick < REPLAY_TICKS; tick++) {
+    double dt;
+    input_snapshot_t input;
+    make_tick(tick, &dt, &input);
+    replay_record(replay, dt, &input);
+  }
+  assert(replay_size(replay) == REPLAY_TICKS);
+  return replay;
+}
+
+void assert_plays_back(replay_t *replay) {
+  replay_setup_t setup = replay_get_setup(replay);
+  assert(setup.seed == REPLAY_SETUP.seed);
+  assert(setup.track_idx == REPLAY_SETUP.track_idx);
+  assert(setup.car_type == REPLAY_SETUP.car_type);
+  assert(setup.villain_type == REPLAY_SETUP.villain_type);
+  for (size_t tick = 0; tick < REPLAY_TICKS; tick++) {
+    double dt, expected_dt;
+    input_snapshot_t input, expected;
+    make_tick(tick, &expected_dt, &expected);
+    assert(replay_next(replay, &dt, &input));
+    assert(dt == expected_dt);
+    assert(input.held == expected.held);
+    assert(input.pressed == expected.pressed);
+    for (size_t i = 0; i < NUM_ACTIONS; i++) {
+      assert(input.held_times[i] == expected.held_times[i]);
+    }
+  }
+  double dt = -1;
+  input_snapshot_t input;
+  assert(!replay_next(replay, &dt, &input));
+  assert(dt == -1);
+}
+
+// Tests that every tick plays back exactly as it was recorded
+void test_playback() {
+  replay_t *replay = record_race();
+  assert_plays_back(replay);
+  replay_free(replay);
+}
+
+// Tests that a recording survives being written to and read from a file
+void test_file() {
+  replay_t *replay = record_race();
+  assert(replay_write(replay, REPLAY_FILE));
+  replay_t *read = replay_read(REPLAY_FILE);
+  assert(read != NULL);
+  assert(replay_size(read) == REPLAY_TICKS);
+  assert_plays_back(read);
+  replay_free(read);
+
+  // A truncated file is rejected
+  FILE *file = fopen(REPLAY_FILE, "r+b");
+  assert(file != NULL);
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fclose(file);
+  // Unchanged ticks take a byte, and held actions their hold times
+  assert(length < (long)(REPLAY_TICKS * 12));
+  assert(truncate(REPLAY_FILE, length - 1) == 0);
+  assert(replay_read(REPLAY_FILE) == NULL);
+  remove(REPLAY_FILE);
+  assert(replay_read(REPLAY_FILE) == NULL);
+  replay_free(replay);
+}
+
+/**
+ * Overwrites the 32-bit number at the given offset of the replay file.
+ */
+void patch_file(long offset, uint32_t value) {
+  FILE *file = fopen(REPLAY_FILE, "r+b");
+  assert(file != NULL);
+  fseek(file, offset, SEEK_SET);
+  assert(fwrite(&value, sizeof(value), 1, file) == 1);
+  fclose(file);
+}
+
+// Tests that a header whose tick count or size does not fit the file is
+// rejected before anything is allocated for it
+void test_corrupt_header() {
+  replay_t *replay = record_race();
+  // The tick count and size follow the magic and the version
+  long num_ticks_offset = 12;
+  long size_offset = 16;
+  assert(replay_write(replay, REPLAY_FILE));
+  patch_file(size_offset, UINT32_MAX);
+  assert(replay_read(REPLAY_FILE) == NULL);
+  assert(replay_write(replay, REPLAY_FILE));
+  patch_file(num_ticks_offset, UINT32_MAX);
+  assert(replay_read(REPLAY_FILE) == NULL);
+  remove(REPLAY_FILE);
+  replay_free(replay);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_playback)
+  DO_TEST(test_file)
+  DO_TEST(test_corrupt_header)
+
+  puts("replay_test PASS");
+}
@@ -0,0 +1,57 @@
+#include "rng.h"
+#include "test_util.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+// Tests that a seed always gives the same numbers, and other seeds others
+void test_repeatable() {
+  uint64_t a = rng_seed(7);
+  uint64_t b = rng_seed(7);
+  uint64_t c = rng_seed(8);
+  assert(a == b && a != c);
+  for (size_t i = 0; i < 100; i++) {
+    uint64_t next = rng_next(&a);
+    assert(next == rng_next(&b));
+    assert(next != rng_next(&c));
+  }
+}
+
+// Tests that the state never gets stuck at zero
+void test_never_zero() {
+  for (uint64_t seed = 0; seed < 1000; seed++) {
+    uint64_t state = rng_seed(seed);
+    assert(state != 0);
+    assert(rng_next(&state) != 0);
+  }
+}
+
+// Tests that signed numbers stay in [-1, 1) and fall on both sides of zero
+void test_signed() {
+  uint64_t state = rng_seed(3);
+  size_t negative = 0;
+  for (size_t i = 0; i < 1000; i++) {
+    double x = rng_signed(&state);
+    assert(-1 <= x && x < 1);
+    if (x < 0) {
+      negative++;
+    }
+  }
+  assert(400 < negative && negative < 600);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_repeatable)
+  DO_TEST(test_never_zero)
+  DO_TEST(test_signed)
+
+  puts("rng_test PASS");
+}
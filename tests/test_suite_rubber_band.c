@@ -0,0 +1,126 @@
+#include "car.h"
+#include "checkpoints.h"
+#include "rubber_band.h"
+#include "scene.h"
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const char *BAND_TRACK = "assets/tracks/caltech.trk";
+const double BAND_DT = 1.0 / 60;
+const double BAND_SKILL = 0.9;
+const rubber_band_config_t BAND_CONFIG = {.max_scale = 1.1,
+                                          .min_scale = 0.8,
+                                          .gap_range = 1000,
+                                          .response = 1,
+                                          .rate = 2};
+
+/**
+ * The player's kart and two AI karts, all in the standings in that order.
+ */
+typedef struct race {
+  track_t *track;
+  scene_t *scene;
+  list_t *karts;
+  ai_field_t *field;
+  standings_t *standings;
+  rubber_band_t *band;
+} race_t;
+
+race_t make_race() {
+  race_t race;
+  race.track = track_read(BAND_TRACK);
+  race.scene = scene_init();
+  race.karts = list_init(3, NULL);
+  race.field = ai_field_init(race.track, 2);
+  for (size_t i = 0; i < 3; i++) {
+    body_t *car = make_car(F1);
+    car_set_checkpoint_state(car, checkpoint_state_init(race.track));
+    scene_add_body(race.scene, car);
+    list_add(race.karts, car);
+    if (i > 0) {
+      ai_field_add(race.field, car, BAND_SKILL);
+    }
+  }
+  race.standings = standings_init(3, track_get_length(race.track));
+  race.band = rubber_band_init(race.field, race.karts,
+                               list_get(race.karts, 0), &BAND_CONFIG);
+  return race;
+}
+
+void free_race(race_t race) {
+  rubber_band_free(race.band);
+  standings_free(race.standings);
+  ai_field_free(race.field);
+  list_free(race.karts);
+  scene_free(race.scene);
+  track_free(race.track);
+}
+
+void set_distances(race_t race, double player, double first, double second) {
+  standings_set_progress(race.standings, 0, 0, player);
+  standings_set_progress(race.standings, 1, 0, first);
+  standings_set_progress(race.standings, 2, 0, second);
+  standings_update(race.standings);
+}
+
+void run(race_t race, double time) {
+  for (size_t i = 0; i < time / BAND_DT; i++) {
+    rubber_band_update(race.band, race.standings, BAND_DT);
+  }
+}
+
+// Tests that karts behind speed up and karts ahead slow down, within bounds
+void test_pull() {
+  race_t race = make_race();
+  assert(rubber_band_get_scale(race.band, 0) == 1);
+  assert(isclose(ai_field_get_skill(race.field, 0), BAND_SKILL));
+  // Half the gap range behind and far ahead
+  set_distances(race, 2000, 1500, 5000);
+  run(race, 20);
+  assert(fabs(rubber_band_get_scale(race.band, 0) - 1.05) < 1e-3);
+  assert(fabs(rubber_band_get_scale(race.band, 1) - 0.8) < 1e-3);
+  assert(fabs(ai_field_get_skill(race.field, 1) - 0.8 * BAND_SKILL) < 1e-3);
+  // Level with the player
+  set_distances(race, 2000, 2000, 2000);
+  run(race, 20);
+  assert(fabs(rubber_band_get_scale(race.band, 0) - 1) < 1e-3);
+  assert(fabs(ai_field_get_skill(race.field, 1) - BAND_SKILL) < 1e-3);
+  free_race(race);
+}
+
+// Tests that the scales change only a few times a second, and smoothly
+void test_rate() {
+  race_t race = make_race();
+  set_distances(race, 5000, 0, 0);
+  // Not yet time for an update
+  run(race, 0.4);
+  assert(rubber_band_get_scale(race.band, 0) == 1);
+  // The first update eases part of the way
+  run(race, 0.15);
+  double scale = rubber_band_get_scale(race.band, 0);
+  assert(scale > 1 && scale < 1.1);
+  assert(isclose(ai_field_get_skill(race.field, 0), BAND_SKILL * scale));
+  run(race, 0.4);
+  assert(rubber_band_get_scale(race.band, 0) == scale);
+  run(race, 0.15);
+  assert(rubber_band_get_scale(race.band, 0) > scale);
+  free_race(race);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_pull)
+  DO_TEST(test_rate)
+
+  puts("rubber_band_test PASS");
+}
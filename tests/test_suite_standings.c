@@ -0,0 +1,109 @@
+#include "standings.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const double LAP_LENGTH = 1000;
+
+// Tests that karts start in index order with no gaps
+void test_init() {
+  standings_t *standings = standings_init(4, LAP_LENGTH);
+  assert(standings_get_num_karts(standings) == 4);
+  for (size_t i = 0; i < 4; i++) {
+    assert(standings_get_position(standings, i) == i + 1);
+    assert(standings_get_kart(standings, i + 1) == i);
+    assert(standings_gap_to_leader(standings, i) == 0);
+  }
+  standings_free(standings);
+}
+
+// Tests that laps count for more than progress into the lap
+void test_order() {
+  standings_t *standings = standings_init(3, LAP_LENGTH);
+  standings_set_progress(standings, 0, 0, 900);
+  standings_set_progress(standings, 1, 1, 100);
+  standings_set_progress(standings, 2, 0, -20);
+  standings_update(standings);
+  assert(standings_get_position(standings, 1) == 1);
+  assert(standings_get_position(standings, 0) == 2);
+  assert(standings_get_position(standings, 2) == 3);
+  assert(standings_get_kart(standings, 1) == 1);
+  assert(within(1e-9, standings_gap_to_leader(standings, 0), 200));
+  assert(within(1e-9, standings_gap_to_leader(standings, 2), 1120));
+  assert(within(1e-9, standings_gap_to_next(standings, 2), 920));
+  assert(standings_gap_to_next(standings, 1) == 0);
+  assert(within(1e-9, standings_get_distance(standings, 1), 1100));
+  standings_free(standings);
+}
+
+// Tests that tied karts keep their previous order
+void test_ties() {
+  standings_t *standings = standings_init(3, LAP_LENGTH);
+  standings_set_progress(standings, 2, 0, 50);
+  standings_update(standings);
+  assert(standings_get_kart(standings, 1) == 2);
+  standings_set_progress(standings, 0, 0, 50);
+  standings_set_progress(standings, 1, 0, 50);
+  standings_update(standings);
+  assert(standings_get_kart(standings, 1) == 2);
+  assert(standings_get_kart(standings, 2) == 0);
+  assert(standings_get_kart(standings, 3) == 1);
+  standings_free(standings);
+}
+
+// Tests a full field against a from-scratch ranking as karts overtake
+void test_many_karts() {
+  size_t num_karts = STANDINGS_MAX_KARTS;
+  standings_t *standings = standings_init(num_karts, LAP_LENGTH);
+  double *distance = malloc(num_karts * sizeof(double));
+  assert(distance != NULL);
+  for (size_t i = 0; i < num_karts; i++) {
+    distance[i] = 0;
+  }
+  srand(7);
+  for (size_t tick = 0; tick < 500; tick++) {
+    for (size_t i = 0; i < num_karts; i++) {
+      distance[i] += rand() % 40;
+      size_t laps = (size_t)(distance[i] / LAP_LENGTH);
+      standings_set_progress(standings, i, laps,
+                             distance[i] - laps * LAP_LENGTH);
+    }
+    standings_update(standings);
+    for (size_t i = 0; i < num_karts; i++) {
+      size_t ahead = 0;
+      size_t tied = 0;
+      for (size_t j = 0; j < num_karts; j++) {
+        if (distance[j] > distance[i]) {
+          ahead++;
+        } else if (j != i && distance[j] == distance[i]) {
+          tied++;
+        }
+      }
+      // Ties may be in either order
+      size_t position = standings_get_position(standings, i);
+      assert(position > ahead && position <= ahead + tied + 1);
+      assert(standings_get_kart(standings, position) == i);
+      assert(standings_gap_to_next(standings, i) >= 0);
+    }
+  }
+  free(distance);
+  standings_free(standings);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_init)
+  DO_TEST(test_order)
+  DO_TEST(test_ties)
+  DO_TEST(test_many_karts)
+
+  puts("standings_test PASS");
+}
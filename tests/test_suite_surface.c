@@ -0,0 +1,76 @@
+#include "surface.h"
+#include "test_util.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// Tests that points map to the cell containing them
+void test_lookup() {
+  surface_map_t *map = surface_map_init((vector_t){-100, -50},
+                                        (vector_t){100, 50}, 10, SURFACE_SAND);
+  assert(surface_map_get_width(map) == 20);
+  assert(surface_map_get_height(map) == 10);
+  assert(surface_map_get(map, (vector_t){0, 0}) == SURFACE_SAND);
+  assert(vec_isclose(surface_map_get_cell_center(map, 10, 5),
+                     (vector_t){5, 5}));
+  surface_map_set_cell(map, 10, 5, SURFACE_BOOST);
+  assert(surface_map_get(map, (vector_t){0.5, 0.5}) == SURFACE_BOOST);
+  assert(surface_map_get(map, (vector_t){9.5, 9.5}) == SURFACE_BOOST);
+  assert(surface_map_get(map, (vector_t){10.5, 9.5}) == SURFACE_SAND);
+  // Off the map is grass
+  assert(surface_map_get(map, (vector_t){-101, 0}) == SURFACE_GRASS);
+  assert(surface_map_get(map, (vector_t){0, 50}) == SURFACE_GRASS);
+  surface_map_free(map);
+}
+
+// Tests that regions cover the cells whose centers they contain
+void test_fill() {
+  surface_map_t *map = surface_map_init((vector_t){0, 0}, (vector_t){100, 100},
+                                        10, SURFACE_ASPHALT);
+  surface_map_fill(map, (surface_region_t){.min = {12, 0},
+                                           .max = {38, 20},
+                                           .type = SURFACE_GRASS});
+  assert(surface_map_get(map, (vector_t){5, 5}) == SURFACE_ASPHALT);
+  assert(surface_map_get(map, (vector_t){21, 5}) == SURFACE_GRASS);
+  assert(surface_map_get(map, (vector_t){31, 15}) == SURFACE_GRASS);
+  assert(surface_map_get(map, (vector_t){31, 25}) == SURFACE_ASPHALT);
+  assert(surface_map_get(map, (vector_t){45, 5}) == SURFACE_ASPHALT);
+  // Regions hanging off the map are clipped
+  surface_map_fill(map, (surface_region_t){.min = {90, 90},
+                                           .max = {500, 500},
+                                           .type = SURFACE_BOOST});
+  assert(surface_map_get(map, (vector_t){95, 95}) == SURFACE_BOOST);
+  assert(surface_map_get(map, (vector_t){85, 95}) == SURFACE_ASPHALT);
+  surface_map_free(map);
+}
+
+// Tests surface names and that only asphalt leaves karts at full speed
+void test_properties() {
+  surface_type_t type;
+  assert(surface_parse_type("sand", &type) && type == SURFACE_SAND);
+  assert(surface_parse_type("boost", &type) && type == SURFACE_BOOST);
+  assert(!surface_parse_type("lava", &type));
+  surface_properties_t asphalt = surface_get_properties(SURFACE_ASPHALT);
+  surface_properties_t grass = surface_get_properties(SURFACE_GRASS);
+  surface_properties_t sand = surface_get_properties(SURFACE_SAND);
+  surface_properties_t boost = surface_get_properties(SURFACE_BOOST);
+  assert(grass.drag > asphalt.drag && sand.drag > grass.drag);
+  assert(sand.friction > grass.friction);
+  assert(boost.thrust > 0 && asphalt.thrust == 0);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_lookup)
+  DO_TEST(test_fill)
+  DO_TEST(test_properties)
+
+  puts("surface_test PASS");
+}
@@ -0,0 +1,157 @@
+#include "test_util.h"
+#include "timer_wheel.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+const double WHEEL_TICK = 0.25;
+const size_t WHEEL_SLOTS = 8;
+
+typedef struct calls {
+  size_t count;
+  double times[8];
+  int tags[8];
+  timer_wheel_t *wheel;
+} calls_t;
+
+typedef struct tagged {
+  calls_t *calls;
+  int tag;
+} tagged_t;
+
+void record_call(void *aux) {
+  tagged_t *tagged = aux;
+  calls_t *calls = tagged->calls;
+  assert(calls->count < 8);
+  calls->times[calls->count] = timer_wheel_get_time(calls->wheel);
+  calls->tags[calls->count] = tagged->tag;
+  calls->count++;
+}
+
+// Tests that timers are called at their exact times, in order
+void test_order() {
+  timer_wheel_t *wheel = timer_wheel_init(WHEEL_TICK, WHEEL_SLOTS);
+  calls_t calls = {.count = 0, .wheel = wheel};
+  tagged_t tags[4];
+  double delays[] = {1.1, 0.3, 0.35, 0.3};
+  for (int i = 0; i < 4; i++) {
+    tags[i] = (tagged_t){.calls = &calls, .tag = i};
+    timer_wheel_schedule(wheel, delays[i], record_call, &tags[i]);
+  }
+  assert(timer_wheel_size(wheel) == 4);
+  timer_wheel_advance(wheel, 0.25);
+  assert(calls.count == 0);
+  timer_wheel_advance(wheel, 0.25);
+  assert(calls.count == 3);
+  assert(calls.tags[0] == 1 || calls.tags[0] == 3);
+  assert(calls.tags[2] == 2);
+  assert(isclose(calls.times[0], 0.3));
+  assert(isclose(calls.times[2], 0.35));
+  assert(timer_wheel_get_time(wheel) == 0.5);
+  timer_wheel_advance(wheel, 1);
+  assert(calls.count == 4);
+  assert(calls.tags[3] == 0 && isclose(calls.times[3], 1.1));
+  assert(timer_wheel_size(wheel) == 0);
+  timer_wheel_free(wheel);
+}
+
+// Tests timers more than a turn of the wheel ahead, and long advances
+void test_wrap() {
+  timer_wheel_t *wheel = timer_wheel_init(WHEEL_TICK, WHEEL_SLOTS);
+  calls_t calls = {.count = 0, .wheel = wheel};
+  tagged_t late = {.calls = &calls, .tag = 0};
+  tagged_t early = {.calls = &calls, .tag = 1};
+  // Both land in the same slot, a turn apart
+  timer_wheel_schedule(wheel, 0.1 + WHEEL_TICK * WHEEL_SLOTS, record_call,
+                       &late);
+  timer_wheel_schedule(wheel, 0.1, record_call, &early);
+  timer_wheel_advance(wheel, 0.2);
+  assert(calls.count == 1 && calls.tags[0] == 1);
+  timer_wheel_advance(wheel, 1.5);
+  assert(calls.count == 1);
+  // One advance across several turns
+  timer_wheel_schedule(wheel, 5, record_call, &early);
+  timer_wheel_advance(wheel, 10);
+  assert(calls.count == 3);
+  assert(calls.tags[1] == 0 && isclose(calls.times[1], 2.1));
+  assert(calls.tags[2] == 1 && isclose(calls.times[2], 6.7));
+  timer_wheel_free(wheel);
+}
+
+// Tests that cancelled timers are never called, and that old IDs stay dead
+void test_cancel() {
+  timer_wheel_t *wheel = timer_wheel_init(WHEEL_TICK, WHEEL_SLOTS);
+  calls_t calls = {.count = 0, .wheel = wheel};
+  tagged_t tag = {.calls = &calls, .tag = 0};
+  assert(!timer_wheel_cancel(wheel, NO_TIMER));
+  timer_id_t first = timer_wheel_schedule(wheel, 1, record_call, &tag);
+  assert(isclose(timer_wheel_get_remaining(wheel, first), 1));
+  timer_wheel_advance(wheel, 0.5);
+  assert(isclose(timer_wheel_get_remaining(wheel, first), 0.5));
+  assert(timer_wheel_cancel(wheel, first));
+  assert(!timer_wheel_cancel(wheel, first));
+  assert(timer_wheel_get_remaining(wheel, first) == 0);
+  // The entry is reused, but not the ID
+  timer_id_t second = timer_wheel_schedule(wheel, 1, record_call, &tag);
+  assert(second != first);
+  assert(!timer_wheel_cancel(wheel, first));
+  timer_wheel_advance(wheel, 2);
+  assert(calls.count == 1);
+  assert(!timer_wheel_cancel(wheel, second));
+  timer_wheel_free(wheel);
+}
+
+typedef struct chain {
+  timer_wheel_t *wheel;
+  size_t links;
+  double last;
+  timer_id_t victim;
+} chain_t;
+
+void extend_chain(void *aux) {
+  chain_t *chain = aux;
+  chain->last = timer_wheel_get_time(chain->wheel);
+  timer_wheel_cancel(chain->wheel, chain->victim);
+  if (++chain->links < 3) {
+    timer_wheel_schedule(chain->wheel, 0.1, extend_chain, chain);
+  }
+}
+
+void never_called(void *aux) { assert(false); }
+
+// Tests that callbacks may schedule and cancel timers
+void test_callbacks() {
+  timer_wheel_t *wheel = timer_wheel_init(WHEEL_TICK, WHEEL_SLOTS);
+  chain_t chain = {.wheel = wheel, .links = 0, .last = 0};
+  chain.victim = timer_wheel_schedule(wheel, 0.3, never_called, NULL);
+  timer_wheel_schedule(wheel, 0.2, extend_chain, &chain);
+  // The timers scheduled by the callbacks start when their callers ran out
+  timer_wheel_advance(wheel, 1);
+  assert(chain.links == 3);
+  assert(isclose(chain.last, 0.4));
+  assert(timer_wheel_size(wheel) == 0);
+
+  // Many timers grow the pool
+  for (size_t i = 0; i < 100; i++) {
+    timer_wheel_schedule(wheel, i * 0.01, never_called, NULL);
+  }
+  assert(timer_wheel_size(wheel) == 100);
+  timer_wheel_free(wheel);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_order)
+  DO_TEST(test_wrap)
+  DO_TEST(test_cancel)
+  DO_TEST(test_callbacks)
+
+  puts("timer_wheel_test PASS");
+}
@@ -0,0 +1,356 @@
+#include "test_util.h"
+#include "track.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const char *CALTECH_TRACK = "assets/tracks/caltech.trk";
+const char *CLASSIC_TRACK = "assets/tracks/caltech_classic.trk";
+const char *BINARY_TRACK = "/tmp/caltech_test.bin";
+const char *TEXT_TRACK = "/tmp/caltech_test.trk";
+
+// Tests that the text track bakes the layout the game was built around
+void test_text_track() {
+  track_t *track = track_read_text(CALTECH_TRACK);
+  assert(track != NULL);
+  assert(strcmp(track_get_name(track), "Caltech") == 0);
+  assert(track_get_size(track) == 16);
+  assert(track_get_num_walls(track) == 32);
+  assert(track_get_num_checkpoints(track) == 17);
+  assert(track_get_num_boxes(track) == 24);
+  assert(track_get_num_spawns(track) == 2);
+
+  // Start line and the first checkpoint after it
+  const vector_t *start = track_get_checkpoint(track, 0);
+  assert(vec_isclose(start[0], (vector_t){408, 200}));
+  assert(vec_isclose(start[1], (vector_t){640, 200}));
+  const vector_t *first = track_get_checkpoint(track, 1);
+  assert(vec_isclose(first[0], track_get_inner(track)[3]));
+  assert(vec_isclose(first[1], track_get_outer(track)[3]));
+
+  // The centerline is halfway between the boundaries
+  vector_t mid = vec_multiply(
+      0.5, vec_add(track_get_inner(track)[5], track_get_outer(track)[5]));
+  assert(vec_isclose(track_get_centerline(track)[5], mid));
+
+  // Walls run along the boundaries and face the road
+  segment_t wall = track_get_wall(track, 0);
+  assert(vec_isclose(wall.start, (vector_t){-4, -2610}));
+  assert(vec_isclose(wall.end, (vector_t){204, -2610}));
+  assert(vec_isclose(wall.normal, (vector_t){0, -1}));
+  segment_t outside = track_get_wall(track, 16);
+  assert(vec_isclose(outside.start, (vector_t){-98, -2840}));
+  assert(vec_isclose(outside.normal, (vector_t){0, 1}));
+
+  spawn_t spawn = track_get_spawn(track, 0);
+  assert(vec_isclose(spawn.position, (vector_t){600, 200}));
+  assert(within(1e-6, spawn.rotation, M_PI));
+
+  assert(track_get_num_sectors(track) == 3);
+  assert(track_get_sector_checkpoint(track, 1) == 6);
+  assert(track_get_sector_progress(track, 2) ==
+         track_get_checkpoint_progress(track, 12));
+  track_free(track);
+}
+
+// Tests a second layout whose name has a space and whose boxes are derived
+void test_classic_track() {
+  track_t *track = track_read_text(CLASSIC_TRACK);
+  assert(track != NULL);
+  assert(strcmp(track_get_name(track), "Caltech Classic") == 0);
+  assert(track_get_num_checkpoints(track) == 17);
+  assert(track_get_num_boxes(track) == 24);
+  for (size_t i = 0; i < track_get_num_spawns(track); i++) {
+    assert(track_on_road(track, track_get_spawn(track, i).position));
+  }
+  for (size_t i = 0; i < track_get_num_boxes(track); i++) {
+    assert(track_on_road(track, track_get_boxes(track)[i]));
+  }
+  assert(track_get_surface(track, (vector_t){640, 1180}) == SURFACE_BOOST);
+
+  // Without a sectors section the lap is split into thirds
+  assert(track_get_num_sectors(track) == 3);
+  assert(track_get_sector_checkpoint(track, 0) == 0);
+  assert(track_get_sector_checkpoint(track, 1) == 5);
+  assert(track_get_sector_checkpoint(track, 2) == 11);
+  track_free(track);
+}
+
+// Tests that a binary track reads back exactly what was written
+void test_binary_round_trip() {
+  track_t *text = track_read_text(CALTECH_TRACK);
+  assert(track_write_binary(text, BINARY_TRACK));
+  track_t *binary = track_read_binary(BINARY_TRACK);
+  assert(binary != NULL);
+  assert(strcmp(track_get_name(binary), track_get_name(text)) == 0);
+  assert(track_get_size(binary) == track_get_size(text));
+  for (size_t i = 0; i < track_get_num_walls(text); i++) {
+    segment_t expected = track_get_wall(text, i);
+    segment_t actual = track_get_wall(binary, i);
+    assert(vec_equal(actual.start, expected.start));
+    assert(vec_equal(actual.end, expected.end));
+    assert(vec_equal(actual.normal, expected.normal));
+  }
+  for (size_t i = 0; i < track_get_num_boxes(text); i++) {
+    assert(vec_equal(track_get_boxes(binary)[i], track_get_boxes(text)[i]));
+  }
+  assert(vec_equal(track_get_min(binary), track_get_min(text)));
+  assert(vec_equal(track_get_max(binary), track_get_max(text)));
+  assert(track_get_num_sectors(binary) == track_get_num_sectors(text));
+  for (size_t i = 0; i < track_get_num_sectors(text); i++) {
+    assert(track_get_sector_checkpoint(binary, i) ==
+           track_get_sector_checkpoint(text, i));
+  }
+  for (double y = 0; y < 3000; y += 40) {
+    vector_t point = {524, y};
+    assert(track_get_surface(binary, point) == track_get_surface(text, point));
+  }
+  track_free(text);
+  track_free(binary);
+  remove(BINARY_TRACK);
+}
+
+/**
+ * Writes the given bytes of a binary track, with the little-endian number
+ * at `offset` replaced by `value` if `offset` is not SIZE_MAX.
+ */
+void write_patched(const uint8_t *bytes, size_t length, size_t offset,
+                   uint32_t value) {
+  FILE *file = fopen(BINARY_TRACK, "wb");
+  assert(file != NULL);
+  fwrite(bytes, 1, length, file);
+  if (offset != SIZE_MAX) {
+    uint8_t number[] = {value, value >> 8, value >> 16, value >> 24};
+    fseek(file, offset, SEEK_SET);
+    fwrite(number, 1, sizeof(number), file);
+  }
+  fclose(file);
+}
+
+// Tests that binary tracks that are cut short, too long or have counts a
+// track cannot have are rejected
+void test_binary_malformed() {
+  track_t *text = track_read_text(CALTECH_TRACK);
+  assert(track_write_binary(text, BINARY_TRACK));
+  track_free(text);
+  FILE *file = fopen(BINARY_TRACK, "rb");
+  fseek(file, 0, SEEK_END);
+  size_t length = ftell(file);
+  rewind(file);
+  // Room for one byte past the end
+  uint8_t *bytes = calloc(length + 1, 1);
+  assert(bytes != NULL);
+  assert(fread(bytes, 1, length, file) == length);
+  fclose(file);
+
+  write_patched(bytes, length, SIZE_MAX, 0);
+  track_t *track = track_read_binary(BINARY_TRACK);
+  assert(track != NULL);
+  track_free(track);
+  write_patched(bytes, length - 1, SIZE_MAX, 0);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  write_patched(bytes, length + 1, SIZE_MAX, 0);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  write_patched(bytes, 20, SIZE_MAX, 0);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  // The counts follow the magic and the version: size, checkpoints, boxes,
+  // spawns, regions, sectors
+  write_patched(bytes, length, 12, 2);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  write_patched(bytes, length, 16, 1);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  write_patched(bytes, length, 24, 0);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  write_patched(bytes, length, 32, 0);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  // The last sector starts past the last checkpoint
+  write_patched(bytes, length, length - sizeof(uint32_t), 1000);
+  assert(track_read_binary(BINARY_TRACK) == NULL);
+  free(bytes);
+  remove(BINARY_TRACK);
+}
+
+/**
+ * Reads a text track holding only the given section.
+ */
+track_t *read_text_section(const char *section) {
+  FILE *file = fopen(TEXT_TRACK, "w");
+  assert(file != NULL);
+  fprintf(file, "name Test\n%s\n", section);
+  fclose(file);
+  return track_read_text(TEXT_TRACK);
+}
+
+// Tests that section counts too large to allocate, or whose array size
+// overflows, are rejected rather than trusted
+void test_text_malformed() {
+  // 2^61 entries of 16 bytes wrap round to 0 bytes
+  assert(read_text_section("inner 2305843009213693952\n1 2") == NULL);
+  assert(read_text_section("inner 4000000000\n1 2") == NULL);
+  assert(read_text_section("checkpoints 18446744073709551615\n1 2 3 4") ==
+         NULL);
+  assert(read_text_section("sectors 4000000000\n0 1") == NULL);
+  assert(read_text_section("surfaces 4000000000\ngrass 0 0 1 1") == NULL);
+  assert(read_text_section("inner -1\n1 2") == NULL);
+  remove(TEXT_TRACK);
+}
+
+// Tests that progress along the centerline round-trips through positions
+void test_arc_length() {
+  track_t *track = track_read_text(CALTECH_TRACK);
+  double length = track_get_length(track);
+  assert(length > 0);
+
+  // Progress is measured from the middle of the start line
+  const vector_t *start = track_get_checkpoint(track, 0);
+  vector_t start_mid = vec_multiply(0.5, vec_add(start[0], start[1]));
+  assert(vec_within(1e-6, track_point_at(track, 0), start_mid));
+  assert(vec_within(1e-6, track_point_at(track, length), start_mid));
+
+  // Checkpoints are in order around the lap
+  for (size_t i = 1; i < track_get_num_checkpoints(track); i++) {
+    double progress = track_get_checkpoint_progress(track, i);
+    assert(progress > track_get_checkpoint_progress(track, i - 1));
+    assert(progress < length);
+    assert(track_find_checkpoint(track, progress) == i);
+    assert(track_find_checkpoint(track, progress - 1) == i - 1);
+  }
+
+  // Walking around the lap with a segment hint matches a full search
+  size_t hint = SIZE_MAX;
+  for (double s = 0; s < length; s += 37) {
+    vector_t point = track_point_at(track, s);
+    double progress = track_project(track, point, &hint);
+    assert(within(1e-6, progress, s));
+    assert(hint == track_segment_at(track, s));
+    size_t full = SIZE_MAX;
+    assert(within(1e-6, track_project(track, point, &full), s));
+  }
+
+  // Queries follow the origin as the scene moves
+  vector_t shift = {-300, 125};
+  track_set_origin(track, shift);
+  assert(vec_within(1e-6, track_point_at(track, 0), vec_add(start_mid, shift)));
+  hint = SIZE_MAX;
+  assert(within(1e-6, track_project(track, vec_add(start_mid, shift), &hint),
+                0));
+  vector_t direction = track_direction_at(track, 0);
+  assert(within(1e-6, vec_get_length(direction), 1));
+  track_free(track);
+}
+
+// Tests that respawn poses sit on the centerline just behind the progress
+void test_respawn() {
+  track_t *track = track_read_text(CALTECH_TRACK);
+  double length = track_get_length(track);
+  vector_t shift = {250, -75};
+  track_set_origin(track, shift);
+  size_t hint = SIZE_MAX;
+  for (double s = 0; s < length; s += 29) {
+    spawn_t respawn = track_respawn_at(track, s);
+    assert(track_on_road(track, respawn.position));
+    double progress = track_project(track, respawn.position, &hint);
+    assert(progress <= s + 1e-6 && progress > s - 50);
+    vector_t heading = {sin(respawn.rotation), -cos(respawn.rotation)};
+    assert(vec_within(1e-6, heading, track_direction_at(track, progress)));
+  }
+  // Progress wraps around the lap
+  spawn_t wrapped = track_respawn_at(track, length + 10);
+  assert(vec_equal(wrapped.position, track_respawn_at(track, 10).position));
+  assert(vec_within(1e-6, track_respawn_at(track, -1).position,
+                    track_respawn_at(track, length - 1).position));
+  track_free(track);
+}
+
+// Tests that a large field of karts starts on the road without overlapping
+void test_grid_slots() {
+  track_t *track = track_read_text(CALTECH_TRACK);
+  double length = track_get_length(track);
+  size_t num_spawns = track_get_num_spawns(track);
+  size_t num_slots = 64;
+  spawn_t slots[num_slots];
+  for (size_t i = 0; i < num_slots; i++) {
+    slots[i] = track_get_grid_slot(track, i);
+    assert(track_get_distance(track, slots[i].position) > 15);
+    // Rows bunch up a little on the inside of corners
+    for (size_t j = 0; j < i; j++) {
+      assert(vec_get_length(vec_subtract(slots[i].position,
+                                         slots[j].position)) > 40);
+    }
+  }
+  for (size_t i = 0; i < num_spawns; i++) {
+    assert(vec_equal(slots[i].position, track_get_spawn(track, i).position));
+  }
+  // Each row starts one row spacing behind the row in front of it
+  size_t hint = SIZE_MAX;
+  for (size_t i = num_spawns; i < num_slots; i++) {
+    double progress = track_project(track, slots[i].position, &hint);
+    double ahead =
+        track_project(track, slots[i - num_spawns].position, &hint);
+    double gap = fmod(ahead - progress + length, length);
+    assert(within(1, gap, 90));
+  }
+  track_free(track);
+}
+
+// Tests the baked distance field against the track geometry
+void test_track_distance() {
+  track_t *track = track_read_text(CALTECH_TRACK);
+  for (size_t i = 0; i < track_get_num_spawns(track); i++) {
+    assert(track_on_road(track, track_get_spawn(track, i).position));
+  }
+  for (double s = 0; s < track_get_length(track); s += 50) {
+    assert(track_get_distance(track, track_point_at(track, s)) > 0);
+  }
+  // Just behind the middle of every wall is off the road
+  for (size_t i = 0; i < track_get_num_walls(track); i++) {
+    segment_t wall = track_get_wall(track, i);
+    vector_t center =
+        vec_subtract(vec_multiply(0.5, vec_add(wall.start, wall.end)),
+                     vec_multiply(25, wall.normal));
+    assert(!track_on_road(track, center));
+    vector_t nearest = track_nearest_on_road(track, center, 20);
+    assert(track_get_distance(track, nearest) > 19);
+  }
+
+  // Asphalt down the middle of the road, grass on the verge, and the boost
+  // strip on the first straight
+  assert(track_get_surface(track, track_point_at(track, 10)) ==
+         SURFACE_ASPHALT);
+  assert(track_get_surface(track, (vector_t){420, 200}) == SURFACE_GRASS);
+  assert(track_get_surface(track, (vector_t){524, 1280}) == SURFACE_BOOST);
+  track_free(track);
+}
+
+// Tests that the loader caches tracks by path and rejects missing files
+void test_track_cache() {
+  track_t *track = track_load(CALTECH_TRACK);
+  assert(track != NULL);
+  assert(track_load(CALTECH_TRACK) == track);
+  assert(track_load("assets/tracks/missing.trk") == NULL);
+  track_cache_destroy();
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_text_track)
+  DO_TEST(test_classic_track)
+  DO_TEST(test_binary_round_trip)
+  DO_TEST(test_binary_malformed)
+  DO_TEST(test_text_malformed)
+  DO_TEST(test_arc_length)
+  DO_TEST(test_respawn)
+  DO_TEST(test_grid_slots)
+  DO_TEST(test_track_distance)
+  DO_TEST(test_track_cache)
+
+  puts("track_test PASS");
+}
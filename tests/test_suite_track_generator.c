@@ -0,0 +1,107 @@
+#include "test_util.h"
+#include "track_generator.h"
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+const track_params_t SMALL_CIRCUIT = {.length = 6000,
+                                      .corners = 8,
+                                      .width = 220,
+                                      .wobble = 0.6,
+                                      .size = 64,
+                                      .num_checkpoints = 16,
+                                      .num_box_rows = 4,
+                                      .seed = 7};
+
+const track_params_t LARGE_CIRCUIT = {.length = 60000,
+                                      .corners = 40,
+                                      .width = 250,
+                                      .wobble = 0.8,
+                                      .size = 2500,
+                                      .num_checkpoints = 300,
+                                      .num_box_rows = 50,
+                                      .seed = 2024};
+
+// Tests that the circuit has the requested shape
+void test_generate_counts() {
+  track_t *track = track_generate(&SMALL_CIRCUIT);
+  assert(track_get_size(track) == 64);
+  assert(track_get_num_walls(track) == 128);
+  assert(track_get_num_checkpoints(track) == 16);
+  assert(track_get_num_boxes(track) == 12);
+  assert(track_get_num_spawns(track) > 0);
+  // Resampling cuts the corners of the spline slightly
+  assert(fabs(track_get_length(track) - 6000) < 60);
+
+  // The boundaries are the road width apart
+  for (size_t i = 0; i < track_get_size(track); i++) {
+    vector_t gap =
+        vec_subtract(track_get_outer(track)[i], track_get_inner(track)[i]);
+    assert(within(1e-6, vec_get_length(gap), 220));
+  }
+  track_free(track);
+}
+
+// Tests that the same seed produces the same circuit and another does not
+void test_generate_deterministic() {
+  track_t *first = track_generate(&SMALL_CIRCUIT);
+  track_t *second = track_generate(&SMALL_CIRCUIT);
+  track_params_t params = SMALL_CIRCUIT;
+  params.seed = 8;
+  track_t *other = track_generate(&params);
+  bool differs = false;
+  for (size_t i = 0; i < track_get_size(first); i++) {
+    vector_t point = track_get_centerline(first)[i];
+    assert(vec_equal(point, track_get_centerline(second)[i]));
+    differs |= !vec_isclose(point, track_get_centerline(other)[i]);
+  }
+  assert(differs);
+  track_free(first);
+  track_free(second);
+  track_free(other);
+}
+
+// Tests that a long, dense circuit bakes into a drivable track
+void test_generate_large() {
+  track_t *track = track_generate(&LARGE_CIRCUIT);
+  assert(track_get_num_walls(track) == 5000);
+  double length = track_get_length(track);
+
+  for (size_t i = 1; i < track_get_num_checkpoints(track); i++) {
+    double progress = track_get_checkpoint_progress(track, i);
+    assert(progress > track_get_checkpoint_progress(track, i - 1));
+    assert(progress < length);
+  }
+  for (size_t i = 0; i < track_get_num_spawns(track); i++) {
+    assert(track_on_road(track, track_get_spawn(track, i).position));
+  }
+  for (size_t i = 0; i < track_get_num_boxes(track); i++) {
+    assert(track_on_road(track, track_get_boxes(track)[i]));
+  }
+
+  // The centerline is on the road and the hint follows it around the lap
+  size_t hint = SIZE_MAX;
+  for (double s = 0; s < length; s += 97) {
+    vector_t point = track_point_at(track, s);
+    assert(track_get_distance(track, point) > 100);
+    assert(within(1e-6, track_project(track, point, &hint), s));
+  }
+  track_free(track);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_generate_counts)
+  DO_TEST(test_generate_deterministic)
+  DO_TEST(test_generate_large)
+
+  puts("track_generator_test PASS");
+}
@@ -0,0 +1,160 @@
+#include "test_util.h"
+#include "wall_bvh.h"
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+// A 100 x 100 box of walls
+const segment_t BOX_WALLS[] = {{{0, 0}, {100, 0}, {0, 1}},
+                               {{100, 0}, {100, 100}, {-1, 0}},
+                               {{100, 100}, {0, 100}, {0, -1}},
+                               {{0, 100}, {0, 0}, {1, 0}}};
+const size_t NUM_BOX_WALLS = 4;
+const size_t NUM_RANDOM_WALLS = 300;
+const size_t NUM_RANDOM_SWEEPS = 2000;
+
+// Tests hits on the sides of walls, from inside and outside the box
+void test_sides() {
+  wall_bvh_t *bvh = wall_bvh_init(BOX_WALLS, NUM_BOX_WALLS);
+  wall_hit_t hit;
+  assert(wall_bvh_sweep(bvh, (vector_t){50, 50}, (vector_t){50, -50}, 10,
+                        &hit));
+  assert(hit.wall == 0);
+  assert(isclose(hit.time, 0.4));
+  assert(vec_isclose(hit.center, (vector_t){50, 10}));
+  assert(vec_isclose(hit.normal, (vector_t){0, 1}));
+  // From outside, the other side of the wall is touched
+  assert(wall_bvh_sweep(bvh, (vector_t){150, 50}, (vector_t){50, 50}, 10,
+                        &hit));
+  assert(hit.wall == 1);
+  assert(isclose(hit.time, 0.4));
+  assert(vec_isclose(hit.normal, (vector_t){1, 0}));
+  // Stopping short
+  assert(!wall_bvh_sweep(bvh, (vector_t){50, 50}, (vector_t){50, 11}, 10,
+                         &hit));
+  wall_bvh_free(bvh);
+}
+
+// Tests circles that start touching a wall, and the ends of walls
+void test_touching() {
+  wall_bvh_t *bvh = wall_bvh_init(BOX_WALLS, 1);
+  wall_hit_t hit;
+  // Moving in is a hit at once, moving out or along is not
+  assert(wall_bvh_sweep(bvh, (vector_t){50, 5}, (vector_t){50, 0}, 10, &hit));
+  assert(hit.time == 0 && vec_isclose(hit.normal, (vector_t){0, 1}));
+  assert(!wall_bvh_sweep(bvh, (vector_t){50, 5}, (vector_t){50, 50}, 10,
+                         &hit));
+  assert(!wall_bvh_sweep(bvh, (vector_t){50, 5}, (vector_t){90, 5}, 10,
+                         &hit));
+  // Past the end of the wall, the rounded end is touched
+  assert(wall_bvh_sweep(bvh, (vector_t){130, 0}, (vector_t){90, 0}, 10,
+                        &hit));
+  assert(isclose(hit.time, 0.5));
+  assert(vec_isclose(hit.normal, (vector_t){1, 0}));
+  assert(!wall_bvh_sweep(bvh, (vector_t){130, 20}, (vector_t){90, 20}, 10,
+                         &hit));
+  wall_bvh_free(bvh);
+}
+
+double random_coord() { return (double)rand() / RAND_MAX * 1000; }
+
+// Tests that the tree finds the same first hit as testing every wall
+void test_matches_brute_force() {
+  srand(7);
+  segment_t walls[NUM_RANDOM_WALLS];
+  for (size_t i = 0; i < NUM_RANDOM_WALLS; i++) {
+    vector_t start = {random_coord(), random_coord()};
+    vector_t end = vec_add(start, (vector_t){random_coord() / 20 - 25,
+                                             random_coord() / 20 - 25});
+    walls[i] = (segment_t){.start = start, .end = end, .normal = VEC_ZERO};
+  }
+  wall_bvh_t *bvh = wall_bvh_init(walls, NUM_RANDOM_WALLS);
+  size_t hits = 0;
+  for (size_t i = 0; i < NUM_RANDOM_SWEEPS; i++) {
+    vector_t start = {random_coord(), random_coord()};
+    vector_t end = vec_add(start, (vector_t){random_coord() / 5 - 100,
+                                             random_coord() / 5 - 100});
+    double radius = random_coord() / 100;
+    wall_hit_t hit;
+    bool touched = wall_bvh_sweep(bvh, start, end, radius, &hit);
+    double first = INFINITY;
+    for (size_t w = 0; w < NUM_RANDOM_WALLS; w++) {
+      wall_bvh_t *single = wall_bvh_init(&walls[w], 1);
+      wall_hit_t single_hit;
+      if (wall_bvh_sweep(single, start, end, radius, &single_hit)) {
+        first = fmin(first, single_hit.time);
+      }
+      wall_bvh_free(single);
+    }
+    assert(touched == isfinite(first));
+    if (touched) {
+      assert(isclose(hit.time, first));
+      hits++;
+    }
+  }
+  // Enough of the sweeps hit something to mean something
+  assert(hits > NUM_RANDOM_SWEEPS / 10);
+  wall_bvh_free(bvh);
+}
+
+// Tests that a box query finds exactly the walls whose bounding boxes
+// overlap the box
+void test_query() {
+  srand(11);
+  segment_t walls[NUM_RANDOM_WALLS];
+  for (size_t i = 0; i < NUM_RANDOM_WALLS; i++) {
+    vector_t start = {random_coord(), random_coord()};
+    vector_t end = vec_add(start, (vector_t){random_coord() / 20 - 25,
+                                             random_coord() / 20 - 25});
+    walls[i] = (segment_t){.start = start, .end = end, .normal = VEC_ZERO};
+  }
+  wall_bvh_t *bvh = wall_bvh_init(walls, NUM_RANDOM_WALLS);
+  size_t found[NUM_RANDOM_WALLS];
+  for (size_t i = 0; i < NUM_RANDOM_SWEEPS; i++) {
+    vector_t min = {random_coord(), random_coord()};
+    vector_t max = vec_add(min, (vector_t){random_coord() / 10,
+                                           random_coord() / 10});
+    size_t count = wall_bvh_query(bvh, min, max, found, NUM_RANDOM_WALLS);
+    size_t expected = 0;
+    for (size_t w = 0; w < NUM_RANDOM_WALLS; w++) {
+      segment_t wall = walls[w];
+      bool overlaps = fmax(wall.start.x, wall.end.x) >= min.x &&
+                      fmin(wall.start.x, wall.end.x) <= max.x &&
+                      fmax(wall.start.y, wall.end.y) >= min.y &&
+                      fmin(wall.start.y, wall.end.y) <= max.y;
+      if (!overlaps) {
+        continue;
+      }
+      expected++;
+      bool listed = false;
+      for (size_t j = 0; j < count; j++) {
+        listed = listed || found[j] == w;
+      }
+      assert(listed);
+    }
+    assert(count == expected);
+  }
+  // Walls past the room given are counted but not written
+  vector_t everywhere_min = {-100, -100};
+  vector_t everywhere_max = {2000, 2000};
+  assert(wall_bvh_query(bvh, everywhere_min, everywhere_max, found, 1) ==
+         NUM_RANDOM_WALLS);
+  wall_bvh_free(bvh);
+}
+
+int main(int argc, char *argv[]) {
+  // Run all tests if there are no command-line arguments
+  bool all_tests = argc == 1;
+  // Read test name from file
+  char testname[100];
+  if (!all_tests) {
+    read_testname(argv[1], testname, sizeof(testname));
+  }
+
+  DO_TEST(test_sides)
+  DO_TEST(test_touching)
+  DO_TEST(test_matches_brute_force)
+  DO_TEST(test_query)
+
+  puts("wall_bvh_test PASS");
+}